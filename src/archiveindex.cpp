@@ -0,0 +1,1152 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "archiveindex.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <zlib.h>
+#include <lzma.h>
+#include <zstd.h>
+
+namespace ASGenerator
+{
+
+/**
+ * Size of the chunks compressed data is read in.
+ */
+constexpr std::size_t INPUT_CHUNK_SIZE = 65536;
+
+/**
+ * Distance between two GZip checkpoints, in uncompressed bytes.
+ * Every checkpoint stores a 32 KiB window, so this is a tradeoff between
+ * the size of the index and the amount of data decompressed per read.
+ */
+constexpr std::uint64_t GZIP_CHECKPOINT_SPAN = 8 * 1024 * 1024;
+
+/**
+ * Minimum distance between two XZ block or Zstandard frame checkpoints.
+ */
+constexpr std::uint64_t MIN_CHECKPOINT_DISTANCE = 1024 * 1024;
+
+/**
+ * If there is more data than this between two checkpoints, seeking would
+ * not save much work and temporary extraction is the better choice.
+ */
+constexpr std::uint64_t MAX_CHECKPOINT_DISTANCE = 64 * 1024 * 1024;
+
+constexpr std::size_t GZIP_WINDOW_SIZE = 32768;
+constexpr std::size_t TAR_BLOCK_SIZE = 512;
+
+/**
+ * Upper limit for the size of tar extension headers (long names, PAX records).
+ */
+constexpr std::uint64_t MAX_TAR_EXTENSION_SIZE = 1024 * 1024;
+
+constexpr int MAX_LINK_DEPTH = 16;
+
+constexpr std::array<char, 8> INDEX_MAGIC = {'A', 'S', 'G', 'I', 'D', 'X', '0', '1'};
+
+std::string normalizedEntryPath(const std::string &path)
+{
+    return (fs::path("/") / path).lexically_normal().string();
+}
+
+namespace
+{
+
+/**
+ * Buffered reader for the compressed data, which keeps track of the file offset.
+ */
+class InputBuffer
+{
+public:
+    InputBuffer(const fs::path &fname, std::uint64_t offset)
+        : m_file(fname, std::ios::binary),
+          m_buffer(INPUT_CHUNK_SIZE),
+          m_bufferOffset(offset)
+    {
+        if (!m_file)
+            throw std::runtime_error(std::format("Unable to open '{}' for reading", fname.string()));
+        m_file.seekg(static_cast<std::streamoff>(offset));
+        if (!m_file)
+            throw std::runtime_error(std::format("Unable to seek to offset {} in '{}'", offset, fname.string()));
+    }
+
+    /**
+     * Make at least @n bytes available, if the file has that many left.
+     *
+     * @return The number of available bytes.
+     */
+    std::size_t fill(std::size_t n = 1)
+    {
+        if (available() >= n)
+            return available();
+
+        const auto remaining = available();
+        std::memmove(m_buffer.data(), m_buffer.data() + m_pos, remaining);
+        m_bufferOffset += m_pos;
+        m_pos = 0;
+        m_len = remaining;
+        if (m_buffer.size() < n)
+            m_buffer.resize(n);
+
+        while (m_len < n && m_file) {
+            m_file.read(reinterpret_cast<char *>(m_buffer.data() + m_len), m_buffer.size() - m_len);
+            const auto count = m_file.gcount();
+            if (count <= 0)
+                break;
+            m_len += static_cast<std::size_t>(count);
+        }
+
+        return available();
+    }
+
+    const std::uint8_t *data() const
+    {
+        return m_buffer.data() + m_pos;
+    }
+
+    std::size_t available() const
+    {
+        return m_len - m_pos;
+    }
+
+    void consume(std::size_t n)
+    {
+        m_pos += n;
+    }
+
+    /**
+     * File offset of the first byte that was not consumed yet.
+     */
+    std::uint64_t position() const
+    {
+        return m_bufferOffset + m_pos;
+    }
+
+private:
+    std::ifstream m_file;
+    std::vector<std::uint8_t> m_buffer;
+    std::size_t m_pos = 0;
+    std::size_t m_len = 0;
+    std::uint64_t m_bufferOffset = 0;
+};
+
+/**
+ * Decompressor which starts at a checkpoint and produces the uncompressed stream from there on.
+ */
+class PayloadDecoder
+{
+public:
+    virtual ~PayloadDecoder() = default;
+
+    /**
+     * Decompress up to @len bytes into @buf.
+     *
+     * @return The number of bytes written, 0 at the end of the data.
+     */
+    virtual std::size_t read(std::uint8_t *buf, std::size_t len) = 0;
+
+    /**
+     * True if decompression was stopped because the data has no checkpoints
+     * we could seek to. Only happens while recording checkpoints.
+     */
+    bool stoppedEarly() const
+    {
+        return m_stoppedEarly;
+    }
+
+protected:
+    bool m_stoppedEarly = false;
+};
+
+class PlainDecoder : public PayloadDecoder
+{
+public:
+    PlainDecoder(const fs::path &fname, std::uint64_t offset)
+        : m_input(fname, offset)
+    {
+    }
+
+    std::size_t read(std::uint8_t *buf, std::size_t len) override
+    {
+        const auto count = std::min(m_input.fill(len), len);
+        std::memcpy(buf, m_input.data(), count);
+        m_input.consume(count);
+        return count;
+    }
+
+private:
+    InputBuffer m_input;
+};
+
+/**
+ * GZip decompressor which can resume at any deflate block boundary, given the
+ * 32 KiB of data preceding it. This is the approach of zlib's "zran" example.
+ */
+class GzipDecoder : public PayloadDecoder
+{
+public:
+    GzipDecoder(
+        const fs::path &fname,
+        const ArchiveIndex::Checkpoint &cp,
+        std::vector<ArchiveIndex::Checkpoint> *record)
+        : m_input(fname, cp.compressedOffset - (cp.bits > 0 ? 1 : 0)),
+          m_record(record),
+          m_totalOut(cp.uncompressedOffset),
+          m_lastCheckpoint(cp.uncompressedOffset)
+    {
+        m_raw = !cp.streamStart;
+        // 15 + 32 detects the gzip header automatically, negative values select raw deflate data
+        if (inflateInit2(&m_strm, m_raw ? -15 : 15 + 32) != Z_OK)
+            throw std::runtime_error("Unable to initialize GZip decompressor");
+
+        // restore the state of the decompressor at the checkpoint
+        bool restored = true;
+        if (cp.bits > 0) {
+            restored = m_input.fill() >= 1;
+            if (restored) {
+                const int ch = *m_input.data();
+                m_input.consume(1);
+                restored = inflatePrime(&m_strm, cp.bits, ch >> (8 - cp.bits)) == Z_OK;
+            }
+        }
+        if (restored && m_raw)
+            restored = inflateSetDictionary(&m_strm, cp.window.data(), static_cast<uInt>(cp.window.size())) == Z_OK;
+        if (!restored) {
+            inflateEnd(&m_strm);
+            throw std::runtime_error("Unable to restore GZip decompressor state");
+        }
+
+        if (m_record != nullptr)
+            m_window.resize(GZIP_WINDOW_SIZE);
+    }
+
+    ~GzipDecoder() override
+    {
+        inflateEnd(&m_strm);
+    }
+
+    std::size_t read(std::uint8_t *buf, std::size_t len) override
+    {
+        std::size_t produced = 0;
+        while (produced < len && !m_finished) {
+            m_input.fill();
+            const auto availIn = static_cast<uInt>(std::min<std::size_t>(m_input.available(), UINT_MAX));
+            const auto availOut = static_cast<uInt>(std::min<std::size_t>(len - produced, UINT_MAX));
+            m_strm.next_in = const_cast<Bytef *>(m_input.data());
+            m_strm.avail_in = availIn;
+            m_strm.next_out = buf + produced;
+            m_strm.avail_out = availOut;
+
+            // while recording, stop at every block boundary so we can place checkpoints there
+            const int ret = inflate(&m_strm, m_record != nullptr ? Z_BLOCK : Z_NO_FLUSH);
+            const std::size_t consumed = availIn - m_strm.avail_in;
+            const std::size_t count = availOut - m_strm.avail_out;
+            m_input.consume(consumed);
+            if (m_record != nullptr)
+                remember(buf + produced, count);
+            produced += count;
+            m_totalOut += count;
+
+            if (ret == Z_STREAM_END) {
+                nextMember();
+                continue;
+            }
+            if (ret == Z_BUF_ERROR && consumed == 0 && count == 0)
+                throw std::runtime_error("Unexpected end of GZip data");
+            if (ret != Z_OK && ret != Z_BUF_ERROR)
+                throw std::runtime_error(
+                    std::format("Invalid GZip data: {}", m_strm.msg != nullptr ? m_strm.msg : "unknown error"));
+
+            // bit 7 of data_type is set at the end of a block, bit 6 if it was the last one
+            if (m_record != nullptr && (m_strm.data_type & 128) && !(m_strm.data_type & 64)
+                && m_totalOut - m_lastCheckpoint >= GZIP_CHECKPOINT_SPAN) {
+                ArchiveIndex::Checkpoint cp;
+                cp.compressedOffset = m_input.position();
+                cp.uncompressedOffset = m_totalOut;
+                cp.bits = static_cast<std::uint8_t>(m_strm.data_type & 7);
+                cp.window = windowData();
+                m_record->push_back(std::move(cp));
+                m_lastCheckpoint = m_totalOut;
+            }
+        }
+
+        return produced;
+    }
+
+private:
+    InputBuffer m_input;
+    z_stream m_strm{};
+    bool m_raw = false;
+    bool m_finished = false;
+
+    std::vector<ArchiveIndex::Checkpoint> *m_record;
+    std::uint64_t m_totalOut;
+    std::uint64_t m_lastCheckpoint;
+
+    // ring buffer with the most recent uncompressed data, while recording
+    std::vector<std::uint8_t> m_window;
+    std::size_t m_windowPos = 0;
+    bool m_windowFull = false;
+
+    void remember(const std::uint8_t *data, std::size_t len)
+    {
+        if (len >= m_window.size()) {
+            std::memcpy(m_window.data(), data + len - m_window.size(), m_window.size());
+            m_windowPos = 0;
+            m_windowFull = true;
+            return;
+        }
+
+        const auto first = std::min(len, m_window.size() - m_windowPos);
+        std::memcpy(m_window.data() + m_windowPos, data, first);
+        std::memcpy(m_window.data(), data + first, len - first);
+        if (m_windowPos + len >= m_window.size())
+            m_windowFull = true;
+        m_windowPos = (m_windowPos + len) % m_window.size();
+    }
+
+    std::vector<std::uint8_t> windowData() const
+    {
+        if (!m_windowFull)
+            return {m_window.begin(), m_window.begin() + m_windowPos};
+
+        std::vector<std::uint8_t> data(m_window.begin() + m_windowPos, m_window.end());
+        data.insert(data.end(), m_window.begin(), m_window.begin() + m_windowPos);
+        return data;
+    }
+
+    void nextMember()
+    {
+        // a raw deflate stream is followed by the CRC32 and size of the gzip member
+        if (m_raw) {
+            if (m_input.fill(8) < 8)
+                throw std::runtime_error("Unexpected end of GZip data");
+            m_input.consume(8);
+        }
+
+        // anything but another gzip member (usually zero padding) ends the data
+        if (m_input.fill(2) < 2 || m_input.data()[0] != 0x1f || m_input.data()[1] != 0x8b) {
+            m_finished = true;
+            return;
+        }
+
+        inflateReset2(&m_strm, 15 + 32);
+        m_raw = false;
+        if (m_record != nullptr) {
+            ArchiveIndex::Checkpoint cp;
+            cp.compressedOffset = m_input.position();
+            cp.uncompressedOffset = m_totalOut;
+            cp.streamStart = true;
+            m_record->push_back(std::move(cp));
+            m_lastCheckpoint = m_totalOut;
+        }
+    }
+};
+
+/**
+ * XZ decompressor which decodes the whole stream, or starts at the beginning of a block.
+ */
+class XzDecoder : public PayloadDecoder
+{
+public:
+    XzDecoder(const fs::path &fname, const ArchiveIndex::Checkpoint &cp, lzma_check check)
+        : m_input(fname, cp.compressedOffset),
+          m_check(check)
+    {
+        // checkpoints are at block starts, which never are at the very beginning of the file
+        m_blockMode = cp.compressedOffset > 0;
+        if (m_blockMode) {
+            m_finished = !startBlock();
+        } else {
+            if (lzma_stream_decoder(&m_strm, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+                throw std::runtime_error("Unable to initialize XZ decompressor");
+        }
+    }
+
+    ~XzDecoder() override
+    {
+        lzma_end(&m_strm);
+    }
+
+    std::size_t read(std::uint8_t *buf, std::size_t len) override
+    {
+        std::size_t produced = 0;
+        while (produced < len && !m_finished) {
+            m_input.fill();
+            const auto availIn = m_input.available();
+            m_strm.next_in = m_input.data();
+            m_strm.avail_in = availIn;
+            m_strm.next_out = buf + produced;
+            m_strm.avail_out = len - produced;
+
+            const auto ret = lzma_code(&m_strm, availIn == 0 ? LZMA_FINISH : LZMA_RUN);
+            m_input.consume(availIn - m_strm.avail_in);
+            produced = len - m_strm.avail_out;
+
+            if (ret == LZMA_STREAM_END) {
+                m_finished = !m_blockMode || !startBlock();
+                continue;
+            }
+            if (ret != LZMA_OK)
+                throw std::runtime_error(std::format("Invalid XZ data (error {})", static_cast<int>(ret)));
+        }
+
+        return produced;
+    }
+
+private:
+    InputBuffer m_input;
+    lzma_stream m_strm = LZMA_STREAM_INIT;
+    lzma_check m_check;
+    lzma_block m_block{};
+    bool m_blockMode = false;
+    bool m_finished = false;
+
+    /**
+     * Set up decoding of the block at the current position.
+     *
+     * @return False if there are no more blocks in the stream.
+     */
+    bool startBlock()
+    {
+        if (m_input.fill() < 1)
+            throw std::runtime_error("Unexpected end of XZ data");
+        // a zero byte is the index indicator, which follows the last block
+        if (m_input.data()[0] == 0x00)
+            return false;
+
+        std::array<lzma_filter, LZMA_FILTERS_MAX + 1> filters;
+        m_block = lzma_block{};
+        m_block.version = 1;
+        m_block.check = m_check;
+        m_block.filters = filters.data();
+        m_block.header_size = lzma_block_header_size_decode(m_input.data()[0]);
+        if (m_input.fill(m_block.header_size) < m_block.header_size)
+            throw std::runtime_error("Unexpected end of XZ data");
+        if (lzma_block_header_decode(&m_block, nullptr, m_input.data()) != LZMA_OK)
+            throw std::runtime_error("Invalid XZ block header");
+        m_input.consume(m_block.header_size);
+
+        // the decoder refers to the block while decoding, but keeps its own copy of the filter options
+        const auto ret = lzma_block_decoder(&m_strm, &m_block);
+        for (std::size_t i = 0; filters[i].id != LZMA_VLI_UNKNOWN; i++)
+            std::free(filters[i].options);
+        m_block.filters = nullptr;
+        if (ret != LZMA_OK)
+            throw std::runtime_error("Unable to initialize XZ block decoder");
+
+        return true;
+    }
+};
+
+/**
+ * Zstandard decompressor, which can start at any frame boundary.
+ */
+class ZstdDecoder : public PayloadDecoder
+{
+public:
+    ZstdDecoder(
+        const fs::path &fname,
+        const ArchiveIndex::Checkpoint &cp,
+        std::vector<ArchiveIndex::Checkpoint> *record)
+        : m_input(fname, cp.compressedOffset),
+          m_record(record),
+          m_totalOut(cp.uncompressedOffset),
+          m_lastCheckpoint(cp.uncompressedOffset)
+    {
+        m_dctx = ZSTD_createDCtx();
+        if (m_dctx == nullptr)
+            throw std::runtime_error("Unable to initialize Zstandard decompressor");
+        // allow data compressed in long-distance mode
+        ZSTD_DCtx_setParameter(m_dctx, ZSTD_d_windowLogMax, sizeof(std::size_t) == 8 ? 31 : 30);
+    }
+
+    ~ZstdDecoder() override
+    {
+        ZSTD_freeDCtx(m_dctx);
+    }
+
+    std::size_t read(std::uint8_t *buf, std::size_t len) override
+    {
+        std::size_t produced = 0;
+        while (produced < len && !m_finished) {
+            if (m_input.fill() == 0 && m_frameDone) {
+                m_finished = true;
+                break;
+            }
+
+            ZSTD_inBuffer in{m_input.data(), m_input.available(), 0};
+            ZSTD_outBuffer out{buf + produced, len - produced, 0};
+            const auto ret = ZSTD_decompressStream(m_dctx, &out, &in);
+            if (ZSTD_isError(ret))
+                throw std::runtime_error(std::format("Invalid Zstandard data: {}", ZSTD_getErrorName(ret)));
+            m_input.consume(in.pos);
+            produced += out.pos;
+            m_totalOut += out.pos;
+            if (in.pos == 0 && out.pos == 0 && m_input.available() == 0)
+                throw std::runtime_error("Unexpected end of Zstandard data");
+
+            m_frameDone = ret == 0;
+            if (m_record == nullptr)
+                continue;
+
+            if (m_frameDone && m_totalOut - m_lastCheckpoint >= MIN_CHECKPOINT_DISTANCE) {
+                ArchiveIndex::Checkpoint cp;
+                cp.compressedOffset = m_input.position();
+                cp.uncompressedOffset = m_totalOut;
+                m_record->push_back(std::move(cp));
+                m_lastCheckpoint = m_totalOut;
+            } else if (m_totalOut - m_lastCheckpoint > MAX_CHECKPOINT_DISTANCE) {
+                // most likely everything is in a single frame, so there is no point in continuing
+                m_stoppedEarly = true;
+                m_finished = true;
+            }
+        }
+
+        return produced;
+    }
+
+private:
+    InputBuffer m_input;
+    ZSTD_DCtx *m_dctx = nullptr;
+    bool m_frameDone = true;
+    bool m_finished = false;
+
+    std::vector<ArchiveIndex::Checkpoint> *m_record;
+    std::uint64_t m_totalOut;
+    std::uint64_t m_lastCheckpoint;
+};
+
+} // anonymous namespace
+
+static std::unique_ptr<PayloadDecoder> createDecoder(
+    const fs::path &fname,
+    IndexedCompression compression,
+    const ArchiveIndex::Checkpoint &cp,
+    std::uint8_t xzCheck,
+    std::vector<ArchiveIndex::Checkpoint> *record = nullptr)
+{
+    switch (compression) {
+    case IndexedCompression::GZIP:
+        return std::make_unique<GzipDecoder>(fname, cp, record);
+    case IndexedCompression::XZ:
+        return std::make_unique<XzDecoder>(fname, cp, static_cast<lzma_check>(xzCheck));
+    case IndexedCompression::ZSTD:
+        return std::make_unique<ZstdDecoder>(fname, cp, record);
+    case IndexedCompression::NONE:
+        break;
+    }
+
+    return std::make_unique<PlainDecoder>(fname, cp.compressedOffset);
+}
+
+static std::size_t readFully(PayloadDecoder &decoder, std::uint8_t *buf, std::size_t len)
+{
+    std::size_t total = 0;
+    while (total < len) {
+        const auto count = decoder.read(buf + total, len - total);
+        if (count == 0)
+            break;
+        total += count;
+    }
+
+    return total;
+}
+
+static std::uint64_t skipFully(PayloadDecoder &decoder, std::uint64_t len, std::vector<std::uint8_t> &scratch)
+{
+    std::uint64_t total = 0;
+    while (total < len) {
+        const auto count = decoder.read(scratch.data(), std::min<std::uint64_t>(scratch.size(), len - total));
+        if (count == 0)
+            break;
+        total += count;
+    }
+
+    return total;
+}
+
+static std::optional<IndexedCompression> detectCompression(const fs::path &fname)
+{
+    std::ifstream f(fname, std::ios::binary);
+    std::array<std::uint8_t, TAR_BLOCK_SIZE> head{};
+    f.read(reinterpret_cast<char *>(head.data()), head.size());
+    const auto len = static_cast<std::size_t>(f.gcount());
+
+    if (len >= 2 && head[0] == 0x1f && head[1] == 0x8b)
+        return IndexedCompression::GZIP;
+    if (len >= 6 && std::memcmp(head.data(), "\xFD" "7zXZ\x00", 6) == 0)
+        return IndexedCompression::XZ;
+    if (len >= 4 && std::memcmp(head.data(), "\x28\xB5\x2F\xFD", 4) == 0)
+        return IndexedCompression::ZSTD;
+    if (len == TAR_BLOCK_SIZE && std::memcmp(head.data() + 257, "ustar", 5) == 0)
+        return IndexedCompression::NONE;
+
+    return std::nullopt;
+}
+
+static std::int64_t fileMtime(const fs::path &fname)
+{
+    std::error_code ec;
+    const auto mtime = fs::last_write_time(fname, ec);
+    if (ec)
+        return 0;
+    return static_cast<std::int64_t>(mtime.time_since_epoch().count());
+}
+
+/**
+ * Check whether decompression can be resumed close enough to any offset of the data.
+ */
+static bool hasDenseCheckpoints(const std::vector<ArchiveIndex::Checkpoint> &checkpoints, std::uint64_t totalSize)
+{
+    if (checkpoints.empty() || checkpoints.front().uncompressedOffset != 0)
+        return false;
+
+    std::uint64_t previous = 0;
+    for (const auto &cp : checkpoints) {
+        if (cp.uncompressedOffset - previous > MAX_CHECKPOINT_DISTANCE)
+            return false;
+        previous = cp.uncompressedOffset;
+    }
+
+    return totalSize < previous || totalSize - previous <= MAX_CHECKPOINT_DISTANCE;
+}
+
+/**
+ * Read the block list from the index at the end of an XZ file.
+ *
+ * @return False if the file does not consist of a single XZ stream we can read the index of.
+ */
+static bool readXzBlocks(
+    const fs::path &fname,
+    std::uint64_t fileSize,
+    std::vector<ArchiveIndex::Checkpoint> &checkpoints,
+    std::uint64_t &uncompressedSize,
+    std::uint8_t &check)
+{
+    if (fileSize < 2 * LZMA_STREAM_HEADER_SIZE)
+        return false;
+
+    std::ifstream f(fname, std::ios::binary);
+    std::array<std::uint8_t, LZMA_STREAM_HEADER_SIZE> buf;
+    lzma_stream_flags headerFlags;
+    lzma_stream_flags footerFlags;
+
+    f.read(reinterpret_cast<char *>(buf.data()), buf.size());
+    if (!f || lzma_stream_header_decode(&headerFlags, buf.data()) != LZMA_OK)
+        return false;
+    f.seekg(static_cast<std::streamoff>(fileSize - LZMA_STREAM_HEADER_SIZE));
+    f.read(reinterpret_cast<char *>(buf.data()), buf.size());
+    if (!f || lzma_stream_footer_decode(&footerFlags, buf.data()) != LZMA_OK)
+        return false;
+    if (lzma_stream_flags_compare(&headerFlags, &footerFlags) != LZMA_OK)
+        return false;
+    if (footerFlags.backward_size > fileSize - 2 * LZMA_STREAM_HEADER_SIZE)
+        return false;
+
+    std::vector<std::uint8_t> indexData(footerFlags.backward_size);
+    f.seekg(static_cast<std::streamoff>(fileSize - LZMA_STREAM_HEADER_SIZE - footerFlags.backward_size));
+    f.read(reinterpret_cast<char *>(indexData.data()), static_cast<std::streamsize>(indexData.size()));
+    if (!f)
+        return false;
+
+    lzma_index *index = nullptr;
+    std::uint64_t memlimit = UINT64_MAX;
+    std::size_t inPos = 0;
+    if (lzma_index_buffer_decode(&index, &memlimit, nullptr, indexData.data(), &inPos, indexData.size()) != LZMA_OK)
+        return false;
+
+    // concatenated streams or stream padding would make the offsets unreliable
+    const bool singleStream = lzma_index_file_size(index) == fileSize;
+    if (singleStream) {
+        lzma_index_iter iter;
+        lzma_index_iter_init(&iter, index);
+        while (!lzma_index_iter_next(&iter, LZMA_INDEX_ITER_BLOCK)) {
+            if (!checkpoints.empty()
+                && iter.block.uncompressed_file_offset - checkpoints.back().uncompressedOffset
+                       < MIN_CHECKPOINT_DISTANCE)
+                continue;
+
+            ArchiveIndex::Checkpoint cp;
+            cp.compressedOffset = iter.block.compressed_file_offset;
+            cp.uncompressedOffset = iter.block.uncompressed_file_offset;
+            checkpoints.push_back(std::move(cp));
+        }
+        uncompressedSize = lzma_index_uncompressed_size(index);
+        check = static_cast<std::uint8_t>(headerFlags.check);
+    }
+    lzma_index_end(index, nullptr);
+
+    return singleStream;
+}
+
+static std::uint64_t parseTarNumber(const std::uint8_t *field, std::size_t len)
+{
+    // GNU base-256 encoding, used for large values
+    if (field[0] & 0x80) {
+        std::uint64_t value = field[0] & 0x7f;
+        for (std::size_t i = 1; i < len; i++)
+            value = (value << 8) | field[i];
+        return value;
+    }
+
+    std::size_t i = 0;
+    while (i < len && (field[i] == ' ' || field[i] == '\0'))
+        i++;
+    std::uint64_t value = 0;
+    for (; i < len && field[i] >= '0' && field[i] <= '7'; i++)
+        value = value * 8 + (field[i] - '0');
+    return value;
+}
+
+static bool tarChecksumValid(const std::uint8_t *header)
+{
+    std::uint64_t sum = 0;
+    for (std::size_t i = 0; i < TAR_BLOCK_SIZE; i++)
+        sum += (i >= 148 && i < 156) ? ' ' : header[i];
+    return sum == parseTarNumber(header + 148, 8);
+}
+
+static std::string tarString(const std::uint8_t *field, std::size_t len)
+{
+    const auto str = reinterpret_cast<const char *>(field);
+    return std::string(str, strnlen(str, len));
+}
+
+static void parsePaxRecords(const std::string &data, std::unordered_map<std::string, std::string> &records)
+{
+    std::size_t pos = 0;
+    while (pos < data.size()) {
+        // every record is "<length> <key>=<value>\n", with the length covering the whole record
+        const auto space = data.find(' ', pos);
+        if (space == std::string::npos)
+            break;
+        std::size_t recordLen = 0;
+        const auto res = std::from_chars(data.data() + pos, data.data() + space, recordLen);
+        if (res.ec != std::errc() || recordLen <= space - pos + 1 || pos + recordLen > data.size())
+            break;
+
+        const auto record = data.substr(space + 1, pos + recordLen - space - 2);
+        const auto eq = record.find('=');
+        if (eq != std::string::npos)
+            records[record.substr(0, eq)] = record.substr(eq + 1);
+        pos += recordLen;
+    }
+}
+
+/**
+ * Read all tar headers from @decoder and record the position of the member data.
+ *
+ * @return The size of the uncompressed data that was read.
+ */
+static std::uint64_t scanTarMembers(
+    PayloadDecoder &decoder,
+    std::unordered_map<std::string, ArchiveIndex::Entry> &entries)
+{
+    std::array<std::uint8_t, TAR_BLOCK_SIZE> header;
+    std::vector<std::uint8_t> scratch(INPUT_CHUNK_SIZE);
+    std::uint64_t pos = 0;
+
+    std::optional<std::string> longName;
+    std::optional<std::string> longLink;
+    std::unordered_map<std::string, std::string> paxRecords;
+
+    const auto readExtension = [&](std::uint64_t size) {
+        if (size > MAX_TAR_EXTENSION_SIZE)
+            throw std::runtime_error("Tar extension header is too large");
+        std::string data(size, '\0');
+        const auto padded = (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+        if (readFully(decoder, reinterpret_cast<std::uint8_t *>(data.data()), size) < size
+            || skipFully(decoder, padded - size, scratch) < padded - size)
+            throw std::runtime_error("Unexpected end of tar data");
+        pos += padded;
+        return data;
+    };
+
+    while (true) {
+        if (readFully(decoder, header.data(), header.size()) < header.size()) {
+            if (decoder.stoppedEarly())
+                return pos;
+            // some tools omit the end-of-archive marker
+            break;
+        }
+        pos += TAR_BLOCK_SIZE;
+        if (std::all_of(header.begin(), header.end(), [](std::uint8_t b) {
+                return b == 0;
+            }))
+            break;
+        if (!tarChecksumValid(header.data()))
+            throw std::runtime_error("Invalid tar header");
+
+        const char type = static_cast<char>(header[156]);
+        std::uint64_t size = parseTarNumber(&header[124], 12);
+
+        if (type == 'L') {
+            longName = readExtension(size).c_str();
+            continue;
+        }
+        if (type == 'K') {
+            longLink = readExtension(size).c_str();
+            continue;
+        }
+        if (type == 'x') {
+            parsePaxRecords(readExtension(size), paxRecords);
+            continue;
+        }
+        if (type == 'g') {
+            readExtension(size);
+            continue;
+        }
+
+        if (type == 'S' || std::any_of(paxRecords.begin(), paxRecords.end(), [](const auto &rec) {
+                return rec.first.starts_with("GNU.sparse.");
+            }))
+            throw std::runtime_error("Sparse tar members are not supported");
+
+        if (const auto it = paxRecords.find("size"); it != paxRecords.end())
+            std::from_chars(it->second.data(), it->second.data() + it->second.size(), size);
+
+        std::string name;
+        if (longName.has_value()) {
+            name = *longName;
+        } else if (const auto it = paxRecords.find("path"); it != paxRecords.end()) {
+            name = it->second;
+        } else {
+            name = tarString(&header[0], 100);
+            // only POSIX ustar headers have a name prefix, GNU ones use the space for other data
+            if (std::memcmp(&header[257], "ustar\0", 6) == 0) {
+                const auto prefix = tarString(&header[345], 155);
+                if (!prefix.empty())
+                    name = prefix + "/" + name;
+            }
+        }
+
+        std::string linkTarget;
+        if (longLink.has_value())
+            linkTarget = *longLink;
+        else if (const auto it = paxRecords.find("linkpath"); it != paxRecords.end())
+            linkTarget = it->second;
+        else
+            linkTarget = tarString(&header[157], 100);
+
+        longName.reset();
+        longLink.reset();
+        paxRecords.clear();
+
+        if (!name.empty()) {
+            ArchiveIndex::Entry entry;
+            entry.offset = pos;
+            switch (type) {
+            case '0':
+            case '\0':
+            case '7':
+                entry.kind = ArchiveIndex::EntryKind::FILE;
+                entry.size = size;
+                entries[normalizedEntryPath(name)] = std::move(entry);
+                break;
+            case '1':
+                entry.kind = ArchiveIndex::EntryKind::HARDLINK;
+                entry.linkTarget = linkTarget;
+                entries[normalizedEntryPath(name)] = std::move(entry);
+                break;
+            case '2':
+                entry.kind = ArchiveIndex::EntryKind::SYMLINK;
+                entry.linkTarget = linkTarget;
+                entries[normalizedEntryPath(name)] = std::move(entry);
+                break;
+            default:
+                // directories, devices and FIFOs have no data we could read
+                break;
+            }
+        }
+
+        const auto padded = (size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+        if (skipFully(decoder, padded, scratch) < padded) {
+            if (decoder.stoppedEarly())
+                return pos;
+            throw std::runtime_error("Unexpected end of tar data");
+        }
+        pos += padded;
+    }
+
+    return pos;
+}
+
+std::unique_ptr<ArchiveIndex> ArchiveIndex::build(const fs::path &archiveFname)
+{
+    const auto compression = detectCompression(archiveFname);
+    if (!compression.has_value())
+        return nullptr;
+
+    std::unique_ptr<ArchiveIndex> index(new ArchiveIndex());
+    index->m_archiveFname = archiveFname;
+    index->m_archiveSize = fs::file_size(archiveFname);
+    index->m_archiveMtime = fileMtime(archiveFname);
+    index->m_compression = *compression;
+
+    Checkpoint start;
+    start.streamStart = true;
+    index->m_checkpoints.push_back(start);
+
+    std::vector<Checkpoint> *record = nullptr;
+    if (*compression == IndexedCompression::XZ) {
+        // XZ has its own index of blocks, so we know in advance whether seeking is possible
+        std::uint64_t uncompressedSize = 0;
+        index->m_checkpoints.clear();
+        if (!readXzBlocks(
+                archiveFname, index->m_archiveSize, index->m_checkpoints, uncompressedSize, index->m_xzCheck))
+            return nullptr;
+        if (!hasDenseCheckpoints(index->m_checkpoints, uncompressedSize))
+            return nullptr;
+    } else if (*compression != IndexedCompression::NONE) {
+        record = &index->m_checkpoints;
+    }
+
+    auto decoder = createDecoder(archiveFname, *compression, start, index->m_xzCheck, record);
+    const auto totalSize = scanTarMembers(*decoder, index->m_entries);
+    if (decoder->stoppedEarly())
+        return nullptr;
+    if (*compression != IndexedCompression::NONE && !hasDenseCheckpoints(index->m_checkpoints, totalSize))
+        return nullptr;
+
+    return index;
+}
+
+template<typename T>
+static void writeValue(std::ostream &out, const T &value)
+{
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void writeString(std::ostream &out, const std::string &str)
+{
+    writeValue(out, static_cast<std::uint32_t>(str.size()));
+    out.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+template<typename T>
+static bool readValue(std::istream &in, T &value)
+{
+    in.read(reinterpret_cast<char *>(&value), sizeof(T));
+    return static_cast<bool>(in);
+}
+
+static bool readString(std::istream &in, std::string &str)
+{
+    std::uint32_t len = 0;
+    if (!readValue(in, len) || len > MAX_TAR_EXTENSION_SIZE)
+        return false;
+    str.resize(len);
+    in.read(str.data(), len);
+    return static_cast<bool>(in);
+}
+
+void ArchiveIndex::save(const fs::path &indexFname) const
+{
+    const fs::path tmpFname = indexFname.string() + ".tmp";
+    {
+        std::ofstream f(tmpFname, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error(std::format("Unable to write archive index '{}'", tmpFname.string()));
+
+        f.write(INDEX_MAGIC.data(), INDEX_MAGIC.size());
+        writeValue(f, m_archiveSize);
+        writeValue(f, m_archiveMtime);
+        writeValue(f, static_cast<std::uint8_t>(m_compression));
+        writeValue(f, m_xzCheck);
+
+        writeValue(f, static_cast<std::uint64_t>(m_checkpoints.size()));
+        for (const auto &cp : m_checkpoints) {
+            writeValue(f, cp.compressedOffset);
+            writeValue(f, cp.uncompressedOffset);
+            writeValue(f, cp.bits);
+            writeValue(f, static_cast<std::uint8_t>(cp.streamStart));
+            writeValue(f, static_cast<std::uint32_t>(cp.window.size()));
+            f.write(reinterpret_cast<const char *>(cp.window.data()), static_cast<std::streamsize>(cp.window.size()));
+        }
+
+        writeValue(f, static_cast<std::uint64_t>(m_entries.size()));
+        for (const auto &[path, entry] : m_entries) {
+            writeString(f, path);
+            writeValue(f, static_cast<std::uint8_t>(entry.kind));
+            writeValue(f, entry.offset);
+            writeValue(f, entry.size);
+            writeString(f, entry.linkTarget);
+        }
+
+        f.flush();
+        if (!f)
+            throw std::runtime_error(std::format("Unable to write archive index '{}'", tmpFname.string()));
+    }
+
+    fs::rename(tmpFname, indexFname);
+}
+
+std::unique_ptr<ArchiveIndex> ArchiveIndex::load(const fs::path &indexFname, const fs::path &archiveFname)
+{
+    std::ifstream f(indexFname, std::ios::binary);
+    if (!f)
+        return nullptr;
+
+    std::error_code ec;
+    const auto archiveSize = fs::file_size(archiveFname, ec);
+    if (ec)
+        return nullptr;
+
+    std::array<char, INDEX_MAGIC.size()> magic{};
+    f.read(magic.data(), magic.size());
+    if (!f || magic != INDEX_MAGIC)
+        return nullptr;
+
+    std::unique_ptr<ArchiveIndex> index(new ArchiveIndex());
+    index->m_archiveFname = archiveFname;
+    std::uint8_t compression = 0;
+    if (!readValue(f, index->m_archiveSize) || !readValue(f, index->m_archiveMtime) || !readValue(f, compression)
+        || !readValue(f, index->m_xzCheck))
+        return nullptr;
+
+    // the archive was replaced since the index was made
+    if (index->m_archiveSize != archiveSize || index->m_archiveMtime != fileMtime(archiveFname))
+        return nullptr;
+    if (compression > static_cast<std::uint8_t>(IndexedCompression::ZSTD))
+        return nullptr;
+    index->m_compression = static_cast<IndexedCompression>(compression);
+
+    std::uint64_t count = 0;
+    if (!readValue(f, count) || count > archiveSize + 1)
+        return nullptr;
+    index->m_checkpoints.resize(count);
+    for (auto &cp : index->m_checkpoints) {
+        std::uint8_t streamStart = 0;
+        std::uint32_t windowLen = 0;
+        if (!readValue(f, cp.compressedOffset) || !readValue(f, cp.uncompressedOffset) || !readValue(f, cp.bits)
+            || !readValue(f, streamStart) || !readValue(f, windowLen))
+            return nullptr;
+        if (windowLen > GZIP_WINDOW_SIZE || cp.bits > 7)
+            return nullptr;
+        cp.streamStart = streamStart != 0;
+        cp.window.resize(windowLen);
+        f.read(reinterpret_cast<char *>(cp.window.data()), windowLen);
+    }
+
+    if (!readValue(f, count))
+        return nullptr;
+    index->m_entries.reserve(count);
+    for (std::uint64_t i = 0; i < count; i++) {
+        std::string path;
+        std::uint8_t kind = 0;
+        Entry entry;
+        if (!readString(f, path) || !readValue(f, kind) || !readValue(f, entry.offset) || !readValue(f, entry.size)
+            || !readString(f, entry.linkTarget))
+            return nullptr;
+        if (kind > static_cast<std::uint8_t>(EntryKind::HARDLINK))
+            return nullptr;
+        entry.kind = static_cast<EntryKind>(kind);
+        index->m_entries.emplace(std::move(path), std::move(entry));
+    }
+
+    return index;
+}
+
+std::size_t ArchiveIndex::entryCount() const
+{
+    return m_entries.size();
+}
+
+std::size_t ArchiveIndex::checkpointCount() const
+{
+    return m_checkpoints.size();
+}
+
+std::optional<std::vector<std::uint8_t>> ArchiveIndex::readFile(const std::string &fname) const
+{
+    return readFileResolved(normalizedEntryPath(fname), 0);
+}
+
+std::optional<std::vector<std::uint8_t>> ArchiveIndex::readFileResolved(const std::string &fname, int depth) const
+{
+    if (depth > MAX_LINK_DEPTH)
+        return std::nullopt;
+
+    const auto it = m_entries.find(fname);
+    if (it == m_entries.end())
+        return std::nullopt;
+
+    const auto &entry = it->second;
+    switch (entry.kind) {
+    case EntryKind::FILE:
+        return readSpan(entry.offset, entry.size);
+    case EntryKind::HARDLINK:
+        return readFileResolved(normalizedEntryPath(entry.linkTarget), depth + 1);
+    case EntryKind::SYMLINK: {
+        fs::path target = entry.linkTarget;
+        if (!target.is_absolute())
+            target = fs::path(fname).parent_path() / target;
+        return readFileResolved(normalizedEntryPath(target.string()), depth + 1);
+    }
+    }
+
+    return std::nullopt;
+}
+
+std::vector<std::uint8_t> ArchiveIndex::readSpan(std::uint64_t offset, std::uint64_t size) const
+{
+    std::vector<std::uint8_t> data;
+    if (size == 0)
+        return data;
+
+    // uncompressed tarballs can be read at any offset
+    Checkpoint direct;
+    direct.compressedOffset = offset;
+    direct.uncompressedOffset = offset;
+    const Checkpoint *cp = &direct;
+    if (m_compression != IndexedCompression::NONE) {
+        const auto it = std::upper_bound(
+            m_checkpoints.begin(), m_checkpoints.end(), offset, [](std::uint64_t value, const Checkpoint &c) {
+                return value < c.uncompressedOffset;
+            });
+        if (it == m_checkpoints.begin())
+            throw std::runtime_error(std::format("No checkpoint in archive index for offset {}", offset));
+        cp = &*std::prev(it);
+    }
+
+    auto decoder = createDecoder(m_archiveFname, m_compression, *cp, m_xzCheck);
+    std::vector<std::uint8_t> scratch(INPUT_CHUNK_SIZE);
+    const auto skip = offset - cp->uncompressedOffset;
+    if (skipFully(*decoder, skip, scratch) < skip)
+        throw std::runtime_error(std::format("Unexpected end of data in '{}'", m_archiveFname.string()));
+
+    data.resize(size);
+    if (readFully(*decoder, data.data(), size) < size)
+        throw std::runtime_error(std::format("Unexpected end of data in '{}'", m_archiveFname.string()));
+
+    return data;
+}
+
+} // namespace ASGenerator
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <memory>
+#include <unordered_map>
+
+namespace ASGenerator
+{
+
+namespace fs = std::filesystem;
+
+/**
+ * Normalize @path to the absolute form used to compare archive entries.
+ */
+std::string normalizedEntryPath(const std::string &path);
+
+/**
+ * Compression of a tarball that can be indexed for seeking.
+ */
+enum class IndexedCompression : std::uint8_t {
+    NONE,
+    GZIP,
+    XZ,
+    ZSTD
+};
+
+/**
+ * Index of the members of a (compressed) tarball, which allows reading
+ * individual files without decompressing the archive from its beginning.
+ *
+ * The index records the offset of every member's data in the uncompressed
+ * stream, together with checkpoints at which decompression can be resumed:
+ * the block boundaries of XZ streams, the frame boundaries of Zstandard data,
+ * and periodic snapshots of the decompressor state for GZip data.
+ * Reading a file then only decompresses the data between the closest
+ * checkpoint and the end of the file.
+ */
+class ArchiveIndex
+{
+public:
+    enum class EntryKind : std::uint8_t {
+        FILE,
+        SYMLINK,
+        HARDLINK
+    };
+
+    struct Entry {
+        EntryKind kind = EntryKind::FILE;
+        std::uint64_t offset = 0;
+        std::uint64_t size = 0;
+        std::string linkTarget;
+    };
+
+    struct Checkpoint {
+        std::uint64_t compressedOffset = 0;
+        std::uint64_t uncompressedOffset = 0;
+        /// GZip only: bits of the byte before @compressedOffset that belong to the next block
+        std::uint8_t bits = 0;
+        /// GZip only: the checkpoint is at the beginning of a new gzip member
+        bool streamStart = false;
+        /// GZip only: the last 32 KiB of uncompressed data before this checkpoint
+        std::vector<std::uint8_t> window;
+    };
+
+    /**
+     * Create an index for the archive @archiveFname, decompressing it once.
+     *
+     * @return The index, or nullptr if the archive format or its compression
+     *         does not allow seeking to the individual files.
+     */
+    static std::unique_ptr<ArchiveIndex> build(const fs::path &archiveFname);
+
+    /**
+     * Load a previously saved index for @archiveFname from @indexFname.
+     *
+     * @return The index, or nullptr if there is no index or it was made for a different archive.
+     */
+    static std::unique_ptr<ArchiveIndex> load(const fs::path &indexFname, const fs::path &archiveFname);
+
+    /**
+     * Save the index to @indexFname, replacing any existing file atomically.
+     */
+    void save(const fs::path &indexFname) const;
+
+    /**
+     * Read the data of @fname from the archive, following symbolic links and hardlinks.
+     *
+     * @return The file data, or an empty optional if the file is not in the archive.
+     */
+    std::optional<std::vector<std::uint8_t>> readFile(const std::string &fname) const;
+
+    std::size_t entryCount() const;
+    std::size_t checkpointCount() const;
+
+    // Delete copy constructor and assignment operator
+    ArchiveIndex(const ArchiveIndex &) = delete;
+    ArchiveIndex &operator=(const ArchiveIndex &) = delete;
+
+private:
+    ArchiveIndex() = default;
+
+    fs::path m_archiveFname;
+    std::uint64_t m_archiveSize = 0;
+    std::int64_t m_archiveMtime = 0;
+    IndexedCompression m_compression = IndexedCompression::NONE;
+    std::uint8_t m_xzCheck = 0;
+
+    std::vector<Checkpoint> m_checkpoints;
+    // members of the archive, by normalized absolute path
+    std::unordered_map<std::string, Entry> m_entries;
+
+    std::optional<std::vector<std::uint8_t>> readFileResolved(const std::string &fname, int depth) const;
+    std::vector<std::uint8_t> readSpan(std::uint64_t offset, std::uint64_t size) const;
+};
+
+} // namespace ASGenerator
@@ -132,6 +132,7 @@ const std::vector<std::string> &AlpinePackage::contents()
     ArchiveDecompressor ad;
     ad.open(getFilename());
     m_contentsL = ad.readContents();
+    contentsChanged();
 
     return m_contentsL;
 }
@@ -139,6 +140,7 @@ const std::vector<std::string> &AlpinePackage::contents()
 void AlpinePackage::setContents(const std::vector<std::string> &c)
 {
     m_contentsL = c;
+    contentsChanged();
 }
 
 void AlpinePackage::finish()
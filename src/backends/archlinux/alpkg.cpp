@@ -105,6 +105,7 @@ const std::vector<std::string> &ArchPackage::contents()
 void ArchPackage::setContents(const std::vector<std::string> &c)
 {
     m_contentsL = c;
+    contentsChanged();
 }
 
 void ArchPackage::finish()
@@ -46,24 +46,38 @@ void DebPackageLocaleTexts::setSummary(const std::string &text, const std::strin
     summary[locale] = text;
 }
 
+/**
+ * Data of a package that is only needed while its file is open.
+ */
+struct DebPackage::ArchiveState {
+    fs::path tmpDir;
+    ArchiveDecompressor controlArchive;
+    ArchiveDecompressor dataArchive;
+    fs::path localDebFname;
+};
+
 DebPackage::DebPackage(
     const std::string &pname,
     const std::string &pver,
     const std::string &parch,
-    std::shared_ptr<DebPackageLocaleTexts> l10nTexts)
-    : m_pkgname(pname),
-      m_pkgver(pver),
-      m_pkgarch(parch),
-      m_contentsRead(false),
-      m_controlArchive(std::make_unique<ArchiveDecompressor>()),
-      m_dataArchive(std::make_unique<ArchiveDecompressor>())
-{
+    std::shared_ptr<DebPackageLocaleTexts> l10nTexts,
+    std::shared_ptr<StringPool> strings)
+    : m_strings(std::move(strings)),
+      m_fileSize(0),
+      m_installedSize(0),
+      m_contentsRead(false)
+{
+    // a package that is not part of an index gets a small pool of its own
+    if (!m_strings)
+        m_strings = std::make_shared<StringPool>(256);
+    m_pkgname = m_strings->intern(pname);
+    m_pkgver = m_strings->intern(pver);
+    m_pkgarch = m_strings->intern(parch);
+
     if (l10nTexts)
         m_descTexts = std::move(l10nTexts);
     else
         m_descTexts = std::make_shared<DebPackageLocaleTexts>();
-
-    updateTmpDirPath();
 }
 
 DebPackage::~DebPackage()
@@ -73,22 +87,22 @@ DebPackage::~DebPackage()
 
 std::string DebPackage::name() const
 {
-    return m_pkgname;
+    return std::string(m_pkgname);
 }
 
 std::string DebPackage::ver() const
 {
-    return m_pkgver;
+    return std::string(m_pkgver);
 }
 
 std::string DebPackage::arch() const
 {
-    return m_pkgarch;
+    return std::string(m_pkgarch);
 }
 
 std::string DebPackage::maintainer() const
 {
-    return m_pkgmaintainer;
+    return std::string(m_pkgmaintainer);
 }
 
 const std::unordered_map<std::string, std::string> &DebPackage::description() const
@@ -103,28 +117,31 @@ const std::unordered_map<std::string, std::string> &DebPackage::summary() const
 
 void DebPackage::setName(const std::string &s)
 {
-    m_pkgname = s;
+    m_pkgname = m_strings->intern(s);
 }
 
 void DebPackage::setVersion(const std::string &s)
 {
-    m_pkgver = s;
+    m_pkgver = m_strings->intern(s);
 }
 
 void DebPackage::setArch(const std::string &s)
 {
-    m_pkgarch = s;
+    m_pkgarch = m_strings->intern(s);
 }
 
 void DebPackage::setMaintainer(const std::string &maint)
 {
-    m_pkgmaintainer = maint;
+    m_pkgmaintainer = m_strings->intern(maint);
 }
 
 void DebPackage::setFilename(const std::string &fname)
 {
     m_debFname = fname;
-    m_localDebFname.clear();
+
+    std::lock_guard<std::mutex> lock(m_archiveMutex);
+    if (m_archive)
+        m_archive->localDebFname.clear();
 }
 
 void DebPackage::setGst(const GStreamer &gst)
@@ -137,39 +154,94 @@ std::optional<GStreamer> DebPackage::gst() const
     return m_gstreamer;
 }
 
+void DebPackage::setFileSize(std::uint64_t size)
+{
+    m_fileSize = size;
+}
+
+void DebPackage::setInstalledSize(std::uint64_t size)
+{
+    m_installedSize = size;
+}
+
+std::uint64_t DebPackage::fileSize() const
+{
+    return m_fileSize;
+}
+
+std::uint64_t DebPackage::installedSize() const
+{
+    return m_installedSize;
+}
+
+std::uint64_t DebPackage::tempDiskUsage()
+{
+    std::lock_guard<std::mutex> lock(m_archiveMutex);
+    if (!m_archive)
+        return 0;
+
+    std::uint64_t usage = 0;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(m_archive->tmpDir, ec); !ec && it != fs::end(it);
+         it.increment(ec)) {
+        std::error_code sizeEc;
+        const auto size = it->is_regular_file(sizeEc) ? it->file_size(sizeEc) : 0;
+        if (!sizeEc)
+            usage += size;
+    }
+
+    return usage;
+}
+
 std::string DebPackage::getFilename()
 {
-    if (!m_localDebFname.empty())
-        return m_localDebFname;
+    // Several callers (getFileData, extractPackage, ...) hold m_mutex while they call
+    // into openPayloadArchive() -> getFilename().
+    // Acquiring m_mutex again on the same thread would be a self-deadlock, so the archive
+    // state has a dedicated mutex, which also serializes downloading.
+    std::lock_guard<std::mutex> lock(m_archiveMutex);
+    auto &state = archiveState();
+    if (!state.localDebFname.empty())
+        return state.localDebFname;
 
     if (Utils::isRemote(m_debFname)) {
-        // Several callers (getFileData, extractPackage, ...) hold m_mutex while they call
-        // into openPayloadArchive() -> getFilename().
-        // Acquiring m_mutex again on the same thread would be a self-deadlock, so we use
-        // a dedicated mutex for downloading.
-        std::lock_guard<std::mutex> lock(m_downloadMutex);
-        // Re-check after acquiring the lock: another thread may have already downloaded the file.
-        if (!m_localDebFname.empty())
-            return m_localDebFname;
-
         auto &dl = Downloader::get();
-        const fs::path path = m_tmpDir / fs::path(m_debFname).filename();
+        const fs::path path = state.tmpDir / fs::path(m_debFname).filename();
         dl.downloadFile(m_debFname, path.string());
-        m_localDebFname = path;
+        state.localDebFname = path;
 
-        return m_localDebFname;
+        return state.localDebFname;
     } else {
-        m_localDebFname = m_debFname;
+        state.localDebFname = m_debFname;
 
         return m_debFname;
     }
 }
 
-void DebPackage::updateTmpDirPath()
+fs::path DebPackage::tmpDirPath() const
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
     const auto &conf = Config::get();
-    m_tmpDir = conf.getTmpDir() / std::format("{}-{}_{}", name(), ver(), arch());
+    return conf.getTmpDir() / std::format("{}-{}_{}", m_pkgname, m_pkgver, m_pkgarch);
+}
+
+DebPackage::ArchiveState &DebPackage::archiveState()
+{
+    // must be called with m_archiveMutex held
+    if (!m_archive) {
+        m_archive = std::make_unique<ArchiveState>();
+        m_archive->tmpDir = tmpDirPath();
+    }
+
+    return *m_archive;
+}
+
+void DebPackage::updateTmpDirPath()
+{
+    // the temporary directory is determined when the package is opened, so we only
+    // need to update it if that has happened already
+    std::lock_guard<std::mutex> lock(m_archiveMutex);
+    if (m_archive)
+        m_archive->tmpDir = tmpDirPath();
 }
 
 void DebPackage::setDescription(const std::string &text, const std::string &locale)
@@ -195,39 +267,48 @@ std::shared_ptr<DebPackageLocaleTexts> DebPackage::localizedTexts()
 
 ArchiveDecompressor &DebPackage::openPayloadArchive()
 {
-    if (m_dataArchive->isOpen())
-        return *m_dataArchive;
+    // callers hold m_mutex, so the state can not be dropped while we use it
+    ArchiveState *state;
+    {
+        std::lock_guard<std::mutex> lock(m_archiveMutex);
+        state = &archiveState();
+    }
+    if (state->dataArchive.isOpen())
+        return state->dataArchive;
 
     ArchiveDecompressor ad;
     // extract the payload to a temporary location first
     ad.open(getFilename());
-    fs::create_directories(m_tmpDir);
+    fs::create_directories(state->tmpDir);
 
     const std::regex dataRegex(R"(data\.*)");
-    auto files = ad.extractFilesByRegex(dataRegex, m_tmpDir);
+    auto files = ad.extractFilesByRegex(dataRegex, state->tmpDir);
     if (files.empty()) {
         throw std::runtime_error(
             std::format("Unable to find the payload tarball in Debian package: {}", getFilename()));
     }
     const std::string dataArchiveFname = files[0];
 
-    m_dataArchive->open(dataArchiveFname, m_tmpDir / "data");
-    m_dataArchive->setOptimizeRepeatedReads(true);
-    return *m_dataArchive;
+    state->dataArchive.open(dataArchiveFname, state->tmpDir / "data");
+    state->dataArchive.setOptimizeRepeatedReads(true);
+    return state->dataArchive;
 }
 
 void DebPackage::extractPackage(const std::string &dest)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
 
+    auto &pa = openPayloadArchive();
+
     fs::path extractPath = dest;
-    if (extractPath.empty())
-        extractPath = m_tmpDir / name();
+    if (extractPath.empty()) {
+        std::lock_guard<std::mutex> archiveLock(m_archiveMutex);
+        extractPath = m_archive->tmpDir / name();
+    }
 
     if (!fs::exists(extractPath))
         fs::create_directories(extractPath);
 
-    auto &pa = openPayloadArchive();
     pa.extractArchive(extractPath);
 }
 
@@ -235,27 +316,33 @@ ArchiveDecompressor &DebPackage::openControlArchive()
 {
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_controlArchive->isOpen())
-            return *m_controlArchive;
+        std::lock_guard<std::mutex> archiveLock(m_archiveMutex);
+        if (m_archive && m_archive->controlArchive.isOpen())
+            return m_archive->controlArchive;
     }
 
     const auto fname = getFilename();
     std::lock_guard<std::mutex> lock(m_mutex);
+    ArchiveState *state;
+    {
+        std::lock_guard<std::mutex> archiveLock(m_archiveMutex);
+        state = &archiveState();
+    }
 
     ArchiveDecompressor ad;
     // extract the payload to a temporary location first
     ad.open(fname);
-    fs::create_directories(m_tmpDir);
+    fs::create_directories(state->tmpDir);
 
     const std::regex controlRegex(R"(control\.*)");
-    auto files = ad.extractFilesByRegex(controlRegex, m_tmpDir);
+    auto files = ad.extractFilesByRegex(controlRegex, state->tmpDir);
     if (files.empty()) {
-        throw std::runtime_error(std::format("Unable to find control data in Debian package: {}", getFilename()));
+        throw std::runtime_error(std::format("Unable to find control data in Debian package: {}", fname));
     }
     const std::string controlArchiveFname = files[0];
 
-    m_controlArchive->open(controlArchiveFname);
-    return *m_controlArchive;
+    state->controlArchive.open(controlArchiveFname);
+    return state->controlArchive;
 }
 
 std::vector<std::uint8_t> DebPackage::getFileData(const std::string &fname)
@@ -265,6 +352,17 @@ std::vector<std::uint8_t> DebPackage::getFileData(const std::string &fname)
     return pa.readData(fname);
 }
 
+void DebPackage::prefetchFiles(const std::set<std::string> &fnames)
+{
+    if (fnames.empty())
+        return;
+
+    // the data is kept by the payload archive, and served from there by getFileData()
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &pa = openPayloadArchive();
+    pa.readDataBatch(fnames);
+}
+
 const std::vector<std::string> &DebPackage::contents()
 {
     {
@@ -280,6 +378,7 @@ const std::vector<std::string> &DebPackage::contents()
             auto &pa = openPayloadArchive();
             m_contentsL = pa.readContents();
             m_contentsRead = true;
+            contentsChanged();
             return m_contentsL;
         }
     }
@@ -303,6 +402,7 @@ const std::vector<std::string> &DebPackage::contents()
         std::string md5sums(md5sumsData.begin(), md5sumsData.end());
         m_contentsL.clear();
         m_contentsL.reserve(20);
+        m_fileDigests.clear();
 
         const auto lines = Utils::splitString(md5sums, '\n');
         for (const auto &line : lines) {
@@ -315,14 +415,27 @@ const std::vector<std::string> &DebPackage::contents()
             const std::string filename = line.substr(doublespace + 2);
             if (!filename.empty()) {
                 m_contentsL.push_back("/" + filename);
+
+                // keep the checksum too, so we can tell whether a file changed between versions
+                m_fileDigests.emplace(m_contentsL.back(), line.substr(0, doublespace));
             }
         }
 
         m_contentsRead = true;
+        contentsChanged();
         return m_contentsL;
     }
 }
 
+const std::unordered_map<std::string, std::string> &DebPackage::fileDigests()
+{
+    // the checksums are read together with the contents list
+    contents();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_fileDigests;
+}
+
 std::unique_ptr<TagFile> DebPackage::readControlInformation()
 {
     auto &ca = openControlArchive();
@@ -344,27 +457,28 @@ std::unique_ptr<TagFile> DebPackage::readControlInformation()
 void DebPackage::cleanupTemp()
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-
-    if (m_controlArchive->isOpen())
-        m_controlArchive->close();
-    if (m_dataArchive->isOpen())
-        m_dataArchive->close();
-
-    if (m_tmpDir.empty())
+    std::lock_guard<std::mutex> archiveLock(m_archiveMutex);
+    if (!m_archive)
         return;
 
+    if (m_archive->controlArchive.isOpen())
+        m_archive->controlArchive.close();
+    if (m_archive->dataArchive.isOpen())
+        m_archive->dataArchive.close();
+
     try {
-        if (fs::exists(m_tmpDir)) {
-            /* Whenever we delete the temporary directory, we need to
-             * forget about the local file too, since (if it's remote) that
-             * was downloaded into there. */
-            m_localDebFname.clear();
-            fs::remove_all(m_tmpDir);
-        }
+        if (fs::exists(m_archive->tmpDir))
+            fs::remove_all(m_archive->tmpDir);
     } catch (const std::exception &e) {
         // we ignore any error
-        LOG_WARNING(logBackend, "Unable to remove temporary directory: {} ({})", m_tmpDir.string(), e.what());
+        LOG_WARNING(
+            logBackend, "Unable to remove temporary directory: {} ({})", m_archive->tmpDir.string(), e.what());
     }
+
+    /* Drop the archive state until the package is opened again. This also
+     * forgets about the local file, which (if it's remote) was downloaded
+     * into the temporary directory we just removed. */
+    m_archive.reset();
 }
 
 void DebPackage::finish()
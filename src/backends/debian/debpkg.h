@@ -20,6 +20,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <memory>
@@ -28,6 +29,7 @@
 
 #include "../interfaces.h"
 #include "../../utils.h"
+#include "../../stringpool.h"
 #include "tagfile.h"
 
 namespace ASGenerator
@@ -54,6 +56,10 @@ private:
 
 /**
  * Representation of a Debian binary package
+ *
+ * Name, version, architecture and maintainer are interned in a string pool that is
+ * usually shared by all packages of an index. Everything needed to read the package
+ * file is only set up once the package is actually opened.
  */
 class DebPackage : public Package
 {
@@ -62,7 +68,8 @@ public:
         const std::string &pname,
         const std::string &pver,
         const std::string &parch,
-        std::shared_ptr<DebPackageLocaleTexts> l10nTexts = nullptr);
+        std::shared_ptr<DebPackageLocaleTexts> l10nTexts = nullptr,
+        std::shared_ptr<StringPool> strings = nullptr);
     ~DebPackage() override;
 
     // Package interface implementation
@@ -77,6 +84,12 @@ public:
     std::string getFilename() override;
     const std::vector<std::string> &contents() override;
     std::vector<std::uint8_t> getFileData(const std::string &fname) override;
+    void prefetchFiles(const std::set<std::string> &fnames) override;
+    const std::unordered_map<std::string, std::string> &fileDigests() override;
+
+    std::uint64_t fileSize() const override;
+    std::uint64_t installedSize() const override;
+    std::uint64_t tempDiskUsage() override;
 
     void cleanupTemp() override;
     void finish() override;
@@ -90,6 +103,8 @@ public:
     void setMaintainer(const std::string &maint);
     void setFilename(const std::string &fname);
     void setGst(const GStreamer &gst);
+    void setFileSize(std::uint64_t size);
+    void setInstalledSize(std::uint64_t size);
 
     void updateTmpDirPath();
     void setDescription(const std::string &text, const std::string &locale);
@@ -102,26 +117,32 @@ public:
     std::unique_ptr<TagFile> readControlInformation();
 
 private:
-    std::string m_pkgname;
-    std::string m_pkgver;
-    std::string m_pkgarch;
-    std::string m_pkgmaintainer;
+    struct ArchiveState;
+
+    std::shared_ptr<StringPool> m_strings;
+    std::string_view m_pkgname;
+    std::string_view m_pkgver;
+    std::string_view m_pkgarch;
+    std::string_view m_pkgmaintainer;
     std::shared_ptr<DebPackageLocaleTexts> m_descTexts;
     std::optional<GStreamer> m_gstreamer;
+    std::uint64_t m_fileSize;
+    std::uint64_t m_installedSize;
 
     bool m_contentsRead;
     std::vector<std::string> m_contentsL;
-
-    fs::path m_tmpDir;
-    std::unique_ptr<ArchiveDecompressor> m_controlArchive;
-    std::unique_ptr<ArchiveDecompressor> m_dataArchive;
+    std::unordered_map<std::string, std::string> m_fileDigests;
 
     std::string m_debFname;
-    fs::path m_localDebFname;
+    // created when the package file is first opened, dropped by cleanupTemp()
+    std::unique_ptr<ArchiveState> m_archive;
 
     mutable std::mutex m_mutex;
-    mutable std::mutex m_downloadMutex;
+    // guards m_archive, and downloading the package file
+    mutable std::mutex m_archiveMutex;
 
+    fs::path tmpDirPath() const;
+    ArchiveState &archiveState();
     ArchiveDecompressor &openPayloadArchive();
     ArchiveDecompressor &openControlArchive();
 };
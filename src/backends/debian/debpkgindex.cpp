@@ -24,6 +24,7 @@
 #include <regex>
 #include <format>
 #include <execution>
+#include <charconv>
 
 #include "../../config.h"
 #include "../../logging.h"
@@ -36,6 +37,7 @@ namespace ASGenerator
 
 DebianPackageIndex::DebianPackageIndex(const std::string &dir)
     : PackageIndex("debian"),
+      m_strings(std::make_shared<StringPool>()),
       m_rootDir(dir)
 {
     m_pkgCache.clear();
@@ -49,8 +51,12 @@ DebianPackageIndex::DebianPackageIndex(const std::string &dir)
 void DebianPackageIndex::release()
 {
     m_pkgCache.clear();
+    m_translations.clear();
     m_l10nTextIndex.clear();
     m_indexChanged.clear();
+
+    // packages we handed out keep the old pool alive for as long as they need it
+    m_strings = std::make_shared<StringPool>();
 }
 
 std::vector<std::string> DebianPackageIndex::findTranslations(const std::string &suite, const std::string &section)
@@ -102,14 +108,19 @@ std::string DebianPackageIndex::packageDescToAppStreamDesc(const std::vector<std
     return description;
 }
 
-void DebianPackageIndex::loadPackageLongDescs(
-    std::unordered_map<std::string, std::shared_ptr<DebPackage>> &pkgs,
+const DebianPackageIndex::TranslationIndex &DebianPackageIndex::translationsFor(
     const std::string &suite,
     const std::string &section)
 {
+    const std::string id = std::format("{}/{}", suite, section);
+    auto cacheIt = m_translations.find(id);
+    if (cacheIt != m_translations.end())
+        return cacheIt->second;
+
     const auto langs = findTranslations(suite, section);
     LOG_DEBUG(m_log, "Found translations for: {}", Utils::joinStrings(langs, ", "));
 
+    TranslationIndex index;
     for (const auto &lang : langs) {
         std::string fname;
         const std::string fullPath =
@@ -125,49 +136,60 @@ void DebianPackageIndex::loadPackageLongDescs(
         TagFile tagf;
         tagf.open(fname);
 
+        const auto descField = std::format("Description-{}", lang);
         do {
             const auto pkgname = tagf.readField("Package");
-            const auto rawDesc = tagf.readField(std::format("Description-{}", lang));
+            const auto rawDesc = tagf.readField(descField);
             if (pkgname.empty() || rawDesc.empty())
                 continue;
 
-            auto it = pkgs.find(pkgname);
-            if (it == pkgs.end())
-                continue;
-
-            auto pkg = it->second;
-            const std::string textPkgId = std::format("{}/{}", pkg->name(), pkg->ver());
-
-            std::shared_ptr<DebPackageLocaleTexts> l10nTexts;
-            auto l10nIt = m_l10nTextIndex.find(textPkgId);
-            if (l10nIt != m_l10nTextIndex.end()) {
-                // we already fetched this information
-                l10nTexts = l10nIt->second;
-                pkg->setLocalizedTexts(l10nTexts);
-            } else {
-                // read new localizations
-                l10nTexts = pkg->localizedTexts();
-                m_l10nTextIndex[textPkgId] = l10nTexts;
-            }
-
             const auto lines = Utils::splitString(rawDesc, '\n');
             if (lines.size() < 2)
                 continue;
 
-            if (lang == "en")
-                l10nTexts->setSummary(lines[0], "C");
-            l10nTexts->setSummary(lines[0], lang);
-
             // Skip the first line (summary) for description
             std::vector<std::string> descLines(lines.begin() + 1, lines.end());
-            const std::string description = packageDescToAppStreamDesc(descLines);
+            index[pkgname].push_back({lang, lines[0], packageDescToAppStreamDesc(descLines)});
+        } while (tagf.nextSection());
+    }
 
-            if (lang == "en")
-                l10nTexts->setDescription(description, "C");
-            l10nTexts->setDescription(description, lang);
+    return m_translations.emplace(id, std::move(index)).first->second;
+}
 
-            pkg->setLocalizedTexts(std::move(l10nTexts));
-        } while (tagf.nextSection());
+void DebianPackageIndex::loadPackageLongDescs(
+    std::unordered_map<std::string, std::shared_ptr<DebPackage>> &pkgs,
+    const std::string &suite,
+    const std::string &section)
+{
+    // the translations are the same for all architectures, so we only parse them once
+    const auto &translations = translationsFor(suite, section);
+
+    for (auto &[pkgname, pkg] : pkgs) {
+        auto trIt = translations.find(pkgname);
+        if (trIt == translations.end())
+            continue;
+
+        const std::string textPkgId = std::format("{}/{}", pkg->name(), pkg->ver());
+        auto l10nIt = m_l10nTextIndex.find(textPkgId);
+        if (l10nIt != m_l10nTextIndex.end()) {
+            // we already fetched this information
+            pkg->setLocalizedTexts(l10nIt->second);
+            continue;
+        }
+
+        // read new localizations
+        auto l10nTexts = pkg->localizedTexts();
+        m_l10nTextIndex[textPkgId] = l10nTexts;
+        for (const auto &text : trIt->second) {
+            if (text.lang == "en") {
+                l10nTexts->setSummary(text.summary, "C");
+                l10nTexts->setDescription(text.description, "C");
+            }
+            l10nTexts->setSummary(text.summary, text.lang);
+            l10nTexts->setDescription(text.description, text.lang);
+        }
+
+        pkg->setLocalizedTexts(std::move(l10nTexts));
     }
 }
 
@@ -185,7 +207,19 @@ std::shared_ptr<DebPackage> DebianPackageIndex::newPackage(
     const std::string &ver,
     const std::string &arch)
 {
-    return std::make_shared<DebPackage>(name, ver, arch);
+    return std::make_shared<DebPackage>(name, ver, arch, nullptr, m_strings);
+}
+
+/**
+ * Parse the value of a numeric field of a package index, returning 0 if it is missing or invalid.
+ */
+static std::uint64_t parseSizeField(const std::string &value)
+{
+    std::uint64_t size = 0;
+    const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), size);
+    if (ec != std::errc() || ptr != value.data() + value.size())
+        return 0;
+    return size;
 }
 
 std::vector<std::shared_ptr<DebPackage>> DebianPackageIndex::loadPackages(
@@ -222,6 +256,9 @@ std::vector<std::shared_ptr<DebPackage>> DebianPackageIndex::loadPackages(
         auto pkg = newPackage(name, ver, actualArch);
         pkg->setFilename((fs::path(m_rootDir) / fname).string());
         pkg->setMaintainer(tagf.readField("Maintainer"));
+        pkg->setFileSize(parseSizeField(tagf.readField("Size")));
+        // the installed size is given in KiB
+        pkg->setInstalledSize(parseSizeField(tagf.readField("Installed-Size")) * 1024);
 
         if (!rawDesc.empty()) {
             // parse old-style descriptions
@@ -290,7 +327,8 @@ std::vector<std::shared_ptr<Package>> DebianPackageIndex::packagesFor(
     const std::string &arch,
     bool withLongDescs)
 {
-    const std::string id = std::format("{}/{}/{}", suite, section, arch);
+    // sets without long descriptions are cached separately, so they are never handed out in place of full ones
+    const std::string id = std::format("{}/{}/{}{}", suite, section, arch, withLongDescs ? "" : "!short");
     auto it = m_pkgCache.find(id);
     if (it == m_pkgCache.end()) {
         auto pkgs = loadPackages(suite, section, arch, withLongDescs);
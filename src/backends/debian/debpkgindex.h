@@ -57,6 +57,8 @@ public:
 
 protected:
     fs::path m_tmpDir;
+    // strings shared by the packages we load
+    std::shared_ptr<StringPool> m_strings;
 
     /**
      * Convert a Debian package description to a description
@@ -85,12 +87,26 @@ protected:
     std::vector<std::string> findTranslations(const std::string &suite, const std::string &section);
 
 private:
+    /// Summary and description of a package in one language
+    struct TranslatedText {
+        std::string lang;
+        std::string summary;
+        std::string description;
+    };
+    /// Translated texts of all packages of a suite/section, by package name
+    using TranslationIndex = std::unordered_map<std::string, std::vector<TranslatedText>>;
+
     std::string m_rootDir;
     std::unordered_map<std::string, std::vector<std::shared_ptr<Package>>> m_pkgCache;
 
+    // parsed Translation-* files, which are shared by all architectures of a suite/section
+    std::unordered_map<std::string, TranslationIndex> m_translations;
+
     // index of localized text for a specific package name
     std::unordered_map<std::string, std::shared_ptr<DebPackageLocaleTexts>> m_l10nTextIndex;
     std::unordered_map<std::string, bool> m_indexChanged;
+
+    const TranslationIndex &translationsFor(const std::string &suite, const std::string &section);
 };
 
 } // namespace ASGenerator
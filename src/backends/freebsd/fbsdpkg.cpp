@@ -171,6 +171,7 @@ const std::vector<std::string> &FreeBSDPackage::contents()
         }
 
         m_contentsL = ret;
+        contentsChanged();
         return m_contentsL;
     }
 
@@ -178,6 +179,7 @@ const std::vector<std::string> &FreeBSDPackage::contents()
         m_pkgArchive->open(getFilename());
 
     m_contentsL = m_pkgArchive->readContents();
+    contentsChanged();
     return m_contentsL;
 }
 
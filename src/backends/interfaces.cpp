@@ -21,6 +21,9 @@
 
 #include <format>
 #include <algorithm>
+#include <functional>
+
+#include "../utils.h"
 
 namespace ASGenerator
 {
@@ -55,6 +58,38 @@ bool GStreamer::isNotEmpty() const noexcept
         m_decoders.empty() && m_encoders.empty() && m_elements.empty() && m_uriSinks.empty() && m_uriSources.empty());
 }
 
+ContentsIndex::ContentsIndex(std::vector<std::string> contents)
+    : m_files(std::move(contents))
+{
+    std::ranges::sort(m_files);
+}
+
+std::vector<std::string>::const_iterator ContentsIndex::lowerBound(std::string_view value) const
+{
+    return std::ranges::lower_bound(m_files, value, std::less<>{});
+}
+
+bool ContentsIndex::contains(std::string_view fname) const
+{
+    const auto it = lowerBound(fname);
+    return it != m_files.end() && *it == fname;
+}
+
+bool ContentsIndex::containsPrefix(std::string_view prefix) const
+{
+    const auto it = lowerBound(prefix);
+    return it != m_files.end() && it->starts_with(prefix);
+}
+
+std::vector<std::string_view> ContentsIndex::filesWithPrefix(std::string_view prefix) const
+{
+    std::vector<std::string_view> result;
+    for (auto it = lowerBound(prefix); it != m_files.end() && it->starts_with(prefix); ++it)
+        result.emplace_back(*it);
+
+    return result;
+}
+
 PackageKind Package::kind() const noexcept
 {
     return PackageKind::Physical;
@@ -66,6 +101,32 @@ const std::unordered_map<std::string, std::string> &Package::summary() const
     return empty_map;
 }
 
+GBytes *Package::getFileBytes(const std::string &fname)
+{
+    return Utils::bytesFromVector(getFileData(fname));
+}
+
+const std::unordered_map<std::string, std::string> &Package::fileDigests()
+{
+    static const std::unordered_map<std::string, std::string> empty_map;
+    return empty_map;
+}
+
+std::uint64_t Package::fileSize() const
+{
+    return 0;
+}
+
+std::uint64_t Package::installedSize() const
+{
+    return 0;
+}
+
+std::uint64_t Package::tempDiskUsage()
+{
+    return 0;
+}
+
 std::optional<GStreamer> Package::gst() const
 {
     return std::nullopt;
@@ -92,6 +153,26 @@ const std::string &Package::id() const
     return m_pkid;
 }
 
+std::shared_ptr<const ContentsIndex> Package::contentsIndex()
+{
+    // contents() may load the list first, which changes its generation
+    const auto &pkgContents = contents();
+    const auto generation = m_contentsGeneration.load();
+
+    std::lock_guard<std::mutex> lock(m_contentsIndexMutex);
+    if (!m_contentsIndex || m_contentsIndexGeneration != generation) {
+        m_contentsIndex = std::make_shared<const ContentsIndex>(pkgContents);
+        m_contentsIndexGeneration = generation;
+    }
+
+    return m_contentsIndex;
+}
+
+void Package::contentsChanged()
+{
+    m_contentsGeneration++;
+}
+
 bool Package::isValid() const
 {
     return !name().empty() && !ver().empty() && !arch().empty();
@@ -107,6 +188,14 @@ PackageIndex::PackageIndex(const std::string &name)
 {
 }
 
+void PackageIndex::contentsAvailable(
+    std::shared_ptr<ContentsStore> cstore,
+    const std::string &suite,
+    const std::string &section,
+    const std::string &arch)
+{
+}
+
 std::string PackageIndex::dataPrefix() const
 {
     return "/usr";
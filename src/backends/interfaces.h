@@ -19,11 +19,16 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
+#include <set>
 #include <unordered_map>
 #include <optional>
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include <glib.h>
 
 #include "../logging.h"
@@ -43,6 +48,7 @@ inline quill::Logger *getBackendRootLogger()
 }
 
 class DataStore;
+class ContentsStore;
 
 class GStreamer
 {
@@ -98,6 +104,41 @@ enum class PackageKind {
     Fake
 };
 
+/**
+ * Sorted copy of the contents list of a package, which answers whether a file
+ * exists or whether files exist below a directory with a binary search.
+ */
+class ContentsIndex
+{
+public:
+    explicit ContentsIndex(std::vector<std::string> contents);
+
+    /**
+     * Check whether the file @fname is part of the contents.
+     */
+    bool contains(std::string_view fname) const;
+
+    /**
+     * Check whether any file starts with @prefix.
+     * To find files in a directory, @prefix needs to end with a slash.
+     */
+    bool containsPrefix(std::string_view prefix) const;
+
+    /**
+     * All files starting with @prefix, in sorted order.
+     */
+    std::vector<std::string_view> filesWithPrefix(std::string_view prefix) const;
+
+    // Delete copy constructor and assignment operator
+    ContentsIndex(const ContentsIndex &) = delete;
+    ContentsIndex &operator=(const ContentsIndex &) = delete;
+
+private:
+    std::vector<std::string> m_files;
+
+    std::vector<std::string>::const_iterator lowerBound(std::string_view value) const;
+};
+
 /**
  * Represents a distribution package in the generator.
  */
@@ -148,11 +189,59 @@ public:
      */
     virtual const std::vector<std::string> &contents() = 0;
 
+    /**
+     * Sorted index of contents(), for fast lookups of files and directories.
+     * It is built on first use, and built again once the contents list changed.
+     * An index that was handed out stays valid when that happens.
+     */
+    std::shared_ptr<const ContentsIndex> contentsIndex();
+
     /**
      * Obtain data for a specific file in the package.
      */
     virtual std::vector<std::uint8_t> getFileData(const std::string &fname) = 0;
 
+    /**
+     * Obtain data for a specific file in the package as GBytes.
+     * By default, the buffer returned by getFileData() is handed over to the
+     * GBytes without being copied. The caller owns the returned reference.
+     */
+    virtual GBytes *getFileBytes(const std::string &fname);
+
+    /**
+     * Announce that the files @fnames will be requested via getFileData() soon.
+     * Backends may use this to read all of them in one go, instead of looking for
+     * each file in the package separately. Does nothing by default.
+     */
+    virtual void prefetchFiles(const std::set<std::string> &) {}
+
+    /**
+     * Checksums of the payload files of this package, as provided by the package itself.
+     * Key is the filename (in the same form as in contents()), value a hex digest.
+     *
+     * Backends that can not obtain checksums without reading the payload return an
+     * empty map, which is the default.
+     */
+    virtual const std::unordered_map<std::string, std::string> &fileDigests();
+
+    /**
+     * Size of the package file in bytes, as recorded in the package index.
+     * Returns 0 if the index does not tell, which is the default.
+     */
+    virtual std::uint64_t fileSize() const;
+
+    /**
+     * Size of the data the package installs in bytes, as recorded in the package index.
+     * Returns 0 if the index does not tell, which is the default.
+     */
+    virtual std::uint64_t installedSize() const;
+
+    /**
+     * Bytes of temporary data this package currently keeps on disk.
+     * Backends that never write temporary files return 0, which is the default.
+     */
+    virtual std::uint64_t tempDiskUsage();
+
     /**
      * Remove temporary data that might have been created while loading information from
      * this package. This function can be called to avoid excessive use of disk space.
@@ -201,8 +290,20 @@ public:
 protected:
     Package() = default;
 
+    /**
+     * Backends call this whenever the list returned by contents() was filled or replaced.
+     */
+    void contentsChanged();
+
 private:
     mutable std::string m_pkid;
+
+    // bumped whenever the contents list changes
+    std::atomic<std::uint64_t> m_contentsGeneration{0};
+
+    std::mutex m_contentsIndexMutex;
+    std::shared_ptr<const ContentsIndex> m_contentsIndex;
+    std::uint64_t m_contentsIndexGeneration = 0;
 };
 
 /**
@@ -256,6 +357,18 @@ public:
         const std::string &section,
         const std::string &arch) = 0;
 
+    /**
+     * Called once @cstore knows the contents of all packages of the given suite/section/arch
+     * triplet, before any of them are processed. Backends that need files from packages other
+     * than the one being processed can index them here, instead of scanning packages themselves.
+     * The default implementation does nothing.
+     */
+    virtual void contentsAvailable(
+        std::shared_ptr<ContentsStore> cstore,
+        const std::string &suite,
+        const std::string &section,
+        const std::string &arch);
+
     /**
      * Prefix used to search for metadata and icons.
      * Defaults to "/usr".
@@ -122,16 +122,30 @@ void RPMPackage::setSummary(const std::string &text, const std::string &locale)
     m_summ[locale] = text;
 }
 
-std::vector<std::uint8_t> RPMPackage::getFileData(const std::string &fname)
+ArchiveDecompressor &RPMPackage::openArchive()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
     if (!m_archive->isOpen()) {
         const auto pkgFilename = getFilename();
         m_archive->open(pkgFilename, Config::get().getTmpDir() / fs::path(pkgFilename).filename());
         m_archive->setOptimizeRepeatedReads(true);
     }
 
-    return m_archive->readData(fname);
+    return *m_archive;
+}
+
+std::vector<std::uint8_t> RPMPackage::getFileData(const std::string &fname)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return openArchive().readData(fname);
+}
+
+void RPMPackage::prefetchFiles(const std::set<std::string> &fnames)
+{
+    if (fnames.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    openArchive().readDataBatch(fnames);
 }
 
 const std::vector<std::string> &RPMPackage::contents()
@@ -142,6 +156,7 @@ const std::vector<std::string> &RPMPackage::contents()
 void RPMPackage::setContents(const std::vector<std::string> &c)
 {
     m_contentsL = c;
+    contentsChanged();
 }
 
 void RPMPackage::finish()
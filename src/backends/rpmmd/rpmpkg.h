@@ -61,6 +61,7 @@ public:
     void setSummary(const std::string &text, const std::string &locale);
 
     std::vector<std::uint8_t> getFileData(const std::string &fname) override;
+    void prefetchFiles(const std::set<std::string> &fnames) override;
 
     const std::vector<std::string> &contents() override;
     void setContents(const std::vector<std::string> &c);
@@ -81,6 +82,8 @@ private:
     std::unique_ptr<ArchiveDecompressor> m_archive;
 
     mutable std::mutex m_mutex;
+
+    ArchiveDecompressor &openArchive();
 };
 
 } // namespace ASGenerator
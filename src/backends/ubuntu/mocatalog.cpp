@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mocatalog.h"
+
+#include <format>
+#include <stdexcept>
+#include <cstring>
+
+namespace ASGenerator
+{
+
+static constexpr std::uint32_t MoMagic = 0x950412de;
+static constexpr std::uint32_t MoMagicSwapped = 0xde120495;
+
+// size of the fixed part of the header, up to and including the hash table offset
+static constexpr std::size_t MoHeaderSize = 7 * sizeof(std::uint32_t);
+
+/**
+ * The string hash function used by GNU gettext for the hash table of .mo files.
+ */
+static std::uint32_t moHashString(std::string_view str)
+{
+    std::uint32_t hval = 0;
+    for (const auto c : str) {
+        hval <<= 4;
+        hval += static_cast<unsigned char>(c);
+        const std::uint32_t g = hval & (static_cast<std::uint32_t>(0xf) << 28);
+        if (g != 0) {
+            hval ^= g >> 24;
+            hval ^= g;
+        }
+    }
+
+    return hval;
+}
+
+/**
+ * Messages with plural forms are stored as "msgid\0msgid_plural", their singular
+ * form is what we look them up by.
+ */
+static std::string_view firstString(std::string_view str)
+{
+    const auto pos = str.find('\0');
+    return pos == std::string_view::npos ? str : str.substr(0, pos);
+}
+
+MoCatalog::MoCatalog(const fs::path &fname)
+    : m_mfile(nullptr),
+      m_swapped(false),
+      m_nStrings(0),
+      m_origTabOffset(0),
+      m_transTabOffset(0),
+      m_hashTabSize(0),
+      m_hashTabOffset(0)
+{
+    g_autoptr(GError) error = nullptr;
+    m_mfile = g_mapped_file_new(fname.c_str(), FALSE, &error);
+    if (m_mfile == nullptr)
+        throw std::runtime_error(std::format("Unable to map message catalog {}: {}", fname.string(), error->message));
+
+    m_data = std::string_view(g_mapped_file_get_contents(m_mfile), g_mapped_file_get_length(m_mfile));
+    try {
+        parseHeader(fname.string());
+    } catch (...) {
+        g_mapped_file_unref(m_mfile);
+        throw;
+    }
+}
+
+MoCatalog::MoCatalog(std::vector<std::uint8_t> data, const std::string &name)
+    : m_mfile(nullptr),
+      m_ownedData(std::move(data)),
+      m_swapped(false),
+      m_nStrings(0),
+      m_origTabOffset(0),
+      m_transTabOffset(0),
+      m_hashTabSize(0),
+      m_hashTabOffset(0)
+{
+    m_data = std::string_view(reinterpret_cast<const char *>(m_ownedData.data()), m_ownedData.size());
+    parseHeader(name);
+}
+
+MoCatalog::~MoCatalog()
+{
+    if (m_mfile != nullptr)
+        g_mapped_file_unref(m_mfile);
+}
+
+void MoCatalog::parseHeader(const std::string &name)
+{
+    if (m_data.size() < MoHeaderSize)
+        throw std::runtime_error(std::format("Message catalog {} is too small.", name));
+
+    std::uint32_t magic;
+    std::memcpy(&magic, m_data.data(), sizeof(magic));
+    if (magic == MoMagicSwapped)
+        m_swapped = true;
+    else if (magic != MoMagic)
+        throw std::runtime_error(std::format("File {} is not a GNU message catalog.", name));
+
+    // only the major revision number tells us about incompatible changes
+    const auto revision = readU32(4);
+    if ((revision >> 16) > 1)
+        throw std::runtime_error(std::format("Message catalog {} has unsupported revision {}.", name, revision));
+
+    m_nStrings = readU32(8);
+    m_origTabOffset = readU32(12);
+    m_transTabOffset = readU32(16);
+    m_hashTabSize = readU32(20);
+    m_hashTabOffset = readU32(24);
+
+    // every table entry is a length/offset pair
+    const std::uint64_t tableSize = static_cast<std::uint64_t>(m_nStrings) * 8;
+    if (m_origTabOffset + tableSize > m_data.size() || m_transTabOffset + tableSize > m_data.size())
+        throw std::runtime_error(std::format("Message catalog {} is truncated.", name));
+    if (m_hashTabOffset + static_cast<std::uint64_t>(m_hashTabSize) * 4 > m_data.size())
+        m_hashTabSize = 0;
+}
+
+std::uint32_t MoCatalog::readU32(std::size_t offset) const
+{
+    std::uint32_t value;
+    std::memcpy(&value, m_data.data() + offset, sizeof(value));
+    return m_swapped ? GUINT32_SWAP_LE_BE(value) : value;
+}
+
+std::string_view MoCatalog::stringAt(std::uint32_t tableOffset, std::uint32_t index) const
+{
+    const std::size_t entry = tableOffset + static_cast<std::size_t>(index) * 8;
+    const auto length = readU32(entry);
+    const auto offset = readU32(entry + 4);
+
+    // the string is followed by a NUL byte, which is not part of its length
+    if (static_cast<std::uint64_t>(offset) + length >= m_data.size())
+        return {};
+    return m_data.substr(offset, length);
+}
+
+std::uint32_t MoCatalog::size() const
+{
+    return m_nStrings;
+}
+
+std::optional<std::string_view> MoCatalog::lookup(std::string_view msgid) const
+{
+    // the empty message ID is reserved for the catalog header
+    if (msgid.empty() || m_nStrings == 0)
+        return std::nullopt;
+
+    std::optional<std::uint32_t> index;
+    if (m_hashTabSize > 2) {
+        const auto hashVal = moHashString(msgid);
+        const std::uint32_t incr = 1 + (hashVal % (m_hashTabSize - 2));
+        std::uint32_t idx = hashVal % m_hashTabSize;
+
+        // the table is never full, but we do not trust the file to be sane
+        for (std::uint32_t probes = 0; probes < m_hashTabSize; probes++) {
+            auto nstr = readU32(m_hashTabOffset + static_cast<std::size_t>(idx) * 4);
+            if (nstr == 0)
+                break;
+
+            // entries are stored with an offset of one, and may refer to system-dependent
+            // strings that we do not support and that follow the regular ones
+            nstr--;
+            if (nstr < m_nStrings && firstString(stringAt(m_origTabOffset, nstr)) == msgid) {
+                index = nstr;
+                break;
+            }
+
+            if (idx >= m_hashTabSize - incr)
+                idx -= m_hashTabSize - incr;
+            else
+                idx += incr;
+        }
+    } else {
+        // without a hash table we can still rely on the messages being sorted
+        std::uint32_t bottom = 0;
+        std::uint32_t top = m_nStrings;
+        while (bottom < top) {
+            const auto mid = bottom + (top - bottom) / 2;
+            const auto cmp = msgid.compare(firstString(stringAt(m_origTabOffset, mid)));
+            if (cmp < 0) {
+                top = mid;
+            } else if (cmp > 0) {
+                bottom = mid + 1;
+            } else {
+                index = mid;
+                break;
+            }
+        }
+    }
+
+    if (!index.has_value())
+        return std::nullopt;
+
+    const auto translation = firstString(stringAt(m_transTabOffset, *index));
+    if (translation.empty())
+        return std::nullopt;
+    return translation;
+}
+
+} // namespace ASGenerator
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <glib.h>
+
+namespace ASGenerator
+{
+
+namespace fs = std::filesystem;
+
+/**
+ * Read-only view of a compiled GNU gettext message catalog (.mo file).
+ *
+ * The catalog is memory-mapped (or held in memory) and queried in place using its hash table,
+ * so lookups neither allocate nor touch any process-wide locale state.
+ * Instances are immutable once created and can be used from any number of threads.
+ */
+class MoCatalog
+{
+public:
+    /**
+     * Map the catalog at @fname. Throws if the file can not be read or is not a valid catalog.
+     */
+    explicit MoCatalog(const fs::path &fname);
+
+    /**
+     * Use the catalog data @data, as read from an archive. @name is used in error messages.
+     */
+    MoCatalog(std::vector<std::uint8_t> data, const std::string &name);
+    ~MoCatalog();
+
+    /**
+     * Number of messages in this catalog.
+     */
+    std::uint32_t size() const;
+
+    /**
+     * Get the translation of @msgid, if the catalog has one.
+     * The returned view is valid for as long as the catalog exists.
+     */
+    std::optional<std::string_view> lookup(std::string_view msgid) const;
+
+    // Delete copy constructor and assignment operator
+    MoCatalog(const MoCatalog &) = delete;
+    MoCatalog &operator=(const MoCatalog &) = delete;
+
+private:
+    GMappedFile *m_mfile;
+    std::vector<std::uint8_t> m_ownedData;
+    std::string_view m_data;
+    bool m_swapped;
+
+    std::uint32_t m_nStrings;
+    std::uint32_t m_origTabOffset;
+    std::uint32_t m_transTabOffset;
+    std::uint32_t m_hashTabSize;
+    std::uint32_t m_hashTabOffset;
+
+    void parseHeader(const std::string &name);
+    std::uint32_t readU32(std::size_t offset) const;
+    std::string_view stringAt(std::uint32_t tableOffset, std::uint32_t index) const;
+};
+
+} // namespace ASGenerator
@@ -21,257 +21,271 @@
 #include "ubupkg.h"
 
 #include <filesystem>
-#include <fstream>
 #include <format>
 #include <algorithm>
-#include <execution>
-#include <clocale>
-#include <cstring>
-#include <libintl.h>
+#include <map>
+#include <set>
 #include <unordered_set>
 
-#include <tbb/parallel_for.h>
-#include <tbb/blocked_range.h>
-
 #include "../../logging.h"
 #include "../../utils.h"
+#include "../../contentsstore.h"
 
 namespace ASGenerator
 {
 
-LanguagePackProvider::LanguagePackProvider(const fs::path &globalTmpDir)
-    : m_globalTmpDir(globalTmpDir),
-      m_langpackDir(globalTmpDir / "langpacks"),
-      m_localeDir(m_langpackDir / "locales")
+LanguagePackProvider::LanguagePackProvider()
+    : m_catalogCache(std::make_shared<const CatalogCache>()),
+      m_useClock(0)
 {
-    g_autofree gchar *localedefExe = g_find_program_in_path("localedef");
-    if (localedefExe)
-        m_localedefExe = localedefExe;
-    if (m_localedefExe.empty())
-        LOG_WARNING(logBackend, "localedef executable not found in PATH");
 }
 
 void LanguagePackProvider::addLanguagePacks(const std::vector<std::shared_ptr<UbuntuPackage>> &langpacks)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_langpacks.insert(m_langpacks.end(), langpacks.begin(), langpacks.end());
+    for (const auto &pkg : langpacks) {
+        if (m_langpackOrder.contains(pkg->id()))
+            continue;
+        m_langpackOrder.emplace(pkg->id(), m_langpackOrder.size());
+        m_langpacks.push_back(pkg);
+    }
 }
 
 void LanguagePackProvider::clear()
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    m_langpacks.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_langpacks.clear();
+        m_indexedPkids.clear();
+        m_langpackOrder.clear();
+        m_catalogIndex.clear();
+    }
+
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_catalogCache.store(std::make_shared<const CatalogCache>());
 }
 
-void LanguagePackProvider::extractLangpacks()
+void LanguagePackProvider::addToIndex(const std::shared_ptr<UbuntuPackage> &pkg, const std::vector<std::string> &files)
 {
-    if (fs::exists(m_langpackDir))
-        return; // Already extracted
+    static const std::string catalogDir = "/usr/share/locale-langpack/";
+    static const std::string_view messagesDir = "/LC_MESSAGES/";
 
-    std::unordered_set<std::string> extracted;
+    const auto orderIt = m_langpackOrder.find(pkg->id());
+    const auto order = orderIt != m_langpackOrder.end() ? orderIt->second : m_langpackOrder.size();
 
-    fs::create_directories(m_langpackDir);
+    // catalogs are named /usr/share/locale-langpack/<locale>/LC_MESSAGES/<domain>.mo
+    for (const auto &fname : files) {
+        if (!fname.starts_with(catalogDir) || !fname.ends_with(".mo"))
+            continue;
 
-    for (auto &pkg : m_langpacks) {
-        if (extracted.contains(pkg->name()))
+        const auto localeEnd = fname.find('/', catalogDir.length());
+        if (localeEnd == std::string::npos || fname.compare(localeEnd, messagesDir.length(), messagesDir) != 0)
+            continue;
+        const auto domainStart = localeEnd + messagesDir.length();
+        if (fname.find('/', domainStart) != std::string::npos)
             continue;
 
-        LOG_DEBUG(logBackend, "Extracting {}", pkg->name());
-        pkg->extractPackage(m_langpackDir);
-        extracted.insert(pkg->name());
+        auto locale = fname.substr(catalogDir.length(), localeEnd - catalogDir.length());
+        auto domain = fname.substr(domainStart, fname.length() - domainStart - 3);
+
+        // Like with extracting all language packs in order, later packages win. Packages
+        // are not necessarily indexed in that order, so we have to check.
+        auto &locations = m_catalogIndex[std::move(domain)];
+        const auto it = locations.find(locale);
+        if (it == locations.end())
+            locations.emplace(std::move(locale), CatalogLocation{pkg, fname, order});
+        else if (it->second.order <= order)
+            it->second = CatalogLocation{pkg, fname, order};
     }
 
-    fs::create_directories(m_localeDir);
-
-    if (extracted.empty()) {
-        LOG_WARNING(logBackend, "We have extracted no language packs for this repository!");
-        m_langpackLocales.clear();
-        m_langpacks.clear();
-        return;
-    }
+    m_indexedPkids.insert(pkg->id());
+}
 
-    // Process supported locales
-    const auto supportedDir = m_langpackDir / "var" / "lib" / "locales" / "supported.d";
-    if (!fs::exists(supportedDir)) {
-        LOG_WARNING(logBackend, "No supported locales directory found in language packs");
+void LanguagePackProvider::indexCatalogs(ContentsStore &cstore)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_langpacks.empty())
         return;
-    }
 
-    // Collect all locale files first
-    std::vector<fs::path> localeFiles;
-    for (const auto &entry : fs::directory_iterator(supportedDir)) {
-        if (entry.is_regular_file())
-            localeFiles.push_back(entry.path());
-    }
-
-    // Process locale files in parallel (batch size of 5)
-    tbb::parallel_for(
-        tbb::blocked_range<std::size_t>(0, localeFiles.size(), 5),
-        [&](const tbb::blocked_range<std::size_t> &range) {
-            for (std::size_t i = range.begin(); i != range.end(); ++i) {
-                const auto &localeFile = localeFiles[i];
-                std::ifstream file(localeFile);
-                std::string line;
-
-                while (std::getline(file, line)) {
-                    line = Utils::trimString(line);
-                    if (line.empty())
-                        continue;
-
-                    const auto components = Utils::splitString(line, ' ');
-                    if (components.size() < 2)
-                        continue;
-
-                    const auto localeCharset = Utils::splitString(components[0], '.');
-                    if (localeCharset.empty())
-                        continue;
-
-                    const auto outdir = fs::path(m_localeDir) / components[0];
-                    if (m_localedefExe.empty()) {
-                        LOG_WARNING(
-                            logBackend, "Not generating locale {}: The localedef binary is missing.", components[0]);
-                        continue;
-                    }
-                    LOG_DEBUG(logBackend, "Generating locale in {}", outdir.string());
-
-                    // Execute localedef to generate locale
-                    std::vector<std::string> args = {
-                        m_localedefExe,
-                        "--no-archive",
-                        "-i",
-                        localeCharset[0],
-                        "-c",
-                        "-f",
-                        components[1],
-                        outdir.string()};
-
-                    // Convert to char* array for g_spawn_sync
-                    std::vector<char *> argv;
-                    argv.reserve(args.size() + 1);
-                    for (auto &arg : args)
-                        argv.push_back(arg.data());
-                    argv.push_back(nullptr);
-
-                    g_autoptr(GError) error = nullptr;
-                    gint exit_status = 0;
-                    gboolean success = g_spawn_sync(
-                        nullptr,         // working_directory
-                        argv.data(),     // argv
-                        nullptr,         // envp
-                        G_SPAWN_DEFAULT, // flags
-                        nullptr,         // child_setup
-                        nullptr,         // user_data
-                        nullptr,         // standard_output
-                        nullptr,         // standard_error
-                        &exit_status,    // exit_status
-                        &error           // error
-                    );
-
-                    if (!success || exit_status != 0) {
-                        if (error)
-                            LOG_DEBUG(
-                                logBackend,
-                                "Failed to generate locale for {}: {}",
-                                components[0],
-                                std::string{error->message});
-                        else
-                            LOG_DEBUG(
-                                logBackend,
-                                "Failed to generate locale for {} (exit status: {})",
-                                components[0],
-                                static_cast<int>(exit_status));
-                    }
-                }
-            }
-        },
-        tbb::static_partitioner{});
+    std::vector<std::string> pkids;
+    pkids.reserve(m_langpacks.size());
+    for (const auto &pkg : m_langpacks)
+        pkids.push_back(pkg->id());
 
-    // Clear langpacks as we don't need them in memory anymore after extraction
-    m_langpacks.clear();
+    // the contents store knows about all catalog files already, since they are locale data
+    const auto localeMap = cstore.getLocaleMap(pkids);
+    std::unordered_map<std::string, std::vector<std::string>> filesByPkid;
+    for (const auto &[fname, pkid] : localeMap)
+        filesByPkid[pkid].push_back(fname);
 
-    // Collect available locales
-    if (m_langpackLocales.empty() && fs::exists(m_localeDir)) {
-        for (const auto &entry : fs::directory_iterator(m_localeDir)) {
-            if (entry.is_directory())
-                m_langpackLocales.push_back(entry.path().filename().string());
+    std::vector<std::shared_ptr<UbuntuPackage>> remaining;
+    for (const auto &pkg : m_langpacks) {
+        if (m_indexedPkids.contains(pkg->id()))
+            continue;
+        if (!cstore.packageExists(pkg->id())) {
+            remaining.push_back(pkg);
+            continue;
         }
+
+        const auto it = filesByPkid.find(pkg->id());
+        addToIndex(pkg, it != filesByPkid.end() ? it->second : std::vector<std::string>{});
     }
+
+    LOG_DEBUG(logBackend, "Indexed message catalogs of {} domains", m_catalogIndex.size());
+    m_langpacks = std::move(remaining);
 }
 
-std::unordered_map<std::string, std::string> LanguagePackProvider::getTranslationsPrivate(
-    const std::string &domain,
-    const std::string &text)
+std::shared_ptr<const LanguagePackProvider::DomainCatalogs> LanguagePackProvider::catalogsForDomain(
+    const std::string &domain)
 {
-    // Store original environment variables
-    std::unordered_map<std::string, std::string> originalEnv;
-    static const std::vector<std::string> envVars = {"LC_ALL", "LANG", "LANGUAGE", "LC_MESSAGES"};
-
-    for (const auto &var : envVars) {
-        const char *value = std::getenv(var.c_str());
-        if (value) {
-            originalEnv[var] = value;
-            unsetenv(var.c_str());
+    // fast path: the domain is cached already
+    {
+        const auto cache = m_catalogCache.load();
+        const auto it = cache->find(domain);
+        if (it != cache->end()) {
+            it->second->lastUse.store(m_useClock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+            return it->second->catalogs;
         }
     }
 
-    // Restore environment on exit
-    auto restoreEnv = [&originalEnv]() {
-        for (const auto &[key, value] : originalEnv)
-            setenv(key.c_str(), value.c_str(), 1);
-    };
+    std::promise<std::shared_ptr<const DomainCatalogs>> promise;
+    {
+        std::unique_lock<std::mutex> lock(m_cacheMutex);
 
-    // Set locale path
-    setenv("LOCPATH", m_localeDir.c_str(), 1);
+        // another thread may have been faster loading this domain, or is loading it right now
+        const auto cache = m_catalogCache.load();
+        const auto it = cache->find(domain);
+        if (it != cache->end()) {
+            it->second->lastUse.store(m_useClock.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+            return it->second->catalogs;
+        }
 
-    // Store original locale
-    const char *originalLocale = setlocale(LC_ALL, "");
-    std::string origLocaleStr = originalLocale ? originalLocale : "C";
+        const auto loadingIt = m_catalogsLoading.find(domain);
+        if (loadingIt != m_catalogsLoading.end()) {
+            auto loading = loadingIt->second;
+            lock.unlock();
+            return loading.get();
+        }
 
-    const auto translationDir = m_langpackDir / "usr" / "share" / "locale-langpack";
-    std::unordered_map<std::string, std::string> result;
+        m_catalogsLoading.emplace(domain, promise.get_future().share());
+    }
 
-    for (const auto &locale : m_langpackLocales) {
-        setlocale(LC_ALL, locale.c_str());
-        bindtextdomain(domain.c_str(), translationDir.c_str());
+    std::shared_ptr<const DomainCatalogs> catalogs;
+    try {
+        catalogs = loadCatalogs(domain);
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(m_cacheMutex);
+            m_catalogsLoading.erase(domain);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
 
-        const char *translatedText = dgettext(domain.c_str(), text.c_str());
+    {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+
+        auto cache = std::make_shared<CatalogCache>(*m_catalogCache.load());
+        while (cache->size() >= MaxCachedDomains) {
+            // evict the least recently used domain - catalogs still in use elsewhere
+            // stay alive until they are no longer needed
+            const auto victim = std::ranges::min_element(*cache, {}, [](const auto &entry) {
+                return entry.second->lastUse.load(std::memory_order_relaxed);
+            });
+            cache->erase(victim);
+        }
+        cache->insert_or_assign(
+            domain,
+            std::make_shared<const CachedCatalogs>(
+                catalogs, m_useClock.fetch_add(1, std::memory_order_relaxed)));
 
-        if (translatedText && text != translatedText)
-            result[locale] = translatedText;
+        m_catalogCache.store(std::move(cache));
+        m_catalogsLoading.erase(domain);
     }
+    promise.set_value(catalogs);
 
-    // Restore original locale
-    setlocale(LC_ALL, origLocaleStr.c_str());
+    return catalogs;
+}
 
-    // Restore environment
-    restoreEnv();
+std::shared_ptr<const LanguagePackProvider::DomainCatalogs> LanguagePackProvider::loadCatalogs(
+    const std::string &domain)
+{
+    std::vector<std::pair<std::string, CatalogLocation>> locations;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // index language packs nobody told us the contents of
+        for (const auto &pkg : m_langpacks) {
+            if (!m_indexedPkids.contains(pkg->id()))
+                addToIndex(pkg, pkg->contents());
+        }
+        m_langpacks.clear();
 
-    return result;
+        const auto it = m_catalogIndex.find(domain);
+        if (it != m_catalogIndex.end())
+            locations.assign(it->second.begin(), it->second.end());
+    }
+
+    // Read only the catalogs of this domain, straight from the language pack archives. Small
+    // archives have no seek index, so we fetch all members we need from a pack in one pass.
+    std::map<std::shared_ptr<UbuntuPackage>, std::vector<std::pair<std::string, std::string>>> localesByPack;
+    for (const auto &[locale, location] : locations)
+        localesByPack[location.pkg].emplace_back(locale, location.fname);
+
+    auto catalogs = std::make_shared<DomainCatalogs>();
+    catalogs->reserve(locations.size());
+
+    // one load must not clean up a language pack another one is still reading from
+    std::lock_guard<std::mutex> readLock(m_readMutex);
+    for (const auto &[pkg, members] : localesByPack) {
+        std::set<std::string> fnames;
+        for (const auto &member : members)
+            fnames.insert(member.second);
+
+        try {
+            pkg->prefetchFiles(fnames);
+        } catch (const std::exception &e) {
+            LOG_WARNING(logBackend, "Unable to read message catalogs of {}: {}", pkg->id(), e.what());
+        }
+
+        for (const auto &[locale, fname] : members) {
+            try {
+                auto data = pkg->getFileData(fname);
+                catalogs->emplace_back(locale, std::make_shared<MoCatalog>(std::move(data), fname));
+            } catch (const std::exception &e) {
+                LOG_WARNING(logBackend, "Ignoring message catalog {} of {}: {}", fname, pkg->id(), e.what());
+            }
+        }
+
+        // we have everything in memory now, drop the extracted payload
+        pkg->cleanupTemp();
+    }
+    LOG_DEBUG(logBackend, "Loaded {} message catalogs for domain {}", catalogs->size(), domain);
+
+    return catalogs;
 }
 
 std::unordered_map<std::string, std::string> LanguagePackProvider::getTranslations(
     const std::string &domain,
     const std::string &text)
 {
-    // this functions does nasty things like changing environment variables and
-    // messing with other global state. We therefore need to ensure that nothing
-    // else is running in parallel
-    static std::mutex global_translation_mutex;
-    std::lock_guard<std::mutex> globalLock(global_translation_mutex);
-
-    // Also lock the instance to prevent concurrent modification of langpacks
-    std::lock_guard<std::mutex> instanceLock(m_mutex);
+    std::unordered_map<std::string, std::string> result;
+    for (const auto &[locale, catalog] : *catalogsForDomain(domain)) {
+        const auto translation = catalog->lookup(text);
+        if (translation.has_value() && *translation != text)
+            result.emplace(locale, *translation);
+    }
 
-    extractLangpacks();
-    return getTranslationsPrivate(domain, text);
+    return result;
 }
 
 UbuntuPackage::UbuntuPackage(
     const std::string &pname,
     const std::string &pver,
     const std::string &parch,
-    std::shared_ptr<DebPackageLocaleTexts> l10nTexts)
-    : DebPackage(pname, pver, parch, std::move(l10nTexts))
+    std::shared_ptr<DebPackageLocaleTexts> l10nTexts,
+    std::shared_ptr<StringPool> strings)
+    : DebPackage(pname, pver, parch, std::move(l10nTexts), std::move(strings))
 {
 }
 
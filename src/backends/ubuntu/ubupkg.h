@@ -23,44 +23,101 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <future>
 #include <glib.h>
 
 #include "../debian/debpkg.h"
+#include "mocatalog.h"
 
 namespace ASGenerator
 {
 
+class ContentsStore;
 class UbuntuPackage;
 
 /**
  * A helper class that provides functions to work with language packs
  * used in Ubuntu.
+ *
+ * Message catalogs are read straight from the language pack archives when a
+ * translation domain is first needed, and the most recently loaded ones are kept in memory.
  */
 class LanguagePackProvider
 {
 public:
-    explicit LanguagePackProvider(const fs::path &globalTmpDir);
+    /// maximum number of translation domains we keep the catalogs of in memory
+    static constexpr std::size_t MaxCachedDomains = 32;
+
+    LanguagePackProvider();
 
     void addLanguagePacks(const std::vector<std::shared_ptr<UbuntuPackage>> &langpacks);
     void clear();
+
+    /**
+     * Learn which language pack ships which message catalog, using the contents
+     * information in @cstore. Language packs that are not indexed here by the time
+     * their translations are needed get indexed from their own contents list.
+     */
+    void indexCatalogs(ContentsStore &cstore);
+
     std::unordered_map<std::string, std::string> getTranslations(const std::string &domain, const std::string &text);
 
 private:
+    /**
+     * Message catalogs of one translation domain, by the locale they provide translations for.
+     */
+    using DomainCatalogs = std::vector<std::pair<std::string, std::shared_ptr<const MoCatalog>>>;
+
+    /**
+     * Where to find the catalog of a domain for a locale.
+     */
+    struct CatalogLocation {
+        std::shared_ptr<UbuntuPackage> pkg;
+        std::string fname;
+        /// position of the language pack in the order they were added in
+        std::size_t order;
+    };
+
+    /**
+     * Catalogs of a cached domain, with the last time they were asked for.
+     */
+    struct CachedCatalogs {
+        std::shared_ptr<const DomainCatalogs> catalogs;
+        mutable std::atomic<std::uint64_t> lastUse;
+    };
+
+    using CatalogCache = std::unordered_map<std::string, std::shared_ptr<const CachedCatalogs>>;
+
+    // language packs whose catalogs we have not indexed yet
     std::vector<std::shared_ptr<UbuntuPackage>> m_langpacks;
-    fs::path m_globalTmpDir;
-    fs::path m_langpackDir;
-    fs::path m_localeDir;
-    std::string m_localedefExe;
-    std::vector<std::string> m_langpackLocales;
+    std::unordered_set<std::string> m_indexedPkids;
+    // position of every language pack in the order they were added in, by package ID
+    std::unordered_map<std::string, std::size_t> m_langpackOrder;
+
+    // domain -> locale -> catalog location
+    std::unordered_map<std::string, std::unordered_map<std::string, CatalogLocation>> m_catalogIndex;
 
     mutable std::mutex m_mutex;
 
-    void extractLangpacks();
-    std::unordered_map<std::string, std::string> getTranslationsPrivate(
-        const std::string &domain,
-        const std::string &text);
+    // Catalogs of the most recently used domains. Lookups only read the current snapshot,
+    // which is replaced as a whole when a domain is loaded or evicted.
+    std::atomic<std::shared_ptr<const CatalogCache>> m_catalogCache;
+    // ticks on every lookup, to find the least recently used domain when evicting
+    std::atomic<std::uint64_t> m_useClock;
+    // domains that are being loaded right now
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const DomainCatalogs>>> m_catalogsLoading;
+    std::mutex m_cacheMutex;
+    // held while reading catalogs from the language packs
+    std::mutex m_readMutex;
+
+    void addToIndex(const std::shared_ptr<UbuntuPackage> &pkg, const std::vector<std::string> &files);
+    std::shared_ptr<const DomainCatalogs> catalogsForDomain(const std::string &domain);
+    std::shared_ptr<const DomainCatalogs> loadCatalogs(const std::string &domain);
 };
 
 /**
@@ -73,7 +130,8 @@ public:
         const std::string &pname,
         const std::string &pver,
         const std::string &parch,
-        std::shared_ptr<DebPackageLocaleTexts> l10nTexts = nullptr);
+        std::shared_ptr<DebPackageLocaleTexts> l10nTexts = nullptr,
+        std::shared_ptr<StringPool> strings = nullptr);
 
     void setLanguagePackProvider(std::shared_ptr<LanguagePackProvider> provider);
 
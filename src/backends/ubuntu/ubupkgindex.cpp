@@ -30,13 +30,13 @@ UbuntuPackageIndex::UbuntuPackageIndex(const std::string &dir)
     : DebianPackageIndex(dir)
 {
     /*
-     * UbuntuPackage needs to extract the langpacks, so we give it an array
-     * of langpacks. There is a small overhead when computing this array
-     * which might be unnecessary if no processed packages are using
-     * langpacks, but otherwise we need to keep a reference to all packages
+     * UbuntuPackage needs to read translations from the langpacks, so we give it
+     * a provider that knows about them. There is a small overhead when computing
+     * the list of langpacks which might be unnecessary if no processed packages are
+     * using langpacks, but otherwise we need to keep a reference to all packages
      * around, which is very expensive.
      */
-    m_langpacks = std::make_shared<LanguagePackProvider>(m_tmpDir);
+    m_langpacks = std::make_shared<LanguagePackProvider>();
 }
 
 void UbuntuPackageIndex::release()
@@ -45,7 +45,7 @@ void UbuntuPackageIndex::release()
     m_checkedLangPacks.clear();
 
     // replace with fresh, empty provider
-    m_langpacks = std::make_shared<LanguagePackProvider>(m_tmpDir);
+    m_langpacks = std::make_shared<LanguagePackProvider>();
 }
 
 std::shared_ptr<DebPackage> UbuntuPackageIndex::newPackage(
@@ -53,7 +53,7 @@ std::shared_ptr<DebPackage> UbuntuPackageIndex::newPackage(
     const std::string &ver,
     const std::string &arch)
 {
-    auto ubuntuPkg = std::make_shared<UbuntuPackage>(name, ver, arch);
+    auto ubuntuPkg = std::make_shared<UbuntuPackage>(name, ver, arch, nullptr, m_strings);
     ubuntuPkg->setLanguagePackProvider(m_langpacks);
     return std::static_pointer_cast<DebPackage>(ubuntuPkg);
 }
@@ -89,6 +89,17 @@ std::vector<std::shared_ptr<Package>> UbuntuPackageIndex::packagesFor(
     return pkgs;
 }
 
+void UbuntuPackageIndex::contentsAvailable(
+    std::shared_ptr<ContentsStore> cstore,
+    const std::string &suite,
+    const std::string &section,
+    const std::string &arch)
+{
+    // find out where the langpack catalogs are, so we can load them on demand without
+    // having to look into every langpack
+    m_langpacks->indexCatalogs(*cstore);
+}
+
 std::shared_ptr<Package> UbuntuPackageIndex::packageForFile(
     const std::string &fname,
     const std::string &suite,
@@ -50,6 +50,12 @@ public:
         const std::string &suite = "",
         const std::string &section = "") override;
 
+    void contentsAvailable(
+        std::shared_ptr<ContentsStore> cstore,
+        const std::string &suite,
+        const std::string &section,
+        const std::string &arch) override;
+
 protected:
     // Make tmpDir accessible to this class
     using DebianPackageIndex::m_tmpDir;
@@ -506,6 +506,41 @@ void Config::loadFromFile(
     if (maxScrFileSizeNode)
         maxScrFileSize = Yaml::nodeIntValue(maxScrFileSizeNode);
 
+    mediaPublishMode = Utils::FileCloneMode::HARDLINK;
+    auto mediaPublishModeNode = Yaml::nodeByKey(root, "MediaPublishMode");
+    if (mediaPublishModeNode) {
+        auto publishModeStr = Utils::toLower(Yaml::nodeStrValue(mediaPublishModeNode));
+        if (publishModeStr == "hardlink") {
+            mediaPublishMode = Utils::FileCloneMode::HARDLINK;
+        } else if (publishModeStr == "reflink") {
+            mediaPublishMode = Utils::FileCloneMode::REFLINK;
+        } else if (publishModeStr == "copy") {
+            mediaPublishMode = Utils::FileCloneMode::COPY;
+        } else {
+            LOG_ERROR(m_log, "Invalid value '{}' for MediaPublishMode setting.", publishModeStr);
+        }
+    }
+
+    packageCacheSize = 1024;
+    auto packageCacheSizeNode = Yaml::nodeByKey(root, "PackageCacheSize");
+    if (packageCacheSizeNode) {
+        packageCacheSize = Yaml::nodeIntValue(packageCacheSizeNode);
+        if (packageCacheSize < 0) {
+            LOG_ERROR(m_log, "Invalid value '{}' for PackageCacheSize setting.", packageCacheSize);
+            packageCacheSize = 1024;
+        }
+    }
+
+    memoryLimit = 0;
+    auto memoryLimitNode = Yaml::nodeByKey(root, "MemoryLimit");
+    if (memoryLimitNode)
+        memoryLimit = std::max<int64_t>(Yaml::nodeIntValue(memoryLimitNode), 0);
+
+    tempDiskLimit = 0;
+    auto tempDiskLimitNode = Yaml::nodeByKey(root, "TempDiskLimit");
+    if (tempDiskLimitNode)
+        tempDiskLimit = std::max<int64_t>(Yaml::nodeIntValue(tempDiskLimitNode), 0);
+
     allowedCustomKeys.clear();
     auto allowedCustomKeysNode = Yaml::nodeByKey(root, "AllowedCustomKeys");
     if (allowedCustomKeysNode) {
@@ -564,6 +599,8 @@ void Config::loadFromFile(
                 feature.screenshotVideos = featureValue;
             } else if (featureId == "propagateMetaInfoArtifacts") {
                 feature.propagateMetaInfoArtifacts = featureValue;
+            } else if (featureId == "zstdIconTarballs") {
+                feature.zstdIconTarballs = featureValue;
             }
         }
     }
@@ -102,6 +102,7 @@ struct GeneratorFeatures {
     bool processLocale = true;
     bool screenshotVideos = true;
     bool propagateMetaInfoArtifacts = false;
+    bool zstdIconTarballs = false;
 };
 
 /// Fake package name AppStream Generator uses internally to inject additional metainfo on users' request
@@ -148,6 +149,16 @@ public:
     /// Default output format for generated media, unless a suite overrides it
     AscImageFormat imageFormat = ASC_IMAGE_FORMAT_JXL;
 
+    /// How media from the pool is placed in the directories of immutable suites
+    Utils::FileCloneMode mediaPublishMode = Utils::FileCloneMode::HARDLINK;
+
+    /// Memory budget for loaded package indices that are kept for reuse, in MiB
+    int64_t packageCacheSize = 1024;
+
+    /// Memory and temporary disk space packages may use while being worked on in parallel, in MiB (0 is unlimited)
+    int64_t memoryLimit = 0;
+    int64_t tempDiskLimit = 0;
+
     std::string formatVersionStr() const;
     fs::path databaseDir() const;
     fs::path cacheRootDir() const;
@@ -26,6 +26,7 @@
 #include <cassert>
 #include <cstring>
 #include <cmath>
+#include <string_view>
 
 #include "config.h"
 #include "logging.h"
@@ -38,6 +39,9 @@ namespace ASGenerator
 ContentsStore::ContentsStore(const std::string &prefixPath)
     : m_log(getLogger("contentsstore")),
       dbEnv(nullptr),
+      m_contentsCodec("contents"),
+      m_iconsCodec("icondata"),
+      m_localeCodec("localedata"),
       m_opened(false)
 {
     // we always want the default icon locations to be searched
@@ -84,9 +88,9 @@ void ContentsStore::open(const std::string &dir)
         return;
     }
 
-    // We are going to use at max 3 sub-databases:
-    // contents, icons and locale
-    rc = mdb_env_set_maxdbs(dbEnv, 3);
+    // We are going to use at max 4 sub-databases:
+    // contents, icons, locale and the compression dictionaries
+    rc = mdb_env_set_maxdbs(dbEnv, 4);
     if (rc != 0) {
         mdb_env_close(dbEnv);
         checkError(rc, "mdb_env_set_maxdbs");
@@ -105,7 +109,8 @@ void ContentsStore::open(const std::string &dir)
     }
 
     // open database
-    rc = mdb_env_open(dbEnv, dir.c_str(), MDB_NOMETASYNC, 0755);
+    // read transactions are recycled across threads, see acquireReadTransaction()
+    rc = mdb_env_open(dbEnv, dir.c_str(), MDB_NOMETASYNC | MDB_NOTLS, 0755);
     if (rc != 0) {
         mdb_env_close(dbEnv);
         checkError(rc, "mdb_env_open");
@@ -136,6 +141,13 @@ void ContentsStore::open(const std::string &dir)
         rc = mdb_dbi_open(txn, "localedata", MDB_CREATE, &dbLocale);
         checkError(rc, "open locale-info database");
 
+        rc = mdb_dbi_open(txn, "dictionaries", MDB_CREATE, &dbDictionaries);
+        checkError(rc, "open compression dictionaries database");
+
+        m_contentsCodec.loadDictionaries(txn, dbDictionaries);
+        m_iconsCodec.loadDictionaries(txn, dbDictionaries);
+        m_localeCodec.loadDictionaries(txn, dbDictionaries);
+
         rc = mdb_txn_commit(txn);
         checkError(rc, "mdb_txn_commit");
 
@@ -145,6 +157,9 @@ void ContentsStore::open(const std::string &dir)
         mdb_env_close(dbEnv);
         throw;
     }
+
+    std::unique_lock lock(m_pkidCacheMutex);
+    m_pkidCache = getPackageIdSet();
 }
 
 void ContentsStore::open(const Config &conf)
@@ -157,10 +172,20 @@ void ContentsStore::close()
 {
     std::lock_guard<std::mutex> lock(m_mutex);
     if (m_opened && dbEnv) {
+        {
+            std::lock_guard<std::mutex> txnLock(m_readTxnMutex);
+            for (auto txn : m_idleReadTxns)
+                mdb_txn_abort(txn);
+            m_idleReadTxns.clear();
+        }
+
         mdb_env_close(dbEnv);
         m_opened = false;
         dbEnv = nullptr;
     }
+
+    std::unique_lock cacheLock(m_pkidCacheMutex);
+    m_pkidCache.clear();
 }
 
 MDB_val ContentsStore::makeDbValue(const std::string &data)
@@ -197,6 +222,84 @@ void ContentsStore::quitTransaction(MDB_txn *txn)
     mdb_txn_abort(txn);
 }
 
+MDB_txn *ContentsStore::acquireReadTransaction()
+{
+    MDB_txn *txn = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_readTxnMutex);
+        if (!m_idleReadTxns.empty()) {
+            txn = m_idleReadTxns.back();
+            m_idleReadTxns.pop_back();
+        }
+    }
+
+    if (txn == nullptr)
+        return newTransaction(MDB_RDONLY);
+
+    auto rc = mdb_txn_renew(txn);
+    if (rc != 0) {
+        mdb_txn_abort(txn);
+        checkError(rc, "mdb_txn_renew");
+    }
+
+    return txn;
+}
+
+void ContentsStore::releaseReadTransaction(MDB_txn *txn)
+{
+    if (txn == nullptr)
+        return;
+
+    // keep the reader slot around, so the next reader does not have to set up a new one
+    mdb_txn_reset(txn);
+
+    std::lock_guard<std::mutex> lock(m_readTxnMutex);
+    m_idleReadTxns.push_back(txn);
+}
+
+const ValueCompressor &ContentsStore::codecFor(MDB_dbi dbi) const
+{
+    if (dbi == dbIcons)
+        return m_iconsCodec;
+    if (dbi == dbLocale)
+        return m_localeCodec;
+    return m_contentsCodec;
+}
+
+/**
+ * Get the list stored in @val, decompressing it into @buffer if needed.
+ */
+std::string_view ContentsStore::decodeValue(MDB_dbi dbi, const MDB_val &val, std::string &buffer) const
+{
+    if (val.mv_data == nullptr || val.mv_size == 0)
+        return {};
+
+    const std::string_view stored(static_cast<const char *>(val.mv_data), val.mv_size);
+    if (ValueCompressor::isCompressed(stored)) {
+        buffer = codecFor(dbi).decode(stored);
+        return buffer;
+    }
+
+    // plain values are stored with their terminating NUL
+    return stored.substr(0, stored.size() - 1);
+}
+
+/**
+ * Call @func for every line of the newline-separated list @data.
+ */
+template<typename Func>
+static void forEachListEntry(std::string_view data, Func &&func)
+{
+    std::size_t start = 0;
+    while (start < data.length()) {
+        auto end = data.find('\n', start);
+        if (end == std::string_view::npos)
+            end = data.length();
+        func(data.substr(start, end - start));
+        start = end + 1;
+    }
+}
+
 void ContentsStore::removePackage(const std::string &pkid)
 {
     MDB_val key = makeDbValue(pkid);
@@ -219,36 +322,70 @@ void ContentsStore::removePackage(const std::string &pkid)
         quitTransaction(txn);
         throw;
     }
+
+    std::unique_lock lock(m_pkidCacheMutex);
+    m_pkidCache.erase(pkid);
 }
 
 bool ContentsStore::packageExists(const std::string &pkid)
 {
-    MDB_val dkey = makeDbValue(pkid);
+    return packagesExist({pkid})[0];
+}
+
+std::vector<bool> ContentsStore::packagesExist(const std::vector<std::string> &pkids)
+{
+    std::vector<bool> result(pkids.size(), false);
+    std::vector<std::size_t> misses;
+
+    {
+        std::shared_lock lock(m_pkidCacheMutex);
+        for (std::size_t i = 0; i < pkids.size(); i++) {
+            if (m_pkidCache.contains(pkids[i]))
+                result[i] = true;
+            else
+                misses.push_back(i);
+        }
+    }
+
+    if (misses.empty())
+        return result;
+
+    // Packages we do not know about may still have been added by another generator
+    // process working on the same database, so we need to check with the database.
     MDB_cursor *cur = nullptr;
+    std::vector<std::string> found;
 
-    auto txn = newTransaction(MDB_RDONLY);
+    auto txn = acquireReadTransaction();
     try {
         auto res = mdb_cursor_open(txn, dbContents, &cur);
         checkError(res, "mdb_cursor_open");
 
-        res = mdb_cursor_get(cur, &dkey, nullptr, MDB_SET);
-        mdb_cursor_close(cur);
-        cur = nullptr;
+        for (const auto idx : misses) {
+            MDB_val dkey = makeDbValue(pkids[idx]);
+            res = mdb_cursor_get(cur, &dkey, nullptr, MDB_SET);
+            if (res == MDB_NOTFOUND)
+                continue;
+            checkError(res, "mdb_cursor_get");
 
-        if (res == MDB_NOTFOUND) {
-            quitTransaction(txn);
-            return false;
+            result[idx] = true;
+            found.push_back(pkids[idx]);
         }
-        checkError(res, "mdb_cursor_get");
 
-        quitTransaction(txn);
-        return true;
+        mdb_cursor_close(cur);
+        releaseReadTransaction(txn);
     } catch (...) {
         if (cur)
             mdb_cursor_close(cur);
-        quitTransaction(txn);
+        releaseReadTransaction(txn);
         throw;
     }
+
+    if (!found.empty()) {
+        std::unique_lock lock(m_pkidCacheMutex);
+        m_pkidCache.insert(found.begin(), found.end());
+    }
+
+    return result;
 }
 
 bool ContentsStore::pathIsIconLocation(const std::string &path) const
@@ -293,7 +430,8 @@ void ContentsStore::addContents(const std::string &pkid, const std::vector<std::
     std::lock_guard<std::mutex> lock(m_mutex);
 
     auto key = makeDbValue(pkid);
-    auto contentsVal = makeDbValue(contentsStr);
+    const auto contentsData = m_contentsCodec.encode(contentsStr);
+    MDB_val contentsVal = {contentsData.size(), const_cast<char *>(contentsData.data())};
 
     auto txn = newTransaction();
     try {
@@ -308,8 +446,8 @@ void ContentsStore::addContents(const std::string &pkid, const std::vector<std::
                     iconsStream << "\n";
                 iconsStream << iconInfo[i];
             }
-            const std::string iconsStr = iconsStream.str();
-            MDB_val iconsVal = makeDbValue(iconsStr);
+            const auto iconsData = m_iconsCodec.encode(iconsStream.str());
+            MDB_val iconsVal = {iconsData.size(), const_cast<char *>(iconsData.data())};
 
             res = mdb_put(txn, dbIcons, &key, &iconsVal, 0);
             checkError(res, "mdb_put (icons)");
@@ -323,8 +461,8 @@ void ContentsStore::addContents(const std::string &pkid, const std::vector<std::
                     localeStream << "\n";
                 localeStream << localeInfo[i];
             }
-            const std::string localeStr = localeStream.str();
-            MDB_val localeVal = makeDbValue(localeStr);
+            const auto localeData = m_localeCodec.encode(localeStream.str());
+            MDB_val localeVal = {localeData.size(), const_cast<char *>(localeData.data())};
 
             res = mdb_put(txn, dbLocale, &key, &localeVal, 0);
             checkError(res, "mdb_put (locale)");
@@ -335,6 +473,9 @@ void ContentsStore::addContents(const std::string &pkid, const std::vector<std::
         quitTransaction(txn);
         throw;
     }
+
+    std::unique_lock cacheLock(m_pkidCacheMutex);
+    m_pkidCache.insert(pkid);
 }
 
 std::unordered_map<std::string, std::string> ContentsStore::getFilesMap(
@@ -342,10 +483,11 @@ std::unordered_map<std::string, std::string> ContentsStore::getFilesMap(
     MDB_dbi dbi,
     bool useBaseName)
 {
-    MDB_cursor *cur;
+    MDB_cursor *cur = nullptr;
 
-    auto txn = newTransaction(MDB_RDONLY);
+    auto txn = acquireReadTransaction();
     std::unordered_map<std::string, std::string> pkgCMap;
+    std::string buffer;
 
     try {
         auto res = mdb_cursor_open(txn, dbi, &cur);
@@ -360,28 +502,22 @@ std::unordered_map<std::string, std::string> ContentsStore::getFilesMap(
                 continue;
             checkError(res, "mdb_cursor_get");
 
-            auto data = static_cast<const char *>(cval.mv_data);
-            std::string contents(data);
-
-            std::istringstream stream(contents);
-            std::string line;
-            while (std::getline(stream, line)) {
+            forEachListEntry(decodeValue(dbi, cval, buffer), [&](std::string_view line) {
                 if (useBaseName) {
-                    auto pos = line.find_last_of('/');
-                    std::string basename = (pos != std::string::npos) ? line.substr(pos + 1) : line;
-                    pkgCMap[basename] = pkid;
-                } else {
-                    pkgCMap[line] = pkid;
+                    const auto pos = line.find_last_of('/');
+                    if (pos != std::string_view::npos)
+                        line = line.substr(pos + 1);
                 }
-            }
+                pkgCMap.insert_or_assign(std::string(line), pkid);
+            });
         }
 
         mdb_cursor_close(cur);
-        quitTransaction(txn);
+        releaseReadTransaction(txn);
     } catch (...) {
         if (cur)
             mdb_cursor_close(cur);
-        quitTransaction(txn);
+        releaseReadTransaction(txn);
         throw;
     }
 
@@ -409,37 +545,25 @@ std::vector<std::string> ContentsStore::getContentsList(const std::string &pkid,
 {
     MDB_val pkey = makeDbValue(pkid);
     MDB_val cval;
-    MDB_cursor *cur;
 
-    auto txn = newTransaction(MDB_RDONLY);
+    auto txn = acquireReadTransaction();
     std::vector<std::string> result;
 
     try {
-        auto res = mdb_cursor_open(txn, dbi, &cur);
-        checkError(res, "mdb_cursor_open");
-
-        res = mdb_cursor_get(cur, &pkey, &cval, MDB_SET);
-        if (res == MDB_NOTFOUND) {
-            mdb_cursor_close(cur);
-            quitTransaction(txn);
-            return result;
+        auto res = mdb_get(txn, dbi, &pkey, &cval);
+        if (res != MDB_NOTFOUND) {
+            checkError(res, "mdb_get");
+
+            // build the list straight from the mapped data, unless it had to be decompressed
+            std::string buffer;
+            forEachListEntry(decodeValue(dbi, cval, buffer), [&result](std::string_view line) {
+                result.emplace_back(line);
+            });
         }
-        checkError(res, "mdb_cursor_get");
-
-        auto data = static_cast<const char *>(cval.mv_data);
-        std::string contentsStr(data);
 
-        std::istringstream stream(contentsStr);
-        std::string line;
-        while (std::getline(stream, line))
-            result.push_back(line);
-
-        mdb_cursor_close(cur);
-        quitTransaction(txn);
+        releaseReadTransaction(txn);
     } catch (...) {
-        if (cur)
-            mdb_cursor_close(cur);
-        quitTransaction(txn);
+        releaseReadTransaction(txn);
         throw;
     }
 
@@ -515,6 +639,10 @@ void ContentsStore::removePackages(const std::unordered_set<std::string> &pkidSe
         quitTransaction(txn);
         throw;
     }
+
+    std::unique_lock lock(m_pkidCacheMutex);
+    for (const auto &pkid : pkidSet)
+        m_pkidCache.erase(pkid);
 }
 
 void ContentsStore::sync()
@@ -523,4 +651,32 @@ void ContentsStore::sync()
     mdb_env_sync(dbEnv, 1);
 }
 
+std::uint64_t ContentsStore::mapUsedBytes()
+{
+    assert(m_opened);
+    MDB_envinfo info;
+    MDB_stat stat;
+    checkError(mdb_env_info(dbEnv, &info), "mdb_env_info");
+    checkError(mdb_env_stat(dbEnv, &stat), "mdb_env_stat");
+    return static_cast<std::uint64_t>(info.me_last_pgno + 1) * stat.ms_psize;
+}
+
+std::uint64_t ContentsStore::mapSizeBytes()
+{
+    assert(m_opened);
+    MDB_envinfo info;
+    checkError(mdb_env_info(dbEnv, &info), "mdb_env_info");
+    return info.me_mapsize;
+}
+
+void ContentsStore::rebuildCompressionDictionaries()
+{
+    assert(m_opened);
+
+    LOG_INFO(m_log, "Rebuilding compression dictionaries of the contents cache");
+    m_contentsCodec.rebuild(dbEnv, dbContents, dbDictionaries);
+    m_iconsCodec.rebuild(dbEnv, dbIcons, dbDictionaries);
+    m_localeCodec.rebuild(dbEnv, dbLocale, dbDictionaries);
+}
+
 } // namespace ASGenerator
@@ -24,9 +24,12 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <mutex>
+#include <shared_mutex>
+#include <cstdint>
 #include <lmdb.h>
 
 #include "logging.h"
+#include "valuecompressor.h"
 
 namespace ASGenerator
 {
@@ -55,6 +58,12 @@ public:
 
     bool packageExists(const std::string &pkid);
 
+    /**
+     * Check which of the packages in @pkids have contents information stored,
+     * using at most one database transaction for the whole list.
+     */
+    std::vector<bool> packagesExist(const std::vector<std::string> &pkids);
+
     void addContents(const std::string &pkid, const std::vector<std::string> &contents);
 
     std::unordered_map<std::string, std::string> getContentsMap(const std::vector<std::string> &pkids);
@@ -76,6 +85,18 @@ public:
 
     void sync();
 
+    /**
+     * Number of bytes of the memory map that are in use, and total size of the map.
+     */
+    std::uint64_t mapUsedBytes();
+    std::uint64_t mapSizeBytes();
+
+    /**
+     * Train new compression dictionaries for the contents lists and recompress
+     * all of them. This must not run while other generator processes use the database.
+     */
+    void rebuildCompressionDictionaries();
+
     // Delete copy constructor and assignment operator
     ContentsStore(const ContentsStore &) = delete;
     ContentsStore &operator=(const ContentsStore &) = delete;
@@ -86,18 +107,35 @@ private:
     MDB_dbi dbContents{0};
     MDB_dbi dbIcons{0};
     MDB_dbi dbLocale{0};
+    MDB_dbi dbDictionaries{0};
+
+    ValueCompressor m_contentsCodec;
+    ValueCompressor m_iconsCodec;
+    ValueCompressor m_localeCodec;
 
     bool m_opened;
     std::mutex m_mutex;
 
     std::vector<std::string> m_knownIconPaths;
 
+    // read transactions that were reset and can be renewed, instead of creating new ones
+    std::vector<MDB_txn *> m_idleReadTxns;
+    std::mutex m_readTxnMutex;
+
+    // IDs of all packages known to be in the database, so lookups rarely need a transaction
+    std::unordered_set<std::string> m_pkidCache;
+    std::shared_mutex m_pkidCacheMutex;
+
     void checkError(int rc, const std::string &msg);
     MDB_val makeDbValue(const std::string &data);
     MDB_txn *newTransaction(unsigned int flags = 0);
     void commitTransaction(MDB_txn *txn);
     void quitTransaction(MDB_txn *txn);
+    MDB_txn *acquireReadTransaction();
+    void releaseReadTransaction(MDB_txn *txn);
     bool pathIsIconLocation(const std::string &path) const;
+    const ValueCompressor &codecFor(MDB_dbi dbi) const;
+    std::string_view decodeValue(MDB_dbi dbi, const MDB_val &val, std::string &buffer) const;
 
     std::unordered_map<std::string, std::string> getFilesMap(
         const std::vector<std::string> &pkids,
@@ -55,6 +55,7 @@ void InjectedModifications::loadForSuite(std::shared_ptr<Suite> suite)
 
     m_removedComponents.clear();
     m_injectedCustomData.clear();
+    m_sourceDigest.clear();
 
     const auto fname = suite->extraMetainfoDir / "modifications.json";
     if (!fs::exists(fname))
@@ -70,6 +71,9 @@ void InjectedModifications::loadForSuite(std::shared_ptr<Suite> suite)
     std::string jsonData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
     file.close();
 
+    g_autofree gchar *digest = g_compute_checksum_for_string(G_CHECKSUM_SHA256, jsonData.c_str(), jsonData.size());
+    m_sourceDigest = digest;
+
     // Parse JSON
     auto doc = Yaml::parseDocument(jsonData, true);
     auto root = Yaml::documentRoot(doc);
@@ -184,4 +188,10 @@ void InjectedModifications::addRemovalRequestsToResult(GeneratorResult *gres) co
     }
 }
 
+std::string InjectedModifications::sourceDigest() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_sourceDigest;
+}
+
 } // namespace ASGenerator
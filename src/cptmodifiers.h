@@ -59,6 +59,12 @@ public:
 
     void addRemovalRequestsToResult(GeneratorResult *gres) const;
 
+    /**
+     * Checksum of the modifications data that was loaded, or an empty string
+     * if there were no modifications.
+     */
+    std::string sourceDigest() const;
+
     // Delete copy constructor and assignment operator
     InjectedModifications(const InjectedModifications &) = delete;
     InjectedModifications &operator=(const InjectedModifications &) = delete;
@@ -70,6 +76,7 @@ private:
 
     bool m_hasRemovedCpts;
     bool m_hasInjectedCustom;
+    std::string m_sourceDigest;
 
     mutable std::shared_mutex m_mutex;
 };
@@ -208,6 +208,7 @@ build_vector:
     m_contentsVector.reserve(m_contents.size());
     for (const auto &[key, value] : m_contents)
         m_contentsVector.push_back(key);
+    contentsChanged();
 
     return m_contentsVector;
 }
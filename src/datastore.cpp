@@ -28,6 +28,10 @@
 #include <cmath>
 #include <ctime>
 #include <algorithm>
+#include <string_view>
+#include <charconv>
+#include <ranges>
+#include <limits>
 #include <nlohmann/json.hpp>
 
 #include <fcntl.h>
@@ -38,6 +42,7 @@
 #include "result.h"
 #include "utils.h"
 #include "scopeguard.h"
+#include "statsseries.h"
 
 namespace ASGenerator
 {
@@ -90,21 +95,264 @@ RepoInfo RepoInfo::deserialize(const std::vector<std::byte> &data)
     return info;
 }
 
-static std::vector<std::byte> serializeStatsEntryData(const StatisticsEntry &entry)
+DataSnapshot::DataSnapshot(DataStore *store, MDB_txn *txn)
+    : m_store(store),
+      m_txn(txn)
 {
-    json statsData = json::object();
-    for (const auto &[key, value] : entry.data) {
-        std::visit(
-            [&statsData, &key](const auto &v) {
-                statsData[key] = v;
+}
+
+DataSnapshot::DataSnapshot(DataSnapshot &&other) noexcept
+    : m_store(other.m_store),
+      m_txn(other.m_txn),
+      m_buffers(std::move(other.m_buffers))
+{
+    other.m_txn = nullptr;
+}
+
+DataSnapshot::~DataSnapshot()
+{
+    if (m_txn != nullptr)
+        m_store->releaseReadTransaction(m_txn);
+}
+
+std::string_view DataSnapshot::view(MDB_dbi dbi, std::string_view key) const
+{
+    // keys are stored with their terminating NUL
+    std::string keyStr(key);
+    MDB_val dkey;
+    dkey.mv_size = keyStr.length() + 1;
+    dkey.mv_data = keyStr.data();
+
+    auto &buffer = m_buffers.emplace_back();
+    const auto value = m_store->viewValue(m_txn, dbi, dkey, buffer);
+    if (buffer.empty())
+        m_buffers.pop_back();
+    return value;
+}
+
+std::string_view DataSnapshot::packageValue(const std::string &pkid) const
+{
+    return view(m_store->m_dbPackages, pkid);
+}
+
+std::vector<std::string_view> DataSnapshot::gcidsForPackage(const std::string &pkid) const
+{
+    const auto pkval = packageValue(pkid);
+    if (pkval.empty() || pkval == "ignore" || pkval == "seen")
+        return {};
+
+    std::vector<std::string_view> gcids;
+    std::size_t start = 0;
+    while (start <= pkval.length()) {
+        auto end = pkval.find('\n', start);
+        if (end == std::string_view::npos)
+            end = pkval.length();
+        if (end > start)
+            gcids.push_back(pkval.substr(start, end - start));
+        start = end + 1;
+    }
+
+    return gcids;
+}
+
+std::string_view DataSnapshot::metadata(DataType dtype, std::string_view gcid) const
+{
+    return view(dtype == DataType::XML ? m_store->m_dbDataXml : m_store->m_dbDataYaml, gcid);
+}
+
+std::string_view DataSnapshot::hints(const std::string &pkid) const
+{
+    return view(m_store->m_dbHints, pkid);
+}
+
+std::optional<ComponentSummary> DataSnapshot::componentSummary(std::string_view gcid) const
+{
+    const auto data = view(m_store->m_dbSummaries, gcid);
+    if (data.empty())
+        return std::nullopt;
+
+    try {
+        return ComponentSummary::deserialize(data);
+    } catch (const std::exception &e) {
+        LOG_WARNING(m_store->m_log, "Ignoring broken summary record for '{}': {}", gcid, e.what());
+        return std::nullopt;
+    }
+}
+
+ComponentSummary ComponentSummary::fromComponent(AsComponent *cpt)
+{
+    ComponentSummary summary;
+    summary.kind = as_component_get_kind(cpt);
+    const auto cid = as_component_get_id(cpt);
+    if (cid != nullptr)
+        summary.cid = cid;
+
+    const auto iconsArr = as_component_get_icons(cpt);
+    for (guint i = 0; i < iconsArr->len; i++) {
+        AsIcon *icon = AS_ICON(g_ptr_array_index(iconsArr, i));
+        if (as_icon_get_kind(icon) == AS_ICON_KIND_CACHED) {
+            summary.iconName = as_icon_get_name(icon);
+            break;
+        }
+    }
+
+    return summary;
+}
+
+std::string ComponentSummary::serialize() const
+{
+    // component IDs and icon names never contain linebreaks
+    return std::format("{}\n{}\n{}", static_cast<int>(kind), cid, iconName);
+}
+
+ComponentSummary ComponentSummary::deserialize(std::string_view data)
+{
+    const auto cidStart = data.find('\n');
+    const auto iconStart = cidStart == std::string_view::npos ? cidStart : data.find('\n', cidStart + 1);
+    if (iconStart == std::string_view::npos)
+        throw std::runtime_error("Invalid component summary data: expected three fields");
+
+    int kind = 0;
+    const auto kindStr = data.substr(0, cidStart);
+    const auto [ptr, ec] = std::from_chars(kindStr.data(), kindStr.data() + kindStr.size(), kind);
+    if (ec != std::errc() || ptr != kindStr.data() + kindStr.size() || kind < 0 || kind >= AS_COMPONENT_KIND_LAST)
+        throw std::runtime_error(std::format("Invalid component summary data: bad kind '{}'", kindStr));
+
+    ComponentSummary summary;
+    summary.kind = static_cast<AsComponentKind>(kind);
+    summary.cid = data.substr(cidStart + 1, iconStart - cidStart - 1);
+    summary.iconName = data.substr(iconStart + 1);
+
+    return summary;
+}
+
+PackageRecord PackageRecord::fromPackage(const Package &pkg)
+{
+    PackageRecord record;
+    record.kind = pkg.kind();
+    record.name = pkg.name();
+    record.ver = pkg.ver();
+    record.arch = pkg.arch();
+    record.maintainer = pkg.maintainer();
+
+    return record;
+}
+
+std::string PackageRecord::serializeList(const std::vector<PackageRecord> &records)
+{
+    std::string data;
+    data.reserve(records.size() * 64);
+    for (const auto &record : records) {
+        // package names, versions and architectures never contain whitespace, but maintainer names might
+        auto maintainer = record.maintainer;
+        std::ranges::replace_if(
+            maintainer,
+            [](char c) {
+                return c == '\t' || c == '\n';
             },
-            value);
+            ' ');
+        data += std::format(
+            "{}\t{}\t{}\t{}\t{}\n", static_cast<int>(record.kind), record.name, record.ver, record.arch, maintainer);
     }
 
-    const auto serialized = statsData.dump();
-    return {
-        reinterpret_cast<const std::byte *>(serialized.data()),
-        reinterpret_cast<const std::byte *>(serialized.data()) + serialized.size()};
+    return data;
+}
+
+std::vector<PackageRecord> PackageRecord::deserializeList(std::string_view data)
+{
+    std::vector<PackageRecord> records;
+    for (const auto line : std::views::split(data, '\n')) {
+        const std::string_view lineView(line.begin(), line.end());
+        if (lineView.empty())
+            continue;
+
+        std::vector<std::string_view> fields;
+        for (const auto field : std::views::split(lineView, '\t'))
+            fields.emplace_back(field.begin(), field.end());
+        if (fields.size() != 5)
+            throw std::runtime_error(std::format("Invalid package record: {}", lineView));
+
+        int kind = 0;
+        const auto [ptr, ec] = std::from_chars(fields[0].data(), fields[0].data() + fields[0].size(), kind);
+        if (ec != std::errc() || ptr != fields[0].data() + fields[0].size() || kind < 0
+            || kind > static_cast<int>(PackageKind::Fake))
+            throw std::runtime_error(std::format("Invalid package record: bad kind '{}'", fields[0]));
+
+        PackageRecord record;
+        record.kind = static_cast<PackageKind>(kind);
+        record.name = fields[1];
+        record.ver = fields[2];
+        record.arch = fields[3];
+        record.maintainer = fields[4];
+        records.push_back(std::move(record));
+    }
+
+    return records;
+}
+
+std::string PackageInputs::serialize() const
+{
+    json files_node = json::object();
+    for (const auto &[fname, digest] : files)
+        files_node[fname] = digest;
+
+    const json payload{
+        {"pkid",  pkid       },
+        {"env",   environment},
+        {"files", files_node }
+    };
+    return payload.dump();
+}
+
+PackageInputs PackageInputs::deserialize(const std::string &data)
+{
+    const auto j = json::parse(data);
+    if (!j.is_object())
+        throw std::runtime_error("Invalid package inputs data: expected JSON object");
+
+    PackageInputs inputs;
+    inputs.pkid = j.value("pkid", "");
+    inputs.environment = j.value("env", "");
+    if (j.contains("files")) {
+        for (const auto &[fname, digest] : j["files"].items())
+            inputs.files[fname] = digest.get<std::string>();
+    }
+
+    return inputs;
+}
+
+/**
+ * Convert a statistics entry into a point of the statistics series. Only integer
+ * values are recorded, any other data besides the suite and section is dropped.
+ */
+static StatisticsPoint statsEntryToPoint(const StatisticsEntry &entry)
+{
+    StatisticsPoint point;
+    point.time = entry.time;
+    for (const auto &[key, value] : entry.data) {
+        if (key == "suite" && std::holds_alternative<std::string>(value))
+            point.suite = std::get<std::string>(value);
+        else if (key == "section" && std::holds_alternative<std::string>(value))
+            point.section = std::get<std::string>(value);
+        else if (std::holds_alternative<std::int64_t>(value))
+            point.values.emplace_back(key, std::get<std::int64_t>(value));
+        else if (std::holds_alternative<double>(value))
+            point.values.emplace_back(key, std::llround(std::get<double>(value)));
+    }
+
+    return point;
+}
+
+static StatisticsEntry pointToStatsEntry(const StatisticsPoint &point)
+{
+    StatisticsEntry entry;
+    entry.time = point.time;
+    entry.data["suite"] = point.suite;
+    entry.data["section"] = point.section;
+    for (const auto &[key, value] : point.values)
+        entry.data[key] = value;
+
+    return entry;
 }
 
 static StatisticsEntry deserializeStatsEntry(std::time_t timestamp, const std::vector<std::byte> &data)
@@ -138,6 +386,17 @@ static StatisticsEntry deserializeStatsEntry(std::time_t timestamp, const std::v
     return entry;
 }
 
+/**
+ * Determine the package state from its value in the packages database.
+ */
+static PackageState packageStateForValue(const char *data, std::size_t len)
+{
+    constexpr std::string_view ignoreValue = "ignore";
+    if (std::string_view(data, len) == ignoreValue)
+        return PackageState::Ignored;
+    return PackageState::Processed;
+}
+
 DataStore::DataStore()
     : m_log(getLogger("datastore")),
       m_dbEnv(nullptr),
@@ -148,6 +407,13 @@ DataStore::DataStore()
       m_dbHints(0),
       m_dbGcidRegistry(0),
       m_dbStats(0),
+      m_dbInputs(0),
+      m_dbDictionaries(0),
+      m_dbSummaries(0),
+      m_dbStatsSeries(0),
+      m_xmlCodec("metadata_xml"),
+      m_yamlCodec("metadata_yaml"),
+      m_hintsCodec("hints"),
       m_opened(false),
       m_mdata(nullptr),
       m_stagingLockFd(-1),
@@ -203,9 +469,10 @@ void DataStore::open(const std::string &dir, const fs::path &mediaBaseDir)
     if (rc != 0)
         checkError(rc, "mdb_env_create");
 
-    // We are going to use at max 7 sub-databases:
-    // packages, hints, gcid_registry, metadata_xml, metadata_yaml, statistics, repository
-    rc = mdb_env_set_maxdbs(m_dbEnv, 7);
+    // We are going to use at max 13 sub-databases:
+    // packages, hints, gcid_registry, metadata_xml, metadata_yaml, statistics, statistics_series,
+    // repository, inputs, dictionaries, summaries, suite_media, package_lists
+    rc = mdb_env_set_maxdbs(m_dbEnv, 13);
     if (rc != 0) {
         mdb_env_close(m_dbEnv);
         checkError(rc, "mdb_env_set_maxdbs");
@@ -222,7 +489,9 @@ void DataStore::open(const std::string &dir, const fs::path &mediaBaseDir)
     }
 
     // open database
-    rc = mdb_env_open(m_dbEnv, dir.c_str(), MDB_NOMETASYNC, 0755);
+    // Read transactions are recycled by any thread that needs one, so they must
+    // not be tied to the thread that created them.
+    rc = mdb_env_open(m_dbEnv, dir.c_str(), MDB_NOMETASYNC | MDB_NOTLS, 0755);
     if (rc != 0) {
         mdb_env_close(m_dbEnv);
         checkError(rc, "mdb_env_open");
@@ -255,9 +524,36 @@ void DataStore::open(const std::string &dir, const fs::path &mediaBaseDir)
         rc = mdb_dbi_open(txn, "gcid_registry", MDB_CREATE, &m_dbGcidRegistry);
         checkError(rc, "open global-component-ID registry database");
 
+        // statistics used to be stored as one record per entry, which we still read to migrate them
         rc = mdb_dbi_open(txn, "statistics", MDB_CREATE | MDB_INTEGERKEY, &m_dbStats);
         checkError(rc, "open statistics database");
 
+        rc = mdb_dbi_open(txn, "statistics_series", MDB_CREATE, &m_dbStatsSeries);
+        checkError(rc, "open statistics series database");
+        migrateLegacyStatistics(txn);
+
+        rc = mdb_dbi_open(txn, "inputs", MDB_CREATE, &m_dbInputs);
+        checkError(rc, "open package inputs database");
+
+        // compression dictionaries of the metadata and hints values
+        rc = mdb_dbi_open(txn, "dictionaries", MDB_CREATE, &m_dbDictionaries);
+        checkError(rc, "open compression dictionaries database");
+
+        rc = mdb_dbi_open(txn, "summaries", MDB_CREATE, &m_dbSummaries);
+        checkError(rc, "open component summaries database");
+
+        // components whose media was placed in the directories of immutable suites already
+        rc = mdb_dbi_open(txn, "suite_media", MDB_CREATE, &m_dbSuiteMedia);
+        checkError(rc, "open suite media database");
+
+        // packages exported for every suite/section/arch, so data can be exported again quickly
+        rc = mdb_dbi_open(txn, "package_lists", MDB_CREATE, &m_dbPackageLists);
+        checkError(rc, "open package lists database");
+
+        m_xmlCodec.loadDictionaries(txn, m_dbDictionaries);
+        m_yamlCodec.loadDictionaries(txn, m_dbDictionaries);
+        m_hintsCodec.loadDictionaries(txn, m_dbDictionaries);
+
         rc = mdb_txn_commit(txn);
         checkError(rc, "mdb_txn_commit");
 
@@ -268,6 +564,35 @@ void DataStore::open(const std::string &dir, const fs::path &mediaBaseDir)
     }
 
     m_opened = true;
+
+    // load the state of all known packages, this is a lot cheaper than a transaction per lookup
+    {
+        MDB_cursor *cur = nullptr;
+        MDB_txn *stxn = newTransaction(MDB_RDONLY);
+        try {
+            rc = mdb_cursor_open(stxn, m_dbPackages, &cur);
+            checkError(rc, "mdb_cursor_open (package states)");
+
+            std::unique_lock cacheLock(m_pkgStateCacheMutex);
+            MDB_val pkey, pval;
+            while (mdb_cursor_get(cur, &pkey, &pval, MDB_NEXT) == 0) {
+                if (pkey.mv_size == 0 || pval.mv_size == 0)
+                    continue;
+                m_pkgStateCache.emplace(
+                    std::string(static_cast<const char *>(pkey.mv_data), pkey.mv_size - 1),
+                    packageStateForValue(static_cast<const char *>(pval.mv_data), pval.mv_size - 1));
+            }
+
+            mdb_cursor_close(cur);
+            quitTransaction(stxn);
+        } catch (...) {
+            if (cur)
+                mdb_cursor_close(cur);
+            quitTransaction(stxn);
+            throw;
+        }
+    }
+
     m_mediaDir = mediaBaseDir / "pool";
     fs::create_directories(m_mediaDir);
 
@@ -286,10 +611,20 @@ void DataStore::close()
     if (m_opened) {
         releaseMediaStaging();
 
+        {
+            std::lock_guard<std::mutex> txnLock(m_readTxnMutex);
+            for (auto txn : m_idleReadTxns)
+                mdb_txn_abort(txn);
+            m_idleReadTxns.clear();
+        }
+
         mdb_env_close(m_dbEnv);
         m_opened = false;
         m_dbEnv = nullptr;
     }
+
+    std::unique_lock cacheLock(m_pkgStateCacheMutex);
+    m_pkgStateCache.clear();
 }
 
 MDB_val DataStore::makeDbValue(const std::string &data)
@@ -328,15 +663,40 @@ void DataStore::quitTransaction(MDB_txn *txn)
     mdb_txn_abort(txn);
 }
 
-void DataStore::putKeyValue(MDB_dbi dbi, const std::string &key, const std::string &value)
+const ValueCompressor *DataStore::codecFor(MDB_dbi dbi) const
+{
+    if (dbi == m_dbDataXml)
+        return &m_xmlCodec;
+    if (dbi == m_dbDataYaml)
+        return &m_yamlCodec;
+    if (dbi == m_dbHints)
+        return &m_hintsCodec;
+    return nullptr;
+}
+
+void DataStore::putKeyValue(MDB_txn *txn, MDB_dbi dbi, const std::string &key, const std::string &value)
 {
     MDB_val dbkey = makeDbValue(key);
     MDB_val dbvalue = makeDbValue(value);
 
+    // the encoded value already carries a NUL terminator if it is stored uncompressed
+    std::string encoded;
+    const auto codec = codecFor(dbi);
+    if (codec != nullptr) {
+        encoded = codec->encode(value);
+        dbvalue.mv_size = encoded.size();
+        dbvalue.mv_data = encoded.data();
+    }
+
+    int res = mdb_put(txn, dbi, &dbkey, &dbvalue, 0);
+    checkError(res, "mdb_put");
+}
+
+void DataStore::putKeyValue(MDB_dbi dbi, const std::string &key, const std::string &value)
+{
     MDB_txn *txn = newTransaction();
     try {
-        int res = mdb_put(txn, dbi, &dbkey, &dbvalue, 0);
-        checkError(res, "mdb_put");
+        putKeyValue(txn, dbi, key, value);
         commitTransaction(txn);
     } catch (...) {
         quitTransaction(txn);
@@ -344,38 +704,81 @@ void DataStore::putKeyValue(MDB_dbi dbi, const std::string &key, const std::stri
     }
 }
 
-std::string DataStore::getValue(MDB_dbi dbi, MDB_val dkey)
+DataSnapshot DataStore::readSnapshot()
+{
+    return DataSnapshot(this, acquireReadTransaction());
+}
+
+MDB_txn *DataStore::acquireReadTransaction()
+{
+    MDB_txn *txn = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_readTxnMutex);
+        if (!m_idleReadTxns.empty()) {
+            txn = m_idleReadTxns.back();
+            m_idleReadTxns.pop_back();
+        }
+    }
+
+    if (txn == nullptr)
+        return newTransaction(MDB_RDONLY);
+
+    const int rc = mdb_txn_renew(txn);
+    if (rc != 0) {
+        mdb_txn_abort(txn);
+        checkError(rc, "mdb_txn_renew");
+    }
+
+    return txn;
+}
+
+void DataStore::releaseReadTransaction(MDB_txn *txn)
+{
+    if (txn == nullptr)
+        return;
+
+    // drop the snapshot, but keep the reader slot and its resources for the next reader
+    mdb_txn_reset(txn);
+
+    std::lock_guard<std::mutex> lock(m_readTxnMutex);
+    m_idleReadTxns.push_back(txn);
+}
+
+std::string_view DataStore::viewValue(MDB_txn *txn, MDB_dbi dbi, MDB_val dkey, std::string &buffer)
 {
     MDB_val dval;
-    MDB_cursor *cur;
+    const int res = mdb_get(txn, dbi, &dkey, &dval);
+    if (res == MDB_NOTFOUND)
+        return {};
+    checkError(res, "mdb_get");
 
-    MDB_txn *txn = newTransaction(MDB_RDONLY);
-    try {
-        int res = mdb_cursor_open(txn, dbi, &cur);
-        checkError(res, "mdb_cursor_open");
+    if (dval.mv_data == nullptr || dval.mv_size == 0)
+        return {};
 
-        res = mdb_cursor_get(cur, &dkey, &dval, MDB_SET);
-        if (res == MDB_NOTFOUND) {
-            mdb_cursor_close(cur);
-            quitTransaction(txn);
-            return {};
+    const std::string_view stored(static_cast<const char *>(dval.mv_data), dval.mv_size);
+    if (ValueCompressor::isCompressed(stored)) {
+        const auto codec = codecFor(dbi);
+        if (codec != nullptr) {
+            buffer = codec->decode(stored);
+            return buffer;
         }
-        checkError(res, "mdb_cursor_get");
+    }
 
-        if (dval.mv_data == nullptr || dval.mv_size == 0) {
-            mdb_cursor_close(cur);
-            quitTransaction(txn);
-            return {};
-        }
+    // exclude null terminator
+    return stored.substr(0, stored.size() - 1);
+}
 
-        std::string result(static_cast<const char *>(dval.mv_data), dval.mv_size - 1); // exclude null terminator
-        mdb_cursor_close(cur);
-        quitTransaction(txn);
+std::string DataStore::getValue(MDB_dbi dbi, MDB_val dkey)
+{
+    MDB_txn *txn = acquireReadTransaction();
+    try {
+        std::string buffer;
+        const auto value = viewValue(txn, dbi, dkey, buffer);
+        std::string result = buffer.empty() ? std::string(value) : std::move(buffer);
+        releaseReadTransaction(txn);
         return result;
     } catch (...) {
-        if (cur)
-            mdb_cursor_close(cur);
-        quitTransaction(txn);
+        releaseReadTransaction(txn);
         throw;
     }
 }
@@ -407,6 +810,54 @@ std::string DataStore::getMetadata(DataType dtype, const std::string &gcid)
         return getValue(m_dbDataYaml, gcid);
 }
 
+void DataStore::setPackageRecords(
+    const std::string &suite,
+    const std::string &section,
+    const std::string &arch,
+    const std::vector<PackageRecord> &records)
+{
+    putKeyValue(m_dbPackageLists, std::format("{}/{}/{}", suite, section, arch), PackageRecord::serializeList(records));
+}
+
+std::optional<std::vector<PackageRecord>> DataStore::getPackageRecords(
+    const std::string &suite,
+    const std::string &section,
+    const std::string &arch)
+{
+    const std::string key = std::format("{}/{}/{}", suite, section, arch);
+    MDB_val dkey = makeDbValue(key);
+
+    MDB_txn *txn = acquireReadTransaction();
+    try {
+        MDB_val dval;
+        const int res = mdb_get(txn, m_dbPackageLists, &dkey, &dval);
+        if (res == MDB_NOTFOUND) {
+            releaseReadTransaction(txn);
+            return std::nullopt;
+        }
+        checkError(res, "mdb_get (package records)");
+
+        // the value carries a NUL terminator, just like all other string values
+        const std::string_view data(static_cast<const char *>(dval.mv_data), dval.mv_size > 0 ? dval.mv_size - 1 : 0);
+        auto records = PackageRecord::deserializeList(data);
+        releaseReadTransaction(txn);
+        return records;
+    } catch (...) {
+        releaseReadTransaction(txn);
+        throw;
+    }
+}
+
+void DataStore::setComponentSummary(const std::string &gcid, const ComponentSummary &summary)
+{
+    putKeyValue(m_dbSummaries, gcid, summary.serialize());
+}
+
+bool DataStore::componentSummaryExists(const std::string &gcid)
+{
+    return !getValue(m_dbSummaries, gcid).empty();
+}
+
 std::string DataStore::getGcidOwner(const std::string &gcid)
 {
     return getValue(m_dbGcidRegistry, gcid);
@@ -658,9 +1109,17 @@ void DataStore::setHints(const std::string &pkid, const std::string &hintsJson)
     putKeyValue(m_dbHints, pkid, hintsJson);
 }
 
+void DataStore::setHints(const std::string &pkid, const PackageHints &hints)
+{
+    putKeyValue(m_dbHints, pkid, hints.encode());
+}
+
 std::string DataStore::getHints(const std::string &pkid)
 {
-    return getValue(m_dbHints, pkid);
+    auto hintsData = getValue(m_dbHints, pkid);
+    if (!PackageHints::isEncoded(hintsData))
+        return hintsData;
+    return PackageHints::decode(hintsData).toJson(pkid);
 }
 
 std::string DataStore::getPackageValue(const std::string &pkid)
@@ -668,20 +1127,70 @@ std::string DataStore::getPackageValue(const std::string &pkid)
     return getValue(m_dbPackages, pkid);
 }
 
+void DataStore::putPackageValue(const std::string &pkid, const std::string &value)
+{
+    putKeyValue(m_dbPackages, pkid, value);
+
+    std::unique_lock lock(m_pkgStateCacheMutex);
+    m_pkgStateCache.insert_or_assign(pkid, packageStateForValue(value.data(), value.length()));
+}
+
 void DataStore::setPackageIgnore(const std::string &pkid)
 {
-    putKeyValue(m_dbPackages, pkid, "ignore");
+    putPackageValue(pkid, "ignore");
 }
 
 bool DataStore::isIgnored(const std::string &pkid)
 {
-    const auto val = getValue(m_dbPackages, pkid);
-    return val == "ignore";
+    return getPackageStates({pkid})[0] == PackageState::Ignored;
 }
 
 bool DataStore::packageExists(const std::string &pkid)
 {
-    return !getValue(m_dbPackages, pkid).empty();
+    return getPackageStates({pkid})[0] != PackageState::Unknown;
+}
+
+std::vector<PackageState> DataStore::getPackageStates(const std::vector<std::string> &pkids)
+{
+    std::vector<PackageState> result(pkids.size(), PackageState::Unknown);
+    std::vector<std::size_t> misses;
+
+    {
+        std::shared_lock lock(m_pkgStateCacheMutex);
+        for (std::size_t i = 0; i < pkids.size(); i++) {
+            const auto it = m_pkgStateCache.find(pkids[i]);
+            if (it != m_pkgStateCache.end())
+                result[i] = it->second;
+            else
+                misses.push_back(i);
+        }
+    }
+
+    if (misses.empty())
+        return result;
+
+    // Another generator process working on the same database may have added packages
+    // we do not know about yet, so anything not in the cache is looked up for real.
+    std::vector<std::pair<std::string, PackageState>> found;
+    {
+        const auto snapshot = readSnapshot();
+        for (const auto idx : misses) {
+            const auto value = snapshot.packageValue(pkids[idx]);
+            if (value.empty())
+                continue;
+
+            result[idx] = packageStateForValue(value.data(), value.length());
+            found.emplace_back(pkids[idx], result[idx]);
+        }
+    }
+
+    if (!found.empty()) {
+        std::unique_lock lock(m_pkgStateCacheMutex);
+        for (auto &[pkid, state] : found)
+            m_pkgStateCache.insert_or_assign(std::move(pkid), state);
+    }
+
+    return result;
 }
 
 void DataStore::addGeneratorResult(DataType dtype, GeneratorResult &gres, bool alwaysRegenerate)
@@ -765,7 +1274,9 @@ void DataStore::addGeneratorResult(DataType dtype, GeneratorResult &gres, bool a
 
         if (metadataExists(dtype, gcid) && previousOwner == ourPkid && !alwaysRegenerate) {
             // we already have seen this exact metadata - only adjust the reference,
-            // and don't regenerate it.
+            // and don't regenerate it. Databases of older versions may lack its summary though.
+            if (!componentSummaryExists(gcid))
+                setComponentSummary(gcid, ComponentSummary::fromComponent(cpt));
             continue;
         }
 
@@ -800,15 +1311,17 @@ void DataStore::addGeneratorResult(DataType dtype, GeneratorResult &gres, bool a
             continue;
         }
 
-        // store metadata
-        if (!data.empty())
+        // store metadata, as well as the summary of it that reports are generated from
+        if (!data.empty()) {
             setMetadata(dtype, gcid, data);
+            setComponentSummary(gcid, ComponentSummary::fromComponent(cpt));
+        }
     }
 
     if (gres.hintsCount() > 0) {
-        const auto hintsJson = gres.hintsToJson();
-        if (!hintsJson.empty())
-            setHints(gres.pkid(), hintsJson);
+        const auto hints = gres.hints();
+        if (!hints.empty())
+            setHints(gres.pkid(), hints);
     }
 
     auto gcids = gres.getComponentGcids();
@@ -821,12 +1334,165 @@ void DataStore::addGeneratorResult(DataType dtype, GeneratorResult &gres, bool a
         // no global components, and we're not ignoring this component.
         // this means we likely have hints stored for this one. Mark it
         // as "seen" so we don't reprocess it again.
-        putKeyValue(m_dbPackages, gres.pkid(), "seen");
+        putPackageValue(gres.pkid(), "seen");
     } else {
         // store global component IDs for this package as newline-separated list
         std::string gcidVal = Utils::joinStrings(gcids, "\n");
-        putKeyValue(m_dbPackages, gres.pkid(), gcidVal);
+        putPackageValue(gres.pkid(), gcidVal);
+    }
+}
+
+std::string DataStore::packageInputsKey(const std::string &pkid)
+{
+    // name/version/arch -> name/arch, so successive versions of a package share one record
+    const auto parts = Utils::splitString(pkid, '/');
+    if (parts.size() != 3)
+        return pkid;
+    return std::format("{}/{}", parts[0], parts[2]);
+}
+
+void DataStore::setPackageInputs(const std::string &key, const PackageInputs &inputs)
+{
+    putKeyValue(m_dbInputs, key, inputs.serialize());
+}
+
+std::optional<PackageInputs> DataStore::getPackageInputs(const std::string &key)
+{
+    const auto data = getValue(m_dbInputs, key);
+    if (data.empty())
+        return std::nullopt;
+
+    try {
+        return PackageInputs::deserialize(data);
+    } catch (const std::exception &e) {
+        LOG_WARNING(m_log, "Ignoring broken inputs record for '{}': {}", key, e.what());
+        return std::nullopt;
+    }
+}
+
+/**
+ * Adjust the hint variables of a result that package @toPkid reuses from @fromPkid
+ * to the new package version.
+ *
+ * @return false if a hint refers to a package file we can not map to the new version.
+ */
+static bool rewriteReusedHints(PackageHints &hints, const std::string &fromPkid, const std::string &toPkid)
+{
+    // package file names do not include the epoch of a version
+    const auto fileVersion = [](const std::string &version) {
+        const auto epochEnd = version.find(':');
+        return epochEnd == std::string::npos ? version : version.substr(epochEnd + 1);
+    };
+
+    const auto [name, fromVersion] = Utils::pkidSplitNameVersion(fromPkid);
+    const auto fromFileVersion = fileVersion(fromVersion);
+    const auto toFileVersion = fileVersion(Utils::pkidSplitNameVersion(toPkid).second);
+    if (fromFileVersion.empty())
+        return false;
+
+    for (auto &cptHints : hints.components) {
+        for (auto &hint : cptHints.hints) {
+            for (auto &[var, value] : hint.vars) {
+                if (value == fromPkid) {
+                    value = toPkid;
+                    continue;
+                }
+                if (var != "pkg_fname")
+                    continue;
+
+                // the file may belong to a different package, which we know nothing about
+                const auto verPos = value.find(fromFileVersion);
+                if (!value.starts_with(name + "_") || verPos == std::string::npos)
+                    return false;
+                value.replace(verPos, fromFileVersion.length(), toFileVersion);
+            }
+        }
     }
+
+    return true;
+}
+
+bool DataStore::cloneResult(DataType dtype, const std::string &fromPkid, const std::string &toPkid)
+{
+    const auto pkval = getPackageValue(fromPkid);
+    if (pkval.empty())
+        return false;
+
+    if (pkval == "ignore") {
+        setPackageIgnore(toPkid);
+        return true;
+    }
+
+    const auto ourName = Utils::pkidSplitNameVersion(toPkid).first;
+    const auto gcids = getGCIDsForPackage(fromPkid);
+    for (const auto &gcid : gcids) {
+        if (!metadataExists(dtype, gcid))
+            return false;
+    }
+
+    // hints records do not name their package, but some of their values may refer to the old version
+    std::string hintsData = getValue(m_dbHints, fromPkid);
+    if (!hintsData.empty()) {
+        try {
+            auto hints = PackageHints::decode(hintsData);
+            if (!rewriteReusedHints(hints, fromPkid, toPkid)) {
+                LOG_DEBUG(m_log, "Hints of '{}' refer to files we can not map to '{}'", fromPkid, toPkid);
+                return false;
+            }
+            hintsData = hints.encode();
+        } catch (const std::exception &e) {
+            LOG_WARNING(m_log, "Unable to reuse hints of '{}': {}", fromPkid, e.what());
+            return false;
+        }
+    }
+
+    // Claim the components and store the result in one transaction, so that either
+    // all of it is written or nothing at all.
+    MDB_txn *txn = newTransaction();
+    try {
+        for (const auto &gcid : gcids) {
+            MDB_val dbkey = makeDbValue(gcid);
+            MDB_val dbval;
+            std::string owner;
+            int res = mdb_get(txn, m_dbGcidRegistry, &dbkey, &dbval);
+            if (res == 0) {
+                if (dbval.mv_data != nullptr && dbval.mv_size > 0)
+                    owner.assign(static_cast<const char *>(dbval.mv_data), dbval.mv_size - 1);
+            } else if (res != MDB_NOTFOUND) {
+                checkError(res, "mdb_get");
+            }
+
+            // If another package took the component in the meantime, the result has to be
+            // generated from scratch, so the duplicate is reported properly.
+            if (!owner.empty() && Utils::pkidSplitNameVersion(owner).first != ourName) {
+                quitTransaction(txn);
+                return false;
+            }
+
+            // losing the claim to another version of ourselves is fine, several versions of the
+            // same package may be present in different suites
+            if (!componentOwnerWins(toPkid, owner))
+                continue;
+
+            MDB_val dbvalue = makeDbValue(toPkid);
+            res = mdb_put(txn, m_dbGcidRegistry, &dbkey, &dbvalue, 0);
+            checkError(res, "mdb_put");
+        }
+
+        if (!hintsData.empty())
+            putKeyValue(txn, m_dbHints, toPkid, hintsData);
+        putKeyValue(txn, m_dbPackages, toPkid, pkval);
+
+        commitTransaction(txn);
+    } catch (...) {
+        quitTransaction(txn);
+        throw;
+    }
+
+    std::unique_lock lock(m_pkgStateCacheMutex);
+    m_pkgStateCache.insert_or_assign(toPkid, packageStateForValue(pkval.data(), pkval.length()));
+
+    return true;
 }
 
 std::vector<std::string> DataStore::getGCIDsForPackage(const std::string &pkid)
@@ -879,11 +1545,16 @@ void DataStore::removePackage(const std::string &pkid)
             checkError(res, "mdb_del");
         }
 
+        dropPackageInputs(txn, pkid);
+
         commitTransaction(txn);
     } catch (...) {
         quitTransaction(txn);
         throw;
     }
+
+    std::unique_lock lock(m_pkgStateCacheMutex);
+    m_pkgStateCache.erase(pkid);
 }
 
 void DataStore::takeComponentFrom(
@@ -904,9 +1575,9 @@ void DataStore::takeComponentFrom(
     if (gcids.empty()) {
         // the package has no components of its own left, but it may well have hints that we
         // want to keep, so we mark it as seen rather than as ignored
-        putKeyValue(m_dbPackages, pkid, "seen");
+        putPackageValue(pkid, "seen");
     } else {
-        putKeyValue(m_dbPackages, pkid, Utils::joinStrings(gcids, "\n"));
+        putPackageValue(pkid, Utils::joinStrings(gcids, "\n"));
     }
 
     LOG_DEBUG(m_log, "Component {} was taken away from '{}'.", gcid, pkid);
@@ -917,18 +1588,18 @@ void DataStore::takeComponentFrom(
     // Record the reason in the package's hints, exactly like the check in the extractor does
     // for a package that already knew it was going to lose.
     try {
-        const auto updated = hintsJsonAddHint(
-            getHints(pkid),
-            pkid,
+        const auto hintsData = getValue(m_dbHints, pkid);
+        auto hints = hintsData.empty() ? PackageHints() : PackageHints::decode(hintsData);
+        const bool added = hints.addHint(
             cid,
             "metainfo-duplicate-id",
             {
                 {"cid",     cid         },
                 {"pkgname", newOwnerName}
         });
-        if (updated)
-            setHints(pkid, *updated);
-    } catch (const json::exception &e) {
+        if (added)
+            setHints(pkid, hints);
+    } catch (const std::exception &e) {
         LOG_WARNING(m_log, "Unable to add duplicate-ID hint to the stored hints of '{}': {}", pkid, e.what());
     }
 }
@@ -1039,6 +1710,113 @@ void DataStore::dropOrphanedData(MDB_dbi dbi, const std::unordered_set<std::stri
     }
 }
 
+void DataStore::dropOrphanedSuiteMediaLinks(
+    const std::unordered_set<std::string> &activeGCIDs,
+    const std::unordered_set<std::string> &keepSuites)
+{
+    MDB_cursor *cur = nullptr;
+
+    MDB_txn *txn = newTransaction();
+    try {
+        int res = mdb_cursor_open(txn, m_dbSuiteMedia, &cur);
+        checkError(res, "mdb_cursor_open (suite media)");
+
+        MDB_val ckey;
+        while (mdb_cursor_get(cur, &ckey, nullptr, MDB_NEXT) == 0) {
+            // keys are "<suite>|<gcid>", neither of which can contain a pipe character
+            const std::string_view key(static_cast<const char *>(ckey.mv_data), ckey.mv_size - 1);
+            const auto sepPos = key.find('|');
+            if (sepPos != std::string_view::npos) {
+                const std::string suite(key.substr(0, sepPos));
+                const std::string gcid(key.substr(sepPos + 1));
+                if (keepSuites.contains(suite) || activeGCIDs.contains(gcid))
+                    continue;
+            }
+
+            res = mdb_cursor_del(cur, 0);
+            checkError(res, "mdb_del");
+        }
+
+        mdb_cursor_close(cur);
+        commitTransaction(txn);
+    } catch (...) {
+        if (cur)
+            mdb_cursor_close(cur);
+        quitTransaction(txn);
+        throw;
+    }
+}
+
+void DataStore::dropPackageInputs(MDB_txn *txn, const std::string &pkid)
+{
+    const auto key = packageInputsKey(pkid);
+    MDB_val dbkey = makeDbValue(key);
+    MDB_val dval;
+
+    int res = mdb_get(txn, m_dbInputs, &dbkey, &dval);
+    if (res == MDB_NOTFOUND)
+        return;
+    checkError(res, "mdb_get (inputs)");
+
+    // the record is shared by all versions of a package, and may belong to a different one by now
+    try {
+        const std::string data(static_cast<const char *>(dval.mv_data), dval.mv_size - 1);
+        if (PackageInputs::deserialize(data).pkid != pkid)
+            return;
+    } catch (const std::exception &) {
+        // a broken record is of no use to anyone
+    }
+
+    res = mdb_del(txn, m_dbInputs, &dbkey, nullptr);
+    if (res != MDB_NOTFOUND)
+        checkError(res, "mdb_del (inputs)");
+}
+
+void DataStore::dropOrphanedInputs()
+{
+    MDB_cursor *cur = nullptr;
+
+    MDB_txn *txn = newTransaction();
+    try {
+        int res = mdb_cursor_open(txn, m_dbInputs, &cur);
+        checkError(res, "mdb_cursor_open (inputs)");
+
+        MDB_val ckey, cval;
+        while (mdb_cursor_get(cur, &ckey, &cval, MDB_NEXT) == 0) {
+            std::string pkid;
+            try {
+                const std::string data(static_cast<const char *>(cval.mv_data), cval.mv_size - 1);
+                pkid = PackageInputs::deserialize(data).pkid;
+            } catch (const std::exception &) {
+                // broken records are dropped as well
+            }
+
+            if (!pkid.empty()) {
+                MDB_val pkey = makeDbValue(pkid);
+                MDB_val pval;
+                res = mdb_get(txn, m_dbPackages, &pkey, &pval);
+                if (res == 0)
+                    continue;
+                if (res != MDB_NOTFOUND)
+                    checkError(res, "mdb_get (packages)");
+            }
+
+            const std::string key(static_cast<const char *>(ckey.mv_data), ckey.mv_size - 1);
+            res = mdb_cursor_del(cur, 0);
+            checkError(res, "mdb_del");
+            LOG_DEBUG(m_log, "Dropped inputs record of {}", key);
+        }
+
+        mdb_cursor_close(cur);
+        commitTransaction(txn);
+    } catch (...) {
+        if (cur)
+            mdb_cursor_close(cur);
+        quitTransaction(txn);
+        throw;
+    }
+}
+
 void DataStore::cleanupDirs(const std::string &rootPath)
 {
     auto pdir = fs::path(rootPath).parent_path();
@@ -1066,10 +1844,22 @@ void DataStore::cleanupCruft()
     dropOrphanedData(m_dbDataXml, activeGCIDs);
     dropOrphanedData(m_dbDataYaml, activeGCIDs);
     dropOrphanedData(m_dbGcidRegistry, activeGCIDs);
+    dropOrphanedData(m_dbSummaries, activeGCIDs);
 
     // we need the global Config instance here
     const auto &conf = Config::get();
 
+    // media of immutable suites is never removed, so we need to remember that it is there
+    std::unordered_set<std::string> immutableSuites;
+    for (const auto &suite : conf.suites) {
+        if (suite.isImmutable)
+            immutableSuites.insert(suite.name);
+    }
+    dropOrphanedSuiteMediaLinks(activeGCIDs, immutableSuites);
+
+    // drop inputs records of package versions we do not know anymore
+    dropOrphanedInputs();
+
     const auto mdirLen = m_mediaDir.string().length();
     if (!fs::exists(m_mediaDir)) {
         LOG_INFO(m_log, "Media directory '{}' does not exist.", m_mediaDir.string());
@@ -1136,6 +1926,99 @@ void DataStore::cleanupCruft()
     }
 }
 
+std::unordered_set<std::string> DataStore::getSuiteMediaLinks(const std::string &suite)
+{
+    MDB_cursor *cur = nullptr;
+
+    MDB_txn *txn = newTransaction(MDB_RDONLY);
+    try {
+        std::unordered_set<std::string> gcids;
+
+        int res = mdb_cursor_open(txn, m_dbSuiteMedia, &cur);
+        checkError(res, "mdb_cursor_open (getSuiteMediaLinks)");
+
+        const std::string prefix = suite + "|";
+        MDB_val ckey = makeDbValue(prefix);
+        res = mdb_cursor_get(cur, &ckey, nullptr, MDB_SET_RANGE);
+        while (res == 0) {
+            const std::string_view key(static_cast<const char *>(ckey.mv_data), ckey.mv_size - 1);
+            if (!key.starts_with(prefix))
+                break;
+            gcids.emplace(key.substr(prefix.length()));
+
+            res = mdb_cursor_get(cur, &ckey, nullptr, MDB_NEXT);
+        }
+        if (res != MDB_NOTFOUND && res != 0)
+            checkError(res, "mdb_cursor_get (getSuiteMediaLinks)");
+
+        mdb_cursor_close(cur);
+        quitTransaction(txn);
+
+        return gcids;
+    } catch (...) {
+        if (cur)
+            mdb_cursor_close(cur);
+        quitTransaction(txn);
+        throw;
+    }
+}
+
+void DataStore::addSuiteMediaLinks(const std::string &suite, const std::vector<std::string> &gcids)
+{
+    if (gcids.empty())
+        return;
+
+    const std::string empty;
+    MDB_val dbvalue = makeDbValue(empty);
+
+    MDB_txn *txn = newTransaction();
+    try {
+        for (const auto &gcid : gcids) {
+            const auto key = std::format("{}|{}", suite, gcid);
+            MDB_val dbkey = makeDbValue(key);
+            int res = mdb_put(txn, m_dbSuiteMedia, &dbkey, &dbvalue, 0);
+            checkError(res, "mdb_put (suite media)");
+        }
+        commitTransaction(txn);
+    } catch (...) {
+        quitTransaction(txn);
+        throw;
+    }
+}
+
+void DataStore::clearSuiteMediaLinks(const std::string &suite)
+{
+    MDB_cursor *cur = nullptr;
+
+    MDB_txn *txn = newTransaction();
+    try {
+        int res = mdb_cursor_open(txn, m_dbSuiteMedia, &cur);
+        checkError(res, "mdb_cursor_open (clearSuiteMediaLinks)");
+
+        const std::string prefix = suite + "|";
+        MDB_val ckey = makeDbValue(prefix);
+        res = mdb_cursor_get(cur, &ckey, nullptr, MDB_SET_RANGE);
+        while (res == 0) {
+            const std::string_view key(static_cast<const char *>(ckey.mv_data), ckey.mv_size - 1);
+            if (!key.starts_with(prefix))
+                break;
+            checkError(mdb_cursor_del(cur, 0), "mdb_del");
+
+            res = mdb_cursor_get(cur, &ckey, nullptr, MDB_NEXT);
+        }
+        if (res != MDB_NOTFOUND && res != 0)
+            checkError(res, "mdb_cursor_get (clearSuiteMediaLinks)");
+
+        mdb_cursor_close(cur);
+        commitTransaction(txn);
+    } catch (...) {
+        if (cur)
+            mdb_cursor_close(cur);
+        quitTransaction(txn);
+        throw;
+    }
+}
+
 std::unordered_set<std::string> DataStore::getPackageIdSet()
 {
     MDB_cursor *cur = nullptr;
@@ -1179,6 +2062,8 @@ void DataStore::removePackages(const std::unordered_set<std::string> &pkidSet)
             if (res != MDB_NOTFOUND)
                 checkError(res, "mdb_del (hints)");
 
+            dropPackageInputs(txn, pkid);
+
             LOG_INFO(m_log, "Dropped package {}", pkid);
         }
 
@@ -1187,6 +2072,10 @@ void DataStore::removePackages(const std::unordered_set<std::string> &pkidSet)
         quitTransaction(txn);
         throw;
     }
+
+    std::unique_lock lock(m_pkgStateCacheMutex);
+    for (const auto &pkid : pkidSet)
+        m_pkgStateCache.erase(pkid);
 }
 
 void DataStore::putBinaryValue(MDB_dbi dbi, const std::string &key, const std::vector<std::byte> &value)
@@ -1243,66 +2132,61 @@ std::vector<std::byte> DataStore::getBinaryValue(MDB_dbi dbi, const std::string
 
 std::vector<StatisticsEntry> DataStore::getStatistics()
 {
-    MDB_val dkey, dval;
-    MDB_cursor *cur = nullptr;
-
-    MDB_txn *txn = newTransaction(MDB_RDONLY);
-    try {
-        int res = mdb_cursor_open(txn, m_dbStats, &cur);
-        checkError(res, "mdb_cursor_open (stats)");
+    const auto points = queryStatistics(
+        std::numeric_limits<std::time_t>::min(), std::numeric_limits<std::time_t>::max());
 
-        std::vector<StatisticsEntry> stats;
-        stats.reserve(256);
-        while (mdb_cursor_get(cur, &dkey, &dval, MDB_NEXT) == 0) {
-            if (dkey.mv_size != sizeof(std::int64_t)) {
-                LOG_WARNING(m_log, "Skipping statistics entry with invalid key size: {}", dkey.mv_size);
-                continue;
-            }
-            std::int64_t keyTimeRaw = 0;
-            std::memcpy(&keyTimeRaw, dkey.mv_data, sizeof(keyTimeRaw));
-            std::time_t timestamp = static_cast<std::time_t>(keyTimeRaw);
+    std::vector<StatisticsEntry> stats;
+    stats.reserve(points.size());
+    for (const auto &point : points)
+        stats.push_back(pointToStatsEntry(point));
 
-            std::vector<std::byte> binaryData(
-                static_cast<const std::byte *>(dval.mv_data),
-                static_cast<const std::byte *>(dval.mv_data) + dval.mv_size);
-            if (!binaryData.empty() && static_cast<uint8_t>(binaryData[0]) == 1) {
-                // previously, data was stored in binary, instead of reading that data, we ignore it now
-                continue;
-            }
+    return stats;
+}
 
-            try {
-                auto entry = deserializeStatsEntry(timestamp, binaryData);
-                stats.push_back(std::move(entry));
-            } catch (const std::exception &e) {
-                LOG_WARNING(m_log, "Failed to deserialize statistics entry: {}", e.what());
-                continue;
-            }
-        }
+std::vector<StatisticsPoint> DataStore::queryStatistics(std::time_t from, std::time_t to, std::time_t interval)
+{
+    MDB_txn *txn = acquireReadTransaction();
+    try {
+        auto points = StatisticsSeries::query(txn, m_dbStatsSeries, from, to, interval);
+        releaseReadTransaction(txn);
+        return points;
+    } catch (...) {
+        releaseReadTransaction(txn);
+        throw;
+    }
+}
 
-        mdb_cursor_close(cur);
-        quitTransaction(txn);
+std::vector<StatisticsPoint> DataStore::readStatistics(StatisticsCursor &cursor)
+{
+    MDB_txn *txn = acquireReadTransaction();
+    try {
+        auto points = StatisticsSeries::readFrom(txn, m_dbStatsSeries, cursor);
+        releaseReadTransaction(txn);
+        return points;
+    } catch (...) {
+        releaseReadTransaction(txn);
+        throw;
+    }
+}
 
-        return stats;
+std::size_t DataStore::compactStatistics()
+{
+    MDB_txn *txn = newTransaction();
+    try {
+        const auto removed = StatisticsSeries::compact(txn, m_dbStatsSeries);
+        commitTransaction(txn);
+        return removed;
     } catch (...) {
-        if (cur)
-            mdb_cursor_close(cur);
         quitTransaction(txn);
         throw;
     }
 }
 
-void DataStore::removeStatistics(std::time_t time)
+void DataStore::addStatistics(const StatisticsEntry &stats)
 {
-    std::int64_t keyTime = time;
-    MDB_val dbkey;
-    dbkey.mv_size = sizeof(std::int64_t);
-    dbkey.mv_data = &keyTime;
-
     MDB_txn *txn = newTransaction();
     try {
-        int res = mdb_del(txn, m_dbStats, &dbkey, nullptr);
-        if (res != MDB_NOTFOUND)
-            checkError(res, "mdb_del");
+        StatisticsSeries::append(txn, m_dbStatsSeries, {statsEntryToPoint(stats)});
         commitTransaction(txn);
     } catch (...) {
         quitTransaction(txn);
@@ -1310,40 +2194,53 @@ void DataStore::removeStatistics(std::time_t time)
     }
 }
 
-void DataStore::addStatistics(const StatisticsEntry &stats)
+void DataStore::migrateLegacyStatistics(MDB_txn *txn)
 {
-    std::int64_t keyTime = stats.time;
-    MDB_val dbkey;
-    dbkey.mv_size = sizeof(std::int64_t);
-    dbkey.mv_data = &keyTime;
+    MDB_stat stat;
+    checkError(mdb_stat(txn, m_dbStats, &stat), "mdb_stat (stats)");
+    if (stat.ms_entries == 0)
+        return;
 
-    auto statsDataBytes = serializeStatsEntryData(stats);
-    MDB_val dbvalue;
-    dbvalue.mv_size = statsDataBytes.size();
-    dbvalue.mv_data = statsDataBytes.data();
+    LOG_INFO(m_log, "Moving {} statistics entries into the statistics series.", stat.ms_entries);
 
-    MDB_txn *txn = newTransaction();
+    MDB_val dkey, dval;
+    MDB_cursor *cur = nullptr;
+    std::vector<StatisticsPoint> points;
+    points.reserve(stat.ms_entries);
     try {
-        int res = mdb_put(txn, m_dbStats, &dbkey, &dbvalue, MDB_APPEND);
-        if (res == MDB_KEYEXIST) {
-            // this point in time already exists, but we do not allow overriding data - so we lie and shift
-            // the timestamp one second forward in time, to get a free slot
-            LOG_WARNING(m_log, "Statistics entry for timestamp {} already exists, skipping a second", stats.time);
+        checkError(mdb_cursor_open(txn, m_dbStats, &cur), "mdb_cursor_open (stats)");
 
-            quitTransaction(txn);
+        // the keys are timestamps, so we read the entries in order
+        while (mdb_cursor_get(cur, &dkey, &dval, MDB_NEXT) == 0) {
+            if (dkey.mv_size != sizeof(std::int64_t))
+                continue;
+            std::int64_t keyTimeRaw = 0;
+            std::memcpy(&keyTimeRaw, dkey.mv_data, sizeof(keyTimeRaw));
 
-            StatisticsEntry newStats;
-            newStats.time = stats.time + 1;
-            newStats.data = stats.data;
-            addStatistics(newStats);
-            return;
+            std::vector<std::byte> binaryData(
+                static_cast<const std::byte *>(dval.mv_data),
+                static_cast<const std::byte *>(dval.mv_data) + dval.mv_size);
+            if (!binaryData.empty() && static_cast<uint8_t>(binaryData[0]) == 1) {
+                // data of even older versions was stored in binary, which we ignore
+                continue;
+            }
+
+            try {
+                points.push_back(statsEntryToPoint(deserializeStatsEntry(keyTimeRaw, binaryData)));
+            } catch (const std::exception &e) {
+                LOG_WARNING(m_log, "Failed to deserialize statistics entry: {}", e.what());
+            }
         }
-        checkError(res, "mdb_put (stats)");
-        commitTransaction(txn);
+        mdb_cursor_close(cur);
+        cur = nullptr;
     } catch (...) {
-        quitTransaction(txn);
+        if (cur)
+            mdb_cursor_close(cur);
         throw;
     }
+
+    StatisticsSeries::append(txn, m_dbStatsSeries, points);
+    checkError(mdb_drop(txn, m_dbStats, 0), "mdb_drop (stats)");
 }
 
 void DataStore::addStatistics(
@@ -1433,4 +2330,37 @@ std::vector<std::string> DataStore::getPkidsMatching(const std::string &prefix)
     }
 }
 
+std::uint64_t DataStore::mapUsedBytes()
+{
+    if (!m_opened)
+        throw std::runtime_error("DataStore is not opened");
+
+    MDB_envinfo info;
+    MDB_stat stat;
+    checkError(mdb_env_info(m_dbEnv, &info), "mdb_env_info");
+    checkError(mdb_env_stat(m_dbEnv, &stat), "mdb_env_stat");
+    return static_cast<std::uint64_t>(info.me_last_pgno + 1) * stat.ms_psize;
+}
+
+std::uint64_t DataStore::mapSizeBytes()
+{
+    if (!m_opened)
+        throw std::runtime_error("DataStore is not opened");
+
+    MDB_envinfo info;
+    checkError(mdb_env_info(m_dbEnv, &info), "mdb_env_info");
+    return info.me_mapsize;
+}
+
+void DataStore::rebuildCompressionDictionaries()
+{
+    if (!m_opened)
+        throw std::runtime_error("DataStore is not opened");
+
+    LOG_INFO(m_log, "Rebuilding compression dictionaries of the main database");
+    m_xmlCodec.rebuild(m_dbEnv, m_dbDataXml, m_dbDictionaries);
+    m_yamlCodec.rebuild(m_dbEnv, m_dbDataYaml, m_dbDictionaries);
+    m_hintsCodec.rebuild(m_dbEnv, m_dbHints, m_dbDictionaries);
+}
+
 } // namespace ASGenerator
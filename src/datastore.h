@@ -26,14 +26,23 @@
 #include <filesystem>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <variant>
+#include <optional>
+#include <string_view>
+#include <deque>
 #include <appstream.h>
 #include <lmdb.h>
 
 #include "logging.h"
 #include "config.h"
+#include "valuecompressor.h"
+#include "statsseries.h"
+#include "packagehints.h"
+#include "backends/interfaces.h"
 
 namespace ASGenerator
 {
@@ -63,6 +72,121 @@ struct RepoInfo {
     static RepoInfo deserialize(const std::vector<std::byte> &data);
 };
 
+/**
+ * What the database knows about a package.
+ */
+enum class PackageState {
+    Unknown,  /// Not in the database
+    Ignored,  /// Known to not contain anything interesting
+    Processed /// Has components or hints
+};
+
+/**
+ * Record of the inputs a package's result was generated from.
+ */
+struct PackageInputs {
+    std::string pkid;
+    /// Digest of everything besides the package files that influenced the result
+    std::string environment;
+    /// Checksums of the relevant package files, by filename
+    std::unordered_map<std::string, std::string> files;
+
+    std::string serialize() const;
+    static PackageInputs deserialize(const std::string &data);
+};
+
+/**
+ * The few facts about a component that reports need, stored alongside its metadata
+ * so they can be read without parsing the metadata again.
+ */
+struct ComponentSummary {
+    AsComponentKind kind{AS_COMPONENT_KIND_UNKNOWN};
+    std::string cid;
+    /// Name of the cached icon, if the component has one
+    std::string iconName;
+
+    static ComponentSummary fromComponent(AsComponent *cpt);
+
+    std::string serialize() const;
+    static ComponentSummary deserialize(std::string_view data);
+};
+
+/**
+ * The identity of a package whose data was exported, which is all we need to
+ * export the data again without loading the package index.
+ */
+struct PackageRecord {
+    PackageKind kind{PackageKind::Physical};
+    std::string name;
+    std::string ver;
+    std::string arch;
+    std::string maintainer;
+
+    static PackageRecord fromPackage(const Package &pkg);
+
+    static std::string serializeList(const std::vector<PackageRecord> &records);
+    static std::vector<PackageRecord> deserializeList(std::string_view data);
+};
+
+class DataStore;
+
+/**
+ * Read-only view of the database contents at one point in time.
+ *
+ * Values are returned as views into the memory-mapped database, so nothing is copied
+ * unless they were stored compressed. They stay valid for as long as the snapshot exists. Snapshots are cheap to create,
+ * as the read transactions backing them are recycled.
+ */
+class DataSnapshot
+{
+public:
+    ~DataSnapshot();
+
+    DataSnapshot(DataSnapshot &&other) noexcept;
+    DataSnapshot &operator=(DataSnapshot &&other) = delete;
+
+    // Delete copy constructor and assignment operator
+    DataSnapshot(const DataSnapshot &) = delete;
+    DataSnapshot &operator=(const DataSnapshot &) = delete;
+
+    /**
+     * Get the raw packages database value of @pkid.
+     */
+    std::string_view packageValue(const std::string &pkid) const;
+
+    /**
+     * Get global component IDs for package
+     */
+    std::vector<std::string_view> gcidsForPackage(const std::string &pkid) const;
+
+    /**
+     * Get the metadata of component @gcid.
+     */
+    std::string_view metadata(DataType dtype, std::string_view gcid) const;
+
+    /**
+     * Get the stored hints record of @pkid, which can be read with PackageHints::decode().
+     */
+    std::string_view hints(const std::string &pkid) const;
+
+    /**
+     * Get the summary record of component @gcid, if one was stored.
+     */
+    std::optional<ComponentSummary> componentSummary(std::string_view gcid) const;
+
+private:
+    friend class DataStore;
+    DataSnapshot(DataStore *store, MDB_txn *txn);
+
+    std::string_view view(MDB_dbi dbi, std::string_view key) const;
+
+    DataStore *m_store;
+    MDB_txn *m_txn;
+
+    // decompressed values we handed out views of
+    mutable std::deque<std::string> m_buffers;
+};
+
 /**
  * Main database containing information about scanned packages,
  * the components they provide, the component metadata itself,
@@ -99,6 +223,12 @@ public:
      */
     void close();
 
+    /**
+     * Get a consistent, read-only view of the database, for reading many values at once
+     * without copying them.
+     */
+    DataSnapshot readSnapshot();
+
     /**
      * Check if metadata exists for given type and GCID
      */
@@ -114,6 +244,16 @@ public:
      */
     std::string getMetadata(DataType dtype, const std::string &gcid);
 
+    /**
+     * Store the summary record of component @gcid.
+     */
+    void setComponentSummary(const std::string &gcid, const ComponentSummary &summary);
+
+    /**
+     * Check if a summary record exists for component @gcid.
+     */
+    bool componentSummaryExists(const std::string &gcid);
+
     /**
      * Get the ID of the package that owns the component data stored for @gcid,
      * or an empty string if we have no record of it.
@@ -173,12 +313,17 @@ public:
     bool hasHints(const std::string &pkid);
 
     /**
-     * Set hints for package
+     * Set hints for package, from a JSON hints document
      */
     void setHints(const std::string &pkid, const std::string &hintsJson);
 
     /**
-     * Get hints for package
+     * Set hints for package
+     */
+    void setHints(const std::string &pkid, const PackageHints &hints);
+
+    /**
+     * Get hints for package, as JSON hints document
      */
     std::string getHints(const std::string &pkid);
 
@@ -202,6 +347,12 @@ public:
      */
     bool packageExists(const std::string &pkid);
 
+    /**
+     * Get the state of every package in @pkids, using at most one database
+     * transaction for the whole list.
+     */
+    std::vector<PackageState> getPackageStates(const std::vector<std::string> &pkids);
+
     /**
      * Add generator result to database.
      *
@@ -210,6 +361,35 @@ public:
      */
     void addGeneratorResult(DataType dtype, GeneratorResult &gres, bool alwaysRegenerate = false);
 
+    /**
+     * Store the record of the inputs that the latest result for a package name/architecture
+     * combination was generated from. @key identifies the combination, see @packageInputsKey.
+     */
+    void setPackageInputs(const std::string &key, const PackageInputs &inputs);
+
+    /**
+     * Get the inputs record stored for @key, if there is one.
+     */
+    std::optional<PackageInputs> getPackageInputs(const std::string &key);
+
+    /**
+     * Key under which the inputs of package @pkid are recorded.
+     */
+    static std::string packageInputsKey(const std::string &pkid);
+
+    /**
+     * Give package @toPkid the exact same result that @fromPkid has: components, metadata
+     * references and hints. Media is shared by component, so nothing needs to be copied.
+     *
+     * Values in the hints that refer to the old package version, like the name of its
+     * file, are changed to refer to the new one. Nothing is written if the result can
+     * not be reused.
+     *
+     * @return false if the result can not be reused, e.g. because one of its components
+     *         belongs to a different package by now or its metadata is gone.
+     */
+    bool cloneResult(DataType dtype, const std::string &fromPkid, const std::string &toPkid);
+
     /**
      * Get global component IDs for package
      */
@@ -237,6 +417,41 @@ public:
     std::unordered_map<std::string, std::vector<std::string>> getPackagesForGCIDs(
         std::unordered_set<std::string> gcids);
 
+    /**
+     * Remember the packages whose data was exported for @suite/@section/@arch.
+     */
+    void setPackageRecords(
+        const std::string &suite,
+        const std::string &section,
+        const std::string &arch,
+        const std::vector<PackageRecord> &records);
+
+    /**
+     * Get the packages recorded for @suite/@section/@arch by setPackageRecords(),
+     * or nothing if no list was recorded yet.
+     */
+    std::optional<std::vector<PackageRecord>> getPackageRecords(
+        const std::string &suite,
+        const std::string &section,
+        const std::string &arch);
+
+    /**
+     * Get the global component IDs whose media has been placed in the media directory
+     * of the immutable suite @suite already.
+     */
+    std::unordered_set<std::string> getSuiteMediaLinks(const std::string &suite);
+
+    /**
+     * Record that the media of @gcids has been placed in the media directory of @suite.
+     */
+    void addSuiteMediaLinks(const std::string &suite, const std::vector<std::string> &gcids);
+
+    /**
+     * Forget about all media placed in the media directory of @suite, e.g. because
+     * the directory was removed.
+     */
+    void clearSuiteMediaLinks(const std::string &suite);
+
     /**
      * Get set of all package IDs in database
      */
@@ -253,9 +468,22 @@ public:
     std::vector<StatisticsEntry> getStatistics();
 
     /**
-     * Remove statistics entry for given time
+     * Get the statistics recorded between @from and @to (inclusive), in order.
+     * If @interval is nonzero, return at most one point per suite/section for every
+     * @interval seconds.
      */
-    void removeStatistics(std::time_t time);
+    std::vector<StatisticsPoint> queryStatistics(std::time_t from, std::time_t to, std::time_t interval = 0);
+
+    /**
+     * Get the statistics recorded after @cursor, and advance it.
+     */
+    std::vector<StatisticsPoint> readStatistics(StatisticsCursor &cursor);
+
+    /**
+     * Drop statistics points that did not change anything compared to the next point
+     * of the same suite/section. Returns the number of points that were removed.
+     */
+    std::size_t compactStatistics();
 
     /**
      * Add statistics entry
@@ -292,7 +520,23 @@ public:
      */
     std::vector<std::string> getPkidsMatching(const std::string &prefix);
 
+    /**
+     * Train new compression dictionaries for the metadata and hints databases
+     * and recompress all values with them.
+     *
+     * This must not run while other generator processes use the database.
+     */
+    void rebuildCompressionDictionaries();
+
+    /**
+     * Number of bytes of the memory map that are in use, and total size of the map.
+     */
+    std::uint64_t mapUsedBytes();
+    std::uint64_t mapSizeBytes();
+
 private:
+    friend class DataSnapshot;
+
     quill::Logger *m_log;
     MDB_env *m_dbEnv;
     MDB_dbi m_dbRepoInfo;
@@ -302,6 +546,17 @@ private:
     MDB_dbi m_dbHints;
     MDB_dbi m_dbGcidRegistry;
     MDB_dbi m_dbStats;
+    MDB_dbi m_dbInputs;
+    MDB_dbi m_dbDictionaries;
+    MDB_dbi m_dbSummaries;
+    MDB_dbi m_dbStatsSeries;
+    MDB_dbi m_dbSuiteMedia;
+    MDB_dbi m_dbPackageLists;
+
+    // compression of the values of the metadata and hints databases
+    ValueCompressor m_xmlCodec;
+    ValueCompressor m_yamlCodec;
+    ValueCompressor m_hintsCodec;
 
     bool m_opened;
     AsMetadata *m_mdata;
@@ -315,6 +570,14 @@ private:
 
     mutable std::mutex m_mutex;
 
+    // read transactions that were reset and can be renewed, instead of creating new ones
+    std::vector<MDB_txn *> m_idleReadTxns;
+    std::mutex m_readTxnMutex;
+
+    // state of all packages known to be in the database, so lookups rarely need a transaction
+    std::unordered_map<std::string, PackageState> m_pkgStateCache;
+    std::shared_mutex m_pkgStateCacheMutex;
+
     /**
      * Create the media staging area of this run and mark it as in use, removing any
      * staging areas that runs which are no longer alive have left behind.
@@ -332,6 +595,11 @@ private:
      */
     void checkError(int rc, const std::string &msg);
 
+    /**
+     * Move statistics entries stored by older versions into the statistics series.
+     */
+    void migrateLegacyStatistics(MDB_txn *txn);
+
     /**
      * Print LMDB version debug info
      */
@@ -362,6 +630,38 @@ private:
      */
     void putKeyValue(MDB_dbi dbi, const std::string &key, const std::string &value);
 
+    /**
+     * Put key-value pair into database, as part of transaction @txn
+     */
+    void putKeyValue(MDB_txn *txn, MDB_dbi dbi, const std::string &key, const std::string &value);
+
+    /**
+     * Get a read-only transaction, reusing one that was used before if possible.
+     */
+    MDB_txn *acquireReadTransaction();
+
+    /**
+     * Hand back a transaction obtained from acquireReadTransaction(), so it can be reused.
+     */
+    void releaseReadTransaction(MDB_txn *txn);
+
+    /**
+     * Get the compressor for the values of @dbi, or nullptr if they are stored as-is.
+     */
+    const ValueCompressor *codecFor(MDB_dbi dbi) const;
+
+    /**
+     * Look up @dkey in @dbi, returning a view of the value without its terminating NUL.
+     * The view is valid for as long as @txn is, or as long as @buffer is if the value
+     * had to be decompressed into it.
+     */
+    std::string_view viewValue(MDB_txn *txn, MDB_dbi dbi, MDB_val dkey, std::string &buffer);
+
+    /**
+     * Set the value of @pkid in the packages database, keeping the state cache in sync.
+     */
+    void putPackageValue(const std::string &pkid, const std::string &value);
+
     /**
      * Get value from database using MDB_val key
      */
@@ -408,6 +708,25 @@ private:
      */
     void dropOrphanedData(MDB_dbi dbi, const std::unordered_set<std::string> &activeGCIDs);
 
+    /**
+     * Drop the records of media placed in suite directories for components that are gone,
+     * except for the suites in @keepSuites.
+     */
+    void dropOrphanedSuiteMediaLinks(
+        const std::unordered_set<std::string> &activeGCIDs,
+        const std::unordered_set<std::string> &keepSuites);
+
+    /**
+     * Drop the inputs record of @pkid within @txn, unless it belongs to a different
+     * version of the package by now.
+     */
+    void dropPackageInputs(MDB_txn *txn, const std::string &pkid);
+
+    /**
+     * Drop inputs records of packages that are not in the packages database anymore.
+     */
+    void dropOrphanedInputs();
+
     /**
      * Clean up empty directories
      */
@@ -20,6 +20,7 @@
 #include "dataunits.h"
 
 #include <string>
+#include <set>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -33,6 +34,14 @@
 
 using namespace ASGenerator;
 
+// files read by the units on this thread, if anyone is interested in them
+static thread_local std::vector<std::pair<const Package *, std::string>> *tlUnitReadLog = nullptr;
+
+void asg_units_set_thread_read_log(std::vector<std::pair<const Package *, std::string>> *readLog)
+{
+    tlUnitReadLog = readLog;
+}
+
 /* AsgPackageUnit implementation */
 
 /**
@@ -87,6 +96,36 @@ AsgPackageUnit *asg_package_unit_new(std::shared_ptr<Package> pkg)
     return unit;
 }
 
+/**
+ * Select the files of @contents that composing metadata will read in any case: metainfo
+ * and desktop-entry files, and the application icons of packages that have those.
+ */
+static std::set<std::string> composeInputFiles(const std::vector<std::string> &contents)
+{
+    // icons are only read if a component refers to them, so we don't want all icons of an icon theme
+    constexpr std::size_t maxPrefetchIcons = 32;
+
+    std::set<std::string> files;
+    std::vector<std::string> icons;
+    for (const auto &fname : contents) {
+        if (fname.ends_with(".xml")
+            && (fname.find("/share/metainfo/") != std::string::npos
+                || fname.find("/share/appdata/") != std::string::npos))
+            files.insert(fname);
+        else if (fname.ends_with(".desktop") && fname.find("/share/applications/") != std::string::npos)
+            files.insert(fname);
+        else if (
+            (fname.find("/share/icons/hicolor/") != std::string::npos && fname.find("/apps/") != std::string::npos)
+            || fname.find("/share/pixmaps/") != std::string::npos)
+            icons.push_back(fname);
+    }
+
+    if (!files.empty() && icons.size() <= maxPrefetchIcons)
+        files.insert(icons.begin(), icons.end());
+
+    return files;
+}
+
 static gboolean asg_package_unit_open_impl(AscUnit *unit, GError **error)
 {
     AsgPackageUnit *pkg_unit = ASG_PACKAGE_UNIT(unit);
@@ -108,8 +147,16 @@ static gboolean asg_package_unit_open_impl(AscUnit *unit, GError **error)
         for (const auto &filename : contents)
             g_ptr_array_add(contents_array, g_strdup(filename.c_str()));
         asc_unit_set_contents(unit, contents_array);
-
         priv->contents_loaded = true;
+
+        // let the backend read everything compose is going to ask for in one go
+        try {
+            priv->package->prefetchFiles(composeInputFiles(contents));
+        } catch (const std::exception &e) {
+            // the files will be read one by one later, where errors are reported properly
+            LOG_DEBUG(logRoot, "Unable to prefetch data of {}: {}", priv->package->id(), e.what());
+        }
+
         return TRUE;
 
     } catch (const std::exception &e) {
@@ -145,15 +192,8 @@ static gboolean asg_package_unit_dir_exists_impl(AscUnit *unit, const gchar *dir
         return FALSE;
     }
 
-    const std::string dirpath(dirname);
-    const std::string dirpath_slash = dirpath + "/";
-
-    for (const auto &file : priv->package->contents()) {
-        if (file.starts_with(dirpath_slash))
-            return TRUE;
-    }
-
-    return FALSE;
+    const std::string dirpath_slash = std::string(dirname) + "/";
+    return priv->package->contentsIndex()->containsPrefix(dirpath_slash);
 }
 
 static GBytes *asg_package_unit_read_data_impl(AscUnit *unit, const gchar *filename, GError **error)
@@ -170,17 +210,17 @@ static GBytes *asg_package_unit_read_data_impl(AscUnit *unit, const gchar *filen
 
     try {
         const std::string fname(filename);
-        auto data = priv->package->getFileData(fname);
+        g_autoptr(GBytes) bytes = priv->package->getFileBytes(fname);
+        if (tlUnitReadLog != nullptr)
+            tlUnitReadLog->emplace_back(priv->package.get(), fname);
 
-        if (data.empty()) {
+        if (g_bytes_get_size(bytes) == 0) {
             g_set_error(
                 error, ASC_COMPOSE_ERROR, ASC_COMPOSE_ERROR_FAILED, "File '%s' does not exist or is empty.", filename);
             return nullptr;
         }
 
-        // Create a copy of the data for GBytes
-        void *data_copy = g_memdup2(data.data(), data.size());
-        return g_bytes_new_take(data_copy, data.size());
+        return g_steal_pointer(&bytes);
 
     } catch (const std::exception &e) {
         LOG_ERROR(logRoot, "Failed to read data from package unit: {}", e.what());
@@ -391,17 +431,17 @@ static GBytes *asg_locale_unit_read_data_impl(AscUnit *unit, const gchar *filena
             return nullptr;
         }
 
-        auto data = pkg->getFileData(fname);
+        g_autoptr(GBytes) bytes = pkg->getFileBytes(fname);
+        if (tlUnitReadLog != nullptr)
+            tlUnitReadLog->emplace_back(pkg, fname);
 
-        if (data.empty()) {
+        if (g_bytes_get_size(bytes) == 0) {
             g_set_error(
                 error, ASC_COMPOSE_ERROR, ASC_COMPOSE_ERROR_FAILED, "File '%s' does not exist or is empty.", filename);
             return nullptr;
         }
 
-        // Create a copy of the data for GBytes
-        void *data_copy = g_memdup2(data.data(), data.size());
-        return g_bytes_new_take(data_copy, data.size());
+        return g_steal_pointer(&bytes);
 
     } catch (const std::exception &e) {
         LOG_ERROR(logRoot, "Failed to read data from locale unit: {}", e.what());
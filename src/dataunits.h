@@ -22,7 +22,8 @@
 #include <glib-object.h>
 #include <appstream-compose.h>
 #include <memory>
-
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "contentsstore.h"
@@ -48,4 +49,12 @@ AsgLocaleUnit *asg_locale_unit_new(
     std::shared_ptr<ASGenerator::ContentsStore> cstore,
     std::vector<std::shared_ptr<ASGenerator::Package>> pkgList);
 
+/**
+ * Record every file read through any data unit on the calling thread in @readLog,
+ * as (package, filename) pairs. Pass nullptr to stop recording.
+ *
+ * This works because a compose run happens entirely on the thread that started it.
+ */
+void asg_units_set_thread_read_log(std::vector<std::pair<const ASGenerator::Package *, std::string>> *readLog);
+
 G_END_DECLS
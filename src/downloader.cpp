@@ -34,6 +34,7 @@
 #include "defines.h"
 #include "config.h"
 #include "logging.h"
+#include "instrumentation.h"
 #include "utils.h"
 
 namespace ASGenerator
@@ -147,6 +148,7 @@ std::optional<std::chrono::system_clock::time_point> Downloader::downloadInterna
     if (!Utils::isRemote(url))
         throw DownloadException("URL is not remote");
 
+    ScopedTimer timer(PerfStage::Download);
     std::optional<std::chrono::system_clock::time_point> lastModified;
 
     /* the curl library is stupid; you can't make an AutoProtocol set timeouts */
@@ -213,6 +215,7 @@ std::optional<std::chrono::system_clock::time_point> Downloader::downloadInterna
         }
 
         curl_easy_cleanup(curl);
+        Instrumentation::get().count(PerfCounter::BytesDownloaded, static_cast<std::uint64_t>(dest.tellp()));
         LOG_DEBUG(m_log, "Downloaded {}", url);
 
     } catch (const DownloadException &) {
@@ -253,6 +256,7 @@ std::vector<std::uint8_t> Downloader::download(const std::string &url, std::uint
     if (!Utils::isRemote(url))
         throw DownloadException("URL is not remote");
 
+    ScopedTimer timer(PerfStage::Download);
     std::vector<std::uint8_t> buffer;
     std::optional<std::chrono::system_clock::time_point> lastModified;
 
@@ -316,6 +320,7 @@ std::vector<std::uint8_t> Downloader::download(const std::string &url, std::uint
         }
 
         curl_easy_cleanup(curl);
+        Instrumentation::get().count(PerfCounter::BytesDownloaded, buffer.size());
         LOG_DEBUG(m_log, "Downloaded {}", url);
 
     } catch (const DownloadException &) {
@@ -21,14 +21,17 @@
 #include "engine.h"
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <execution>
 #include <filesystem>
 #include <format>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <thread>
 #include <unordered_set>
+#include <sys/stat.h>
 
 #include <appstream.h>
 #include <glib.h>
@@ -41,9 +44,12 @@
 #include <inja/inja.hpp>
 
 #include "datainjectpkg.h"
+#include "recordedpkg.h"
 #include "extractor.h"
 #include "hintregistry.h"
+#include "instrumentation.h"
 #include "logging.h"
+#include "metrics.h"
 #include "result.h"
 #include "utils.h"
 #include "yaml-utils.h"
@@ -74,33 +80,43 @@ Engine::Engine()
     const auto maxThreads = std::max((long)numCPU > 6 ? 6L : numCPU, std::lround(numCPU * 0.60));
     m_taskArena = std::make_unique<tbb::task_arena>(maxThreads);
 
+    // Keep the packages worked on in parallel from using more memory or temporary disk space than allowed
+    m_governor = std::make_unique<ResourceGovernor>(
+        static_cast<std::uint64_t>(m_conf->memoryLimit) * 1024 * 1024,
+        static_cast<std::uint64_t>(m_conf->tempDiskLimit) * 1024 * 1024);
+
     // Select backend
+    std::unique_ptr<PackageIndex> backend;
     switch (m_conf->backend) {
     case Backend::Dummy:
-        m_pkgIndex = std::make_unique<DummyPackageIndex>(m_conf->archiveRoot);
+        backend = std::make_unique<DummyPackageIndex>(m_conf->archiveRoot);
         break;
     case Backend::Debian:
-        m_pkgIndex = std::make_unique<DebianPackageIndex>(m_conf->archiveRoot);
+        backend = std::make_unique<DebianPackageIndex>(m_conf->archiveRoot);
         break;
     case Backend::Ubuntu:
-        m_pkgIndex = std::make_unique<UbuntuPackageIndex>(m_conf->archiveRoot);
+        backend = std::make_unique<UbuntuPackageIndex>(m_conf->archiveRoot);
         break;
     case Backend::Archlinux:
-        m_pkgIndex = std::make_unique<ArchPackageIndex>(m_conf->archiveRoot);
+        backend = std::make_unique<ArchPackageIndex>(m_conf->archiveRoot);
         break;
     case Backend::RpmMd:
-        m_pkgIndex = std::make_unique<RPMPackageIndex>(m_conf->archiveRoot);
+        backend = std::make_unique<RPMPackageIndex>(m_conf->archiveRoot);
         break;
     case Backend::Alpinelinux:
-        m_pkgIndex = std::make_unique<AlpinePackageIndex>(m_conf->archiveRoot);
+        backend = std::make_unique<AlpinePackageIndex>(m_conf->archiveRoot);
         break;
     case Backend::FreeBSD:
-        m_pkgIndex = std::make_unique<FreeBSDPackageIndex>(m_conf->archiveRoot);
+        backend = std::make_unique<FreeBSDPackageIndex>(m_conf->archiveRoot);
         break;
     default:
         throw std::runtime_error("No backend specified, can not continue!");
     }
 
+    // share loaded package sets between all users, the budget is in MiB
+    m_pkgIndex = std::make_unique<PackageIndexCache>(
+        std::move(backend), static_cast<std::size_t>(m_conf->packageCacheSize) * 1024 * 1024);
+
     // set preferred prefix for this backend
     m_backendPathPrefix = Utils::normalizePath(m_pkgIndex->dataPrefix());
     m_backendPrefixNotUsr = m_backendPathPrefix != "/usr";
@@ -115,6 +131,9 @@ Engine::Engine()
     // Open package contents cache
     m_cstore = std::make_shared<ContentsStore>(m_backendPathPrefix);
     m_cstore->open(*m_conf);
+
+    // Persistent cache of rendered icons, shared by all icon handlers
+    m_iconRenderCache = std::make_shared<IconRenderCache>(m_conf->cacheRootDir() / "icon-render");
 }
 
 bool Engine::forced() const
@@ -127,6 +146,16 @@ void Engine::setForced(bool v)
     m_forced = v;
 }
 
+void Engine::setPerfReportFile(const fs::path &fname)
+{
+    m_perfReportFname = fname;
+}
+
+void Engine::setMetricsFile(const fs::path &fname)
+{
+    m_metricsFname = fname;
+}
+
 void Engine::logVersionInfo()
 {
     std::string backendInfo = "";
@@ -157,12 +186,191 @@ void Engine::checkLibfyamlVersion()
     }
 }
 
+std::string Engine::resultEnvironmentDigest(
+    AscImageFormat imageFormat,
+    const std::shared_ptr<InjectedModifications> &injMods,
+    const IconHandler &iconh) const
+{
+    const auto &ft = m_conf->feature;
+    std::string env = std::format(
+        "{}|{}|{}|{}|{}|{}|{}{}{}{}{}{}{}{}{}|{}|{}|{}",
+        ASGEN_VERSION,
+        as_version_string(),
+        m_conf->formatVersionStr(),
+        static_cast<int>(m_conf->metadataType),
+        asc_image_format_to_string(imageFormat),
+        m_backendPathPrefix,
+        ft.processDesktop,
+        ft.validate,
+        ft.storeScreenshots,
+        ft.processFonts,
+        ft.allowIconUpscale,
+        ft.processGStreamer,
+        ft.processLocale,
+        ft.screenshotVideos,
+        ft.propagateMetaInfoArtifacts,
+        m_conf->maxScrFileSize,
+        m_conf->mediaBaseUrl,
+        injMods ? injMods->sourceDigest() : "");
+
+    std::vector<std::string> customKeys;
+    for (const auto &[key, allowed] : m_conf->allowedCustomKeys)
+        customKeys.push_back(std::format("{}={}", key, allowed));
+    std::ranges::sort(customKeys);
+    env += "|" + Utils::joinStrings(customKeys, ",");
+
+    AscIconPolicyIter policyIter;
+    asc_icon_policy_iter_init(&policyIter, m_conf->iconPolicy());
+    guint iconSize, iconScale;
+    AscIconState iconState;
+    while (asc_icon_policy_iter_next(&policyIter, &iconSize, &iconScale, &iconState))
+        env += std::format("|{}@{}:{}", iconSize, iconScale, static_cast<int>(iconState));
+
+    // icons in the package itself are looked up through the themes of other packages
+    env += "|" + iconh.themesDigest();
+
+    g_autofree gchar *digest = g_compute_checksum_for_string(G_CHECKSUM_SHA256, env.c_str(), env.length());
+    return digest;
+}
+
+/**
+ * Digest of the package metadata (as opposed to its payload) that may end up in the result.
+ */
+static std::string packageDataDigest(Package &pkg)
+{
+    std::string data;
+    const auto appendSorted = [&data](const std::unordered_map<std::string, std::string> &map) {
+        std::vector<std::pair<std::string, std::string>> entries(map.begin(), map.end());
+        std::ranges::sort(entries);
+        for (const auto &[key, value] : entries)
+            data += std::format("{}={}\n", key, value);
+        data += "\n";
+    };
+    appendSorted(pkg.description());
+    appendSorted(pkg.summary());
+
+    const auto gst = pkg.gst();
+    if (gst.has_value()) {
+        for (const auto *list :
+             {&gst->decoders(), &gst->encoders(), &gst->elements(), &gst->uriSinks(), &gst->uriSources()})
+            data += Utils::joinStrings(*list, ",") + "\n";
+    }
+
+    g_autofree gchar *digest = g_compute_checksum_for_string(G_CHECKSUM_SHA256, data.c_str(), data.length());
+    return digest;
+}
+
+bool Engine::isResultInputFile(const std::string &fname) const
+{
+    // translations may be looked up for any component, wherever they are installed
+    if (fname.ends_with(".mo") || fname.ends_with(".qm"))
+        return true;
+
+    static constexpr std::array<std::string_view, 7> dataDirs =
+        {"metainfo/", "appdata/", "applications/", "icons/", "pixmaps/", "fonts/", "locale/"};
+
+    for (const auto &prefix : {std::string("/usr/share/"), m_backendPathPrefix + "/share/"}) {
+        if (!fname.starts_with(prefix))
+            continue;
+        const auto subPath = std::string_view(fname).substr(prefix.length());
+        for (const auto &dir : dataDirs) {
+            if (subPath.starts_with(dir))
+                return true;
+        }
+    }
+
+    return false;
+}
+
+bool Engine::reusePreviousResult(const std::shared_ptr<Package> &pkg, const std::string &envDigest)
+{
+    // Packages whose results depend on data we can not fingerprint are always processed
+    if (pkg->kind() != PackageKind::Physical || pkg->hasDesktopFileTranslations())
+        return false;
+
+    const auto &digests = pkg->fileDigests();
+    if (digests.empty())
+        return false;
+
+    const auto inputsKey = DataStore::packageInputsKey(pkg->id());
+    auto prev = m_dstore->getPackageInputs(inputsKey);
+    if (!prev.has_value() || prev->pkid == pkg->id())
+        return false;
+
+    if (prev->environment != std::format("{}:{}", envDigest, packageDataDigest(*pkg)))
+        return false;
+
+    // every file the previous result was made from must be unchanged...
+    for (const auto &[fname, digest] : prev->files) {
+        const auto it = digests.find(fname);
+        if (it == digests.end() || it->second != digest)
+            return false;
+    }
+
+    // ...and there must not be any new file that could have been picked up
+    for (const auto &[fname, digest] : digests) {
+        if (isResultInputFile(fname) && !prev->files.contains(fname))
+            return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_dstore->cloneResult(m_conf->metadataType, prev->pkid, pkg->id()))
+            return false;
+    }
+
+    LOG_INFO(m_log, "Reused result of {} for {}, its metadata inputs are unchanged", prev->pkid, pkg->id());
+
+    prev->pkid = pkg->id();
+    m_dstore->setPackageInputs(inputsKey, *prev);
+
+    return true;
+}
+
+void Engine::recordResultInputs(const GeneratorResult &gres, const std::string &envDigest)
+{
+    const auto pkg = gres.getPackage();
+    if (pkg->kind() != PackageKind::Physical || pkg->hasDesktopFileTranslations())
+        return;
+
+    const auto &digests = pkg->fileDigests();
+    if (digests.empty())
+        return;
+
+    PackageInputs inputs;
+    inputs.pkid = pkg->id();
+    inputs.environment = std::format("{}:{}", envDigest, packageDataDigest(*pkg));
+
+    // We can not tell whether data from other packages is still the same the next
+    // time around, so results depending on it are never reused.
+    if (gres.usesOtherPackages())
+        return;
+
+    for (const auto &[srcPkg, fname] : gres.inputFiles()) {
+        if (srcPkg != pkg.get())
+            return;
+
+        const auto it = digests.find(fname);
+        if (it == digests.end())
+            return;
+        inputs.files[fname] = it->second;
+    }
+
+    for (const auto &[fname, digest] : digests) {
+        if (isResultInputFile(fname))
+            inputs.files[fname] = digest;
+    }
+
+    m_dstore->setPackageInputs(DataStore::packageInputsKey(inputs.pkid), inputs);
+}
+
 void Engine::processPackages(
     const std::vector<std::shared_ptr<Package>> &pkgs,
     std::shared_ptr<IconHandler> iconh,
     std::shared_ptr<InjectedModifications> injMods,
     AscImageFormat imageFormat)
 {
+    ScopedTimer processTimer(PerfStage::Process);
     g_autoptr(AsgLocaleUnit) localeUnit = asg_locale_unit_new(m_cstore, pkgs);
 
     {
@@ -172,6 +380,15 @@ void Engine::processPackages(
                 std::format("Failed to open locale unit: {}", error ? error->message : "Unknown error"));
     }
 
+    const auto envDigest = resultEnvironmentDigest(imageFormat, injMods, *iconh);
+
+    // find out which packages we already know in one go
+    std::vector<std::string> pkids;
+    pkids.reserve(pkgs.size());
+    for (const auto &pkg : pkgs)
+        pkids.push_back(pkg->id());
+    const auto pkgStates = m_dstore->getPackageStates(pkids);
+
     const auto numProcessors = std::thread::hardware_concurrency();
     std::size_t chunkSize = pkgs.size() / numProcessors / 10;
     if (chunkSize > 100)
@@ -200,17 +417,39 @@ void Engine::processPackages(
 
                 for (std::size_t i = range.begin(); i != range.end(); ++i) {
                     auto pkg = pkgs[i];
-                    const auto &pkid = pkg->id();
+                    if (pkgStates[i] != PackageState::Unknown)
+                        continue;
+                    TraceSpan span("package", pkg->id());
 
-                    if (m_dstore->packageExists(pkid))
+                    // checking for a reusable result may already need the package to be downloaded
+                    auto reservation = m_governor->reserve(m_governor->processEstimate(*pkg));
+
+                    // a version bump that did not touch any of the metadata needs no processing
+                    if (reusePreviousResult(pkg, envDigest)) {
+                        Instrumentation::get().count(PerfCounter::PackagesReused);
+                        pkg->finish();
                         continue;
+                    }
 
                     auto res = mde->processPackage(pkg);
                     {
                         std::lock_guard<std::mutex> lock(m_mutex);
+                        ScopedTimer timer(PerfStage::DbCommit);
                         // Write resulting data into the database
                         m_dstore->addGeneratorResult(m_conf->metadataType, res);
                     }
+                    recordResultInputs(res, envDigest);
+
+                    auto &instr = Instrumentation::get();
+                    instr.count(PerfCounter::PackagesProcessed);
+                    instr.count(PerfCounter::Components, res.componentsCount());
+                    if (res.hintsCount() > 0) {
+                        instr.count(PerfCounter::Hints, res.hintsCount());
+                        instr.count(PerfCounter::HintsError, res.hintsCount(AS_ISSUE_SEVERITY_ERROR));
+                        instr.count(PerfCounter::HintsWarning, res.hintsCount(AS_ISSUE_SEVERITY_WARNING));
+                        instr.count(PerfCounter::HintsInfo, res.hintsCount(AS_ISSUE_SEVERITY_INFO));
+                        instr.count(PerfCounter::HintsPedantic, res.hintsCount(AS_ISSUE_SEVERITY_PEDANTIC));
+                    }
 
                     LOG_INFO(
                         m_log,
@@ -219,7 +458,9 @@ void Engine::processPackages(
                         res.componentsCount(),
                         res.hintsCount());
 
-                    // We don't need content data from this package anymore
+                    // We don't need content data from this package anymore, remember how much
+                    // temporary space it needed to better estimate its next version
+                    m_governor->recordDiskUsage(pkg->name(), pkg->tempDiskUsage());
                     pkg->finish();
                 }
             });
@@ -277,6 +518,8 @@ bool Engine::seedContentsData(
     const std::string &arch,
     const std::vector<std::shared_ptr<Package>> &pkgs)
 {
+    ScopedTimer seedTimer(PerfStage::ContentsSeed);
+
     const auto numProcessors = std::thread::hardware_concurrency();
     std::size_t workUnitSize = numProcessors * 2;
     if (workUnitSize >= pkgs.size())
@@ -295,14 +538,17 @@ bool Engine::seedContentsData(
     if (pkgs.empty() && !m_pkgIndex->hasChanges(m_dstore, suite.name, section, arch) && !m_forced) {
         LOG_DEBUG(
             m_log, "Skipping contents cache update for {}/{} [{}], index has not changed.", suite.name, section, arch);
+        m_pkgIndex->contentsAvailable(m_cstore, suite.name, section, arch);
         return false;
     }
 
     LOG_INFO(m_log, "Scanning new packages for {}/{} [{}]", suite.name, section, arch);
 
     std::vector<std::shared_ptr<Package>> packagesToProcess = pkgs;
-    if (packagesToProcess.empty())
+    if (packagesToProcess.empty()) {
+        ScopedTimer timer(PerfStage::IndexLoad);
         packagesToProcess = m_pkgIndex->packagesFor(suite.name, section, arch);
+    }
 
     // Get contents information for packages and add them to the database
     std::atomic_bool interestingFound = false;
@@ -310,7 +556,17 @@ bool Engine::seedContentsData(
     // First get the contents (only) of all packages in the base suite
     if (!suite.baseSuite.empty()) {
         LOG_INFO(m_log, "Scanning new packages for base suite {}/{} [{}]", suite.baseSuite, section, arch);
-        auto baseSuitePkgs = m_pkgIndex->packagesFor(suite.baseSuite, section, arch);
+        std::vector<std::shared_ptr<Package>> baseSuitePkgs;
+        {
+            ScopedTimer timer(PerfStage::IndexLoad);
+            baseSuitePkgs = m_pkgIndex->packagesFor(suite.baseSuite, section, arch);
+        }
+
+        std::vector<std::string> basePkids;
+        basePkids.reserve(baseSuitePkgs.size());
+        for (const auto &pkg : baseSuitePkgs)
+            basePkids.push_back(pkg->id());
+        const auto baseInContents = m_cstore->packagesExist(basePkids);
 
         m_taskArena->execute([&] {
             tbb::parallel_for(
@@ -319,9 +575,13 @@ bool Engine::seedContentsData(
                     for (size_t i = range.begin(); i != range.end(); ++i) {
                         auto pkg = baseSuitePkgs[i];
                         const auto &pkid = pkg->id();
+                        TraceSpan span("scan", pkid);
 
-                        if (!m_cstore->packageExists(pkid)) {
+                        ResourceGovernor::Reservation reservation;
+                        if (!baseInContents[i]) {
+                            reservation = m_governor->reserve(m_governor->scanEstimate(*pkg));
                             m_cstore->addContents(pkid, pkg->contents());
+                            Instrumentation::get().count(PerfCounter::PackagesScanned);
                             LOG_INFO(m_log, "Scanned {} for base suite.", pkid);
                         }
 
@@ -333,6 +593,15 @@ bool Engine::seedContentsData(
         });
     }
 
+    // Look up what we already know about the packages for all of them at once, rather
+    // than asking the databases about every single package
+    std::vector<std::string> pkids;
+    pkids.reserve(packagesToProcess.size());
+    for (const auto &pkg : packagesToProcess)
+        pkids.push_back(pkg->id());
+    const auto inContents = m_cstore->packagesExist(pkids);
+    const auto pkgStates = m_dstore->getPackageStates(pkids);
+
     // And then scan the suite itself - here packages can be 'interesting'
     // in that they might end up in the output.
     m_taskArena->execute([&] {
@@ -342,17 +611,19 @@ bool Engine::seedContentsData(
                 for (std::size_t i = range.begin(); i != range.end(); ++i) {
                     auto pkg = packagesToProcess[i];
                     const auto &pkid = pkg->id();
+                    TraceSpan span("scan", pkid);
 
                     std::vector<std::string> contents;
-                    if (m_cstore->packageExists(pkid)) {
-                        if (m_dstore->packageExists(pkid)) {
+                    ResourceGovernor::Reservation reservation;
+                    if (inContents[i]) {
+                        if (pkgStates[i] != PackageState::Unknown) {
                             // TODO: Unfortunately, packages can move between suites without changing their ID.
                             // This means as soon as we have an interesting package, even if we already processed it,
                             // we need to regenerate the output metadata.
                             // For that to happen, we set interestingFound to true here. Later, a more elegant solution
                             // would be desirable here, ideally one which doesn't force us to track which package is
                             // in which suite as well.
-                            if (!m_dstore->isIgnored(pkid))
+                            if (pkgStates[i] != PackageState::Ignored)
                                 interestingFound.store(true);
                             continue;
                         }
@@ -361,13 +632,16 @@ bool Engine::seedContentsData(
                         contents = m_cstore->getContents(pkid);
                     } else {
                         // Add contents to the index
+                        reservation = m_governor->reserve(m_governor->scanEstimate(*pkg));
                         contents = pkg->contents();
                         m_cstore->addContents(pkid, contents);
+                        Instrumentation::get().count(PerfCounter::PackagesScanned);
                     }
 
                     // Check if we can already mark this package as ignored, and print some log messages
                     if (!packageIsInteresting(pkg)) {
                         m_dstore->setPackageIgnore(pkid);
+                        Instrumentation::get().count(PerfCounter::PackagesIgnored);
                         LOG_INFO(m_log, "Scanned {}, no interesting files found.", pkid);
                         // We won't use this anymore
                         pkg->finish();
@@ -384,6 +658,8 @@ bool Engine::seedContentsData(
     // is run.
     m_cstore->sync();
 
+    m_pkgIndex->contentsAvailable(m_cstore, suite.name, section, arch);
+
     return interestingFound;
 }
 
@@ -443,6 +719,7 @@ void Engine::exportMetadata(
     const std::string &arch,
     const std::vector<std::shared_ptr<Package>> &pkgs)
 {
+    ScopedTimer exportTimer(PerfStage::Export);
     std::ostringstream mdataFile;
     std::ostringstream hintsFile;
 
@@ -473,6 +750,17 @@ void Engine::exportMetadata(
     else
         mediaExportDir = m_dstore->mediaExportPoolDir();
 
+    // Components whose media is in the suite directory already. If the directory is gone,
+    // all of it has to be placed there again.
+    std::unordered_set<std::string> linkedGCIDs;
+    std::unordered_set<std::string> newlyLinkedGCIDs;
+    if (useImmutableSuites) {
+        if (fs::exists(mediaExportDir))
+            linkedGCIDs = m_dstore->getSuiteMediaLinks(suite.name);
+        else
+            m_dstore->clearSuiteMediaLinks(suite.name);
+    }
+
     // Collect metadata, icons and hints for the given packages
     std::unordered_map<std::string, std::string> cidGcidMap;
     bool firstHintEntry = true;
@@ -482,16 +770,23 @@ void Engine::exportMetadata(
 
     tbb::parallel_for_each(pkgs.begin(), pkgs.end(), [&](std::shared_ptr<Package> pkg) {
         const auto &pkid = pkg->id();
-        auto gcids = m_dstore->getGCIDsForPackage(pkid);
-        if (!gcids.empty()) {
-            auto mres = m_dstore->getMetadataForPackage(m_conf->metadataType, pkid);
-            if (!mres.empty()) {
+
+        // read everything we need for this package from one snapshot, without copying it
+        const auto snapshot = m_dstore->readSnapshot();
+        const auto gcidViews = snapshot.gcidsForPackage(pkid);
+        if (!gcidViews.empty()) {
+            {
                 std::lock_guard<std::mutex> lock(exportMutex);
-                for (const auto &md : mres)
-                    mdataFile << md << "\n";
+                for (const auto &gcid : gcidViews) {
+                    const auto md = snapshot.metadata(m_conf->metadataType, gcid);
+                    if (!md.empty())
+                        mdataFile << md << "\n";
+                }
             }
 
-            for (const auto &gcid : gcids) {
+            for (const auto &gcidView : gcidViews) {
+                const std::string gcid(gcidView);
+                bool needsMediaLink = false;
                 {
                     std::lock_guard<std::mutex> lock(exportMutex);
                     const auto cid = Utils::getCidFromGlobalID(gcid);
@@ -499,30 +794,50 @@ void Engine::exportMetadata(
                         cidGcidMap[cid.value()] = gcid;
                     else
                         LOG_ERROR(m_log, "Could not extract component-ID from GCID: {}", gcid);
+
+                    // claim the component, so no other thread places the same media concurrently
+                    if (useImmutableSuites && !linkedGCIDs.contains(gcid))
+                        needsMediaLink = newlyLinkedGCIDs.insert(gcid).second;
                 }
 
-                // Hardlink data from the pool to the suite-specific directories
-                if (useImmutableSuites) {
+                // Place data from the pool in the suite-specific directories
+                if (needsMediaLink) {
                     const auto gcidMediaPoolPath = m_dstore->mediaExportPoolDir() / gcid;
                     const auto gcidMediaSuitePath = mediaExportDir / gcid;
-                    if (!fs::exists(gcidMediaSuitePath) && fs::exists(gcidMediaPoolPath))
-                        Utils::copyDir(gcidMediaPoolPath.string(), gcidMediaSuitePath.string(), true);
+                    // files that are present already are kept, which also completes interrupted runs
+                    if (fs::exists(gcidMediaPoolPath))
+                        Utils::cloneDir(gcidMediaPoolPath, gcidMediaSuitePath, m_conf->mediaPublishMode);
                 }
             }
         }
 
-        const auto hres = m_dstore->getHints(pkid);
+        // hints are stored in binary form, the JSON document is only generated for the export
+        const auto hintsData = snapshot.hints(pkid);
+        std::string hres;
+        if (PackageHints::isEncoded(hintsData)) {
+            try {
+                PackageHints::decode(hintsData).appendJson(hres, pkid);
+            } catch (const std::exception &e) {
+                LOG_ERROR(m_log, "Unable to read hints of package {}: {}", pkid, e.what());
+            }
+        } else {
+            hres = hintsData.substr(0, hintsData.find_last_not_of(" \t\n\r") + 1);
+        }
         if (!hres.empty()) {
             std::lock_guard<std::mutex> lock(exportMutex);
             if (firstHintEntry) {
                 firstHintEntry = false;
-                hintsFile << Utils::rtrimString(hres);
+                hintsFile << hres;
             } else {
-                hintsFile << ",\n" << Utils::rtrimString(hres);
+                hintsFile << ",\n" << hres;
             }
         }
     });
 
+    if (useImmutableSuites)
+        m_dstore->addSuiteMediaLinks(
+            suite.name, std::vector<std::string>(newlyLinkedGCIDs.begin(), newlyLinkedGCIDs.end()));
+
     fs::path dataBaseFname;
     if (m_conf->metadataType == DataType::XML)
         dataBaseFname = dataExportDir / std::format("Components-{}.xml", arch);
@@ -570,6 +885,13 @@ void Engine::exportMetadata(
     // (this allows other apps to just resolve the hint tags to severities and explanations
     // without loading either AppStream or AppStream-Generator code)
     saveHintsRegistryToJsonFile((m_conf->hintsExportDir / suite.name / "hint-definitions.json").string());
+
+    // Remember what we exported, so the data can be published again without loading the package index
+    std::vector<PackageRecord> pkgRecords;
+    pkgRecords.reserve(pkgs.size());
+    for (const auto &pkg : pkgs)
+        pkgRecords.push_back(PackageRecord::fromPackage(*pkg));
+    m_dstore->setPackageRecords(suite.name, section, arch, pkgRecords);
 }
 
 void Engine::exportIconTarballs(
@@ -577,17 +899,19 @@ void Engine::exportIconTarballs(
     const std::string &section,
     const std::vector<std::shared_ptr<Package>> &pkgs)
 {
+    ScopedTimer timer(PerfStage::IconTarballs);
+
     // Determine data sources and destinations
     const auto dataExportDir = m_conf->dataExportDir / suite.name / section;
     fs::create_directories(dataExportDir);
     const bool useImmutableSuites = m_conf->feature.immutableSuites;
     const auto mediaExportDir = useImmutableSuites ? m_dstore->mediaExportPoolDir().parent_path() / suite.name
                                                    : m_dstore->mediaExportPoolDir();
+    const auto manifestDir = m_conf->cacheRootDir() / "icon-tarballs" / suite.name / section;
+    fs::create_directories(manifestDir);
 
-    // Prepare icon-tarball array
-    std::unordered_map<std::string, std::vector<std::string>> iconTarFiles;
-
-    // Initialize icon policy iterator
+    // Collect the icon sizes we create tarballs for
+    std::vector<ImageSize> iconSizes;
     AscIconPolicyIter policyIter;
     asc_icon_policy_iter_init(&policyIter, m_conf->iconPolicy());
 
@@ -597,74 +921,116 @@ void Engine::exportIconTarballs(
     while (asc_icon_policy_iter_next(&policyIter, &iconSizeInt, &iconScale, &iconState)) {
         if (iconState == ASC_ICON_STATE_IGNORED || iconState == ASC_ICON_STATE_REMOTE_ONLY)
             continue; // We only want to create tarballs for cached icons
-
-        const ImageSize iconSize(iconSizeInt, iconSizeInt, iconScale);
-        iconTarFiles[iconSize.toString()] = std::vector<std::string>();
-        iconTarFiles[iconSize.toString()].reserve(256);
+        iconSizes.emplace_back(iconSizeInt, iconSizeInt, iconScale);
     }
 
     LOG_INFO(m_log, "Creating icon tarballs for: {}/{}", suite.name, section);
-    std::unordered_set<std::string> processedDirs;
-    std::mutex dirMutex;
-    std::mutex iconMutex;
 
+    // Find the cached icon of every component once. The summary records tell us its name, so we
+    // usually do not need to list the contents of the icon directories.
+    std::unordered_map<std::string, std::optional<std::string>> gcidIconNames;
+    std::mutex gcidMutex;
     tbb::parallel_for_each(pkgs.begin(), pkgs.end(), [&](std::shared_ptr<Package> pkg) {
-        const auto &pkid = pkg->id();
-        auto gcids = m_dstore->getGCIDsForPackage(pkid);
-        if (gcids.empty())
-            return;
-
-        for (const auto &gcid : gcids) {
-            // Compile list of icon-tarball files
-            AscIconPolicyIter ipIter;
-            asc_icon_policy_iter_init(&ipIter, m_conf->iconPolicy());
-            while (asc_icon_policy_iter_next(&ipIter, &iconSizeInt, &iconScale, &iconState)) {
-                if (iconState == ASC_ICON_STATE_IGNORED || iconState == ASC_ICON_STATE_REMOTE_ONLY)
-                    continue; // Only add icon to cache tarball if we want a cache for the particular size
-
-                const ImageSize iconSize(iconSizeInt, iconSizeInt, iconScale);
-                const auto iconDir = mediaExportDir / gcid / "icons" / iconSize.toString();
-
-                // Skip adding icon entries if we've already investigated this directory
-                {
-                    std::lock_guard<std::mutex> lock(dirMutex);
-                    if (processedDirs.contains(iconDir.string()))
-                        continue;
-                    else
-                        processedDirs.insert(iconDir.string());
-                }
+        const auto snapshot = m_dstore->readSnapshot();
+        for (const auto &gcidView : snapshot.gcidsForPackage(pkg->id())) {
+            const auto summary = snapshot.componentSummary(gcidView);
+            std::optional<std::string> iconName;
+            if (summary.has_value())
+                iconName = summary->iconName;
+
+            std::lock_guard<std::mutex> lock(gcidMutex);
+            gcidIconNames.emplace(gcidView, std::move(iconName));
+        }
+    });
 
-                if (!fs::exists(iconDir))
-                    continue;
+    struct IconTarball {
+        ArchiveType type;
+        std::string extension;
+    };
+    std::vector<IconTarball> tarballTypes = {
+        {ArchiveType::GZIP, "tar.gz"}
+    };
+    if (m_conf->feature.zstdIconTarballs)
+        tarballTypes.push_back({ArchiveType::ZSTD, "tar.zst"});
+
+    // Create the icon tarballs, all sizes at once
+    tbb::parallel_for_each(iconSizes.begin(), iconSizes.end(), [&](const ImageSize &iconSize) {
+        const auto sizeStr = iconSize.toString();
+
+        // icon files, together with the state we record in the manifest
+        std::vector<std::pair<std::string, std::string>> iconFiles;
+        const auto addIconFile = [&iconFiles](const fs::path &fname) {
+            struct stat st;
+            if (stat(fname.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+                return false;
+            iconFiles.emplace_back(
+                fname.string(), std::format("{}\t{}.{}", st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec));
+            return true;
+        };
+        for (const auto &[gcid, iconName] : gcidIconNames) {
+            if (iconName.has_value() && iconName->empty())
+                continue;
+
+            const auto iconDir = mediaExportDir / gcid / "icons" / sizeStr;
+            if (iconName.has_value() && addIconFile(iconDir / iconName.value()))
+                continue;
+
+            // the icon of this size may have a different name, or the component was stored without summary
+            std::error_code ec;
+            for (const auto &entry : fs::directory_iterator(iconDir, ec))
+                addIconFile(entry.path());
+        }
+        std::sort(iconFiles.begin(), iconFiles.end());
 
-                for (const auto &entry : fs::directory_iterator(iconDir)) {
-                    if (entry.is_regular_file()) {
-                        std::lock_guard<std::mutex> lock(iconMutex);
-                        iconTarFiles[iconSize.toString()].push_back(entry.path().string());
-                    }
-                }
+        // Skip creating the tarballs if none of the icons changed since we last built them
+        std::string manifest;
+        manifest.reserve(iconFiles.size() * 128);
+        for (const auto &[fname, state] : iconFiles)
+            manifest += std::format("{}\t{}\n", fname, state);
+        g_autofree gchar *manifestDigest = g_compute_checksum_for_string(
+            G_CHECKSUM_SHA256, manifest.c_str(), manifest.size());
+
+        const auto manifestFname = manifestDir / std::format("icons-{}.manifest", sizeStr);
+        bool tarballsExist = true;
+        for (const auto &tarball : tarballTypes) {
+            if (!fs::exists(dataExportDir / std::format("icons-{}.{}", sizeStr, tarball.extension)))
+                tarballsExist = false;
+        }
+        if (tarballsExist && fs::exists(manifestFname)) {
+            std::ifstream mf(manifestFname);
+            std::string lastDigest;
+            std::getline(mf, lastDigest);
+            if (lastDigest == manifestDigest) {
+                LOG_DEBUG(m_log, "Icon tarball {} of {}/{} is up to date", sizeStr, suite.name, section);
+                return;
             }
         }
-    });
 
-    // Create the icon tarballs
-    asc_icon_policy_iter_init(&policyIter, m_conf->iconPolicy());
-    while (asc_icon_policy_iter_next(&policyIter, &iconSizeInt, &iconScale, &iconState)) {
-        if (iconState == ASC_ICON_STATE_IGNORED || iconState == ASC_ICON_STATE_REMOTE_ONLY)
-            continue;
+        for (const auto &tarball : tarballTypes) {
+            const auto tarFname = dataExportDir / std::format("icons-{}.{}", sizeStr, tarball.extension);
+            const auto tarTmpFname = fs::path(tarFname.string() + ".new");
 
-        const ImageSize iconSize(iconSizeInt, iconSizeInt, iconScale);
-        auto iconTar = std::make_unique<ArchiveCompressor>(ArchiveType::GZIP);
-        iconTar->open((dataExportDir / std::format("icons-{}.tar.gz", iconSize.toString())).string());
+            ArchiveCompressor iconTar(tarball.type);
+            iconTar.open(tarTmpFname.string());
+            for (const auto &iconFile : iconFiles)
+                iconTar.addFile(iconFile.first);
+            iconTar.close();
 
-        auto &iconFiles = iconTarFiles[iconSize.toString()];
-        std::sort(iconFiles.begin(), iconFiles.end());
+            fs::rename(tarTmpFname, tarFname);
+        }
 
-        for (const auto &fname : iconFiles)
-            iconTar->addFile(fname);
+        std::ofstream mf(manifestFname, std::ios::trunc);
+        mf << manifestDigest << "\n";
+    });
 
-        iconTar->close();
+    // drop tarball variants we do not create anymore
+    if (!m_conf->feature.zstdIconTarballs) {
+        for (const auto &iconSize : iconSizes) {
+            std::error_code ec;
+            fs::remove(dataExportDir / std::format("icons-{}.tar.zst", iconSize.toString()), ec);
+        }
     }
+
     LOG_INFO(m_log, "Icon tarballs built for: {}/{}", suite.name, section);
 }
 
@@ -677,6 +1043,7 @@ std::unordered_map<std::string, std::shared_ptr<Package>> Engine::getIconCandida
     // on Debian and Ubuntu. Load the "core" and "extra" components for Arch Linux.
     // FIXME: This is a hack, find a sane way to get rid of this, or at least get rid of the
     // distro-specific hardcoding.
+    ScopedTimer timer(PerfStage::IndexLoad);
     std::vector<std::shared_ptr<Package>> pkgs;
 
     for (const auto &newSection : std::vector<std::string>{"main", "universe", "core", "extra"}) {
@@ -769,55 +1136,120 @@ bool Engine::processSuiteSection(const Suite &suite, const std::string &section,
     std::vector<std::shared_ptr<Package>> sectionPkgs;
     bool suiteDataChanged = false;
 
-    for (const auto &arch : suite.architectures) {
-        // Update package contents information and flag boring packages as ignored
-        const bool foundInteresting = seedContentsData(suite, section, arch) || m_forced;
+    const auto iconCacheHitsStart = m_iconRenderCache->hits();
+    const auto iconCacheMissesStart = m_iconRenderCache->misses();
+    m_governor->resetStats();
 
-        // Check if the suite/section/arch has actually changed
-        if (!foundInteresting) {
-            LOG_INFO(
-                m_log,
-                "Skipping {}/{} [{}], no interesting new packages since last update.",
-                suite.name,
-                section,
-                arch);
-            continue;
-        }
-
-        // Process new packages
-        auto pkgs = m_pkgIndex->packagesFor(suite.name, section, arch);
-        auto iconh = std::make_shared<IconHandler>(
-            *m_cstore,
-            getIconCandidatePackages(suite, section, arch),
-            suite.imageFormat,
-            suite.iconTheme,
-            m_pkgIndex->dataPrefix());
-        processPackages(pkgs, iconh, injMods, suite.imageFormat);
-
-        // Read injected data and add it to the database as a fake package
-        auto fakePkg = processExtraMetainfoData(suite, std::move(iconh), section, arch, injMods);
-        if (fakePkg)
-            pkgs.push_back(std::move(fakePkg));
-
-        // Export package data
-        exportMetadata(suite, section, arch, pkgs);
-        suiteDataChanged = true;
-
-        // We store the package info over all architectures to generate reports later
-        sectionPkgs.reserve(sectionPkgs.capacity() + pkgs.size());
-        sectionPkgs.insert(sectionPkgs.end(), pkgs.begin(), pkgs.end());
+    {
+        // Keep the package sets of this section loaded while all of its architectures are processed,
+        // seeding the contents, processing and the icon lookup all need them.
+        PackageIndexCache::Pin sectionPin(*m_pkgIndex, suite.name, section);
+        PackageIndexCache::Pin baseSectionPin(*m_pkgIndex, suite.baseSuite, section);
+
+        for (const auto &arch : suite.architectures) {
+            Instrumentation::get().setScope(suite.name, section, arch);
+
+            // Update package contents information and flag boring packages as ignored
+            const bool foundInteresting = seedContentsData(suite, section, arch) || m_forced;
+
+            // Check if the suite/section/arch has actually changed
+            if (!foundInteresting) {
+                LOG_INFO(
+                    m_log,
+                    "Skipping {}/{} [{}], no interesting new packages since last update.",
+                    suite.name,
+                    section,
+                    arch);
+                continue;
+            }
 
-        // Log progress
-        LOG_INFO(m_log, "Completed metadata processing of {}/{} [{}]", suite.name, section, arch);
+            // Process new packages
+            std::vector<std::shared_ptr<Package>> pkgs;
+            {
+                ScopedTimer timer(PerfStage::IndexLoad);
+                pkgs = m_pkgIndex->packagesFor(suite.name, section, arch);
+            }
+            auto iconh = std::make_shared<IconHandler>(
+                *m_cstore,
+                getIconCandidatePackages(suite, section, arch),
+                suite.imageFormat,
+                suite.iconTheme,
+                m_pkgIndex->dataPrefix(),
+                m_iconRenderCache);
+            processPackages(pkgs, iconh, injMods, suite.imageFormat);
+
+            // Read injected data and add it to the database as a fake package
+            auto fakePkg = processExtraMetainfoData(suite, std::move(iconh), section, arch, injMods);
+            if (fakePkg)
+                pkgs.push_back(std::move(fakePkg));
+
+            // Export package data
+            exportMetadata(suite, section, arch, pkgs);
+            suiteDataChanged = true;
+
+            // We store the package info over all architectures to generate reports later
+            sectionPkgs.reserve(sectionPkgs.capacity() + pkgs.size());
+            sectionPkgs.insert(sectionPkgs.end(), pkgs.begin(), pkgs.end());
+
+            // Log progress
+            LOG_INFO(m_log, "Completed metadata processing of {}/{} [{}]", suite.name, section, arch);
+        }
     }
 
     // Finalize
+    Instrumentation::get().setScope(suite.name, section);
     if (suiteDataChanged) {
         // Export icons for the found packages in this section
         exportIconTarballs(suite, section, sectionPkgs);
 
+        // Record how often we could avoid rendering icons again
+        std::unordered_map<std::string, MetaValue> runStats;
+        const auto iconCacheHits = m_iconRenderCache->hits() - iconCacheHitsStart;
+        const auto iconCacheMisses = m_iconRenderCache->misses() - iconCacheMissesStart;
+        if (iconCacheHits + iconCacheMisses > 0) {
+            LOG_INFO(
+                m_log,
+                "Icon render cache for {}/{}: {} hits, {} misses ({:.1f}% hit rate)",
+                suite.name,
+                section,
+                iconCacheHits,
+                iconCacheMisses,
+                100.0 * static_cast<double>(iconCacheHits) / static_cast<double>(iconCacheHits + iconCacheMisses));
+            runStats["iconRenderCacheHits"] = static_cast<std::int64_t>(iconCacheHits);
+            runStats["iconRenderCacheMisses"] = static_cast<std::int64_t>(iconCacheMisses);
+        }
+
+        // Record how much the packages reserved at most at the same time, and how often they had to wait
+        const auto admission = m_governor->stats();
+        if (admission.waits > 0)
+            LOG_INFO(
+                m_log,
+                "Packages of {}/{} waited for resources {} times, {:.1f}s in total",
+                suite.name,
+                section,
+                admission.waits,
+                std::chrono::duration<double>(admission.waitTime).count());
+        runStats["reservedMemoryPeak"] = static_cast<std::int64_t>(admission.peak.memory);
+        runStats["reservedTempDiskPeak"] = static_cast<std::int64_t>(admission.peak.disk);
+        runStats["reservedMemory"] = static_cast<std::int64_t>(admission.reserved.memory);
+        runStats["reservedTempDisk"] = static_cast<std::int64_t>(admission.reserved.disk);
+        runStats["admissionWaits"] = static_cast<std::int64_t>(admission.waits);
+        runStats["admissionWaitTimeMs"] = static_cast<std::int64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(admission.waitTime).count());
+
+        // Keep the time spent in the individual stages along with the other statistics. The
+        // report is only rendered after they are stored, so its time is part of the summary only.
+        const auto perfSummary = Instrumentation::get().sectionSummary(suite.name, section);
+        for (std::size_t i = 0; i < PerfStageCount; i++) {
+            const auto &timing = perfSummary.stages[i];
+            if (timing.calls > 0)
+                runStats[std::format("{}TimeMs", perfStageName(static_cast<PerfStage>(i)))] = static_cast<std::int64_t>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(timing.total).count());
+        }
+
         // Write reports & statistics and render HTML, if that option is selected
-        reportgen->processFor(suite.name, section, sectionPkgs);
+        ScopedTimer timer(PerfStage::ReportRender);
+        reportgen->processFor(suite.name, section, sectionPkgs, runStats);
     }
 
     // Release the index to free some memory
@@ -925,7 +1357,8 @@ bool Engine::processFile(
             getIconCandidatePackages(suite, sectionName, arch),
             suite.imageFormat,
             suite.iconTheme,
-            m_pkgIndex->dataPrefix());
+            m_pkgIndex->dataPrefix(),
+            m_iconRenderCache);
         processPackages(pkgs, std::move(iconh), nullptr, suite.imageFormat);
     }
 
@@ -936,6 +1369,7 @@ void Engine::run()
 {
     logVersionInfo();
     checkLibfyamlVersion();
+    Instrumentation::get().reset();
 
     bool dataChanged = false;
     auto reportgen = std::make_shared<ReportGenerator>(m_dstore.get());
@@ -965,9 +1399,7 @@ void Engine::run()
 
     // Render index pages & statistics
     printHeaderBox("Updating Global Data");
-    reportgen->updateIndexPages();
-    if (dataChanged)
-        reportgen->exportStatistics();
+    finishRun(*reportgen, dataChanged);
 }
 
 void Engine::run(const std::string &suiteName)
@@ -982,6 +1414,7 @@ void Engine::run(const std::string &suiteName)
 
     logVersionInfo();
     checkLibfyamlVersion();
+    Instrumentation::get().reset();
 
     auto reportgen = std::make_shared<ReportGenerator>(m_dstore.get());
 
@@ -993,9 +1426,7 @@ void Engine::run(const std::string &suiteName)
     }
 
     // Render index pages & statistics
-    reportgen->updateIndexPages();
-    if (dataChanged)
-        reportgen->exportStatistics();
+    finishRun(*reportgen, dataChanged);
 }
 
 void Engine::run(const std::string &suiteName, const std::string &sectionName)
@@ -1010,6 +1441,7 @@ void Engine::run(const std::string &suiteName, const std::string &sectionName)
 
     logVersionInfo();
     checkLibfyamlVersion();
+    Instrumentation::get().reset();
 
     bool sectionValid = false;
     for (const auto &section : suite.sections) {
@@ -1027,15 +1459,170 @@ void Engine::run(const std::string &suiteName, const std::string &sectionName)
     auto dataChanged = processSuiteSection(suite, sectionName, reportgen);
 
     // Render index pages & statistics
-    reportgen->updateIndexPages();
-    if (dataChanged)
-        reportgen->exportStatistics();
+    finishRun(*reportgen, dataChanged);
+}
+
+void Engine::finishRun(ReportGenerator &reportgen, bool dataChanged)
+{
+    auto &instr = Instrumentation::get();
+    instr.setScope({}, {});
+    {
+        ScopedTimer timer(PerfStage::ReportRender);
+        reportgen.updateIndexPages();
+        if (dataChanged)
+            reportgen.exportStatistics();
+    }
+
+    printHeaderBox("Performance Summary");
+    for (const auto &line : instr.summaryTable())
+        LOG_INFO(m_log, "{}", line);
+
+    writeMetrics("run");
+
+    if (m_perfReportFname.empty())
+        return;
+    std::ofstream f(m_perfReportFname);
+    f << instr.toJson().dump(2) << "\n";
+    if (!f)
+        LOG_ERROR(m_log, "Unable to write timings to {}", m_perfReportFname.string());
+}
+
+void Engine::writeMetrics(const std::string &command)
+{
+    if (m_metricsFname.empty())
+        return;
+
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+    const auto &instr = Instrumentation::get();
+    std::vector<MetricFamily> families;
+
+    MetricFamily buildInfo{"asgen_build", "info", "Version of the generator that wrote these metrics.", {}, {}};
+    buildInfo.add(1, {{"version", ASGEN_VERSION}});
+    families.push_back(std::move(buildInfo));
+
+    MetricFamily lastRun{
+        "asgen_last_run_timestamp_seconds", "gauge", "Time the last command finished.", "seconds", {}};
+    lastRun.add(
+        std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count(),
+        {{"command", command}});
+    families.push_back(std::move(lastRun));
+
+    MetricFamily duration{
+        "asgen_last_run_duration_seconds", "gauge", "Time the last command took to complete.", "seconds", {}};
+    duration.add(std::chrono::duration<double>(instr.elapsed()).count(), {{"command", command}});
+    families.push_back(std::move(duration));
+
+    // per suite/section/architecture data of the instrumentation
+    MetricFamily packages{"asgen_packages", "gauge", "Number of packages handled, by state.", {}, {}};
+    MetricFamily components{"asgen_components", "gauge", "Number of components found.", {}, {}};
+    MetricFamily hints{"asgen_hints", "gauge", "Number of issue hints emitted, by severity.", {}, {}};
+    MetricFamily downloaded{"asgen_downloaded_bytes", "gauge", "Amount of data downloaded.", "bytes", {}};
+    MetricFamily decompressed{
+        "asgen_decompressed_bytes", "gauge", "Amount of data read from package archives.", "bytes", {}};
+    MetricFamily stageTime{
+        "asgen_stage_duration_seconds", "gauge", "Time spent in the individual stages.", "seconds", {}};
+    MetricFamily stageCalls{"asgen_stage_calls", "gauge", "Number of times a stage was entered.", {}, {}};
+
+    for (const auto &scope : instr.summaries()) {
+        const Labels scopeLabels = {{"suite", scope.suite}, {"section", scope.section}, {"arch", scope.arch}};
+        const auto withLabel = [&scopeLabels](const std::string &name, const std::string &value) {
+            auto labels = scopeLabels;
+            labels.emplace_back(name, value);
+            return labels;
+        };
+        const auto counter = [&scope](PerfCounter c) {
+            return static_cast<double>(scope.counters[static_cast<std::size_t>(c)]);
+        };
+
+        packages.add(counter(PerfCounter::PackagesScanned), withLabel("state", "scanned"));
+        packages.add(counter(PerfCounter::PackagesIgnored), withLabel("state", "ignored"));
+        packages.add(counter(PerfCounter::PackagesProcessed), withLabel("state", "processed"));
+        packages.add(counter(PerfCounter::PackagesReused), withLabel("state", "reused"));
+        components.add(counter(PerfCounter::Components), scopeLabels);
+        hints.add(counter(PerfCounter::HintsError), withLabel("severity", "error"));
+        hints.add(counter(PerfCounter::HintsWarning), withLabel("severity", "warning"));
+        hints.add(counter(PerfCounter::HintsInfo), withLabel("severity", "info"));
+        hints.add(counter(PerfCounter::HintsPedantic), withLabel("severity", "pedantic"));
+        downloaded.add(counter(PerfCounter::BytesDownloaded), scopeLabels);
+        decompressed.add(counter(PerfCounter::BytesDecompressed), scopeLabels);
+
+        for (std::size_t i = 0; i < PerfStageCount; i++) {
+            const auto &timing = scope.stages[i];
+            if (timing.calls == 0)
+                continue;
+            const auto stageName = perfStageName(static_cast<PerfStage>(i));
+            stageTime.add(std::chrono::duration<double>(timing.total).count(), withLabel("stage", stageName));
+            stageCalls.add(static_cast<double>(timing.calls), withLabel("stage", stageName));
+        }
+    }
+    families.push_back(std::move(packages));
+    families.push_back(std::move(components));
+    families.push_back(std::move(hints));
+    families.push_back(std::move(downloaded));
+    families.push_back(std::move(decompressed));
+    families.push_back(std::move(stageTime));
+    families.push_back(std::move(stageCalls));
+
+    MetricFamily mapUsed{"asgen_database_map_used_bytes", "gauge", "Space used in the database maps.", "bytes", {}};
+    MetricFamily mapSize{"asgen_database_map_size_bytes", "gauge", "Size of the database maps.", "bytes", {}};
+    mapUsed.add(static_cast<double>(m_dstore->mapUsedBytes()), {{"database", "main"}});
+    mapSize.add(static_cast<double>(m_dstore->mapSizeBytes()), {{"database", "main"}});
+    mapUsed.add(static_cast<double>(m_cstore->mapUsedBytes()), {{"database", "contents"}});
+    mapSize.add(static_cast<double>(m_cstore->mapSizeBytes()), {{"database", "contents"}});
+    families.push_back(std::move(mapUsed));
+    families.push_back(std::move(mapSize));
+
+    // walk the media pool, skipping over anything that vanishes or can not be read meanwhile
+    std::uint64_t poolBytes = 0;
+    std::uint64_t poolFiles = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator
+             it(m_dstore->mediaExportPoolDir(), fs::directory_options::skip_permission_denied, ec),
+         end;
+         !ec && it != end;
+         it.increment(ec)) {
+        std::error_code fileEc;
+        if (!it->is_regular_file(fileEc))
+            continue;
+        const auto size = it->file_size(fileEc);
+        if (fileEc)
+            continue;
+        poolBytes += size;
+        poolFiles++;
+    }
+    MetricFamily mediaBytes{"asgen_media_pool_bytes", "gauge", "Size of the media pool.", "bytes", {}};
+    mediaBytes.add(static_cast<double>(poolBytes));
+    MetricFamily mediaFiles{"asgen_media_pool_files", "gauge", "Number of files in the media pool.", {}, {}};
+    mediaFiles.add(static_cast<double>(poolFiles));
+    families.push_back(std::move(mediaBytes));
+    families.push_back(std::move(mediaFiles));
+
+    const auto cacheHits = m_iconRenderCache->hits();
+    const auto cacheMisses = m_iconRenderCache->misses();
+    MetricFamily cacheLookups{
+        "asgen_icon_render_cache_lookups", "gauge", "Lookups in the icon render cache, by result.", {}, {}};
+    cacheLookups.add(static_cast<double>(cacheHits), {{"result", "hit"}});
+    cacheLookups.add(static_cast<double>(cacheMisses), {{"result", "miss"}});
+    MetricFamily cacheRatio{
+        "asgen_icon_render_cache_hit_ratio", "gauge", "Share of icon render cache lookups that were hits.", {}, {}};
+    cacheRatio.add(
+        cacheHits + cacheMisses > 0 ? static_cast<double>(cacheHits) / static_cast<double>(cacheHits + cacheMisses)
+                                    : 0.0);
+    families.push_back(std::move(cacheLookups));
+    families.push_back(std::move(cacheRatio));
+
+    try {
+        writeOpenMetricsFile(m_metricsFname, families);
+    } catch (const std::exception &e) {
+        LOG_ERROR(m_log, "Unable to write metrics: {}", e.what());
+    }
 }
 
 void Engine::publishMetadataForSuiteSection(
     const Suite &suite,
     const std::string &section,
-    std::shared_ptr<ReportGenerator> rgen)
+    std::shared_ptr<ReportGenerator> rgen,
+    bool fromRecords)
 {
     auto reportgen = std::move(rgen);
     if (!reportgen)
@@ -1043,8 +1630,25 @@ void Engine::publishMetadataForSuiteSection(
 
     std::vector<std::shared_ptr<Package>> sectionPkgs;
     for (const auto &arch : suite.architectures) {
-        // Process new packages
-        auto pkgs = m_pkgIndex->packagesFor(suite.name, section, arch);
+        std::vector<std::shared_ptr<Package>> pkgs;
+        if (fromRecords) {
+            // Use the packages we exported last time, without looking at the archive
+            const auto records = m_dstore->getPackageRecords(suite.name, section, arch);
+            if (!records.has_value()) {
+                LOG_WARNING(
+                    m_log,
+                    "No packages were recorded for {}/{} [{}] yet, skipping it. Run `publish` once to record them.",
+                    suite.name,
+                    section,
+                    arch);
+                continue;
+            }
+            pkgs.reserve(records->size());
+            for (const auto &record : records.value())
+                pkgs.push_back(std::make_shared<RecordedPackage>(record));
+        } else {
+            pkgs = m_pkgIndex->packagesFor(suite.name, section, arch);
+        }
 
         // Export package data
         exportMetadata(suite, section, arch, pkgs);
@@ -1068,24 +1672,28 @@ void Engine::publishMetadataForSuiteSection(
 
 void Engine::publish(const std::string &suiteName)
 {
-    // Fetch suite and exit in case we can't write to it.
-    auto scResult = checkSuiteUsable(suiteName);
-    if (!scResult.suiteUsable)
-        return;
-    auto suite = scResult.suite;
+    publishSuite(suiteName, std::nullopt, false);
+}
 
-    logVersionInfo();
+void Engine::publish(const std::string &suiteName, const std::string &sectionName)
+{
+    publishSuite(suiteName, sectionName, false);
+}
 
-    auto reportgen = std::make_shared<ReportGenerator>(m_dstore.get());
-    for (const auto &section : suite.sections)
-        publishMetadataForSuiteSection(suite, section, reportgen);
+void Engine::republish(const std::string &suiteName)
+{
+    publishSuite(suiteName, std::nullopt, true);
+}
 
-    // Render index pages & statistics
-    reportgen->updateIndexPages();
-    reportgen->exportStatistics();
+void Engine::republish(const std::string &suiteName, const std::string &sectionName)
+{
+    publishSuite(suiteName, sectionName, true);
 }
 
-void Engine::publish(const std::string &suiteName, const std::string &sectionName)
+void Engine::publishSuite(
+    const std::string &suiteName,
+    const std::optional<std::string> &sectionName,
+    bool fromRecords)
 {
     // Fetch suite and exit in case we can't write to it.
     auto scResult = checkSuiteUsable(suiteName);
@@ -1094,71 +1702,41 @@ void Engine::publish(const std::string &suiteName, const std::string &sectionNam
     auto suite = scResult.suite;
 
     logVersionInfo();
+    Instrumentation::get().reset();
 
-    bool sectionValid = false;
-    for (const auto &section : suite.sections) {
-        if (section == sectionName) {
-            sectionValid = true;
-            break;
-        }
-    }
-    if (!sectionValid) {
-        LOG_ERROR(m_log, "Section '{}' does not exist in suite '{}'. Can not continue.", sectionName, suite.name);
+    if (sectionName.has_value() && std::ranges::find(suite.sections, sectionName.value()) == suite.sections.end()) {
+        LOG_ERROR(
+            m_log, "Section '{}' does not exist in suite '{}'. Can not continue.", sectionName.value(), suite.name);
         return;
     }
 
     auto reportgen = std::make_shared<ReportGenerator>(m_dstore.get());
-    publishMetadataForSuiteSection(suite, sectionName, reportgen);
+    for (const auto &section : suite.sections) {
+        if (sectionName.has_value() && section != sectionName.value())
+            continue;
+        Instrumentation::get().setScope(suite.name, section);
+        publishMetadataForSuiteSection(suite, section, reportgen, fromRecords);
+    }
 
     // Render index pages & statistics
+    Instrumentation::get().setScope({}, {});
     reportgen->updateIndexPages();
     reportgen->exportStatistics();
+
+    writeMetrics(fromRecords ? "republish" : "publish");
 }
 
 void Engine::cleanupStatistics()
 {
-    auto allStats = m_dstore->getStatistics();
-    std::sort(allStats.begin(), allStats.end(), [](const auto &a, const auto &b) {
-        return a.time < b.time;
-    });
-
-    std::unordered_map<std::string, std::unordered_map<std::string, MetaValue>> lastStatData;
-    std::unordered_map<std::string, std::time_t> lastTime;
-
-    for (const auto &entry : allStats) {
-        // We don't clean up combined statistics entries, and therefore need to reset
-        // the last-data hashmaps as soon as we encounter one to not lose data.
-        auto suiteIt = entry.data.find("suite");
-        auto sectionIt = entry.data.find("section");
-
-        if (suiteIt == entry.data.end() || sectionIt == entry.data.end()) {
-            lastStatData.clear();
-            lastTime.clear();
-            continue;
-        }
-
-        const auto ssid = std::format(
-            "{}-{}", std::get<std::string>(suiteIt->second), std::get<std::string>(sectionIt->second));
-
-        if (lastStatData.find(ssid) == lastStatData.end()) {
-            lastStatData[ssid] = entry.data;
-            lastTime[ssid] = entry.time;
-            continue;
-        }
-
-        if (lastStatData[ssid] == entry.data) {
-            LOG_INFO(m_log, "Removing superfluous statistics entry: {}", lastTime[ssid]);
-            m_dstore->removeStatistics(lastTime[ssid]);
-        }
-
-        lastTime[ssid] = entry.time;
-        lastStatData[ssid] = entry.data;
-    }
+    const auto removed = m_dstore->compactStatistics();
+    if (removed > 0)
+        LOG_INFO(m_log, "Removed {} superfluous statistics entries.", removed);
 }
 
 void Engine::runCleanup()
 {
     logVersionInfo();
+    Instrumentation::get().reset();
 
     LOG_INFO(m_log, "Cleaning up left over temporary data.");
     const auto tmpDir = m_conf->cacheRootDir() / "tmp";
@@ -1233,9 +1811,31 @@ void Engine::runCleanup()
     LOG_INFO(m_log, "Cleaning up obsolete media.");
     m_dstore->cleanupCruft();
 
+    // Drop rendered icons we have not needed in a long time
+    LOG_INFO(m_log, "Cleaning up icon render cache.");
+    m_iconRenderCache->prune(std::chrono::days(60));
+
     // Cleanup duplicate statistical entries
     LOG_INFO(m_log, "Cleaning up excess statistical data.");
     cleanupStatistics();
+
+    writeMetrics("cleanup");
+}
+
+void Engine::optimizeDatabases()
+{
+    logVersionInfo();
+
+    LOG_INFO(m_log, "Recompressing databases.");
+    tbb::parallel_invoke(
+        [&]() {
+            m_cstore->rebuildCompressionDictionaries();
+        },
+        [&]() {
+            m_dstore->rebuildCompressionDictionaries();
+        });
+
+    LOG_INFO(m_log, "Database optimization completed.");
 }
 
 void Engine::removeHintsComponents(const std::string &suiteName)
@@ -23,6 +23,7 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <optional>
 #include <mutex>
 
 #include <tbb/task_arena.h>
@@ -32,7 +33,10 @@
 #include "datastore.h"
 #include "contentsstore.h"
 #include "backends/interfaces.h"
+#include "pkgindexcache.h"
+#include "resourcegovernor.h"
 #include "iconhandler.h"
+#include "iconrendercache.h"
 #include "reportgenerator.h"
 #include "cptmodifiers.h"
 
@@ -64,6 +68,17 @@ public:
     bool forced() const;
     void setForced(bool v);
 
+    /**
+     * Write the timings and counters collected during a run to @fname, as JSON.
+     */
+    void setPerfReportFile(const fs::path &fname);
+
+    /**
+     * Write metrics about the last run, publish or cleanup to @fname,
+     * in the OpenMetrics text format.
+     */
+    void setMetricsFile(const fs::path &fname);
+
     bool processFile(
         const std::string &suiteName,
         const std::string &sectionName,
@@ -94,8 +109,26 @@ public:
      */
     void publish(const std::string &suiteName, const std::string &sectionName);
 
+    /**
+     * Publish metadata like publish() does, but for the packages that were exported last time
+     * instead of loading the package indices. The archive is not accessed at all, which makes
+     * this a quick way to apply template or configuration changes.
+     */
+    void republish(const std::string &suiteName);
+
+    /**
+     * Publish metadata of a single section of a suite for the packages that were exported last time.
+     */
+    void republish(const std::string &suiteName, const std::string &sectionName);
+
     void runCleanup();
 
+    /**
+     * Train new compression dictionaries for all databases and recompress their
+     * contents with them. Must not run concurrently with other generator runs.
+     */
+    void optimizeDatabases();
+
     /**
      * Drop all packages which contain valid components or hints
      * from the database.
@@ -114,19 +147,28 @@ public:
 private:
     Config *m_conf;
     quill::Logger *m_log;
-    std::unique_ptr<PackageIndex> m_pkgIndex;
+    std::unique_ptr<PackageIndexCache> m_pkgIndex;
     std::shared_ptr<DataStore> m_dstore;
     std::shared_ptr<ContentsStore> m_cstore;
+    std::shared_ptr<IconRenderCache> m_iconRenderCache;
     std::string m_backendPathPrefix;
     bool m_backendPrefixNotUsr;
     bool m_forced;
+    fs::path m_perfReportFname;
+    fs::path m_metricsFname;
 
     std::unique_ptr<tbb::task_arena> m_taskArena;
+    std::unique_ptr<ResourceGovernor> m_governor;
 
     mutable std::mutex m_mutex;
 
     void logVersionInfo();
 
+    /**
+     * Write the metrics of the @command that just finished, if a metrics file was set.
+     */
+    void writeMetrics(const std::string &command);
+
     /**
      * Throw an error if the libfyaml version is bad.
      */
@@ -147,6 +189,33 @@ private:
         std::shared_ptr<InjectedModifications> injMods,
         AscImageFormat imageFormat);
 
+    /**
+     * Digest of all settings besides the package data that influence the result of
+     * processing a package, including the icon themes of @iconh.
+     */
+    std::string resultEnvironmentDigest(
+        AscImageFormat imageFormat,
+        const std::shared_ptr<InjectedModifications> &injMods,
+        const IconHandler &iconh) const;
+
+    /**
+     * Check whether @fname is a file that may be looked at when composing metadata.
+     */
+    bool isResultInputFile(const std::string &fname) const;
+
+    /**
+     * Give @pkg the result of a previous version of it, if nothing it was generated from
+     * has changed between the two versions.
+     *
+     * @return true if the previous result was reused.
+     */
+    bool reusePreviousResult(const std::shared_ptr<Package> &pkg, const std::string &envDigest);
+
+    /**
+     * Remember which files went into @gres, so a later version of the package can reuse it.
+     */
+    void recordResultInputs(const GeneratorResult &gres, const std::string &envDigest);
+
     /**
      * Populate the contents index with new contents data. While we are at it, we can also mark
      * some uninteresting packages as to-be-ignored, so we don't waste time on them
@@ -162,6 +231,12 @@ private:
 
     std::string getMetadataHead(const Suite &suite, const std::string &section);
 
+    /**
+     * Update the global report pages and statistics after a run, and summarize
+     * where the run spent its time.
+     */
+    void finishRun(ReportGenerator &reportgen, bool dataChanged);
+
     /**
      * Export metadata and issue hints from the database and store them as files.
      */
@@ -211,7 +286,14 @@ private:
     void publishMetadataForSuiteSection(
         const Suite &suite,
         const std::string &section,
-        std::shared_ptr<ReportGenerator> rgen);
+        std::shared_ptr<ReportGenerator> rgen,
+        bool fromRecords = false);
+
+    /**
+     * Publish the data of suite @suiteName, or only of its section @sectionName if set.
+     * If @fromRecords is set, the packages recorded by the last export are used.
+     */
+    void publishSuite(const std::string &suiteName, const std::optional<std::string> &sectionName, bool fromRecords);
 
     void cleanupStatistics();
 };
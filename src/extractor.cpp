@@ -30,6 +30,7 @@
 #include "config.h"
 #include "logging.h"
 #include "hintregistry.h"
+#include "instrumentation.h"
 #include "result.h"
 #include "backends/interfaces.h"
 #include "datastore.h"
@@ -281,9 +282,17 @@ GeneratorResult DataExtractor::processPackage(std::shared_ptr<Package> pkg)
     auto unit = asg_package_unit_new(pkg);
     asc_compose_add_unit(m_compose, ASC_UNIT(unit));
 
-    // process all data
+    // process all data, and keep track of which files were used for it
+    std::vector<std::pair<const Package *, std::string>> unitReadLog;
+    asg_units_set_thread_read_log(&unitReadLog);
     g_autoptr(GError) error = nullptr;
-    if (!asc_compose_run(m_compose, nullptr, &error))
+    bool composeOk;
+    {
+        ScopedTimer timer(PerfStage::Compose);
+        composeOk = asc_compose_run(m_compose, nullptr, &error);
+    }
+    asg_units_set_thread_read_log(nullptr);
+    if (!composeOk)
         throw std::runtime_error(
             std::format("Failed to run compose process: {}", error ? error->message : "Unknown error"));
 
@@ -296,6 +305,8 @@ GeneratorResult DataExtractor::processPackage(std::shared_ptr<Package> pkg)
 
     // create result wrapper, handing the staging area over to it
     GeneratorResult gres(ASC_RESULT(g_ptr_array_index(resultsArray, 0)), pkg, stagingDir);
+    for (const auto &[srcPkg, fname] : unitReadLog)
+        gres.addInputFile(srcPkg, fname);
 
     // process icons and perform additional refinements
     g_autoptr(GPtrArray) cptsPtrArray = gres.fetchComponents();
@@ -309,6 +320,14 @@ GeneratorResult DataExtractor::processPackage(std::shared_ptr<Package> pkg)
             as_component_set_context(cpt, context);
         }
 
+        // Translations are looked up in the locale unit, which covers all packages of the section,
+        // so the result depends on what other packages ship even if nothing was found there.
+        if (m_l10nUnit != nullptr && m_conf->feature.processLocale) {
+            const auto translations = as_component_get_translations(cpt);
+            if (translations != nullptr && translations->len > 0)
+                gres.markUsesOtherPackages();
+        }
+
         // find & store icons
         m_iconh->process(gres, cpt, m_media);
         if (gres.isIgnored(cpt))
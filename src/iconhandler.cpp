@@ -24,6 +24,7 @@
 #include <filesystem>
 #include <fstream>
 #include <ranges>
+#include <optional>
 #include <appstream-compose.h>
 #include <gio/gio.h>
 
@@ -31,6 +32,7 @@
 
 #include "config.h"
 #include "logging.h"
+#include "instrumentation.h"
 #include "result.h"
 #include "utils.h"
 
@@ -60,6 +62,9 @@ Theme::Theme(const std::string &name, const std::vector<std::uint8_t> &indexData
     if (m_prefix.empty())
         m_prefix = "/usr";
 
+    g_autofree gchar *digest = g_compute_checksum_for_data(G_CHECKSUM_SHA256, indexData.data(), indexData.size());
+    m_digest = digest;
+
     std::string indexText(indexData.begin(), indexData.end());
     if (!g_key_file_load_from_data(index, indexText.c_str(), indexText.length(), G_KEY_FILE_NONE, &error))
         throw std::runtime_error(std::format("Failed to parse theme index for {}: {}", name, error->message));
@@ -148,6 +153,11 @@ const std::string &Theme::name() const
     return m_name;
 }
 
+const std::string &Theme::digest() const
+{
+    return m_digest;
+}
+
 bool Theme::directoryMatchesSize(
     const std::unordered_map<std::string, std::variant<int, std::string>> &themedir,
     const ImageSize &size,
@@ -220,10 +230,12 @@ IconHandler::IconHandler(
     const std::unordered_map<std::string, std::shared_ptr<Package>> &pkgMap,
     AscImageFormat imageFormat,
     const std::string &iconTheme,
-    const std::string &extraPrefix)
+    const std::string &extraPrefix,
+    std::shared_ptr<IconRenderCache> renderCache)
     : m_log(getLogger("iconhandler")),
       m_iconPolicy(nullptr),
       m_imageFormat(imageFormat),
+      m_renderCache(std::move(renderCache)),
       m_defaultIconSize(64),
       m_defaultIconState(ASC_ICON_STATE_IGNORED),
       m_allowIconUpscaling(false),
@@ -445,6 +457,14 @@ bool IconHandler::iconAllowed(const std::string &iconName)
     });
 }
 
+std::string IconHandler::themesDigest() const
+{
+    std::string themes;
+    for (const auto &theme : m_themes)
+        themes += std::format("{}:{};", theme->name(), theme->digest());
+    return themes;
+}
+
 std::generator<std::string> IconHandler::possibleIconFilenames(
     const std::string &iconName,
     const ImageSize &size,
@@ -485,14 +505,14 @@ std::unordered_map<ImageSize, IconHandler::IconFindResult> IconHandler::findIcon
     std::shared_ptr<Package> pkg) const
 {
     std::unordered_map<ImageSize, IconFindResult> sizeMap;
+    const auto pkgContents = pkg ? pkg->contentsIndex() : nullptr;
 
     for (const auto &size : sizes) {
         // search for possible icon filenames, using relaxed scaling rules by default
         for (const auto &fname : possibleIconFilenames(iconName, size, true)) {
-            if (pkg) {
+            if (pkgContents != nullptr) {
                 // we are supposed to search in one particular package
-                const auto &contents = pkg->contents();
-                if (std::ranges::find(contents, fname) != contents.end()) {
+                if (pkgContents->contains(fname)) {
                     sizeMap[size] = IconFindResult(pkg, fname);
                     break;
                 }
@@ -601,6 +621,8 @@ bool IconHandler::storeIcon(
         return false;
     }
 
+    gres.addInputFile(sourcePkg.get(), iconPath);
+
     if (iconData.empty()) {
         gres.addHint(
             as_component_get_id(cpt),
@@ -633,49 +655,81 @@ bool IconHandler::storeIcon(
         fs::remove(cptExportPath.parent_path(), ec); // .../<component-id>
     };
 
-    g_autoptr(GBytes) iconBytes = g_bytes_new(iconData.data(), iconData.size());
-    g_autoptr(AscImageSource) imgSource = asc_image_source_new(iconBytes);
-    if (isVectorIcon) {
-        // render vector graphics straight at the size we want to store them in
-        asc_image_source_set_render_size(imgSource, scaled_width, scaled_height);
+    // check if we rendered this exact icon data before, and reuse the result if we did
+    std::string cacheKey;
+    std::optional<IconRenderCache::Entry> renderInfo;
+    if (m_renderCache) {
+        cacheKey = IconRenderCache::makeKey(iconData, size, m_imageFormat, isVectorIcon);
+        renderInfo = m_renderCache->fetch(cacheKey, iconStoreLocation);
     }
 
-    g_autoptr(GPtrArray) imgTargets = g_ptr_array_new_with_free_func((GDestroyNotify)asc_image_target_free);
+    if (!renderInfo.has_value()) {
+        // the icon data is not needed anymore, so hand it over without copying it
+        g_autoptr(GBytes) iconBytes = Utils::bytesFromVector(std::move(iconData));
+        g_autoptr(AscImageSource) imgSource = asc_image_source_new(iconBytes);
+        if (isVectorIcon) {
+            // render vector graphics straight at the size we want to store them in
+            asc_image_source_set_render_size(imgSource, scaled_width, scaled_height);
+        }
 
-    AscImageTarget *imgTarget = asc_image_target_new(
-        iconName.c_str(), ASC_IMAGE_SCALE_MODE_PAD, scaled_width, scaled_height);
-    // icons are always stored losslessly, which even results in smaller files than lossy encoding
-    // would, due to their simple shapes and colors and non-photo-like qualities
-    asc_image_target_set_save_flags(
-        imgTarget, static_cast<AscImageSaveFlags>(ASC_IMAGE_SAVE_FLAG_OPTIMIZE | ASC_IMAGE_SAVE_FLAG_LOSSLESS));
+        g_autoptr(GPtrArray) imgTargets = g_ptr_array_new_with_free_func((GDestroyNotify)asc_image_target_free);
+
+        AscImageTarget *imgTarget = asc_image_target_new(
+            iconName.c_str(), ASC_IMAGE_SCALE_MODE_PAD, scaled_width, scaled_height);
+        // icons are always stored losslessly, which even results in smaller files than lossy encoding
+        // would, due to their simple shapes and colors and non-photo-like qualities
+        asc_image_target_set_save_flags(
+            imgTarget, static_cast<AscImageSaveFlags>(ASC_IMAGE_SAVE_FLAG_OPTIMIZE | ASC_IMAGE_SAVE_FLAG_LOSSLESS));
+
+        // ensure that we don't try to make an application visible that has a really tiny icon
+        // by upscaling it to a blurry mess
+        if (!isVectorIcon && size.scale == 1 && size.width == 64)
+            asc_image_target_set_source_size_range(imgTarget, 48, 48, 0, 0);
+        g_ptr_array_add(imgTargets, imgTarget);
+
+        g_autoptr(GError) error = nullptr;
+        if (!asc_media_process_image(media, imgSource, imgTargets, path.c_str(), nullptr, &error)) {
+            // only genuine worker malfunctions get the worker-error hint,
+            // anything else is reported as a regular image issue
+            gres.addHint(
+                as_component_get_id(cpt),
+                asc_media_error_is_worker_failure(error) ? "media-worker-process-error" : "image-write-error",
+                {
+                    {"fname",     fs::path(iconPath).filename()                },
+                    {"pkg_fname", fs::path(sourcePkg->getFilename()).filename()},
+                    {"error",     error->message                               }
+            });
+            dropEmptyIconDir();
+            return false;
+        }
 
-    // ensure that we don't try to make an application visible that has a really tiny icon
-    // by upscaling it to a blurry mess
-    if (!isVectorIcon && size.scale == 1 && size.width == 64)
-        asc_image_target_set_source_size_range(imgTarget, 48, 48, 0, 0);
-    g_ptr_array_add(imgTargets, imgTarget);
+        if (asc_image_target_get_error_message(imgTarget) != nullptr) {
+            gres.addHint(
+                cpt,
+                "image-write-error",
+                {
+                    {"fname",     fs::path(iconPath).filename()                },
+                    {"pkg_fname", fs::path(sourcePkg->getFilename()).filename()},
+                    {"error",     asc_image_target_get_error_message(imgTarget)}
+            });
+            dropEmptyIconDir();
+            return false;
+        }
 
-    g_autoptr(GError) error = nullptr;
-    if (!asc_media_process_image(media, imgSource, imgTargets, path.c_str(), nullptr, &error)) {
-        // only genuine worker malfunctions get the worker-error hint,
-        // anything else is reported as a regular image issue
-        gres.addHint(
-            as_component_get_id(cpt),
-            asc_media_error_is_worker_failure(error) ? "media-worker-process-error" : "image-write-error",
-            {
-                {"fname",     fs::path(iconPath).filename()                },
-                {"pkg_fname", fs::path(sourcePkg->getFilename()).filename()},
-                {"error",     error->message                               }
-        });
-        dropEmptyIconDir();
-        return false;
+        // the source dimensions are only known after the image has been loaded
+        IconRenderCache::Entry newInfo;
+        newInfo.srcWidth = asc_image_source_get_width(imgSource);
+        newInfo.srcHeight = asc_image_source_get_height(imgSource);
+        newInfo.skipped = asc_image_target_get_skipped(imgTarget);
+        if (m_renderCache)
+            m_renderCache->store(cacheKey, iconStoreLocation, newInfo);
+        renderInfo = newInfo;
     }
 
-    // the source dimensions are only known after the image has been loaded
-    const gint srcWidth = asc_image_source_get_width(imgSource);
-    const gint srcHeight = asc_image_source_get_height(imgSource);
+    const int srcWidth = renderInfo->srcWidth;
+    const int srcHeight = renderInfo->srcHeight;
 
-    if (asc_image_target_get_skipped(imgTarget)) {
+    if (renderInfo->skipped) {
         // the source icon was too small for the size we wanted to render
         gres.addHint(
             cpt,
@@ -688,19 +742,6 @@ bool IconHandler::storeIcon(
         return false;
     }
 
-    if (asc_image_target_get_error_message(imgTarget) != nullptr) {
-        gres.addHint(
-            cpt,
-            "image-write-error",
-            {
-                {"fname",     fs::path(iconPath).filename()                },
-                {"pkg_fname", fs::path(sourcePkg->getFilename()).filename()},
-                {"error",     asc_image_target_get_error_message(imgTarget)}
-        });
-        dropEmptyIconDir();
-        return false;
-    }
-
     // warn about icon upscaling, it looks ugly
     if (!isVectorIcon && scaled_width > srcWidth) {
         gres.addHint(
@@ -786,6 +827,7 @@ IconHandler::IconFindResult IconHandler::findIconScalableToSize(
 bool IconHandler::process(GeneratorResult &gres, AsComponent *cpt, AscMedia *media)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
+    ScopedTimer timer(PerfStage::IconRender);
 
     // we don't touch fonts unless those didn't have their icon
     // rendered from the font itself already
@@ -822,8 +864,7 @@ bool IconHandler::process(GeneratorResult &gres, AsComponent *cpt, AscMedia *med
     if (iconName.starts_with("/")) {
         LOG_DEBUG(m_log, "Looking for icon '{}' for '{}::{}' (path)", iconName, gres.pkid(), as_component_get_id(cpt));
 
-        const auto &contents = gres.getPackage()->contents();
-        if (std::ranges::find(contents, iconName) != contents.end()) {
+        if (gres.getPackage()->contentsIndex()->contains(iconName)) {
             return storeIcon(
                 cpt, gres, media, cptMediaPath, gres.getPackage(), iconName, m_defaultIconSize, m_defaultIconState);
         }
@@ -951,7 +992,9 @@ bool IconHandler::process(GeneratorResult &gres, AsComponent *cpt, AscMedia *med
         // search for the right icon inside the current package
         auto success = findAndStoreXdgIcon(gres.getPackage());
         if (!success && !gres.isIgnored(cpt)) {
-            // search in all packages
+            // search in all packages, which makes the result depend on whatever they contain,
+            // even if we do not find anything
+            gres.markUsesOtherPackages();
             success = findAndStoreXdgIcon();
         }
 
@@ -33,6 +33,7 @@
 #include "utils.h"
 #include "backends/interfaces.h"
 #include "contentsstore.h"
+#include "iconrendercache.h"
 
 namespace ASGenerator
 {
@@ -50,6 +51,12 @@ public:
     explicit Theme(const std::string &name, std::shared_ptr<Package> pkg, const std::string &prefix = {});
 
     const std::string &name() const;
+
+    /**
+     * Checksum of the index this theme was loaded from.
+     */
+    const std::string &digest() const;
+
     const auto &directories() const
     {
         return m_directories;
@@ -79,6 +86,7 @@ public:
 private:
     std::string m_name;
     std::string m_prefix;
+    std::string m_digest;
     std::vector<std::unordered_map<std::string, std::variant<int, std::string>>> m_directories;
 };
 
@@ -94,7 +102,8 @@ public:
         const std::unordered_map<std::string, std::shared_ptr<Package>> &pkgMap,
         AscImageFormat imageFormat = ASC_IMAGE_FORMAT_JXL,
         const std::string &iconTheme = "",
-        const std::string &extraPrefix = "");
+        const std::string &extraPrefix = "",
+        std::shared_ptr<IconRenderCache> renderCache = nullptr);
 
     ~IconHandler();
 
@@ -111,6 +120,12 @@ public:
 
     static bool iconAllowed(const std::string &iconName);
 
+    /**
+     * Digest of the icon themes that are used to look up icons, in the order
+     * they are searched.
+     */
+    std::string themesDigest() const;
+
     // Delete copy constructor and assignment operator
     IconHandler(const IconHandler &) = delete;
     IconHandler &operator=(const IconHandler &) = delete;
@@ -124,6 +139,7 @@ private:
 
     AscIconPolicy *m_iconPolicy;
     AscImageFormat m_imageFormat;
+    std::shared_ptr<IconRenderCache> m_renderCache;
     ImageSize m_defaultIconSize;
     AscIconState m_defaultIconState;
     std::vector<ImageSize> m_enabledIconSizes;
@@ -179,6 +195,7 @@ private:
      * Extracts the icon from the package and stores it in the cache.
      * Ensures the stored icon always has the size given in "size", and renders
      * scalable vectorgraphics if necessary.
+     * Previously rendered icons are taken from the render cache, if we have one.
      */
     bool storeIcon(
         AsComponent *cpt,
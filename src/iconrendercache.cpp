@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "defines.h"
+#include "iconrendercache.h"
+
+#include <format>
+#include <fstream>
+#include <glib.h>
+
+namespace ASGenerator
+{
+
+// Version of the layout of cache entries, to be bumped whenever it changes
+static constexpr int RenderCacheFormat = 1;
+
+IconRenderCache::IconRenderCache(const fs::path &cacheDir)
+    : m_log(getLogger("iconcache")),
+      m_cacheDir(cacheDir),
+      m_hits(0),
+      m_misses(0)
+{
+}
+
+std::string IconRenderCache::makeKey(
+    const std::vector<std::uint8_t> &data,
+    const ImageSize &size,
+    AscImageFormat format,
+    bool isVector)
+{
+    g_autofree gchar *digest = g_compute_checksum_for_data(G_CHECKSUM_SHA256, data.data(), data.size());
+
+    // The icon policy only decides which icon kinds are added to the component,
+    // it has no influence on the rendered image, so it is not part of the key.
+    // The code doing the rendering does, so renders of other versions are never used.
+    return std::format(
+        "{}-{}-{}{}-r{}-{}-{}",
+        digest,
+        size.toString(),
+        asc_image_format_to_string(format),
+        isVector ? "-v" : "",
+        RenderCacheFormat,
+        ASGEN_VERSION,
+        as_version_string());
+}
+
+fs::path IconRenderCache::entryBasePath(const std::string &key) const
+{
+    // fan out a bit, so we don't end up with one huge directory
+    return m_cacheDir / key.substr(0, 2) / key;
+}
+
+std::optional<IconRenderCache::Entry> IconRenderCache::fetch(const std::string &key, const fs::path &destFile)
+{
+    const auto basePath = entryBasePath(key);
+    auto infoPath = basePath;
+    infoPath += ".info";
+
+    Entry entry;
+    {
+        std::ifstream f(infoPath);
+        int skipped = 0;
+        if (!f.is_open() || !(f >> entry.srcWidth >> entry.srcHeight >> skipped)) {
+            m_misses++;
+            return std::nullopt;
+        }
+        entry.skipped = skipped != 0;
+    }
+
+    std::error_code ec;
+    if (!entry.skipped) {
+        auto iconPath = basePath;
+        iconPath += ".icon";
+
+        fs::create_hard_link(iconPath, destFile, ec);
+        if (ec) {
+            // the cache may live on a different filesystem than the media staging area
+            ec.clear();
+            fs::copy_file(iconPath, destFile, fs::copy_options::overwrite_existing, ec);
+        }
+        if (ec) {
+            LOG_DEBUG(m_log, "Unable to use cached icon {}: {}", key, ec.message());
+            m_misses++;
+            return std::nullopt;
+        }
+    }
+
+    // remember when this entry was last used, so pruning keeps it around
+    fs::last_write_time(infoPath, fs::file_time_type::clock::now(), ec);
+
+    m_hits++;
+    return entry;
+}
+
+void IconRenderCache::store(const std::string &key, const fs::path &renderedFile, const Entry &entry)
+{
+    const auto basePath = entryBasePath(key);
+    const auto tmpSuffix = std::format(".tmp-{}", Utils::randomString(8));
+
+    std::error_code ec;
+    fs::create_directories(basePath.parent_path(), ec);
+    if (ec) {
+        LOG_WARNING(m_log, "Unable to create icon render cache directory: {}", ec.message());
+        return;
+    }
+
+    // write to temporary files first and rename them in place, so concurrent
+    // readers never see a partially written entry
+    if (!entry.skipped) {
+        auto iconPath = basePath;
+        iconPath += ".icon";
+        auto iconTmpPath = iconPath;
+        iconTmpPath += tmpSuffix;
+
+        fs::copy_file(renderedFile, iconTmpPath, fs::copy_options::overwrite_existing, ec);
+        if (!ec)
+            fs::rename(iconTmpPath, iconPath, ec);
+        if (ec) {
+            LOG_WARNING(m_log, "Unable to add icon {} to render cache: {}", key, ec.message());
+            fs::remove(iconTmpPath, ec);
+            return;
+        }
+    }
+
+    auto infoPath = basePath;
+    infoPath += ".info";
+    auto infoTmpPath = infoPath;
+    infoTmpPath += tmpSuffix;
+    {
+        std::ofstream f(infoTmpPath);
+        f << entry.srcWidth << " " << entry.srcHeight << " " << (entry.skipped ? 1 : 0) << "\n";
+    }
+    fs::rename(infoTmpPath, infoPath, ec);
+    if (ec) {
+        LOG_WARNING(m_log, "Unable to add icon {} to render cache: {}", key, ec.message());
+        fs::remove(infoTmpPath, ec);
+    }
+}
+
+void IconRenderCache::prune(std::chrono::hours maxAge)
+{
+    if (!fs::exists(m_cacheDir))
+        return;
+
+    const auto cutoff = fs::file_time_type::clock::now() - maxAge;
+    std::vector<fs::path> staleInfoFiles;
+
+    std::error_code ec;
+    for (const auto &entry : fs::recursive_directory_iterator(m_cacheDir, ec)) {
+        if (!entry.is_regular_file(ec) || entry.path().extension() != ".info")
+            continue;
+        if (entry.last_write_time(ec) < cutoff)
+            staleInfoFiles.push_back(entry.path());
+    }
+
+    for (const auto &infoPath : staleInfoFiles) {
+        auto iconPath = infoPath;
+        iconPath.replace_extension(".icon");
+        fs::remove(iconPath, ec);
+        fs::remove(infoPath, ec);
+    }
+
+    if (!staleInfoFiles.empty())
+        LOG_INFO(m_log, "Removed {} unused entries from the icon render cache.", staleInfoFiles.size());
+}
+
+std::uint64_t IconRenderCache::hits() const
+{
+    return m_hits;
+}
+
+std::uint64_t IconRenderCache::misses() const
+{
+    return m_misses;
+}
+
+} // namespace ASGenerator
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <appstream-compose.h>
+
+#include "logging.h"
+#include "utils.h"
+
+namespace ASGenerator
+{
+
+/**
+ * Persistent cache of rendered icons.
+ *
+ * Entries are keyed by the digest of the source image data, the target size
+ * and the target image format, so an icon that did not change between two
+ * package versions never has to be decoded and rendered again. The key also
+ * includes the generator and AppStream versions, since they do the rendering.
+ */
+class IconRenderCache
+{
+public:
+    /**
+     * Information about a previous render of an icon.
+     */
+    struct Entry {
+        int srcWidth = 0;
+        int srcHeight = 0;
+        /// True if the source was too small to be rendered at the requested size
+        bool skipped = false;
+    };
+
+    explicit IconRenderCache(const fs::path &cacheDir);
+
+    /**
+     * Compute the cache key for rendering @data at @size in @format.
+     */
+    static std::string makeKey(
+        const std::vector<std::uint8_t> &data,
+        const ImageSize &size,
+        AscImageFormat format,
+        bool isVector);
+
+    /**
+     * Look up @key and, if a rendered image exists, place it at @destFile.
+     * The file is hardlinked if possible and copied otherwise.
+     *
+     * @return The cached render information, or nothing on a cache miss.
+     */
+    std::optional<Entry> fetch(const std::string &key, const fs::path &destFile);
+
+    /**
+     * Store the result of rendering an icon.
+     * @renderedFile may be empty if the render was skipped.
+     */
+    void store(const std::string &key, const fs::path &renderedFile, const Entry &entry);
+
+    /**
+     * Remove all entries which have not been used for longer than @maxAge.
+     */
+    void prune(std::chrono::hours maxAge);
+
+    std::uint64_t hits() const;
+    std::uint64_t misses() const;
+
+    // Delete copy constructor and assignment operator
+    IconRenderCache(const IconRenderCache &) = delete;
+    IconRenderCache &operator=(const IconRenderCache &) = delete;
+
+private:
+    quill::Logger *m_log;
+    fs::path m_cacheDir;
+
+    std::atomic<std::uint64_t> m_hits;
+    std::atomic<std::uint64_t> m_misses;
+
+    fs::path entryBasePath(const std::string &key) const;
+};
+
+} // namespace ASGenerator
@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "instrumentation.h"
+
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+
+namespace ASGenerator
+{
+
+const char *perfStageName(PerfStage stage)
+{
+    switch (stage) {
+    case PerfStage::Download:
+        return "download";
+    case PerfStage::IndexLoad:
+        return "indexLoad";
+    case PerfStage::ContentsSeed:
+        return "contentsSeed";
+    case PerfStage::Process:
+        return "process";
+    case PerfStage::ArchiveExtract:
+        return "archiveExtract";
+    case PerfStage::Compose:
+        return "compose";
+    case PerfStage::IconRender:
+        return "iconRender";
+    case PerfStage::DbCommit:
+        return "dbCommit";
+    case PerfStage::Export:
+        return "export";
+    case PerfStage::ExportCompress:
+        return "exportCompress";
+    case PerfStage::IconTarballs:
+        return "iconTarballs";
+    case PerfStage::ReportRender:
+        return "reportRender";
+    }
+
+    return "unknown";
+}
+
+const char *perfCounterName(PerfCounter counter)
+{
+    switch (counter) {
+    case PerfCounter::PackagesScanned:
+        return "packagesScanned";
+    case PerfCounter::PackagesIgnored:
+        return "packagesIgnored";
+    case PerfCounter::PackagesProcessed:
+        return "packagesProcessed";
+    case PerfCounter::PackagesReused:
+        return "packagesReused";
+    case PerfCounter::Components:
+        return "components";
+    case PerfCounter::Hints:
+        return "hints";
+    case PerfCounter::HintsError:
+        return "hintsError";
+    case PerfCounter::HintsWarning:
+        return "hintsWarning";
+    case PerfCounter::HintsInfo:
+        return "hintsInfo";
+    case PerfCounter::HintsPedantic:
+        return "hintsPedantic";
+    case PerfCounter::BytesDownloaded:
+        return "bytesDownloaded";
+    case PerfCounter::BytesDecompressed:
+        return "bytesDecompressed";
+    }
+
+    return "unknown";
+}
+
+/**
+ * Format a duration for humans, with a precision that fits its magnitude.
+ */
+static std::string formatDuration(std::chrono::nanoseconds duration)
+{
+    const auto ms = static_cast<double>(duration.count()) / 1000000.0;
+    if (ms >= 10000.0)
+        return std::format("{:.1f}s", ms / 1000.0);
+    return std::format("{:.1f}ms", ms);
+}
+
+void PerfScopeSummary::merge(const PerfScopeSummary &other)
+{
+    for (std::size_t i = 0; i < PerfStageCount; i++) {
+        stages[i].calls += other.stages[i].calls;
+        stages[i].total += other.stages[i].total;
+        stages[i].max = std::max(stages[i].max, other.stages[i].max);
+    }
+    for (std::size_t i = 0; i < PerfCounterCount; i++)
+        counters[i] += other.counters[i];
+}
+
+PerfScopeSummary Instrumentation::ScopeData::summary() const
+{
+    PerfScopeSummary summary;
+    summary.suite = suite;
+    summary.section = section;
+    summary.arch = arch;
+    for (std::size_t i = 0; i < PerfStageCount; i++) {
+        summary.stages[i].calls = calls[i].load(std::memory_order_relaxed);
+        summary.stages[i].total = std::chrono::nanoseconds(totalNs[i].load(std::memory_order_relaxed));
+        summary.stages[i].max = std::chrono::nanoseconds(maxNs[i].load(std::memory_order_relaxed));
+    }
+    for (std::size_t i = 0; i < PerfCounterCount; i++)
+        summary.counters[i] = counters[i].load(std::memory_order_relaxed);
+
+    return summary;
+}
+
+Instrumentation::Instrumentation()
+    : m_current(nullptr)
+{
+    // measurements taken outside of any suite are collected here
+    reset();
+}
+
+Instrumentation &Instrumentation::get()
+{
+    static Instrumentation instance;
+    return instance;
+}
+
+void Instrumentation::setScope(const std::string &suite, const std::string &section, const std::string &arch)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &scope : m_scopes) {
+        if (scope->suite == suite && scope->section == section && scope->arch == arch) {
+            m_current.store(scope.get());
+            return;
+        }
+    }
+
+    auto scope = std::make_unique<ScopeData>();
+    scope->suite = suite;
+    scope->section = section;
+    scope->arch = arch;
+    m_current.store(scope.get());
+    m_scopes.push_back(std::move(scope));
+}
+
+void Instrumentation::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_scopes.clear();
+    m_scopes.push_back(std::make_unique<ScopeData>());
+    m_current.store(m_scopes.front().get());
+    m_resetTime = std::chrono::steady_clock::now();
+}
+
+std::chrono::nanoseconds Instrumentation::elapsed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::chrono::steady_clock::now() - m_resetTime;
+}
+
+void Instrumentation::recordTime(PerfStage stage, std::chrono::nanoseconds duration)
+{
+    auto scope = m_current.load(std::memory_order_acquire);
+    const auto idx = static_cast<std::size_t>(stage);
+    const auto ns = static_cast<std::uint64_t>(duration.count());
+
+    scope->calls[idx].fetch_add(1, std::memory_order_relaxed);
+    scope->totalNs[idx].fetch_add(ns, std::memory_order_relaxed);
+    auto prevMax = scope->maxNs[idx].load(std::memory_order_relaxed);
+    while (prevMax < ns && !scope->maxNs[idx].compare_exchange_weak(prevMax, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void Instrumentation::count(PerfCounter counter, std::uint64_t amount)
+{
+    auto scope = m_current.load(std::memory_order_acquire);
+    scope->counters[static_cast<std::size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+std::vector<PerfScopeSummary> Instrumentation::summaries() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<PerfScopeSummary> result;
+    result.reserve(m_scopes.size());
+    for (const auto &scope : m_scopes) {
+        auto summary = scope->summary();
+
+        // skip scopes that never saw any work
+        const bool haveTimes = std::ranges::any_of(summary.stages, [](const auto &t) {
+            return t.calls > 0;
+        });
+        const bool haveCounts = std::ranges::any_of(summary.counters, [](auto c) {
+            return c > 0;
+        });
+        if (haveTimes || haveCounts)
+            result.push_back(std::move(summary));
+    }
+
+    return result;
+}
+
+PerfScopeSummary Instrumentation::sectionSummary(const std::string &suite, const std::string &section) const
+{
+    PerfScopeSummary result;
+    result.suite = suite;
+    result.section = section;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &scope : m_scopes) {
+        if (scope->suite == suite && scope->section == section)
+            result.merge(scope->summary());
+    }
+
+    return result;
+}
+
+std::vector<std::string> Instrumentation::summaryTable() const
+{
+    std::vector<std::string> lines;
+    for (const auto &summary : summaries()) {
+        std::string title;
+        if (summary.suite.empty())
+            title = "(global)";
+        else if (summary.arch.empty())
+            title = std::format("{}/{}", summary.suite, summary.section);
+        else
+            title = std::format("{}/{} [{}]", summary.suite, summary.section, summary.arch);
+        lines.push_back(title);
+
+        lines.push_back(std::format("  {:<16} {:>9} {:>12} {:>12} {:>12}", "Stage", "Calls", "Total", "Mean", "Max"));
+        for (std::size_t i = 0; i < PerfStageCount; i++) {
+            const auto &timing = summary.stages[i];
+            if (timing.calls == 0)
+                continue;
+            lines.push_back(std::format(
+                "  {:<16} {:>9} {:>12} {:>12} {:>12}",
+                perfStageName(static_cast<PerfStage>(i)),
+                timing.calls,
+                formatDuration(timing.total),
+                formatDuration(timing.total / timing.calls),
+                formatDuration(timing.max)));
+        }
+
+        std::string countersLine;
+        for (std::size_t i = 0; i < PerfCounterCount; i++) {
+            if (summary.counters[i] == 0)
+                continue;
+            countersLine += std::format(
+                "{}{}: {}",
+                countersLine.empty() ? "  " : ", ",
+                perfCounterName(static_cast<PerfCounter>(i)),
+                summary.counters[i]);
+        }
+        if (!countersLine.empty())
+            lines.push_back(std::move(countersLine));
+    }
+
+    return lines;
+}
+
+nlohmann::json Instrumentation::toJson() const
+{
+    auto scopesNode = nlohmann::json::array();
+    for (const auto &summary : summaries()) {
+        nlohmann::json node{
+            {"suite",   summary.suite  },
+            {"section", summary.section},
+            {"arch",    summary.arch   }
+        };
+
+        auto &stagesNode = node["stages"];
+        stagesNode = nlohmann::json::object();
+        for (std::size_t i = 0; i < PerfStageCount; i++) {
+            const auto &timing = summary.stages[i];
+            if (timing.calls == 0)
+                continue;
+            stagesNode[perfStageName(static_cast<PerfStage>(i))] = {
+                {"calls",   timing.calls                                                       },
+                {"totalMs", std::chrono::duration<double, std::milli>(timing.total).count()},
+                {"maxMs",   std::chrono::duration<double, std::milli>(timing.max).count()  }
+            };
+        }
+
+        auto &countersNode = node["counters"];
+        countersNode = nlohmann::json::object();
+        for (std::size_t i = 0; i < PerfCounterCount; i++)
+            countersNode[perfCounterName(static_cast<PerfCounter>(i))] = summary.counters[i];
+
+        scopesNode.push_back(std::move(node));
+    }
+
+    return nlohmann::json{
+        {"scopes", scopesNode}
+    };
+}
+
+// nesting depth of timers of every stage on this thread
+static thread_local std::array<unsigned int, PerfStageCount> timerDepth{};
+
+ScopedTimer::ScopedTimer(PerfStage stage)
+    : m_stage(stage),
+      m_outermost(timerDepth[static_cast<std::size_t>(stage)]++ == 0),
+      m_start(m_outermost ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{})
+{
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    timerDepth[static_cast<std::size_t>(m_stage)]--;
+    if (!m_outermost)
+        return;
+
+    const auto end = std::chrono::steady_clock::now();
+    Instrumentation::get().recordTime(m_stage, end - m_start);
+
+    auto &trace = TraceRecorder::get();
+    if (trace.enabled())
+        trace.addSpan(perfStageName(m_stage), "stage", m_start, end);
+}
+
+// trace buffer of the current thread, owned by the recorder
+thread_local TraceRecorder::ThreadBuffer *TraceRecorder::m_threadBuffer = nullptr;
+
+TraceRecorder::TraceRecorder()
+    : m_enabled(false)
+{
+}
+
+TraceRecorder &TraceRecorder::get()
+{
+    static TraceRecorder instance;
+    return instance;
+}
+
+void TraceRecorder::start()
+{
+    m_epoch = std::chrono::steady_clock::now();
+    m_mainThread = std::this_thread::get_id();
+    m_enabled.store(true);
+}
+
+TraceRecorder::ThreadBuffer *TraceRecorder::threadBuffer()
+{
+    if (m_threadBuffer != nullptr)
+        return m_threadBuffer;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->tid = static_cast<std::uint32_t>(m_buffers.size() + 1);
+    if (std::this_thread::get_id() == m_mainThread)
+        buffer->threadName = "main";
+    else
+        buffer->threadName = std::format("worker {}", buffer->tid);
+    buffer->events.reserve(1024);
+
+    m_threadBuffer = buffer.get();
+    m_buffers.push_back(std::move(buffer));
+    return m_threadBuffer;
+}
+
+void TraceRecorder::addSpan(
+    std::string name,
+    const char *category,
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+
+    threadBuffer()->events.push_back(
+        Event{
+            std::move(name),
+            category,
+            duration_cast<microseconds>(start - m_epoch).count(),
+            duration_cast<microseconds>(end - start).count()});
+}
+
+void TraceRecorder::write(const std::filesystem::path &fname) const
+{
+    std::ofstream f(fname);
+    if (!f)
+        throw std::runtime_error(std::format("Unable to open trace file {}", fname.string()));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for (const auto &buffer : m_buffers) {
+        f << (first ? "" : ",\n")
+          << std::format(
+                 R"({{"ph":"M","pid":1,"tid":{},"name":"thread_name","args":{{"name":"{}"}}}})",
+                 buffer->tid,
+                 buffer->threadName);
+        first = false;
+
+        for (const auto &event : buffer->events)
+            f << ",\n"
+              << std::format(
+                     R"({{"ph":"X","pid":1,"tid":{},"cat":"{}","name":{},"ts":{},"dur":{}}})",
+                     buffer->tid,
+                     event.category,
+                     nlohmann::json(event.name).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace),
+                     event.startUs,
+                     event.durationUs);
+    }
+    f << "\n]}\n";
+
+    if (!f)
+        throw std::runtime_error(std::format("Unable to write trace file {}", fname.string()));
+}
+
+TraceSpan::TraceSpan(const char *category, const std::string &name)
+    : m_category(category)
+{
+    if (!TraceRecorder::get().enabled())
+        return;
+    m_name = name;
+    m_start = std::chrono::steady_clock::now();
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (m_name.empty())
+        return;
+    TraceRecorder::get().addSpan(std::move(m_name), m_category, m_start, std::chrono::steady_clock::now());
+}
+
+} // namespace ASGenerator
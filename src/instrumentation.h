@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cstdint>
+#include <filesystem>
+#include <nlohmann/json.hpp>
+
+namespace ASGenerator
+{
+
+/**
+ * Stages of a generator run that we keep timings for.
+ */
+enum class PerfStage {
+    Download,
+    IndexLoad,
+    ContentsSeed,
+    Process,
+    ArchiveExtract,
+    Compose,
+    IconRender,
+    DbCommit,
+    Export,
+    ExportCompress,
+    IconTarballs,
+    ReportRender,
+};
+inline constexpr std::size_t PerfStageCount = static_cast<std::size_t>(PerfStage::ReportRender) + 1;
+
+/**
+ * Events of a generator run that we count.
+ */
+enum class PerfCounter {
+    PackagesScanned,
+    PackagesIgnored,
+    PackagesProcessed,
+    PackagesReused,
+    Components,
+    Hints,
+    HintsError,
+    HintsWarning,
+    HintsInfo,
+    HintsPedantic,
+    BytesDownloaded,
+    BytesDecompressed,
+};
+inline constexpr std::size_t PerfCounterCount = static_cast<std::size_t>(PerfCounter::BytesDecompressed) + 1;
+
+/**
+ * Name of @stage, as used in summaries and statistics.
+ */
+const char *perfStageName(PerfStage stage);
+
+/**
+ * Name of @counter, as used in summaries and statistics.
+ */
+const char *perfCounterName(PerfCounter counter);
+
+/**
+ * Accumulated timing of one stage.
+ */
+struct PerfStageTiming {
+    std::uint64_t calls{0};
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds max{0};
+};
+
+/**
+ * Timings and counters collected for one suite/section/architecture.
+ * Work that is not specific to an architecture is recorded with an empty @arch.
+ */
+struct PerfScopeSummary {
+    std::string suite;
+    std::string section;
+    std::string arch;
+    std::array<PerfStageTiming, PerfStageCount> stages;
+    std::array<std::uint64_t, PerfCounterCount> counters{};
+
+    /**
+     * Add the timings and counters of @other to this summary.
+     */
+    void merge(const PerfScopeSummary &other);
+};
+
+/**
+ * Collects timings and counters of the hot paths of a generator run.
+ *
+ * Measurements are attributed to the suite/section/architecture that is currently being
+ * worked on, which the engine sets with setScope() from its (serial) main loop. Recording
+ * only touches atomics of that scope, so timers can be used from any number of worker threads.
+ */
+class Instrumentation
+{
+public:
+    static Instrumentation &get();
+
+    /**
+     * Attribute all following measurements to @suite/@section/@arch.
+     */
+    void setScope(const std::string &suite, const std::string &section, const std::string &arch = {});
+
+    /**
+     * Drop all collected data. Must not be called while measurements may still be recorded.
+     */
+    void reset();
+
+    /**
+     * Time that passed since the collected data was last reset.
+     */
+    std::chrono::nanoseconds elapsed() const;
+
+    void recordTime(PerfStage stage, std::chrono::nanoseconds duration);
+    void count(PerfCounter counter, std::uint64_t amount = 1);
+
+    /**
+     * Get the data collected for every scope so far, in the order the scopes were first used.
+     */
+    std::vector<PerfScopeSummary> summaries() const;
+
+    /**
+     * Get the data collected for @suite/@section, over all of its architectures.
+     */
+    PerfScopeSummary sectionSummary(const std::string &suite, const std::string &section) const;
+
+    /**
+     * Render the collected data as human-readable table, one line per entry.
+     */
+    std::vector<std::string> summaryTable() const;
+
+    /**
+     * Get the collected data as JSON document.
+     */
+    nlohmann::json toJson() const;
+
+    // Delete copy constructor and assignment operator
+    Instrumentation(const Instrumentation &) = delete;
+    Instrumentation &operator=(const Instrumentation &) = delete;
+
+private:
+    Instrumentation();
+
+    struct ScopeData {
+        std::string suite;
+        std::string section;
+        std::string arch;
+        std::array<std::atomic<std::uint64_t>, PerfStageCount> calls{};
+        std::array<std::atomic<std::uint64_t>, PerfStageCount> totalNs{};
+        std::array<std::atomic<std::uint64_t>, PerfStageCount> maxNs{};
+        std::array<std::atomic<std::uint64_t>, PerfCounterCount> counters{};
+
+        PerfScopeSummary summary() const;
+    };
+
+    mutable std::mutex m_mutex;
+    std::deque<std::unique_ptr<ScopeData>> m_scopes;
+    std::atomic<ScopeData *> m_current;
+    std::chrono::steady_clock::time_point m_resetTime;
+};
+
+/**
+ * Records a timeline of a run in the trace event format understood by Chrome's
+ * about:tracing and Perfetto, with one track per thread.
+ *
+ * Every thread appends to a buffer of its own, so recording a span needs no locking.
+ * The buffers are only read by write(), which must be called once all work has finished.
+ */
+class TraceRecorder
+{
+public:
+    static TraceRecorder &get();
+
+    /**
+     * Start recording spans.
+     */
+    void start();
+
+    bool enabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Record a span named @name of @category for the calling thread.
+     */
+    void addSpan(
+        std::string name,
+        const char *category,
+        std::chrono::steady_clock::time_point start,
+        std::chrono::steady_clock::time_point end);
+
+    /**
+     * Write all recorded spans to @fname. Throws if the file can not be written.
+     */
+    void write(const std::filesystem::path &fname) const;
+
+    // Delete copy constructor and assignment operator
+    TraceRecorder(const TraceRecorder &) = delete;
+    TraceRecorder &operator=(const TraceRecorder &) = delete;
+
+private:
+    TraceRecorder();
+
+    struct Event {
+        std::string name;
+        const char *category;
+        std::int64_t startUs;
+        std::int64_t durationUs;
+    };
+
+    struct ThreadBuffer {
+        std::uint32_t tid;
+        std::string threadName;
+        std::vector<Event> events;
+    };
+
+    static thread_local ThreadBuffer *m_threadBuffer;
+    ThreadBuffer *threadBuffer();
+
+    std::atomic<bool> m_enabled;
+    std::chrono::steady_clock::time_point m_epoch;
+    std::thread::id m_mainThread;
+
+    // only guards registering the buffer of a new thread
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+};
+
+/**
+ * Record a trace span named @name for the current scope, if tracing is enabled.
+ */
+class TraceSpan
+{
+public:
+    TraceSpan(const char *category, const std::string &name);
+    ~TraceSpan();
+
+    // Delete copy constructor and assignment operator
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *m_category;
+    std::string m_name;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * Measure the time until the end of the current scope for @stage.
+ * If tracing is enabled, the time is also recorded as span of the trace.
+ *
+ * Timers of the same stage may nest (e.g. when reading an archive member requires extracting
+ * the whole archive first), in which case only the outermost one is recorded.
+ */
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(PerfStage stage);
+    ~ScopedTimer();
+
+    // Delete copy constructor and assignment operator
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    PerfStage m_stage;
+    bool m_outermost;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace ASGenerator
@@ -39,6 +39,7 @@
 #include "logging.h"
 #include "config.h"
 #include "engine.h"
+#include "instrumentation.h"
 #include "utils.h"
 
 using namespace ASGenerator;
@@ -148,10 +149,19 @@ static void ensureSuiteAndOrSectionParameterSet(const std::vector<std::string> &
 /**
  * Execute the specified command with the given arguments.
  */
-static int executeCommand(const std::string &command, const std::vector<std::string> &args, bool forceAction)
+static int executeCommand(
+    const std::string &command,
+    const std::vector<std::string> &args,
+    bool forceAction,
+    const std::string &timingsFname,
+    const std::string &metricsFname)
 {
     auto engine = std::make_unique<Engine>();
     engine->setForced(forceAction);
+    if (!timingsFname.empty())
+        engine->setPerfReportFile(timingsFname);
+    if (!metricsFname.empty())
+        engine->setMetricsFile(metricsFname);
 
     if (command == "run" || command == "process") {
         if (args.size() == 2) {
@@ -180,8 +190,16 @@ static int executeCommand(const std::string &command, const std::vector<std::str
             engine->publish(args[2]);
         else
             engine->publish(args[2], args[3]);
+    } else if (command == "republish") {
+        ensureSuiteAndOrSectionParameterSet(args);
+        if (args.size() == 3)
+            engine->republish(args[2]);
+        else
+            engine->republish(args[2], args[3]);
     } else if (command == "cleanup") {
         engine->runCleanup();
+    } else if (command == "optimize-db") {
+        engine->optimizeDatabases();
     } else if (command == "remove-found") {
         if (args.size() != 3) {
             flushLogs();
@@ -244,6 +262,9 @@ int main(int argc, char **argv)
     g_autofree gchar *wdir = nullptr;
     g_autofree gchar *exportDir = nullptr;
     g_autofree gchar *configFname = nullptr;
+    g_autofree gchar *timingsFname = nullptr;
+    g_autofree gchar *traceFname = nullptr;
+    g_autofree gchar *metricsFname = nullptr;
 
     setupLocale();
 
@@ -260,6 +281,9 @@ int main(int argc, char **argv)
         {"workspace", 'w', 0, G_OPTION_ARG_STRING, &wdir, "Define the workspace location", "DIR"},
         {"config", 'c', 0, G_OPTION_ARG_STRING, &configFname, "Use the given configuration file", "FILE"},
         {"export-dir", 0, 0, G_OPTION_ARG_STRING, &exportDir, "Override the workspace root export directory", "DIR"},
+        {"timings", 0, 0, G_OPTION_ARG_FILENAME, &timingsFname, "Write the timings of a run to FILE, as JSON", "FILE"},
+        {"trace", 0, 0, G_OPTION_ARG_FILENAME, &traceFname, "Write a timeline of the run to FILE, in trace event format", "FILE"},
+        {"metrics", 0, 0, G_OPTION_ARG_FILENAME, &metricsFname, "Write metrics of the command to FILE, in OpenMetrics format", "FILE"},
         {nullptr}
     };
 
@@ -274,7 +298,10 @@ int main(int argc, char **argv)
         "  process-file SUITE SECTION FILE1 [FILE2 ...]\n"
         "                          - Process new metadata for the given package file.\n"
         "  cleanup                 - Cleanup old metadata and media files.\n"
+        "  optimize-db             - Train new compression dictionaries and recompress the databases.\n"
         "  publish SUITE [SECTION] - Export all metadata and publish reports in the export directories.\n"
+        "  republish SUITE [SECTION]\n"
+        "                          - Publish again for the packages exported last time, without reading the archive.\n"
         "  remove-found SUITE      - Drop all valid processed metadata and hints.\n"
         "  forget PKID             - Drop all information we have about this (partial) package-id.\n"
         "  info PKID               - Show information associated with this (full) package-id.\n");
@@ -354,12 +381,18 @@ int main(int argc, char **argv)
     // ensure runtime dir exists, in case we are installed with Snappy
     createXdgRuntimeDir();
 
+    // record a timeline for the whole command, and write it once everything is done
+    if (traceFname)
+        TraceRecorder::get().start();
+
     int result = 0;
     if (verbose) {
-        result = executeCommand(args[1], args, forceAction);
+        result = executeCommand(
+            args[1], args, forceAction, timingsFname ? timingsFname : "", metricsFname ? metricsFname : "");
     } else {
         try {
-            result = executeCommand(args[1], args, forceAction);
+            result = executeCommand(
+                args[1], args, forceAction, timingsFname ? timingsFname : "", metricsFname ? metricsFname : "");
         } catch (const std::exception &e) {
             flushLogs();
             std::cerr << std::format("Error executing command: {}", e.what()) << std::endl;
@@ -367,6 +400,15 @@ int main(int argc, char **argv)
         }
     }
 
+    if (traceFname) {
+        try {
+            TraceRecorder::get().write(traceFname);
+        } catch (const std::exception &e) {
+            LOG_ERROR(logRoot, "{}", e.what());
+            result = 1;
+        }
+    }
+
     shutdownLogging();
     return result;
 }
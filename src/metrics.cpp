@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "metrics.h"
+
+#include <format>
+#include <fstream>
+#include <stdexcept>
+#include <cmath>
+#include <unistd.h>
+
+namespace ASGenerator
+{
+
+void MetricFamily::add(double value, std::vector<std::pair<std::string, std::string>> labels)
+{
+    samples.push_back(MetricSample{std::move(labels), value});
+}
+
+static std::string escapeLabelValue(const std::string &value)
+{
+    std::string res;
+    res.reserve(value.size());
+    for (const auto c : value) {
+        switch (c) {
+        case '\\':
+            res += "\\\\";
+            break;
+        case '"':
+            res += "\\\"";
+            break;
+        case '\n':
+            res += "\\n";
+            break;
+        default:
+            res += c;
+        }
+    }
+
+    return res;
+}
+
+static std::string escapeHelp(const std::string &text)
+{
+    std::string res;
+    res.reserve(text.size());
+    for (const auto c : text) {
+        if (c == '\\')
+            res += "\\\\";
+        else if (c == '\n')
+            res += "\\n";
+        else
+            res += c;
+    }
+
+    return res;
+}
+
+static std::string formatValue(double value)
+{
+    if (std::isnan(value))
+        return "NaN";
+    if (std::isinf(value))
+        return value > 0 ? "+Inf" : "-Inf";
+    // print integral values without exponent, which is what most of our values are
+    if (value == std::trunc(value) && std::fabs(value) < 1e15)
+        return std::format("{}", static_cast<long long>(value));
+    return std::format("{}", value);
+}
+
+std::string renderOpenMetrics(const std::vector<MetricFamily> &families)
+{
+    std::string res;
+    for (const auto &family : families) {
+        res += std::format("# TYPE {} {}\n", family.name, family.type);
+        if (!family.unit.empty())
+            res += std::format("# UNIT {} {}\n", family.name, family.unit);
+        if (!family.help.empty())
+            res += std::format("# HELP {} {}\n", family.name, escapeHelp(family.help));
+
+        // counters are exposed with a suffix, info metrics always have a value of 1
+        std::string sampleName = family.name;
+        if (family.type == "counter")
+            sampleName += "_total";
+        else if (family.type == "info")
+            sampleName += "_info";
+
+        for (const auto &sample : family.samples) {
+            res += sampleName;
+            if (!sample.labels.empty()) {
+                res += '{';
+                bool first = true;
+                for (const auto &[name, value] : sample.labels) {
+                    if (!first)
+                        res += ',';
+                    first = false;
+                    res += std::format("{}=\"{}\"", name, escapeLabelValue(value));
+                }
+                res += '}';
+            }
+            res += ' ';
+            res += formatValue(sample.value);
+            res += '\n';
+        }
+    }
+    res += "# EOF\n";
+
+    return res;
+}
+
+void writeOpenMetricsFile(const std::filesystem::path &fname, const std::vector<MetricFamily> &families)
+{
+    // write next to the target, so the final rename does not cross filesystems
+    const auto tmpFname = fname.parent_path() / std::format(".{}.{}.tmp", fname.filename().string(), getpid());
+    {
+        std::ofstream f(tmpFname, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error(std::format("Unable to open {} for writing", tmpFname.string()));
+        f << renderOpenMetrics(families);
+        f.close();
+        if (!f) {
+            std::error_code ec;
+            std::filesystem::remove(tmpFname, ec);
+            throw std::runtime_error(std::format("Unable to write metrics to {}", tmpFname.string()));
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpFname, fname, ec);
+    if (ec) {
+        std::error_code rmEc;
+        std::filesystem::remove(tmpFname, rmEc);
+        throw std::runtime_error(std::format("Unable to write metrics to {}: {}", fname.string(), ec.message()));
+    }
+}
+
+} // namespace ASGenerator
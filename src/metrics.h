@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <filesystem>
+
+namespace ASGenerator
+{
+
+/**
+ * One sample of a metric, with its labels as name/value pairs.
+ */
+struct MetricSample {
+    std::vector<std::pair<std::string, std::string>> labels;
+    double value{0};
+};
+
+/**
+ * A metric and all of its samples.
+ */
+struct MetricFamily {
+    std::string name;
+    /// OpenMetrics type of the metric, e.g. "gauge", "counter" or "info"
+    std::string type;
+    std::string help;
+    /// Unit of the metric, if any. The name must end with it.
+    std::string unit;
+    std::vector<MetricSample> samples;
+
+    /**
+     * Add a sample with value @value and labels @labels.
+     */
+    void add(double value, std::vector<std::pair<std::string, std::string>> labels = {});
+};
+
+/**
+ * Render @families in the OpenMetrics text exposition format.
+ */
+std::string renderOpenMetrics(const std::vector<MetricFamily> &families);
+
+/**
+ * Write @families to @fname in the OpenMetrics text format.
+ *
+ * The file is replaced atomically, so collectors like the node exporter's textfile
+ * collector never see a partially written file. Throws if the file can not be written.
+ */
+void writeOpenMetricsFile(const std::filesystem::path &fname, const std::vector<MetricFamily> &families);
+
+} // namespace ASGenerator
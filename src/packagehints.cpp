@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "packagehints.h"
+
+#include <format>
+#include <stdexcept>
+#include <unordered_map>
+#include <cstdint>
+#include <glib.h>
+#include <nlohmann/json.hpp>
+
+#include "utils.h"
+
+namespace ASGenerator
+{
+
+// first byte of a binary hints record. JSON documents start with '{', and this must also
+// differ from the marker of compressed values, as records may be stored uncompressed.
+static constexpr char HintsFormatBinary = 0x02;
+
+static void appendString(std::string &buffer, std::string_view str)
+{
+    Utils::appendVarint(buffer, str.size());
+    buffer.append(str);
+}
+
+static std::string_view readString(std::string_view data, std::size_t &pos)
+{
+    std::uint64_t length;
+    if (!Utils::readVarint(data, pos, length) || length > data.size() - pos)
+        throw std::runtime_error("Hints record is truncated.");
+
+    const auto str = data.substr(pos, length);
+    pos += length;
+    return str;
+}
+
+/**
+ * Read the number of entries of a list. Every entry takes at least one byte,
+ * so a count larger than the remaining data means the record is damaged.
+ */
+static std::uint64_t readCount(std::string_view data, std::size_t &pos)
+{
+    std::uint64_t count;
+    if (!Utils::readVarint(data, pos, count) || count > data.size() - pos)
+        throw std::runtime_error("Hints record is truncated.");
+    return count;
+}
+
+/**
+ * Append @str to @buffer as JSON string, escaped the same way nlohmann::json does it.
+ */
+static void appendJsonString(std::string &buffer, std::string_view str)
+{
+    g_autofree gchar *validStr = nullptr;
+    if (!g_utf8_validate_len(str.data(), str.size(), nullptr)) {
+        validStr = g_utf8_make_valid(str.data(), str.size());
+        str = validStr;
+    }
+
+    buffer.push_back('"');
+    for (const char c : str) {
+        switch (c) {
+        case '"':
+            buffer.append("\\\"");
+            break;
+        case '\\':
+            buffer.append("\\\\");
+            break;
+        case '\b':
+            buffer.append("\\b");
+            break;
+        case '\f':
+            buffer.append("\\f");
+            break;
+        case '\n':
+            buffer.append("\\n");
+            break;
+        case '\r':
+            buffer.append("\\r");
+            break;
+        case '\t':
+            buffer.append("\\t");
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                buffer.append(std::format("\\u{:04x}", static_cast<unsigned char>(c)));
+            else
+                buffer.push_back(c);
+        }
+    }
+    buffer.push_back('"');
+}
+
+static PackageHints decodeJson(std::string_view data)
+{
+    const auto doc = nlohmann::ordered_json::parse(data);
+    if (!doc.is_object() || !doc.contains("hints") || !doc["hints"].is_object())
+        throw std::runtime_error("Hints document has no hints.");
+
+    PackageHints result;
+    for (const auto &[cid, hintNodes] : doc["hints"].items()) {
+        auto &cptHints = result.components.emplace_back();
+        cptHints.cid = cid;
+        if (!hintNodes.is_array())
+            continue;
+
+        for (const auto &hintNode : hintNodes) {
+            if (!hintNode.is_object() || !hintNode.contains("tag") || !hintNode["tag"].is_string())
+                continue;
+
+            auto &hint = cptHints.hints.emplace_back();
+            hint.tag = hintNode["tag"].get<std::string>();
+            if (!hintNode.contains("vars") || !hintNode["vars"].is_object())
+                continue;
+            for (const auto &[key, value] : hintNode["vars"].items())
+                hint.vars.emplace_back(key, value.is_string() ? value.get<std::string>() : value.dump());
+        }
+    }
+
+    return result;
+}
+
+static PackageHints decodeBinary(std::string_view data)
+{
+    std::size_t pos = 1;
+
+    // the tags and variable names used in this record
+    std::vector<std::string_view> strings(readCount(data, pos));
+    for (auto &str : strings)
+        str = readString(data, pos);
+
+    const auto stringAt = [&](std::uint64_t index) {
+        if (index >= strings.size())
+            throw std::runtime_error(std::format("Hints record refers to unknown string {}.", index));
+        return std::string(strings[index]);
+    };
+
+    PackageHints result;
+    result.components.resize(readCount(data, pos));
+    for (auto &cptHints : result.components) {
+        cptHints.cid = readString(data, pos);
+        cptHints.hints.resize(readCount(data, pos));
+        for (auto &hint : cptHints.hints) {
+            std::uint64_t index;
+            if (!Utils::readVarint(data, pos, index))
+                throw std::runtime_error("Hints record is truncated.");
+            hint.tag = stringAt(index);
+
+            const auto varsCount = readCount(data, pos);
+            hint.vars.reserve(varsCount);
+            for (std::uint64_t i = 0; i < varsCount; i++) {
+                if (!Utils::readVarint(data, pos, index))
+                    throw std::runtime_error("Hints record is truncated.");
+                auto key = stringAt(index);
+                hint.vars.emplace_back(std::move(key), readString(data, pos));
+            }
+        }
+    }
+
+    return result;
+}
+
+bool PackageHints::empty() const
+{
+    for (const auto &cptHints : components) {
+        if (!cptHints.hints.empty())
+            return false;
+    }
+
+    return true;
+}
+
+bool PackageHints::addHint(
+    const std::string &cid,
+    const std::string &tag,
+    std::vector<std::pair<std::string, std::string>> vars)
+{
+    ComponentHints *target = nullptr;
+    for (auto &cptHints : components) {
+        if (cptHints.cid == cid) {
+            target = &cptHints;
+            break;
+        }
+    }
+    if (target == nullptr) {
+        target = &components.emplace_back();
+        target->cid = cid;
+    }
+
+    for (const auto &hint : target->hints) {
+        if (hint.tag == tag)
+            return false;
+    }
+
+    target->hints.push_back(IssueHint{tag, std::move(vars)});
+    return true;
+}
+
+std::string PackageHints::encode() const
+{
+    // intern tags and variable names, which are shared by many hints
+    std::vector<std::string_view> strings;
+    std::unordered_map<std::string_view, std::uint64_t> stringIds;
+    const auto intern = [&](std::string_view str) {
+        const auto [it, inserted] = stringIds.emplace(str, strings.size());
+        if (inserted)
+            strings.push_back(str);
+        return it->second;
+    };
+    for (const auto &cptHints : components) {
+        for (const auto &hint : cptHints.hints) {
+            intern(hint.tag);
+            for (const auto &var : hint.vars)
+                intern(var.first);
+        }
+    }
+
+    std::string data;
+    data.push_back(HintsFormatBinary);
+    Utils::appendVarint(data, strings.size());
+    for (const auto &str : strings)
+        appendString(data, str);
+
+    Utils::appendVarint(data, components.size());
+    for (const auto &cptHints : components) {
+        appendString(data, cptHints.cid);
+        Utils::appendVarint(data, cptHints.hints.size());
+        for (const auto &hint : cptHints.hints) {
+            Utils::appendVarint(data, stringIds.at(hint.tag));
+            Utils::appendVarint(data, hint.vars.size());
+            for (const auto &[key, value] : hint.vars) {
+                Utils::appendVarint(data, stringIds.at(key));
+                appendString(data, value);
+            }
+        }
+    }
+
+    return data;
+}
+
+bool PackageHints::isEncoded(std::string_view data)
+{
+    return !data.empty() && data[0] == HintsFormatBinary;
+}
+
+PackageHints PackageHints::decode(std::string_view data)
+{
+    if (isEncoded(data))
+        return decodeBinary(data);
+    return decodeJson(data);
+}
+
+void PackageHints::appendJson(std::string &buffer, std::string_view pkid) const
+{
+    buffer.append("{\"package\":");
+    appendJsonString(buffer, pkid);
+    buffer.append(",\"hints\":{");
+
+    bool firstCpt = true;
+    for (const auto &cptHints : components) {
+        if (!firstCpt)
+            buffer.push_back(',');
+        firstCpt = false;
+
+        appendJsonString(buffer, cptHints.cid);
+        buffer.append(":[");
+        bool firstHint = true;
+        for (const auto &hint : cptHints.hints) {
+            if (!firstHint)
+                buffer.push_back(',');
+            firstHint = false;
+
+            buffer.append("{\"tag\":");
+            appendJsonString(buffer, hint.tag);
+            if (!hint.vars.empty()) {
+                buffer.append(",\"vars\":{");
+                bool firstVar = true;
+                for (const auto &[key, value] : hint.vars) {
+                    if (!firstVar)
+                        buffer.push_back(',');
+                    firstVar = false;
+
+                    appendJsonString(buffer, key);
+                    buffer.push_back(':');
+                    appendJsonString(buffer, value);
+                }
+                buffer.push_back('}');
+            }
+            buffer.push_back('}');
+        }
+        buffer.push_back(']');
+    }
+
+    buffer.append("}}");
+}
+
+std::string PackageHints::toJson(std::string_view pkid) const
+{
+    std::string buffer;
+    appendJson(buffer, pkid);
+    return buffer;
+}
+
+} // namespace ASGenerator
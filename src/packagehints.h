@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+
+namespace ASGenerator
+{
+
+/**
+ * A single issue hint, as tag with the variables used to render its explanation.
+ */
+struct IssueHint {
+    std::string tag;
+    std::vector<std::pair<std::string, std::string>> vars;
+};
+
+/**
+ * All hints found for one component of a package.
+ */
+struct ComponentHints {
+    std::string cid;
+    std::vector<IssueHint> hints;
+};
+
+/**
+ * The hints found for a package, and their storage format.
+ *
+ * Hints are stored in a compact binary record: every distinct tag and variable name used by
+ * the package is stored once and referenced by its index, and all lengths and indices are
+ * variable-length integers. JSON is only generated from it when hints are exported.
+ * Records written by older versions, which stored the JSON document itself, can be read as well.
+ */
+struct PackageHints {
+    std::vector<ComponentHints> components;
+
+    /**
+     * True if no component has any hints.
+     */
+    bool empty() const;
+
+    /**
+     * Add a hint with @tag for @cid.
+     *
+     * @return False if @cid already carries a hint with @tag, in which case nothing is added.
+     */
+    bool addHint(
+        const std::string &cid,
+        const std::string &tag,
+        std::vector<std::pair<std::string, std::string>> vars = {});
+
+    /**
+     * Serialize the hints into their binary storage format.
+     */
+    std::string encode() const;
+
+    /**
+     * Read hints from @data, which may be a binary record or a JSON hints document.
+     * Throws if the data is malformed.
+     */
+    static PackageHints decode(std::string_view data);
+
+    /**
+     * Check whether @data is a binary hints record, as opposed to a JSON document.
+     */
+    static bool isEncoded(std::string_view data);
+
+    /**
+     * Append the JSON hints document for package @pkid to @buffer.
+     */
+    void appendJson(std::string &buffer, std::string_view pkid) const;
+
+    /**
+     * Get the JSON hints document for package @pkid.
+     */
+    std::string toJson(std::string_view pkid) const;
+};
+
+} // namespace ASGenerator
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pkgindexcache.h"
+
+#include <format>
+
+#include "logging.h"
+
+namespace ASGenerator
+{
+
+/**
+ * Rough estimate of the memory a loaded package occupies. Package contents
+ * are loaded lazily and dropped when a package is finished, so they are not included.
+ */
+static std::size_t estimatePackageBytes(const Package &pkg)
+{
+    std::size_t bytes = 256 + pkg.id().size() * 2;
+    for (const auto &[locale, text] : pkg.summary())
+        bytes += 64 + locale.size() + text.size();
+    for (const auto &[locale, text] : pkg.description())
+        bytes += 64 + locale.size() + text.size();
+
+    return bytes;
+}
+
+PackageIndexCache::Pin::Pin(PackageIndexCache &cache, const std::string &suite, const std::string &section)
+    : m_cache(cache),
+      m_key(std::format("{}/{}", suite, section))
+{
+    m_cache.pin(m_key);
+}
+
+PackageIndexCache::Pin::~Pin()
+{
+    m_cache.unpin(m_key);
+}
+
+PackageIndexCache::PackageIndexCache(std::unique_ptr<PackageIndex> index, std::size_t budgetBytes)
+    : PackageIndex("pkgcache"),
+      m_index(std::move(index)),
+      m_budget(budgetBytes),
+      m_cachedBytes(0)
+{
+}
+
+void PackageIndexCache::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        evictToBudget();
+    }
+
+    std::lock_guard<std::mutex> indexLock(m_indexMutex);
+    m_index->release();
+}
+
+std::vector<std::shared_ptr<Package>> PackageIndexCache::packagesFor(
+    const std::string &suite,
+    const std::string &section,
+    const std::string &arch,
+    bool withLongDescs)
+{
+    const auto pinKey = std::format("{}/{}", suite, section);
+    const auto key = std::format("{}/{}", pinKey, arch);
+
+    std::promise<PackageSet> promise;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            auto it = m_entries.find(key);
+            // a set without long descriptions can only be used if we do not need them
+            if (it != m_entries.end() && (it->second.withLongDescs || !withLongDescs)) {
+                m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+                return *it->second.pkgs;
+            }
+
+            const auto loadingIt = m_loading.find(key);
+            if (loadingIt == m_loading.end())
+                break;
+
+            // somebody else is loading this set already, wait for them
+            const auto loading = loadingIt->second;
+            lock.unlock();
+            const auto pkgs = loading.pkgs.get();
+            if (loading.withLongDescs || !withLongDescs)
+                return *pkgs;
+            lock.lock();
+        }
+
+        m_loading.emplace(key, Loading{promise.get_future().share(), withLongDescs});
+    }
+
+    // parse the index without blocking other users of the cache
+    PackageSet pkgs;
+    try {
+        std::lock_guard<std::mutex> indexLock(m_indexMutex);
+        pkgs = std::make_shared<const std::vector<std::shared_ptr<Package>>>(
+            m_index->packagesFor(suite, section, arch, withLongDescs));
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_loading.erase(key);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+
+    Entry entry;
+    entry.pkgs = pkgs;
+    entry.pinKey = pinKey;
+    entry.withLongDescs = withLongDescs;
+    for (const auto &pkg : *pkgs)
+        entry.bytes += estimatePackageBytes(*pkg);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // replace a set we loaded without long descriptions before
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_cachedBytes -= it->second.bytes;
+            m_lru.erase(it->second.lruPos);
+            m_entries.erase(it);
+        }
+
+        m_lru.push_front(key);
+        entry.lruPos = m_lru.begin();
+        m_cachedBytes += entry.bytes;
+        LOG_DEBUG(
+            m_log,
+            "Cached {} packages of {} (~{} KiB, {} KiB in total)",
+            pkgs->size(),
+            key,
+            entry.bytes / 1024,
+            m_cachedBytes / 1024);
+        m_entries.emplace(key, std::move(entry));
+        m_loading.erase(key);
+    }
+    promise.set_value(pkgs);
+
+    return *pkgs;
+}
+
+std::shared_ptr<Package> PackageIndexCache::packageForFile(
+    const std::string &fname,
+    const std::string &suite,
+    const std::string &section)
+{
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    return m_index->packageForFile(fname, suite, section);
+}
+
+bool PackageIndexCache::hasChanges(
+    std::shared_ptr<DataStore> dstore,
+    const std::string &suite,
+    const std::string &section,
+    const std::string &arch)
+{
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    return m_index->hasChanges(std::move(dstore), suite, section, arch);
+}
+
+void PackageIndexCache::contentsAvailable(
+    std::shared_ptr<ContentsStore> cstore,
+    const std::string &suite,
+    const std::string &section,
+    const std::string &arch)
+{
+    std::lock_guard<std::mutex> lock(m_indexMutex);
+    m_index->contentsAvailable(std::move(cstore), suite, section, arch);
+}
+
+std::string PackageIndexCache::dataPrefix() const
+{
+    return m_index->dataPrefix();
+}
+
+std::size_t PackageIndexCache::cachedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cachedBytes;
+}
+
+std::size_t PackageIndexCache::cachedSets() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+void PackageIndexCache::pin(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pins[key]++;
+}
+
+void PackageIndexCache::unpin(const std::string &key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_pins.find(key);
+    if (it == m_pins.end())
+        return;
+    if (--it->second == 0)
+        m_pins.erase(it);
+}
+
+void PackageIndexCache::evictToBudget()
+{
+    // walk from the least recently used set to the most recently used one
+    auto lruIt = m_lru.end();
+    while (m_cachedBytes > m_budget && lruIt != m_lru.begin()) {
+        --lruIt;
+        auto entryIt = m_entries.find(*lruIt);
+        if (m_pins.contains(entryIt->second.pinKey))
+            continue;
+
+        LOG_DEBUG(m_log, "Evicting package set {} from cache", *lruIt);
+        m_cachedBytes -= entryIt->second.bytes;
+        m_entries.erase(entryIt);
+        lruIt = m_lru.erase(lruIt);
+    }
+}
+
+} // namespace ASGenerator
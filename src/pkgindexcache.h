@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <cstdint>
+#include <unordered_map>
+
+#include "backends/interfaces.h"
+
+namespace ASGenerator
+{
+
+/**
+ * Caching layer over a backend's PackageIndex.
+ *
+ * Package sets are loaded once per suite/section/arch triplet and shared between all
+ * callers, even if they ask for the same set at the same time. Sets that are not pinned
+ * are evicted in least-recently-used order once their estimated size exceeds the memory
+ * budget, which happens when the index is released.
+ */
+class PackageIndexCache final : public PackageIndex
+{
+public:
+    /**
+     * Keeps the package sets of a suite/section in memory for as long as it exists.
+     */
+    class Pin
+    {
+    public:
+        Pin(PackageIndexCache &cache, const std::string &suite, const std::string &section);
+        ~Pin();
+
+        // Delete copy constructor and assignment operator
+        Pin(const Pin &) = delete;
+        Pin &operator=(const Pin &) = delete;
+
+    private:
+        PackageIndexCache &m_cache;
+        std::string m_key;
+    };
+
+    /**
+     * Wrap @index, keeping at most @budgetBytes worth of unpinned package sets
+     * in memory after the index is released.
+     */
+    PackageIndexCache(std::unique_ptr<PackageIndex> index, std::size_t budgetBytes);
+
+    /**
+     * Evict unpinned package sets until the budget is met, and let the backend
+     * drop its own data.
+     */
+    void release() override;
+
+    std::vector<std::shared_ptr<Package>> packagesFor(
+        const std::string &suite,
+        const std::string &section,
+        const std::string &arch,
+        bool withLongDescs = true) override;
+
+    std::shared_ptr<Package> packageForFile(
+        const std::string &fname,
+        const std::string &suite = "",
+        const std::string &section = "") override;
+
+    bool hasChanges(
+        std::shared_ptr<DataStore> dstore,
+        const std::string &suite,
+        const std::string &section,
+        const std::string &arch) override;
+
+    void contentsAvailable(
+        std::shared_ptr<ContentsStore> cstore,
+        const std::string &suite,
+        const std::string &section,
+        const std::string &arch) override;
+
+    [[nodiscard]] std::string dataPrefix() const override;
+
+    /**
+     * Estimated size of all package sets that are currently cached, in bytes.
+     */
+    std::size_t cachedBytes() const;
+
+    /**
+     * Number of package sets that are currently cached.
+     */
+    std::size_t cachedSets() const;
+
+private:
+    using PackageSet = std::shared_ptr<const std::vector<std::shared_ptr<Package>>>;
+
+    struct Entry {
+        PackageSet pkgs;
+        std::string pinKey;
+        std::size_t bytes = 0;
+        bool withLongDescs = false;
+        std::list<std::string>::iterator lruPos;
+    };
+
+    /**
+     * A package set that is being loaded right now.
+     */
+    struct Loading {
+        std::shared_future<PackageSet> pkgs;
+        bool withLongDescs = false;
+    };
+
+    std::unique_ptr<PackageIndex> m_index;
+    // backends are not thread-safe, so only one thread may use the wrapped index at a time
+    std::mutex m_indexMutex;
+    std::size_t m_budget;
+    std::size_t m_cachedBytes;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::unordered_map<std::string, Loading> m_loading;
+    // cache keys, the most recently used one first
+    std::list<std::string> m_lru;
+    // number of pins for every suite/section
+    std::unordered_map<std::string, std::size_t> m_pins;
+
+    void pin(const std::string &key);
+    void unpin(const std::string &key);
+    void evictToBudget();
+};
+
+} // namespace ASGenerator
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "recordedpkg.h"
+
+#include <format>
+#include <stdexcept>
+
+namespace ASGenerator
+{
+
+RecordedPackage::RecordedPackage(PackageRecord record)
+    : m_record(std::move(record))
+{
+}
+
+std::string RecordedPackage::name() const
+{
+    return m_record.name;
+}
+
+std::string RecordedPackage::ver() const
+{
+    return m_record.ver;
+}
+
+std::string RecordedPackage::arch() const
+{
+    return m_record.arch;
+}
+
+std::string RecordedPackage::maintainer() const
+{
+    return m_record.maintainer;
+}
+
+PackageKind RecordedPackage::kind() const noexcept
+{
+    return m_record.kind;
+}
+
+const std::unordered_map<std::string, std::string> &RecordedPackage::description() const
+{
+    return m_desc;
+}
+
+std::string RecordedPackage::getFilename()
+{
+    return "_recorded_";
+}
+
+const std::vector<std::string> &RecordedPackage::contents()
+{
+    return m_contents;
+}
+
+std::vector<std::uint8_t> RecordedPackage::getFileData(const std::string &fname)
+{
+    throw std::runtime_error(
+        std::format("Can not read '{}': The data of recorded package {} is not available.", fname, id()));
+}
+
+void RecordedPackage::finish()
+{
+    // nothing was opened
+}
+
+} // namespace ASGenerator
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "datastore.h"
+#include "backends/interfaces.h"
+
+namespace ASGenerator
+{
+
+/**
+ * Package restored from the record the data store keeps of exported packages.
+ *
+ * It knows the identity of the package, but nothing about its contents, so it can only
+ * be used to export data that was generated before.
+ */
+class RecordedPackage final : public Package
+{
+public:
+    explicit RecordedPackage(PackageRecord record);
+
+    std::string name() const override;
+    std::string ver() const override;
+    std::string arch() const override;
+    std::string maintainer() const override;
+    PackageKind kind() const noexcept override;
+    const std::unordered_map<std::string, std::string> &description() const override;
+    std::string getFilename() override;
+
+    const std::vector<std::string> &contents() override;
+    std::vector<std::uint8_t> getFileData(const std::string &fname) override;
+    void finish() override;
+
+private:
+    PackageRecord m_record;
+    std::unordered_map<std::string, std::string> m_desc;
+    std::vector<std::string> m_contents;
+};
+
+} // namespace ASGenerator
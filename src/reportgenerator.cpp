@@ -27,8 +27,11 @@
 #include <chrono>
 #include <ranges>
 #include <optional>
+#include <atomic>
 
 #include <glib.h>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
 #include <appstream.h>
 #include <appstream-compose.h>
 
@@ -47,13 +50,8 @@ ReportGenerator::ReportGenerator(DataStore *db)
     : m_log(getLogger("report")),
       m_dstore(db),
       m_conf(&Config::get()),
-      m_templateDir(m_conf->templateDir()),
-      m_injaEnv(
-          m_conf->templateDir().empty() ? inja::Environment() : inja::Environment(m_conf->templateDir().string() + "/"))
+      m_templateDir(m_conf->templateDir())
 {
-    // Enable searching for included templates in files if we have a template directory
-    m_injaEnv.set_search_included_templates_in_files(!m_conf->templateDir().empty());
-
     m_htmlExportDir = m_conf->htmlExportDir;
     m_mediaPoolDir = m_dstore->mediaExportPoolDir();
     m_mediaPoolUrl = std::format("{}/pool", m_conf->mediaBaseUrl);
@@ -61,13 +59,44 @@ ReportGenerator::ReportGenerator(DataStore *db)
     m_defaultTemplateDir = Utils::getDataPath("templates/default");
 
     m_versionInfo = std::format("{}, AS: {}", ASGEN_VERSION, as_version_string());
+
+    // pages need to be rendered again whenever a template has changed, so the state of
+    // all template files is part of every page digest
+    std::vector<std::string> templateFiles;
+    for (const auto &dir : {m_templateDir, m_defaultTemplateDir}) {
+        if (dir.empty() || !fs::is_directory(dir))
+            continue;
+        for (const auto &entry : fs::recursive_directory_iterator(dir)) {
+            if (!entry.is_regular_file())
+                continue;
+            templateFiles.push_back(
+                std::format(
+                    "{}:{}:{}",
+                    entry.path().string(),
+                    entry.file_size(),
+                    entry.last_write_time().time_since_epoch().count()));
+        }
+    }
+    std::sort(templateFiles.begin(), templateFiles.end());
+
+    std::string stampData;
+    for (const auto &line : templateFiles) {
+        stampData += line;
+        stampData += '\n';
+    }
+    g_autofree gchar *stamp = g_compute_checksum_for_string(
+        G_CHECKSUM_SHA256,
+        stampData.c_str(),
+        stampData.length());
+    m_templateStamp = stamp;
 }
 
 void ReportGenerator::setupInjaContext(inja::json &context)
 {
     auto now = std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto *tm = std::localtime(&time_t);
+    struct tm tmBuf;
+    auto *tm = localtime_r(&time_t, &tmBuf);
 
     auto timeStr = std::format(
         "{:04d}-{:02d}-{:02d} {:02d}:{:02d} [{}]",
@@ -84,178 +113,327 @@ void ReportGenerator::setupInjaContext(inja::json &context)
     context["root_url"] = m_conf->htmlBaseUrl;
 }
 
-void ReportGenerator::renderPage(const std::string &pageID, const std::string &exportName, const inja::json &context)
+std::string ReportGenerator::renderTemplate(const std::string &pageID, const inja::json &context)
 {
-    inja::json fullContext = context;
-    setupInjaContext(fullContext);
+    auto &renderer = m_renderers.local();
+
+    auto it = renderer.templates.find(pageID);
+    if (it == renderer.templates.end()) {
+        const auto templateName = pageID + ".html";
+        inja::Environment *env;
+
+        if (!fs::exists(m_templateDir / templateName) && fs::exists(m_defaultTemplateDir / templateName)) {
+            if (!renderer.defaultEnv) {
+                renderer.defaultEnv = std::make_unique<inja::Environment>(m_defaultTemplateDir.string() + "/");
+                // Configure the default environment to search for included templates in files
+                renderer.defaultEnv->set_search_included_templates_in_files(true);
+            }
+            env = renderer.defaultEnv.get();
+        } else {
+            if (!renderer.env) {
+                renderer.env = m_templateDir.empty()
+                                   ? std::make_unique<inja::Environment>()
+                                   : std::make_unique<inja::Environment>(m_templateDir.string() + "/");
+                // Enable searching for included templates in files if we have a template directory
+                renderer.env->set_search_included_templates_in_files(!m_templateDir.empty());
+            }
+            env = renderer.env.get();
+        }
 
+        it = renderer.templates.emplace(pageID, CachedTemplate{env, env->parse_template(templateName)}).first;
+    }
+
+    return it->second.env->render(it->second.tmpl, context);
+}
+
+void ReportGenerator::writePage(const std::string &exportName, const std::string &data)
+{
     auto fname = m_htmlExportDir / (exportName + ".html");
     fs::create_directories(fname.parent_path());
 
-    auto templatePath = m_templateDir / (pageID + ".html");
-    auto defaultTemplatePath = m_defaultTemplateDir / (pageID + ".html");
-
-    inja::Environment *activeEnv = &m_injaEnv;
-    std::unique_ptr<inja::Environment> defaultEnv;
+    std::ofstream f(fname);
+    f << data;
+    f.close();
+}
 
-    if (!fs::exists(templatePath) && fs::exists(defaultTemplatePath)) {
-        defaultEnv = std::make_unique<inja::Environment>(m_defaultTemplateDir.string() + "/");
-        // Configure the default environment to search for included templates in files
-        defaultEnv->set_search_included_templates_in_files(true);
-        activeEnv = defaultEnv.get();
-    }
+bool ReportGenerator::renderPage(const std::string &pageID, const std::string &exportName, const inja::json &context)
+{
+    inja::json fullContext = context;
+    setupInjaContext(fullContext);
 
     LOG_DEBUG(m_log, "Rendering HTML page: {}", exportName);
     try {
-        auto data = activeEnv->render_file(pageID + ".html", fullContext);
-
-        std::ofstream f(fname);
-        f << data;
-        f.close();
+        writePage(exportName, renderTemplate(pageID, fullContext));
     } catch (const std::exception &e) {
         LOG_ERROR(m_log, "Failed to render template {}: {}", pageID, e.what());
+        return false;
     }
+
+    return true;
 }
 
-void ReportGenerator::renderPagesFor(const std::string &suiteName, const std::string &section, const DataSummary &dsum)
+std::string ReportGenerator::pageDigest(const std::string &pageID, const inja::json &context) const
 {
-    if (m_templateDir.empty()) {
-        LOG_ERROR(m_log, "Can not render HTML: No page templates found.");
-        return;
-    }
+    // the render time is left out on purpose, it would make every page look changed
+    const auto data = std::format(
+        "{}\n{}\n{}\n{}\n{}\n{}",
+        m_versionInfo,
+        m_templateStamp,
+        m_conf->projectName,
+        m_conf->htmlBaseUrl,
+        pageID,
+        context.dump());
+
+    g_autofree gchar *digest = g_compute_checksum_for_string(G_CHECKSUM_SHA256, data.c_str(), data.length());
+    return digest;
+}
 
-    LOG_INFO(m_log, "Rendering HTML for {}/{}", suiteName, section);
-    std::regex maintRE(R"([àáèéëêòöøîìùñ~/\\(\\" '])");
+std::string ReportGenerator::renderPageIfChanged(
+    const std::string &pageID,
+    const std::string &exportName,
+    const inja::json &context,
+    const nlohmann::json &oldDigests,
+    bool &rendered)
+{
+    rendered = false;
+    auto digest = pageDigest(pageID, context);
 
-    // write issue hint pages
-    for (const auto &[pkgname, pkgHEntries] : dsum.hintEntries) {
-        auto exportName = std::format("{}/{}/issues/{}", suiteName, section, pkgname);
+    auto it = oldDigests.find(exportName);
+    if (it != oldDigests.end() && it->is_string() && it->get_ref<const std::string &>() == digest
+        && fs::exists(m_htmlExportDir / (exportName + ".html")))
+        return digest;
 
-        inja::json context;
-        context["suite"] = suiteName;
-        context["package_name"] = pkgname;
-        context["section"] = section;
+    if (!renderPage(pageID, exportName, context))
+        return {};
 
-        inja::json entries = inja::json::array();
-        for (const auto &[cid, hentry] : pkgHEntries) {
-            inja::json entry;
-            entry["component_id"] = cid;
+    rendered = true;
+    return digest;
+}
 
-            inja::json architectures = inja::json::array();
-            for (const auto &arch : hentry.archs) {
-                architectures.push_back(
+inja::json ReportGenerator::issuesPageContext(
+    const std::string &suiteName,
+    const std::string &section,
+    const std::string &pkgname,
+    const std::unordered_map<std::string, HintEntry> &pkgHEntries)
+{
+    inja::json context;
+    context["suite"] = suiteName;
+    context["package_name"] = pkgname;
+    context["section"] = section;
+
+    inja::json entries = inja::json::array();
+    for (const auto &[cid, hentry] : pkgHEntries) {
+        inja::json entry;
+        entry["component_id"] = cid;
+
+        inja::json architectures = inja::json::array();
+        for (const auto &arch : hentry.archs) {
+            architectures.push_back(
+                inja::json{
+                    {"arch", arch}
+            });
+        }
+        entry["architectures"] = architectures;
+
+        entry["has_errors"] = false;
+        if (!hentry.errors.empty()) {
+            entry["has_errors"] = true;
+            inja::json errors = inja::json::array();
+            for (const auto &error : hentry.errors) {
+                errors.push_back(
                     inja::json{
-                        {"arch", arch}
+                        {"error_tag",         error.tag    },
+                        {"error_description", error.message}
                 });
             }
-            entry["architectures"] = architectures;
-
-            entry["has_errors"] = false;
-            if (!hentry.errors.empty()) {
-                entry["has_errors"] = true;
-                inja::json errors = inja::json::array();
-                for (const auto &error : hentry.errors) {
-                    errors.push_back(
-                        inja::json{
-                            {"error_tag",         error.tag    },
-                            {"error_description", error.message}
-                    });
-                }
-                entry["errors"] = errors;
+            entry["errors"] = errors;
+        }
+
+        entry["has_warnings"] = false;
+        if (!hentry.warnings.empty()) {
+            entry["has_warnings"] = true;
+            inja::json warnings = inja::json::array();
+            for (const auto &warning : hentry.warnings) {
+                warnings.push_back(
+                    inja::json{
+                        {"warning_tag",         warning.tag    },
+                        {"warning_description", warning.message}
+                });
             }
+            entry["warnings"] = warnings;
+        }
 
-            entry["has_warnings"] = false;
-            if (!hentry.warnings.empty()) {
-                entry["has_warnings"] = true;
-                inja::json warnings = inja::json::array();
-                for (const auto &warning : hentry.warnings) {
-                    warnings.push_back(
-                        inja::json{
-                            {"warning_tag",         warning.tag    },
-                            {"warning_description", warning.message}
-                    });
-                }
-                entry["warnings"] = warnings;
+        entry["has_infos"] = false;
+        if (!hentry.infos.empty()) {
+            entry["has_infos"] = true;
+            inja::json infos = inja::json::array();
+            for (const auto &info : hentry.infos) {
+                infos.push_back(
+                    inja::json{
+                        {"info_tag",         info.tag    },
+                        {"info_description", info.message}
+                });
             }
+            entry["infos"] = infos;
+        }
+
+        entries.push_back(entry);
+    }
+    context["entries"] = entries;
 
-            entry["has_infos"] = false;
-            if (!hentry.infos.empty()) {
-                entry["has_infos"] = true;
-                inja::json infos = inja::json::array();
-                for (const auto &info : hentry.infos) {
-                    infos.push_back(
-                        inja::json{
-                            {"info_tag",         info.tag    },
-                            {"info_description", info.message}
-                    });
+    return context;
+}
+
+inja::json ReportGenerator::metainfoPageContext(
+    const std::string &suiteName,
+    const std::string &section,
+    const std::string &pkgname,
+    const std::unordered_map<std::string, std::unordered_map<std::string, MetadataEntry>> &pkgMVerEntries)
+{
+    inja::json context;
+    context["suite"] = suiteName;
+    context["package_name"] = pkgname;
+    context["section"] = section;
+
+    inja::json cpts = inja::json::array();
+    for (const auto &[ver, mEntries] : pkgMVerEntries) {
+        for (const auto &[gcid, mentry] : mEntries) {
+            inja::json cpt;
+            cpt["component_id"] = std::format("{} - {}", mentry.identifier, ver);
+
+            inja::json architectures = inja::json::array();
+            for (const auto &arch : mentry.archs) {
+                architectures.push_back(
+                    inja::json{
+                        {"arch", Utils::escapeXml(arch)}
+                });
+            }
+            cpt["architectures"] = architectures;
+            cpt["metadata"] = Utils::escapeXml(mentry.data);
+
+            auto cptMediaPath = m_mediaPoolDir / gcid;
+            auto cptMediaUrl = std::format("{}/{}", m_mediaPoolUrl, gcid);
+            std::string iconUrl;
+
+            switch (mentry.kind) {
+            case AS_COMPONENT_KIND_UNKNOWN:
+                iconUrl = std::format("{}/{}/{}/{}", m_conf->htmlBaseUrl, "static", "img", "no-image.png");
+                break;
+            case AS_COMPONENT_KIND_DESKTOP_APP:
+            case AS_COMPONENT_KIND_WEB_APP:
+            case AS_COMPONENT_KIND_FONT:
+            case AS_COMPONENT_KIND_OPERATING_SYSTEM: {
+                auto iconPath = cptMediaPath / "icons" / "64x64" / mentry.iconName;
+                if (fs::exists(iconPath)) {
+                    iconUrl = std::format("{}/{}/{}/{}", cptMediaUrl, "icons", "64x64", mentry.iconName);
+                } else {
+                    iconUrl = std::format("{}/{}/{}/{}", m_conf->htmlBaseUrl, "static", "img", "no-image.png");
                 }
-                entry["infos"] = infos;
+                break;
+            }
+            default:
+                iconUrl = std::format("{}/{}/{}/{}", m_conf->htmlBaseUrl, "static", "img", "cpt-nogui.png");
+                break;
             }
 
-            entries.push_back(entry);
+            cpt["icon_url"] = iconUrl;
+            cpts.push_back(cpt);
         }
-        context["entries"] = entries;
+    }
+    context["cpts"] = cpts;
+
+    return context;
+}
 
-        renderPage("issues_page", exportName, context);
+void ReportGenerator::renderPagesFor(const std::string &suiteName, const std::string &section, const DataSummary &dsum)
+{
+    if (m_templateDir.empty()) {
+        LOG_ERROR(m_log, "Can not render HTML: No page templates found.");
+        return;
     }
 
-    // write metadata info pages
-    for (const auto &[pkgname, pkgMVerEntries] : dsum.mdataEntries) {
-        auto exportName = std::format("{}/{}/metainfo/{}", suiteName, section, pkgname);
-
-        inja::json context;
-        context["suite"] = suiteName;
-        context["package_name"] = pkgname;
-        context["section"] = section;
-
-        inja::json cpts = inja::json::array();
-        for (const auto &[ver, mEntries] : pkgMVerEntries) {
-            for (const auto &[gcid, mentry] : mEntries) {
-                inja::json cpt;
-                cpt["component_id"] = std::format("{} - {}", mentry.identifier, ver);
-
-                inja::json architectures = inja::json::array();
-                for (const auto &arch : mentry.archs) {
-                    architectures.push_back(
-                        inja::json{
-                            {"arch", Utils::escapeXml(arch)}
-                    });
-                }
-                cpt["architectures"] = architectures;
-                cpt["metadata"] = Utils::escapeXml(mentry.data);
+    std::regex maintRE(R"([àáèéëêòöøîìùñ~/\\(\\" '])");
 
-                auto cptMediaPath = m_mediaPoolDir / gcid;
-                auto cptMediaUrl = std::format("{}/{}", m_mediaPoolUrl, gcid);
-                std::string iconUrl;
+    // load the digests of the pages we rendered last time, so we only touch the ones that changed
+    const auto digestFname = m_conf->cacheRootDir() / "report" / suiteName / (section + ".json");
+    auto oldDigests = json::object();
+    if (fs::exists(digestFname)) {
+        try {
+            std::ifstream f(digestFname);
+            oldDigests = json::parse(f);
+        } catch (const std::exception &e) {
+            LOG_WARNING(m_log, "Unable to read page digests for {}/{}: {}", suiteName, section, e.what());
+        }
+    }
+    if (!oldDigests.is_object() || oldDigests.empty()) {
+        // we don't know which of the existing pages are stale, so start from scratch
+        oldDigests = json::object();
+        auto suitSecPagesDest = m_htmlExportDir / suiteName / section;
+        if (fs::exists(suitSecPagesDest))
+            fs::remove_all(suitSecPagesDest);
+    }
 
-                switch (mentry.kind) {
-                case AS_COMPONENT_KIND_UNKNOWN:
-                    iconUrl = std::format("{}/{}/{}/{}", m_conf->htmlBaseUrl, "static", "img", "no-image.png");
-                    break;
-                case AS_COMPONENT_KIND_DESKTOP_APP:
-                case AS_COMPONENT_KIND_WEB_APP:
-                case AS_COMPONENT_KIND_FONT:
-                case AS_COMPONENT_KIND_OPERATING_SYSTEM: {
-                    auto iconPath = cptMediaPath / "icons" / "64x64" / mentry.iconName;
-                    if (fs::exists(iconPath)) {
-                        iconUrl = std::format("{}/{}/{}/{}", cptMediaUrl, "icons", "64x64", mentry.iconName);
-                    } else {
-                        iconUrl = std::format("{}/{}/{}/{}", m_conf->htmlBaseUrl, "static", "img", "no-image.png");
-                    }
-                    break;
-                }
-                default:
-                    iconUrl = std::format("{}/{}/{}/{}", m_conf->htmlBaseUrl, "static", "img", "cpt-nogui.png");
-                    break;
+    std::vector<const decltype(dsum.hintEntries)::value_type *> hintPkgs;
+    hintPkgs.reserve(dsum.hintEntries.size());
+    for (const auto &entry : dsum.hintEntries)
+        hintPkgs.push_back(&entry);
+
+    std::vector<const decltype(dsum.mdataEntries)::value_type *> mdataPkgs;
+    mdataPkgs.reserve(dsum.mdataEntries.size());
+    for (const auto &entry : dsum.mdataEntries)
+        mdataPkgs.push_back(&entry);
+
+    // write issue hint pages and metadata info pages
+    const auto pageCount = hintPkgs.size() + mdataPkgs.size();
+    std::vector<std::pair<std::string, std::string>> pageDigests(pageCount);
+    std::atomic_size_t renderedCount = 0;
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, pageCount), [&](const tbb::blocked_range<std::size_t> &range) {
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                std::string pageID;
+                std::string exportName;
+                inja::json context;
+
+                if (i < hintPkgs.size()) {
+                    const auto &[pkgname, pkgHEntries] = *hintPkgs[i];
+                    pageID = "issues_page";
+                    exportName = std::format("{}/{}/issues/{}", suiteName, section, pkgname);
+                    context = issuesPageContext(suiteName, section, pkgname, pkgHEntries);
+                } else {
+                    const auto &[pkgname, pkgMVerEntries] = *mdataPkgs[i - hintPkgs.size()];
+                    pageID = "metainfo_page";
+                    exportName = std::format("{}/{}/metainfo/{}", suiteName, section, pkgname);
+                    context = metainfoPageContext(suiteName, section, pkgname, pkgMVerEntries);
                 }
 
-                cpt["icon_url"] = iconUrl;
-                cpts.push_back(cpt);
+                bool rendered;
+                auto digest = renderPageIfChanged(pageID, exportName, context, oldDigests, rendered);
+                if (rendered)
+                    renderedCount++;
+                pageDigests[i] = {std::move(exportName), std::move(digest)};
             }
-        }
-        context["cpts"] = cpts;
+        });
+    LOG_INFO(m_log, "Rendered {} of {} HTML package pages for {}/{}", renderedCount.load(), pageCount, suiteName, section);
 
-        renderPage("metainfo_page", exportName, context);
+    // drop pages of packages that are gone and save the new digests
+    auto newDigests = json::object();
+    for (auto &[exportName, digest] : pageDigests) {
+        if (!digest.empty())
+            newDigests[exportName] = std::move(digest);
+    }
+    for (const auto &[exportName, digest] : oldDigests.items()) {
+        if (newDigests.contains(exportName))
+            continue;
+        std::error_code ec;
+        fs::remove(m_htmlExportDir / (exportName + ".html"), ec);
+    }
+
+    try {
+        fs::create_directories(digestFname.parent_path());
+        std::ofstream f(digestFname);
+        f << newDigests.dump();
+    } catch (const std::exception &e) {
+        LOG_WARNING(m_log, "Unable to save page digests for {}/{}: {}", suiteName, section, e.what());
     }
 
     // write hint overview page
@@ -362,6 +540,125 @@ void ReportGenerator::renderPagesFor(const std::string &suiteName, const std::st
     renderPage("section_page", secIndexExportName, secIndexCtx);
 }
 
+/**
+ * Everything we need to know about one package to add it to a data summary, loaded ahead
+ * of time so that the expensive parts can be done for all packages in parallel.
+ */
+struct ReportPackageData {
+    bool empty = true;
+    // gcid -> metadata entry (without architectures), unset if the component ID could not be determined
+    std::vector<std::pair<std::string, std::optional<ReportGenerator::MetadataEntry>>> mdata;
+    std::vector<ReportGenerator::HintEntry> hints;
+    bool hintsValid = true;
+};
+
+std::optional<ReportGenerator::MetadataEntry> ReportGenerator::loadMetadataEntry(
+    const DataSnapshot &snapshot,
+    const std::string &gcid,
+    AsMetadata *mdata)
+{
+    const auto dtype = m_conf->metadataType;
+
+    MetadataEntry me;
+    me.data = snapshot.metadata(dtype, gcid);
+
+    // everything besides the metadata text itself we take from the summary record
+    // written alongside it, only data of older generator versions needs to be parsed
+    const auto summary = snapshot.componentSummary(gcid);
+    if (summary.has_value()) {
+        me.kind = summary->kind;
+        me.iconName = summary->iconName;
+        return me;
+    }
+
+    as_metadata_clear_components(mdata);
+    g_autoptr(GError) error = nullptr;
+    if (dtype == DataType::YAML)
+        as_metadata_parse_data(mdata, me.data.c_str(), -1, AS_FORMAT_KIND_YAML, &error);
+    else
+        as_metadata_parse_data(mdata, me.data.c_str(), -1, AS_FORMAT_KIND_XML, &error);
+
+    if (error != nullptr) {
+        LOG_WARNING(m_log, "Failed to parse metadata for {}: {}", gcid, error->message);
+        return std::nullopt;
+    }
+
+    auto cpt = as_metadata_get_component(mdata);
+    if (cpt != nullptr) {
+        const auto cptSummary = ComponentSummary::fromComponent(cpt);
+        me.kind = cptSummary.kind;
+        me.iconName = cptSummary.iconName;
+    } else {
+        me.kind = AS_COMPONENT_KIND_UNKNOWN;
+    }
+
+    return me;
+}
+
+std::vector<ReportGenerator::HintEntry> ReportGenerator::loadHintEntries(
+    const std::string &pkid,
+    std::string_view hintsData,
+    bool &valid)
+{
+    std::vector<HintEntry> entries;
+    valid = true;
+
+    PackageHints hints;
+    try {
+        hints = PackageHints::decode(hintsData);
+    } catch (const std::exception &e) {
+        LOG_ERROR(m_log, "Failed to read hints of package {}: {}", pkid, e.what());
+        valid = false;
+        return entries;
+    }
+
+    for (const auto &cptHints : hints.components) {
+        auto &he = entries.emplace_back();
+        he.identifier = cptHints.cid;
+
+        for (const auto &issue : cptHints.hints) {
+            std::string tag = issue.tag;
+
+            g_autoptr(AscHint) hint = nullptr;
+            g_autoptr(GError) error = nullptr;
+            hint = asc_hint_new_for_tag(tag.c_str(), &error);
+            if (hint == nullptr) {
+                LOG_ERROR(
+                    m_log,
+                    "Encountered invalid tag '{}' in component '{}' of package '{}': {}",
+                    tag,
+                    cptHints.cid,
+                    pkid,
+                    error ? error->message : "Unknown error");
+
+                // emit an internal error, invalid tags shouldn't happen
+                tag = "internal-unknown-tag";
+                hint = asc_hint_new_for_tag(tag.c_str(), nullptr);
+            }
+
+            // render the full message using the static template and data from the hint
+            for (const auto &[varKey, varValue] : issue.vars)
+                asc_hint_add_explanation_var(hint, varKey.c_str(), varValue.c_str());
+
+            g_autofree gchar *msg = asc_hint_format_explanation(hint);
+            const auto severity = asc_hint_get_severity(hint);
+
+            // add the new hint to the right category
+            if (severity == AS_ISSUE_SEVERITY_INFO) {
+                he.infos.emplace_back(tag, msg);
+            } else if (severity == AS_ISSUE_SEVERITY_WARNING) {
+                he.warnings.emplace_back(tag, msg);
+            } else if (severity == AS_ISSUE_SEVERITY_PEDANTIC) {
+                // We ignore pedantic issues completely for now
+            } else {
+                he.errors.emplace_back(tag, msg);
+            }
+        }
+    }
+
+    return entries;
+}
+
 ReportGenerator::DataSummary ReportGenerator::preprocessInformation(
     const std::string &suiteName,
     const std::string &section,
@@ -371,17 +668,50 @@ ReportGenerator::DataSummary ReportGenerator::preprocessInformation(
 
     LOG_INFO(m_log, "Collecting data about hints and available metainfo for {}/{}", suiteName, section);
 
-    auto dtype = m_conf->metadataType;
-    g_autoptr(AsMetadata) mdata = as_metadata_new();
-    as_metadata_set_format_style(mdata, AS_FORMAT_STYLE_CATALOG);
-    as_metadata_set_format_version(mdata, m_conf->formatVersion);
+    // Loading the data of a package is what takes time, so we do that for all packages in parallel.
+    // Which package a component or hint is attributed to depends on the order in which packages are
+    // visited though, so the (cheap) merge into the summary happens in order afterwards.
+    std::vector<ReportPackageData> pkgsData(pkgs.size());
+    tbb::enumerable_thread_specific<std::unique_ptr<AsMetadata, decltype(&g_object_unref)>> threadMdata([this]() {
+        auto mdata = as_metadata_new();
+        as_metadata_set_format_style(mdata, AS_FORMAT_STYLE_CATALOG);
+        as_metadata_set_format_version(mdata, m_conf->formatVersion);
+        return std::unique_ptr<AsMetadata, decltype(&g_object_unref)>(mdata, &g_object_unref);
+    });
+
+    tbb::parallel_for(
+        tbb::blocked_range<std::size_t>(0, pkgs.size()), [&](const tbb::blocked_range<std::size_t> &range) {
+            auto mdata = threadMdata.local().get();
+
+            // all data of these packages is read from one snapshot, and only copied where we keep it
+            const auto snapshot = m_dstore->readSnapshot();
+            for (auto i = range.begin(); i != range.end(); ++i) {
+                const auto &pkid = pkgs[i]->id();
+                auto &pdata = pkgsData[i];
+
+                const auto gcids = snapshot.gcidsForPackage(pkid);
+                const auto hintsData = snapshot.hints(pkid);
+                if (gcids.empty() && hintsData.empty())
+                    continue;
+                pdata.empty = false;
+
+                for (const auto &gcidView : gcids) {
+                    std::string gcid(gcidView);
+                    if (!Utils::getCidFromGlobalID(gcid).has_value())
+                        continue;
+                    auto me = loadMetadataEntry(snapshot, gcid, mdata);
+                    pdata.mdata.emplace_back(std::move(gcid), std::move(me));
+                }
 
-    for (const auto &pkg : pkgs) {
-        const auto &pkid = pkg->id();
+                if (!hintsData.empty())
+                    pdata.hints = loadHintEntries(pkid, hintsData, pdata.hintsValid);
+            }
+        });
 
-        auto gcids = m_dstore->getGCIDsForPackage(pkid);
-        auto hintsData = m_dstore->getHints(pkid);
-        if (gcids.empty() && hintsData.empty())
+    for (std::size_t i = 0; i < pkgs.size(); ++i) {
+        const auto &pkg = pkgs[i];
+        auto &pdata = pkgsData[i];
+        if (pdata.empty)
             continue;
 
         PkgSummary pkgsummary;
@@ -400,176 +730,63 @@ ReportGenerator::DataSummary ReportGenerator::preprocessInformation(
         }
 
         // process component metadata for this package if there are any
-        if (!gcids.empty()) {
-            for (const auto &gcid : gcids) {
-                auto cidOpt = Utils::getCidFromGlobalID(gcid);
-                if (!cidOpt.has_value())
-                    continue;
-
-                auto cid = cidOpt.value();
-
-                // don't add the same entry multiple times for multiple versions
-                auto pkgIt = dsum.mdataEntries.find(pkg->name());
-                if (pkgIt != dsum.mdataEntries.end()) {
-                    auto verIt = pkgIt->second.find(pkg->ver());
-                    if (verIt != pkgIt->second.end()) {
-                        auto meIt = verIt->second.find(gcid);
-                        if (meIt == verIt->second.end()) {
-                            // this component is new
-                            dsum.totalMetadata += 1;
-                            newInfo = true;
-                        } else {
-                            // we already have a component with this gcid
-                            auto &archs = meIt->second.archs;
-                            if (std::find(archs.begin(), archs.end(), pkg->arch()) == archs.end()) {
-                                archs.push_back(pkg->arch());
-                            }
-                            continue;
+        for (auto &[gcid, meOpt] : pdata.mdata) {
+            // don't add the same entry multiple times for multiple versions
+            auto pkgIt = dsum.mdataEntries.find(pkg->name());
+            if (pkgIt != dsum.mdataEntries.end()) {
+                auto verIt = pkgIt->second.find(pkg->ver());
+                if (verIt != pkgIt->second.end()) {
+                    auto meIt = verIt->second.find(gcid);
+                    if (meIt == verIt->second.end()) {
+                        // this component is new
+                        dsum.totalMetadata += 1;
+                        newInfo = true;
+                    } else {
+                        // we already have a component with this gcid
+                        auto &archs = meIt->second.archs;
+                        if (std::find(archs.begin(), archs.end(), pkg->arch()) == archs.end()) {
+                            archs.push_back(pkg->arch());
                         }
+                        continue;
                     }
-                } else {
-                    // we will add a new component
-                    dsum.totalMetadata += 1;
-                }
-
-                MetadataEntry me;
-                me.identifier = cid;
-                me.data = m_dstore->getMetadata(dtype, gcid);
-
-                as_metadata_clear_components(mdata);
-                g_autoptr(GError) error = nullptr;
-                if (dtype == DataType::YAML)
-                    as_metadata_parse_data(mdata, me.data.c_str(), -1, AS_FORMAT_KIND_YAML, &error);
-                else
-                    as_metadata_parse_data(mdata, me.data.c_str(), -1, AS_FORMAT_KIND_XML, &error);
-
-                if (error != nullptr) {
-                    LOG_WARNING(m_log, "Failed to parse metadata for {}: {}", gcid, error->message);
-                    continue;
                 }
+            } else {
+                // we will add a new component
+                dsum.totalMetadata += 1;
+            }
 
-                auto cpt = as_metadata_get_component(mdata);
-                if (cpt != nullptr) {
-                    const auto iconsArr = as_component_get_icons(cpt);
-                    assert(iconsArr != nullptr);
-                    for (guint i = 0; i < iconsArr->len; i++) {
-                        AsIcon *icon = AS_ICON(g_ptr_array_index(iconsArr, i));
-                        if (as_icon_get_kind(icon) == AS_ICON_KIND_CACHED) {
-                            me.iconName = as_icon_get_name(icon);
-                            break;
-                        }
-                    }
-
-                    me.kind = as_component_get_kind(cpt);
-                } else {
-                    me.kind = AS_COMPONENT_KIND_UNKNOWN;
-                }
+            if (!meOpt.has_value())
+                continue;
 
-                me.archs.push_back(pkg->arch());
-                dsum.mdataEntries[pkg->name()][pkg->ver()][gcid] = std::move(me);
-                pkgsummary.cpts.emplace_back(std::format("{} - {}", cid, pkg->ver()));
-            }
+            auto me = std::move(meOpt.value());
+            me.identifier = Utils::getCidFromGlobalID(gcid).value();
+            me.archs.push_back(pkg->arch());
+            pkgsummary.cpts.emplace_back(std::format("{} - {}", me.identifier, pkg->ver()));
+            dsum.mdataEntries[pkg->name()][pkg->ver()][gcid] = std::move(me);
         }
 
         // process hints for this package, if there are any
-        if (!hintsData.empty()) {
-            try {
-                auto hintsJson = json::parse(hintsData);
-
-                if (!hintsJson.contains("hints") || !hintsJson["hints"].is_object())
+        if (!pdata.hintsValid)
+            continue;
+        for (auto &he : pdata.hints) {
+            // don't add the same hints multiple times for multiple versions and architectures
+            auto pkgIt = dsum.hintEntries.find(pkg->name());
+            if (pkgIt != dsum.hintEntries.end()) {
+                auto heIt = pkgIt->second.find(he.identifier);
+                if (heIt != pkgIt->second.end()) {
+                    // we already have hints for this component ID
+                    // TODO: check if we have the same hints - if not, create a new entry.
                     continue;
-
-                auto hintsNode = hintsJson["hints"];
-
-                // Iterate through component IDs in hints
-                for (const auto &[cid, jhintsNode] : hintsNode.items()) {
-                    HintEntry he;
-
-                    // don't add the same hints multiple times for multiple versions and architectures
-                    auto pkgIt = dsum.hintEntries.find(pkg->name());
-                    if (pkgIt != dsum.hintEntries.end()) {
-                        auto heIt = pkgIt->second.find(cid);
-                        if (heIt != pkgIt->second.end()) {
-                            he = heIt->second;
-                            // we already have hints for this component ID
-                            he.archs.push_back(pkg->arch());
-
-                            // TODO: check if we have the same hints - if not, create a new entry.
-                            continue;
-                        }
-                        newInfo = true;
-                    } else {
-                        newInfo = true;
-                    }
-
-                    he.identifier = cid;
-
-                    if (jhintsNode.is_array()) {
-                        // Iterate through hints array
-                        for (const auto &jhintNode : jhintsNode) {
-                            if (!jhintNode.is_object())
-                                continue;
-
-                            // Get tag
-                            if (!jhintNode.contains("tag") || !jhintNode["tag"].is_string())
-                                continue;
-
-                            std::string tag = jhintNode["tag"];
-
-                            g_autoptr(AscHint) hint = nullptr;
-                            g_autoptr(GError) error = nullptr;
-                            hint = asc_hint_new_for_tag(tag.c_str(), &error);
-                            if (hint == nullptr) {
-                                LOG_ERROR(
-                                    m_log,
-                                    "Encountered invalid tag '{}' in component '{}' of package '{}': {}",
-                                    tag,
-                                    cid,
-                                    pkid,
-                                    error ? error->message : "Unknown error");
-
-                                // emit an internal error, invalid tags shouldn't happen
-                                tag = "internal-unknown-tag";
-                                hint = asc_hint_new_for_tag(tag.c_str(), nullptr);
-                            }
-
-                            // render the full message using the static template and data from the hint
-                            if (jhintNode.contains("vars") && jhintNode["vars"].is_object()) {
-                                for (const auto &[varKey, varValue] : jhintNode["vars"].items()) {
-                                    if (varValue.is_string()) {
-                                        std::string varValueStr = varValue;
-                                        asc_hint_add_explanation_var(hint, varKey.c_str(), varValueStr.c_str());
-                                    }
-                                }
-                            }
-
-                            g_autofree gchar *msg = asc_hint_format_explanation(hint);
-                            const auto severity = asc_hint_get_severity(hint);
-
-                            // add the new hint to the right category
-                            if (severity == AS_ISSUE_SEVERITY_INFO) {
-                                he.infos.emplace_back(tag, msg);
-                                pkgsummary.infoCount++;
-                            } else if (severity == AS_ISSUE_SEVERITY_WARNING) {
-                                he.warnings.emplace_back(tag, msg);
-                                pkgsummary.warningCount++;
-                            } else if (severity == AS_ISSUE_SEVERITY_PEDANTIC) {
-                                // We ignore pedantic issues completely for now
-                            } else {
-                                he.errors.emplace_back(tag, msg);
-                                pkgsummary.errorCount++;
-                            }
-                        }
-                    }
-
-                    if (newInfo)
-                        he.archs.push_back(pkg->arch());
-
-                    dsum.hintEntries[pkg->name()][he.identifier] = he;
                 }
-            } catch (const std::exception &e) {
-                LOG_ERROR(m_log, "Failed to parse hints JSON for package {}: {}", pkid, e.what());
             }
+            newInfo = true;
+
+            pkgsummary.infoCount += static_cast<int>(he.infos.size());
+            pkgsummary.warningCount += static_cast<int>(he.warnings.size());
+            pkgsummary.errorCount += static_cast<int>(he.errors.size());
+
+            he.archs.push_back(pkg->arch());
+            dsum.hintEntries[pkg->name()][he.identifier] = std::move(he);
         }
 
         dsum.pkgSummaries[pkg->maintainer()][pkg->name()] = pkgsummary;
@@ -583,9 +800,13 @@ ReportGenerator::DataSummary ReportGenerator::preprocessInformation(
     return dsum;
 }
 
-void ReportGenerator::saveStatistics(const std::string &suiteName, const std::string &section, const DataSummary &dsum)
+void ReportGenerator::saveStatistics(
+    const std::string &suiteName,
+    const std::string &section,
+    const DataSummary &dsum,
+    const std::unordered_map<std::string, MetaValue> &runStats)
 {
-    std::unordered_map<std::string, std::variant<std::int64_t, std::string, double>> statsData = {
+    std::unordered_map<std::string, MetaValue> statsData = {
         {"suite",         suiteName         },
         {"section",       section           },
         {"totalInfos",    dsum.totalInfos   },
@@ -593,6 +814,8 @@ void ReportGenerator::saveStatistics(const std::string &suiteName, const std::st
         {"totalErrors",   dsum.totalErrors  },
         {"totalMetadata", dsum.totalMetadata}
     };
+    // the collected values always take precedence over extra run statistics
+    statsData.insert(runStats.begin(), runStats.end());
 
     m_dstore->addStatistics(statsData);
 }
@@ -601,92 +824,51 @@ void ReportGenerator::exportStatistics()
 {
     LOG_INFO(m_log, "Exporting statistical data.");
 
-    // return all statistics we have from the database
-    auto statsCollection = m_dstore->getStatistics();
-
-    // Sort statsCollection by timestamp in ascending order
-    std::sort(statsCollection.begin(), statsCollection.end(), [](const auto &a, const auto &b) -> bool {
-        return a.time < b.time;
-    });
-
-    std::unordered_map<std::string, std::unordered_map<std::string, std::vector<std::array<int64_t, 2>>>> suiteData;
-
-    // Group data by suite and section
-    for (const auto &entry : statsCollection) {
-        const auto &js = entry.data;
-        const auto timestamp = static_cast<int64_t>(entry.time);
-
-        // Extract suite and section from the data
-        std::string suite, section;
-        int64_t totalErrors = 0, totalWarnings = 0, totalInfos = 0, totalMetadata = 0;
-
-        auto suiteIt = js.find("suite");
-        if (suiteIt != js.end() && std::holds_alternative<std::string>(suiteIt->second))
-            suite = std::get<std::string>(suiteIt->second);
-
-        auto sectionIt = js.find("section");
-        if (sectionIt != js.end() && std::holds_alternative<std::string>(sectionIt->second))
-            section = std::get<std::string>(sectionIt->second);
-
-        auto errorsIt = js.find("totalErrors");
-        if (errorsIt != js.end() && std::holds_alternative<std::int64_t>(errorsIt->second))
-            totalErrors = std::get<std::int64_t>(errorsIt->second);
-
-        auto warningsIt = js.find("totalWarnings");
-        if (warningsIt != js.end() && std::holds_alternative<std::int64_t>(warningsIt->second))
-            totalWarnings = std::get<std::int64_t>(warningsIt->second);
-
-        auto infosIt = js.find("totalInfos");
-        if (infosIt != js.end() && std::holds_alternative<std::int64_t>(infosIt->second))
-            totalInfos = std::get<std::int64_t>(infosIt->second);
-
-        auto metadataIt = js.find("totalMetadata");
-        if (metadataIt != js.end() && std::holds_alternative<std::int64_t>(metadataIt->second))
-            totalMetadata = std::get<std::int64_t>(metadataIt->second);
+    // We keep the data we exported last time along with the position in the statistics series
+    // it was read up to, so only points that were added since then need to be read.
+    const auto stateFname = m_conf->cacheRootDir() / "report" / "statistics.json";
+    auto jsonGzFname = fs::path(m_htmlExportDir) / "statistics.json.gz";
+    auto jsonFname = fs::path(m_htmlExportDir) / "statistics.json";
 
-        if (suite.empty() || section.empty())
-            continue;
+    StatisticsCursor cursor;
+    auto jsonOutput = json::object();
+    if (fs::exists(stateFname)) {
+        try {
+            std::ifstream f(stateFname);
+            const auto state = json::parse(f);
+            cursor.generation = state.at("generation").get<std::uint64_t>();
+            cursor.row = state.at("row").get<std::uint64_t>();
+            jsonOutput = state.at("data");
+        } catch (const std::exception &e) {
+            LOG_WARNING(m_log, "Unable to read previously exported statistics, exporting all data: {}", e.what());
+            cursor = StatisticsCursor();
+            jsonOutput = json::object();
+        }
+    }
 
-        // Store data points
-        suiteData[suite][section + "_errors"].push_back({timestamp, totalErrors});
-        suiteData[suite][section + "_warnings"].push_back({timestamp, totalWarnings});
-        suiteData[suite][section + "_infos"].push_back({timestamp, totalInfos});
-        suiteData[suite][section + "_metadata"].push_back({timestamp, totalMetadata});
+    const auto lastCursor = cursor;
+    const auto points = m_dstore->readStatistics(cursor);
+    if (cursor.generation != lastCursor.generation || cursor.row != lastCursor.row + points.size()) {
+        // the series was rewritten, so we got all of it and start over
+        jsonOutput = json::object();
+    } else if (points.empty() && fs::exists(jsonGzFname)) {
+        LOG_DEBUG(m_log, "No new statistics to export.");
+        return;
     }
 
-    auto jsonOutput = json::object();
-    for (const auto &[suiteName, sections] : suiteData) {
-        // Group by section
-        std::unordered_map<std::string, std::unordered_map<std::string, std::vector<std::array<int64_t, 2>>>>
-            sectionGroups;
-        for (const auto &[key, data] : sections) {
-            auto underscorePos = key.rfind('_');
-            if (underscorePos != std::string::npos) {
-                std::string sectionName = key.substr(0, underscorePos);
-                std::string dataType = key.substr(underscorePos + 1);
-                sectionGroups[sectionName][dataType] = data;
-            }
-        }
+    for (const auto &point : points) {
+        if (point.suite.empty() || point.section.empty())
+            continue;
 
-        auto suiteJson = json::object();
-        for (const auto &[sectionName, dataTypes] : sectionGroups) {
-            auto sectionJson = json::object();
-            for (const auto &[dataType, dataPoints] : dataTypes) {
-                auto dataArray = json::array();
-                for (const auto &point : dataPoints) {
-                    dataArray.push_back(json::array({point[0], point[1]}));
-                }
-                sectionJson[dataType] = dataArray;
-            }
-            suiteJson[sectionName] = sectionJson;
-        }
-        jsonOutput[suiteName] = suiteJson;
+        const auto timestamp = static_cast<std::int64_t>(point.time);
+        auto &sectionJson = jsonOutput[point.suite][point.section];
+        sectionJson["errors"].push_back(json::array({timestamp, point.value("totalErrors")}));
+        sectionJson["warnings"].push_back(json::array({timestamp, point.value("totalWarnings")}));
+        sectionJson["infos"].push_back(json::array({timestamp, point.value("totalInfos")}));
+        sectionJson["metadata"].push_back(json::array({timestamp, point.value("totalMetadata")}));
     }
 
-    auto jsonFname = fs::path(m_htmlExportDir) / "statistics.json";
-    auto jsonGzFname = fs::path(m_htmlExportDir) / "statistics.json.gz";
     fs::create_directories(jsonGzFname.parent_path());
-
     const auto jsonData = jsonOutput.dump();
 
     try {
@@ -698,24 +880,34 @@ void ReportGenerator::exportStatistics()
             fs::remove(jsonFname);
     } catch (const std::exception &e) {
         LOG_WARNING(m_log, "Failed to write gzip-compressed statistics data: {}", e.what());
+        return;
+    }
+
+    try {
+        const json state{
+            {"generation", cursor.generation},
+            {"row",        cursor.row       },
+            {"data",       jsonOutput       }
+        };
+        fs::create_directories(stateFname.parent_path());
+        std::ofstream f(stateFname);
+        f << state.dump();
+    } catch (const std::exception &e) {
+        LOG_WARNING(m_log, "Unable to save exported statistics state: {}", e.what());
     }
 }
 
 void ReportGenerator::processFor(
     const std::string &suiteName,
     const std::string &section,
-    const std::vector<std::shared_ptr<Package>> &pkgs)
+    const std::vector<std::shared_ptr<Package>> &pkgs,
+    const std::unordered_map<std::string, MetaValue> &runStats)
 {
     // collect all needed information and save statistics
     auto dsum = preprocessInformation(suiteName, section, pkgs);
-    saveStatistics(suiteName, section, dsum);
-
-    // drop old pages
-    auto suitSecPagesDest = fs::path(m_htmlExportDir) / suiteName / section;
-    if (fs::exists(suitSecPagesDest))
-        fs::remove_all(suitSecPagesDest);
+    saveStatistics(suiteName, section, dsum, runStats);
 
-    // render fresh info pages
+    // render info pages, only pages that have changed are written again
     renderPagesFor(suiteName, section, dsum);
 }
 
@@ -24,9 +24,12 @@
 #include <unordered_map>
 #include <memory>
 #include <cstdint>
+#include <optional>
+#include <string_view>
 
 #include <appstream.h>
 #include <inja/inja.hpp>
+#include <tbb/enumerable_thread_specific.h>
 
 #include "config.h"
 #include "datastore.h"
@@ -41,10 +44,16 @@ public:
     explicit ReportGenerator(DataStore *db);
     ~ReportGenerator() = default;
 
+    /**
+     * Collect information and statistics for a suite section and render its HTML pages.
+     * @runStats may contain additional statistics of the current run to store alongside
+     * the collected data.
+     */
     void processFor(
         const std::string &suiteName,
         const std::string &section,
-        const std::vector<std::shared_ptr<Package>> &pkgs);
+        const std::vector<std::shared_ptr<Package>> &pkgs,
+        const std::unordered_map<std::string, MetaValue> &runStats = {});
     void updateIndexPages();
     void exportStatistics();
 
@@ -99,15 +108,34 @@ public:
 
     // Public methods for testing access
     void setupInjaContext(inja::json &context);
-    void renderPage(const std::string &pageID, const std::string &exportName, const inja::json &context);
+    bool renderPage(const std::string &pageID, const std::string &exportName, const inja::json &context);
     void renderPagesFor(const std::string &suiteName, const std::string &section, const DataSummary &dsum);
     DataSummary preprocessInformation(
         const std::string &suiteName,
         const std::string &section,
         const std::vector<std::shared_ptr<Package>> &pkgs);
-    void saveStatistics(const std::string &suiteName, const std::string &section, const DataSummary &dsum);
+    void saveStatistics(
+        const std::string &suiteName,
+        const std::string &section,
+        const DataSummary &dsum,
+        const std::unordered_map<std::string, MetaValue> &runStats = {});
 
 private:
+    struct CachedTemplate {
+        inja::Environment *env;
+        inja::Template tmpl;
+    };
+
+    /**
+     * Template environments of one worker thread. inja environments are not thread-safe,
+     * so every thread parses the templates it needs once and reuses them for all its pages.
+     */
+    struct PageRenderer {
+        std::unique_ptr<inja::Environment> env;
+        std::unique_ptr<inja::Environment> defaultEnv;
+        std::unordered_map<std::string, CachedTemplate> templates;
+    };
+
     quill::Logger *m_log;
     DataStore *m_dstore;
     Config *m_conf;
@@ -120,8 +148,36 @@ private:
     std::string m_mediaPoolUrl;
 
     std::string m_versionInfo;
-
-    inja::Environment m_injaEnv;
+    std::string m_templateStamp;
+
+    tbb::enumerable_thread_specific<PageRenderer> m_renderers;
+
+    std::string renderTemplate(const std::string &pageID, const inja::json &context);
+    void writePage(const std::string &exportName, const std::string &data);
+    std::string pageDigest(const std::string &pageID, const inja::json &context) const;
+    std::string renderPageIfChanged(
+        const std::string &pageID,
+        const std::string &exportName,
+        const inja::json &context,
+        const nlohmann::json &oldDigests,
+        bool &rendered);
+
+    std::optional<MetadataEntry> loadMetadataEntry(
+        const DataSnapshot &snapshot,
+        const std::string &gcid,
+        AsMetadata *mdata);
+    std::vector<HintEntry> loadHintEntries(const std::string &pkid, std::string_view hintsData, bool &valid);
+
+    inja::json issuesPageContext(
+        const std::string &suiteName,
+        const std::string &section,
+        const std::string &pkgname,
+        const std::unordered_map<std::string, HintEntry> &pkgHEntries);
+    inja::json metainfoPageContext(
+        const std::string &suiteName,
+        const std::string &section,
+        const std::string &pkgname,
+        const std::unordered_map<std::string, std::unordered_map<std::string, MetadataEntry>> &pkgMVerEntries);
 };
 
 } // namespace ASGenerator
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resourcegovernor.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace ASGenerator
+{
+
+// Assumed size of packages whose index does not tell us how large they are
+static constexpr std::uint64_t DefaultPackageSize = 32 * 1024 * 1024;
+// Memory needed for working on any package, e.g. for decoding images or fonts
+static constexpr std::uint64_t BaseScanMemory = 16 * 1024 * 1024;
+static constexpr std::uint64_t BaseProcessMemory = 64 * 1024 * 1024;
+
+// Number of reservations the current thread holds, so nested reservations never wait on ourselves
+static thread_local std::size_t t_heldReservations = 0;
+
+ResourceGovernor::Reservation::Reservation(ResourceGovernor *governor, Resources resources)
+    : m_governor(governor),
+      m_resources(resources)
+{
+}
+
+ResourceGovernor::Reservation::~Reservation()
+{
+    release();
+}
+
+ResourceGovernor::Reservation::Reservation(Reservation &&other) noexcept
+    : m_governor(std::exchange(other.m_governor, nullptr)),
+      m_resources(other.m_resources)
+{
+}
+
+ResourceGovernor::Reservation &ResourceGovernor::Reservation::operator=(Reservation &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_governor = std::exchange(other.m_governor, nullptr);
+        m_resources = other.m_resources;
+    }
+
+    return *this;
+}
+
+void ResourceGovernor::Reservation::release()
+{
+    if (m_governor == nullptr)
+        return;
+
+    m_governor->returnResources(m_resources);
+    m_governor = nullptr;
+    t_heldReservations--;
+}
+
+ResourceGovernor::ResourceGovernor(std::uint64_t memoryLimit, std::uint64_t diskLimit)
+{
+    m_limits.memory = memoryLimit;
+    m_limits.disk = diskLimit;
+}
+
+ResourceGovernor::Resources ResourceGovernor::scanEstimate(const Package &pkg) const
+{
+    const auto fileSize = pkg.fileSize() > 0 ? pkg.fileSize() : DefaultPackageSize;
+
+    // the package may be downloaded, and its payload tarball is extracted for some packages
+    Resources resources;
+    resources.memory = BaseScanMemory;
+    resources.disk = fileSize * 2;
+    return resources;
+}
+
+ResourceGovernor::Resources ResourceGovernor::processEstimate(const Package &pkg) const
+{
+    const auto fileSize = pkg.fileSize() > 0 ? pkg.fileSize() : DefaultPackageSize;
+    const auto installedSize = pkg.installedSize() > 0 ? pkg.installedSize() : fileSize * 3;
+
+    // Besides the package and its payload tarball, the payload itself may be extracted
+    // for reading many files from it. Files are read into memory one batch at a time.
+    Resources resources;
+    resources.memory = BaseProcessMemory + fileSize;
+    resources.disk = fileSize * 2 + installedSize;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_diskHistory.find(pkg.name());
+    if (it != m_diskHistory.end())
+        resources.disk = std::max(resources.disk, it->second);
+
+    return resources;
+}
+
+bool ResourceGovernor::withinLimits(const Resources &resources) const
+{
+    return (m_limits.memory == 0 || resources.memory <= m_limits.memory)
+           && (m_limits.disk == 0 || resources.disk <= m_limits.disk);
+}
+
+bool ResourceGovernor::canAdmit(const Resources &resources, bool isOldestWaiter) const
+{
+    Resources total = m_stats.reserved;
+    if (total.memory == 0 && total.disk == 0 && (isOldestWaiter || m_waiting.empty()))
+        return true;
+
+    total.memory += resources.memory;
+    total.disk += resources.disk;
+    if (!isOldestWaiter && !m_waiting.empty()) {
+        // leave room for the reservation that waits longest, so it is not starved by smaller ones
+        total.memory += m_waiting.front().memory;
+        total.disk += m_waiting.front().disk;
+    }
+
+    return withinLimits(total);
+}
+
+ResourceGovernor::Reservation ResourceGovernor::reserve(Resources resources)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // a thread holding resources already would wait for itself
+    if (t_heldReservations == 0 && !canAdmit(resources, false)) {
+        const auto waitStart = std::chrono::steady_clock::now();
+        const auto waitPos = m_waiting.insert(m_waiting.end(), resources);
+        m_available.wait(lock, [&]() {
+            return canAdmit(resources, waitPos == m_waiting.begin());
+        });
+        m_waiting.erase(waitPos);
+
+        m_stats.waits++;
+        m_stats.waitTime += std::chrono::steady_clock::now() - waitStart;
+
+        // the next waiter might fit now as well
+        m_available.notify_all();
+    }
+
+    m_stats.reserved.memory += resources.memory;
+    m_stats.reserved.disk += resources.disk;
+    m_stats.peak.memory = std::max(m_stats.peak.memory, m_stats.reserved.memory);
+    m_stats.peak.disk = std::max(m_stats.peak.disk, m_stats.reserved.disk);
+    t_heldReservations++;
+
+    return Reservation(this, resources);
+}
+
+void ResourceGovernor::returnResources(const Resources &resources)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.reserved.memory -= resources.memory;
+        m_stats.reserved.disk -= resources.disk;
+    }
+
+    m_available.notify_all();
+}
+
+void ResourceGovernor::recordDiskUsage(const std::string &pkgName, std::uint64_t bytes)
+{
+    if (bytes == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto &usage = m_diskHistory[pkgName];
+    usage = std::max(usage, bytes);
+}
+
+ResourceGovernor::Stats ResourceGovernor::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void ResourceGovernor::resetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.peak = m_stats.reserved;
+    m_stats.waits = 0;
+    m_stats.waitTime = std::chrono::nanoseconds(0);
+}
+
+} // namespace ASGenerator
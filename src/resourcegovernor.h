@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <list>
+#include <unordered_map>
+
+#include "backends/interfaces.h"
+
+namespace ASGenerator
+{
+
+/**
+ * Admission control for working on packages in parallel.
+ *
+ * Before a package is opened, a reservation for the memory and temporary disk space
+ * it is estimated to need is made. If that would exceed the configured limits, the
+ * reservation waits until enough other packages are done, while packages that still
+ * fit next to the longest-waiting one proceed. A single package is always admitted if
+ * nothing else is reserved, even if it needs more than the limit.
+ */
+class ResourceGovernor
+{
+public:
+    struct Resources {
+        std::uint64_t memory = 0;
+        std::uint64_t disk = 0;
+    };
+
+    struct Stats {
+        /// resources that are reserved right now
+        Resources reserved;
+        /// highest amount of resources that were reserved at the same time
+        Resources peak;
+        /// number of reservations that had to wait
+        std::uint64_t waits = 0;
+        std::chrono::nanoseconds waitTime{0};
+    };
+
+    /**
+     * Resources held for one package, returned to the governor when this is destroyed.
+     */
+    class Reservation
+    {
+    public:
+        Reservation() = default;
+        ~Reservation();
+
+        Reservation(Reservation &&other) noexcept;
+        Reservation &operator=(Reservation &&other) noexcept;
+
+        // Delete copy constructor and assignment operator
+        Reservation(const Reservation &) = delete;
+        Reservation &operator=(const Reservation &) = delete;
+
+    private:
+        friend class ResourceGovernor;
+        Reservation(ResourceGovernor *governor, Resources resources);
+
+        void release();
+
+        ResourceGovernor *m_governor = nullptr;
+        Resources m_resources;
+    };
+
+    /**
+     * @param memoryLimit Memory that packages may use at the same time, in bytes. 0 means unlimited.
+     * @param diskLimit Temporary disk space that packages may use at the same time, in bytes. 0 means unlimited.
+     */
+    ResourceGovernor(std::uint64_t memoryLimit, std::uint64_t diskLimit);
+
+    /**
+     * Estimate the resources reading the contents list of @pkg needs.
+     */
+    Resources scanEstimate(const Package &pkg) const;
+
+    /**
+     * Estimate the resources extracting metadata from @pkg needs, taking into
+     * account how much disk space earlier versions of it used.
+     */
+    Resources processEstimate(const Package &pkg) const;
+
+    /**
+     * Reserve @resources, waiting until they are available.
+     * A thread that already holds a reservation is never made to wait.
+     */
+    [[nodiscard]] Reservation reserve(Resources resources);
+
+    /**
+     * Remember that a package named @pkgName used @bytes of temporary disk space.
+     */
+    void recordDiskUsage(const std::string &pkgName, std::uint64_t bytes);
+
+    Stats stats() const;
+
+    /**
+     * Reset the peak and wait statistics.
+     */
+    void resetStats();
+
+    // Delete copy constructor and assignment operator
+    ResourceGovernor(const ResourceGovernor &) = delete;
+    ResourceGovernor &operator=(const ResourceGovernor &) = delete;
+
+private:
+    Resources m_limits;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_available;
+    Stats m_stats;
+    // resources of the reservations that are waiting, the longest-waiting one first
+    std::list<Resources> m_waiting;
+
+    // largest temporary disk usage seen for packages, by name
+    std::unordered_map<std::string, std::uint64_t> m_diskHistory;
+
+    bool withinLimits(const Resources &resources) const;
+    bool canAdmit(const Resources &resources, bool isOldestWaiter) const;
+    void returnResources(const Resources &resources);
+};
+
+} // namespace ASGenerator
@@ -23,7 +23,6 @@
 #include <algorithm>
 #include <appstream.h>
 #include <appstream-compose.h>
-#include <nlohmann/json.hpp>
 
 #include "hintregistry.h"
 #include "logging.h"
@@ -31,36 +30,6 @@
 namespace ASGenerator
 {
 
-using ordered_json = nlohmann::ordered_json;
-
-/**
- * Create an empty hints document for @pkid.
- */
-static ordered_json makeHintsDocument(const std::string &pkid)
-{
-    return ordered_json{
-        {"package", pkid                  },
-        {"hints",   ordered_json::object()}
-    };
-}
-
-/**
- * Create the JSON object representing a single hint.
- */
-static ordered_json makeHintNode(const std::string &tag, const std::vector<std::pair<std::string, std::string>> &vars)
-{
-    ordered_json hint{
-        {"tag", tag}
-    };
-    if (!vars.empty()) {
-        auto &varsNode = hint["vars"];
-        for (const auto &[key, value] : vars)
-            varsNode[key] = value;
-    }
-
-    return hint;
-}
-
 GeneratorResult::GeneratorResult(std::shared_ptr<Package> pkg, fs::path mediaStagingDir)
     : m_pkg(std::move(pkg)),
       m_res(asc_result_new()),
@@ -90,6 +59,8 @@ GeneratorResult::~GeneratorResult()
 GeneratorResult::GeneratorResult(GeneratorResult &&other) noexcept
     : m_pkg(std::move(other.m_pkg)),
       m_res(other.m_res),
+      m_inputFiles(std::move(other.m_inputFiles)),
+      m_usesOtherPackages(other.m_usesOtherPackages),
       m_mediaStagingDir(std::move(other.m_mediaStagingDir))
 {
     other.m_res = nullptr;
@@ -105,6 +76,8 @@ GeneratorResult &GeneratorResult::operator=(GeneratorResult &&other) noexcept
 
         m_pkg = std::move(other.m_pkg);
         m_res = other.m_res;
+        m_inputFiles = std::move(other.m_inputFiles);
+        m_usesOtherPackages = other.m_usesOtherPackages;
         m_mediaStagingDir = std::move(other.m_mediaStagingDir);
 
         other.m_res = nullptr;
@@ -113,6 +86,21 @@ GeneratorResult &GeneratorResult::operator=(GeneratorResult &&other) noexcept
     return *this;
 }
 
+void GeneratorResult::addInputFile(const Package *pkg, const std::string &fname)
+{
+    m_inputFiles.emplace_back(pkg, fname);
+}
+
+void GeneratorResult::markUsesOtherPackages()
+{
+    m_usesOtherPackages = true;
+}
+
+bool GeneratorResult::usesOtherPackages() const
+{
+    return m_usesOtherPackages;
+}
+
 fs::path GeneratorResult::mediaStagingDir(AsComponent *cpt) const
 {
     if (m_mediaStagingDir.empty())
@@ -196,54 +184,55 @@ void GeneratorResult::addComponentWithString(AsComponent *cpt, const std::string
         throw std::runtime_error(error->message);
 }
 
-std::string GeneratorResult::hintsToJson() const
+PackageHints GeneratorResult::hints() const
 {
-    if (hintsCount() == 0)
-        return {};
-
-    auto doc = makeHintsDocument(pkid());
+    PackageHints result;
     for (const auto &cid : getComponentIdsWithHints()) {
         GPtrArray *cptHints = asc_result_get_hints(m_res, cid.c_str());
         if (!cptHints || cptHints->len == 0)
             continue;
 
-        auto &hintNodes = doc["hints"][cid];
+        auto &hintEntries = result.components.emplace_back();
+        hintEntries.cid = cid;
         for (guint i = 0; i < cptHints->len; i++) {
             auto *hint = static_cast<AscHint *>(g_ptr_array_index(cptHints, i));
 
-            std::vector<std::pair<std::string, std::string>> vars;
+            auto &entry = hintEntries.hints.emplace_back();
+            entry.tag = asc_hint_get_tag(hint);
             GPtrArray *varsList = asc_hint_get_explanation_vars_list(hint);
             if (varsList) {
                 for (guint j = 0; j + 1 < varsList->len; j += 2)
-                    vars.emplace_back(
+                    entry.vars.emplace_back(
                         static_cast<const char *>(g_ptr_array_index(varsList, j)),
                         static_cast<const char *>(g_ptr_array_index(varsList, j + 1)));
             }
-
-            hintNodes.push_back(makeHintNode(asc_hint_get_tag(hint), vars));
         }
     }
 
-    return doc.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    return result;
 }
 
-std::optional<std::string> hintsJsonAddHint(
-    const std::string &hintsJson,
-    const std::string &pkid,
-    const std::string &cid,
-    const std::string &tag,
-    const std::unordered_map<std::string, std::string> &vars)
+std::string GeneratorResult::hintsToJson() const
 {
-    auto doc = hintsJson.empty() ? makeHintsDocument(pkid) : ordered_json::parse(hintsJson);
+    if (hintsCount() == 0)
+        return {};
+    return hints().toJson(pkid());
+}
 
-    auto &hintNodes = doc["hints"][cid];
-    for (const auto &hint : hintNodes) {
-        if (hint.value("tag", "") == tag)
-            return std::nullopt;
+std::uint32_t GeneratorResult::hintsCount(AsIssueSeverity severity) const
+{
+    std::uint32_t count = 0;
+    for (const auto &cid : getComponentIdsWithHints()) {
+        GPtrArray *cptHints = asc_result_get_hints(m_res, cid.c_str());
+        if (!cptHints)
+            continue;
+        for (guint i = 0; i < cptHints->len; i++) {
+            if (asc_hint_get_severity(static_cast<AscHint *>(g_ptr_array_index(cptHints, i))) == severity)
+                count++;
+        }
     }
 
-    hintNodes.push_back(makeHintNode(tag, {vars.begin(), vars.end()}));
-    return doc.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    return count;
 }
 
 std::uint32_t GeneratorResult::hintsCount() const
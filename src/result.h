@@ -24,10 +24,12 @@
 #include <unordered_map>
 #include <memory>
 #include <optional>
+#include <utility>
 #include <filesystem>
 #include <appstream.h>
 
 #include "backends/interfaces.h"
+#include "packagehints.h"
 
 typedef struct _AscResult AscResult;
 
@@ -136,12 +138,22 @@ public:
      */
     bool addHint(AsComponent *cpt, const std::string &tag, const std::string &msg);
 
+    /**
+     * Get the hints found for the package associated with this GeneratorResult.
+     */
+    PackageHints hints() const;
+
     /**
      * Create JSON metadata for the hints found for the package
      * associated with this GeneratorResult.
      */
     std::string hintsToJson() const;
 
+    /**
+     * Get the number of hints with @severity.
+     */
+    std::uint32_t hintsCount(AsIssueSeverity severity) const;
+
     // Delegate methods to AscResult
     std::uint32_t hintsCount() const;
     std::uint32_t componentsCount() const;
@@ -169,25 +181,40 @@ public:
      */
     void clearMediaStaging();
 
+    /**
+     * Note that file @fname of package @pkg was used to generate this result.
+     */
+    void addInputFile(const Package *pkg, const std::string &fname);
+
+    /**
+     * All files that were used to generate this result, as (package, filename) pairs.
+     */
+    const std::vector<std::pair<const Package *, std::string>> &inputFiles() const
+    {
+        return m_inputFiles;
+    }
+
+    /**
+     * Note that this result depends on what other packages contain, beyond the files
+     * listed in @inputFiles, e.g. because an icon was searched for in all of them.
+     */
+    void markUsesOtherPackages();
+
+    /**
+     * True if this result depends on the contents of other packages.
+     */
+    bool usesOtherPackages() const;
+
 private:
     std::shared_ptr<Package> m_pkg;
     AscResult *m_res;
 
+    // files this result was generated from
+    std::vector<std::pair<const Package *, std::string>> m_inputFiles;
+    bool m_usesOtherPackages = false;
+
     // directory the media of this result lives in until it is moved into the media pool
     fs::path m_mediaStagingDir;
 };
 
-/**
- * Add a hint for @cid to the hints document @hintsJson, which must be in the form produced
- * by GeneratorResult::hintsToJson(). An empty document is created for @pkid if none is given.
- *
- * @return The updated document, or nothing if @cid already carries a hint with @tag.
- */
-[[nodiscard]] std::optional<std::string> hintsJsonAddHint(
-    const std::string &hintsJson,
-    const std::string &pkid,
-    const std::string &cid,
-    const std::string &tag,
-    const std::unordered_map<std::string, std::string> &vars);
-
 } // namespace ASGenerator
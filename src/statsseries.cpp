@@ -0,0 +1,558 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "statsseries.h"
+
+#include <format>
+#include <stdexcept>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+#include <limits>
+
+#include "utils.h"
+
+namespace ASGenerator
+{
+
+static constexpr std::string_view MetaKey = "meta";
+static constexpr std::string_view DictionaryKey = "dict";
+static constexpr std::string_view ChunkKeyPrefix = "chunk/";
+
+/**
+ * Bookkeeping record of the whole series.
+ */
+struct SeriesMeta {
+    std::uint64_t generation = 0;
+    std::uint64_t chunks = 0;
+    std::uint64_t rows = 0;
+};
+
+/**
+ * Decoded contents of one chunk of the series.
+ */
+struct SeriesChunk {
+    std::vector<std::int64_t> times;
+    std::vector<std::uint32_t> suites;
+    std::vector<std::uint32_t> sections;
+    // name ID -> value of every row, if the row has one
+    std::vector<std::pair<std::uint32_t, std::vector<std::optional<std::int64_t>>>> columns;
+
+    std::size_t size() const
+    {
+        return times.size();
+    }
+};
+
+/**
+ * Strings used by the series (suite, section and value names), by ID.
+ */
+struct SeriesDictionary {
+    std::vector<std::string> strings;
+    std::unordered_map<std::string, std::uint32_t> ids;
+    bool changed = false;
+
+    std::uint32_t idFor(const std::string &str)
+    {
+        auto it = ids.find(str);
+        if (it != ids.end())
+            return it->second;
+
+        const auto id = static_cast<std::uint32_t>(strings.size());
+        strings.push_back(str);
+        ids.emplace(str, id);
+        changed = true;
+        return id;
+    }
+
+    const std::string &at(std::uint64_t id) const
+    {
+        if (id >= strings.size())
+            throw std::runtime_error(std::format("Statistics series refers to unknown string {}.", id));
+        return strings[id];
+    }
+};
+
+static std::uint64_t zigzagEncode(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+static std::int64_t zigzagDecode(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+static std::int64_t wrappingDiff(std::int64_t a, std::int64_t b)
+{
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) - static_cast<std::uint64_t>(b));
+}
+
+static std::int64_t wrappingSum(std::int64_t a, std::int64_t b)
+{
+    return static_cast<std::int64_t>(static_cast<std::uint64_t>(a) + static_cast<std::uint64_t>(b));
+}
+
+static std::uint64_t readSeriesVarint(std::string_view data, std::size_t &pos)
+{
+    std::uint64_t value;
+    if (!Utils::readVarint(data, pos, value))
+        throw std::runtime_error("Statistics series data is truncated.");
+    return value;
+}
+
+static void checkMdbError(int rc, const std::string &msg)
+{
+    if (rc != 0)
+        throw std::runtime_error(std::format("{}[{}]: {}", msg, rc, mdb_strerror(rc)));
+}
+
+static std::optional<std::string_view> getRaw(MDB_txn *txn, MDB_dbi dbi, std::string_view key)
+{
+    MDB_val dkey, dval;
+    dkey.mv_size = key.size();
+    dkey.mv_data = const_cast<char *>(key.data());
+
+    const auto rc = mdb_get(txn, dbi, &dkey, &dval);
+    if (rc == MDB_NOTFOUND)
+        return std::nullopt;
+    checkMdbError(rc, "mdb_get (statistics)");
+
+    return std::string_view(static_cast<const char *>(dval.mv_data), dval.mv_size);
+}
+
+static void putRaw(MDB_txn *txn, MDB_dbi dbi, std::string_view key, std::string_view value)
+{
+    MDB_val dkey, dval;
+    dkey.mv_size = key.size();
+    dkey.mv_data = const_cast<char *>(key.data());
+    dval.mv_size = value.size();
+    dval.mv_data = const_cast<char *>(value.data());
+
+    checkMdbError(mdb_put(txn, dbi, &dkey, &dval, 0), "mdb_put (statistics)");
+}
+
+static void deleteRaw(MDB_txn *txn, MDB_dbi dbi, std::string_view key)
+{
+    MDB_val dkey;
+    dkey.mv_size = key.size();
+    dkey.mv_data = const_cast<char *>(key.data());
+
+    const auto rc = mdb_del(txn, dbi, &dkey, nullptr);
+    if (rc != MDB_NOTFOUND)
+        checkMdbError(rc, "mdb_del (statistics)");
+}
+
+static std::string chunkKey(std::uint64_t index)
+{
+    // big-endian, so chunks are sorted by their index
+    std::string key(ChunkKeyPrefix);
+    for (int i = 7; i >= 0; i--)
+        key.push_back(static_cast<char>((index >> (i * 8)) & 0xff));
+    return key;
+}
+
+static SeriesMeta loadMeta(MDB_txn *txn, MDB_dbi dbi)
+{
+    SeriesMeta meta;
+    const auto data = getRaw(txn, dbi, MetaKey);
+    if (!data.has_value())
+        return meta;
+
+    std::size_t pos = 0;
+    meta.generation = readSeriesVarint(*data, pos);
+    meta.chunks = readSeriesVarint(*data, pos);
+    meta.rows = readSeriesVarint(*data, pos);
+    return meta;
+}
+
+static void storeMeta(MDB_txn *txn, MDB_dbi dbi, const SeriesMeta &meta)
+{
+    std::string data;
+    Utils::appendVarint(data, meta.generation);
+    Utils::appendVarint(data, meta.chunks);
+    Utils::appendVarint(data, meta.rows);
+    putRaw(txn, dbi, MetaKey, data);
+}
+
+static SeriesDictionary loadDictionary(MDB_txn *txn, MDB_dbi dbi)
+{
+    SeriesDictionary dict;
+    const auto data = getRaw(txn, dbi, DictionaryKey);
+    if (!data.has_value())
+        return dict;
+
+    std::size_t pos = 0;
+    const auto count = readSeriesVarint(*data, pos);
+    for (std::uint64_t i = 0; i < count; i++) {
+        const auto len = readSeriesVarint(*data, pos);
+        if (len > data->size() - pos)
+            throw std::runtime_error("Statistics series dictionary is truncated.");
+        dict.idFor(std::string(data->substr(pos, len)));
+        pos += len;
+    }
+
+    dict.changed = false;
+    return dict;
+}
+
+static void storeDictionary(MDB_txn *txn, MDB_dbi dbi, const SeriesDictionary &dict)
+{
+    std::string data;
+    Utils::appendVarint(data, dict.strings.size());
+    for (const auto &str : dict.strings) {
+        Utils::appendVarint(data, str.size());
+        data += str;
+    }
+    putRaw(txn, dbi, DictionaryKey, data);
+}
+
+static std::uint64_t seriesKey(std::uint32_t suite, std::uint32_t section)
+{
+    return (static_cast<std::uint64_t>(suite) << 32) | section;
+}
+
+static std::string encodeChunk(const SeriesChunk &chunk)
+{
+    std::string data;
+    Utils::appendVarint(data, chunk.size());
+    if (chunk.size() == 0)
+        return data;
+
+    // the time range comes first, so readers can skip chunks without decoding them
+    Utils::appendVarint(data, zigzagEncode(chunk.times.front()));
+    Utils::appendVarint(data, zigzagEncode(wrappingDiff(chunk.times.back(), chunk.times.front())));
+
+    auto prevTime = chunk.times.front();
+    for (const auto time : chunk.times) {
+        Utils::appendVarint(data, zigzagEncode(wrappingDiff(time, prevTime)));
+        prevTime = time;
+    }
+    for (const auto id : chunk.suites)
+        Utils::appendVarint(data, id);
+    for (const auto id : chunk.sections)
+        Utils::appendVarint(data, id);
+
+    // values are stored as difference to the previous value of the same suite/section,
+    // which usually makes them fit into a single byte. Zero marks a missing value.
+    Utils::appendVarint(data, chunk.columns.size());
+    for (const auto &[nameId, values] : chunk.columns) {
+        Utils::appendVarint(data, nameId);
+
+        std::unordered_map<std::uint64_t, std::int64_t> lastValues;
+        for (std::size_t row = 0; row < chunk.size(); row++) {
+            if (!values[row].has_value()) {
+                Utils::appendVarint(data, 0);
+                continue;
+            }
+
+            auto &last = lastValues[seriesKey(chunk.suites[row], chunk.sections[row])];
+            Utils::appendVarint(data, zigzagEncode(wrappingDiff(*values[row], last)) + 1);
+            last = *values[row];
+        }
+    }
+
+    return data;
+}
+
+static void decodeChunkRange(std::string_view data, std::int64_t &first, std::int64_t &last)
+{
+    std::size_t pos = 0;
+    if (readSeriesVarint(data, pos) == 0) {
+        first = 1;
+        last = 0;
+        return;
+    }
+
+    first = zigzagDecode(readSeriesVarint(data, pos));
+    last = wrappingSum(first, zigzagDecode(readSeriesVarint(data, pos)));
+}
+
+static SeriesChunk decodeChunk(std::string_view data)
+{
+    SeriesChunk chunk;
+    std::size_t pos = 0;
+
+    const auto rows = readSeriesVarint(data, pos);
+    if (rows == 0)
+        return chunk;
+    if (rows > data.size())
+        throw std::runtime_error("Statistics series chunk is corrupt.");
+
+    auto time = zigzagDecode(readSeriesVarint(data, pos));
+    readSeriesVarint(data, pos);
+
+    chunk.times.reserve(rows);
+    for (std::uint64_t i = 0; i < rows; i++) {
+        time = wrappingSum(time, zigzagDecode(readSeriesVarint(data, pos)));
+        chunk.times.push_back(time);
+    }
+    chunk.suites.reserve(rows);
+    for (std::uint64_t i = 0; i < rows; i++)
+        chunk.suites.push_back(static_cast<std::uint32_t>(readSeriesVarint(data, pos)));
+    chunk.sections.reserve(rows);
+    for (std::uint64_t i = 0; i < rows; i++)
+        chunk.sections.push_back(static_cast<std::uint32_t>(readSeriesVarint(data, pos)));
+
+    const auto columnCount = readSeriesVarint(data, pos);
+    for (std::uint64_t c = 0; c < columnCount; c++) {
+        auto &[nameId, values] = chunk.columns.emplace_back();
+        nameId = static_cast<std::uint32_t>(readSeriesVarint(data, pos));
+        values.reserve(rows);
+
+        std::unordered_map<std::uint64_t, std::int64_t> lastValues;
+        for (std::uint64_t row = 0; row < rows; row++) {
+            const auto encoded = readSeriesVarint(data, pos);
+            if (encoded == 0) {
+                values.emplace_back(std::nullopt);
+                continue;
+            }
+
+            auto &last = lastValues[seriesKey(chunk.suites[row], chunk.sections[row])];
+            last = wrappingSum(last, zigzagDecode(encoded - 1));
+            values.emplace_back(last);
+        }
+    }
+
+    return chunk;
+}
+
+static void addRow(SeriesChunk &chunk, SeriesDictionary &dict, const StatisticsPoint &point, std::int64_t time)
+{
+    const auto row = chunk.size();
+    chunk.times.push_back(time);
+    chunk.suites.push_back(dict.idFor(point.suite));
+    chunk.sections.push_back(dict.idFor(point.section));
+
+    for (auto &column : chunk.columns)
+        column.second.emplace_back(std::nullopt);
+
+    for (const auto &[name, value] : point.values) {
+        const auto nameId = dict.idFor(name);
+        auto it = std::find_if(chunk.columns.begin(), chunk.columns.end(), [nameId](const auto &column) {
+            return column.first == nameId;
+        });
+        if (it == chunk.columns.end()) {
+            chunk.columns.emplace_back(nameId, std::vector<std::optional<std::int64_t>>(row + 1));
+            it = chunk.columns.end() - 1;
+        }
+        it->second[row] = value;
+    }
+}
+
+static StatisticsPoint pointAt(const SeriesChunk &chunk, std::size_t row, const SeriesDictionary &dict)
+{
+    StatisticsPoint point;
+    point.time = static_cast<std::time_t>(chunk.times[row]);
+    point.suite = dict.at(chunk.suites[row]);
+    point.section = dict.at(chunk.sections[row]);
+    for (const auto &[nameId, values] : chunk.columns) {
+        if (values[row].has_value())
+            point.values.emplace_back(dict.at(nameId), *values[row]);
+    }
+
+    return point;
+}
+
+static SeriesChunk loadChunk(MDB_txn *txn, MDB_dbi dbi, std::uint64_t index)
+{
+    const auto data = getRaw(txn, dbi, chunkKey(index));
+    if (!data.has_value())
+        throw std::runtime_error(std::format("Statistics series chunk {} is missing.", index));
+    return decodeChunk(*data);
+}
+
+std::int64_t StatisticsPoint::value(std::string_view name, std::int64_t defaultValue) const
+{
+    for (const auto &[vname, val] : values) {
+        if (vname == name)
+            return val;
+    }
+
+    return defaultValue;
+}
+
+void StatisticsSeries::append(MDB_txn *txn, MDB_dbi dbi, const std::vector<StatisticsPoint> &points)
+{
+    if (points.empty())
+        return;
+
+    auto meta = loadMeta(txn, dbi);
+    auto dict = loadDictionary(txn, dbi);
+
+    // continue filling the last chunk, if it has room left
+    SeriesChunk tail;
+    std::uint64_t tailIndex = meta.chunks;
+    auto lastTime = std::numeric_limits<std::int64_t>::min();
+    if (meta.chunks > 0) {
+        auto last = loadChunk(txn, dbi, meta.chunks - 1);
+        if (last.size() > 0)
+            lastTime = last.times.back();
+        if (last.size() < ChunkRows) {
+            tail = std::move(last);
+            tailIndex = meta.chunks - 1;
+        }
+    }
+
+    for (const auto &point : points) {
+        if (tail.size() >= ChunkRows) {
+            putRaw(txn, dbi, chunkKey(tailIndex), encodeChunk(tail));
+            tailIndex++;
+            tail = SeriesChunk();
+        }
+
+        lastTime = std::max(lastTime, static_cast<std::int64_t>(point.time));
+        addRow(tail, dict, point, lastTime);
+        meta.rows++;
+    }
+
+    putRaw(txn, dbi, chunkKey(tailIndex), encodeChunk(tail));
+    meta.chunks = tailIndex + 1;
+
+    if (dict.changed)
+        storeDictionary(txn, dbi, dict);
+    storeMeta(txn, dbi, meta);
+}
+
+std::vector<StatisticsPoint> StatisticsSeries::query(
+    MDB_txn *txn,
+    MDB_dbi dbi,
+    std::time_t from,
+    std::time_t to,
+    std::time_t interval)
+{
+    const auto meta = loadMeta(txn, dbi);
+    const auto dict = loadDictionary(txn, dbi);
+
+    std::vector<StatisticsPoint> points;
+    for (std::uint64_t i = 0; i < meta.chunks; i++) {
+        const auto data = getRaw(txn, dbi, chunkKey(i));
+        if (!data.has_value())
+            continue;
+
+        std::int64_t first, last;
+        decodeChunkRange(*data, first, last);
+        if (last < from || first > to)
+            continue;
+
+        const auto chunk = decodeChunk(*data);
+        for (std::size_t row = 0; row < chunk.size(); row++) {
+            if (chunk.times[row] >= from && chunk.times[row] <= to)
+                points.push_back(pointAt(chunk, row, dict));
+        }
+    }
+
+    if (interval <= 0)
+        return points;
+
+    // keep the last point of every suite/section per interval
+    std::vector<StatisticsPoint> sampled;
+    std::unordered_map<std::string, std::pair<std::time_t, std::size_t>> lastSample;
+    for (auto &point : points) {
+        const auto bucket = point.time / interval;
+        const auto key = point.suite + '\0' + point.section;
+
+        auto it = lastSample.find(key);
+        if (it != lastSample.end() && it->second.first == bucket) {
+            sampled[it->second.second] = std::move(point);
+            continue;
+        }
+
+        lastSample[key] = {bucket, sampled.size()};
+        sampled.push_back(std::move(point));
+    }
+
+    std::stable_sort(sampled.begin(), sampled.end(), [](const auto &a, const auto &b) {
+        return a.time < b.time;
+    });
+    return sampled;
+}
+
+std::vector<StatisticsPoint> StatisticsSeries::readFrom(MDB_txn *txn, MDB_dbi dbi, StatisticsCursor &cursor)
+{
+    const auto meta = loadMeta(txn, dbi);
+    if (cursor.generation != meta.generation || cursor.row > meta.rows) {
+        cursor.generation = meta.generation;
+        cursor.row = 0;
+    }
+
+    std::vector<StatisticsPoint> points;
+    if (cursor.row == meta.rows)
+        return points;
+
+    // all chunks but the last one are full, so we know where to start
+    const auto dict = loadDictionary(txn, dbi);
+    const auto firstChunk = cursor.row / ChunkRows;
+    for (auto i = firstChunk; i < meta.chunks; i++) {
+        const auto chunk = loadChunk(txn, dbi, i);
+        const std::size_t firstRow = i == firstChunk ? cursor.row % ChunkRows : 0;
+        for (auto row = firstRow; row < chunk.size(); row++)
+            points.push_back(pointAt(chunk, row, dict));
+    }
+
+    cursor.row = meta.rows;
+    return points;
+}
+
+std::size_t StatisticsSeries::compact(MDB_txn *txn, MDB_dbi dbi)
+{
+    StatisticsCursor cursor;
+    auto points = readFrom(txn, dbi, cursor);
+
+    for (auto &point : points)
+        std::sort(point.values.begin(), point.values.end());
+
+    // a point is superfluous if the next one of its suite/section did not change anything
+    std::vector<bool> keep(points.size(), true);
+    std::unordered_map<std::string, std::size_t> lastIndex;
+    for (std::size_t i = 0; i < points.size(); i++) {
+        const auto key = points[i].suite + '\0' + points[i].section;
+        auto it = lastIndex.find(key);
+        if (it != lastIndex.end() && points[it->second].values == points[i].values)
+            keep[it->second] = false;
+        lastIndex[key] = i;
+    }
+
+    std::vector<StatisticsPoint> kept;
+    kept.reserve(points.size());
+    for (std::size_t i = 0; i < points.size(); i++) {
+        if (keep[i])
+            kept.push_back(std::move(points[i]));
+    }
+
+    // write everything anew, which also drops strings that are not used anymore
+    const auto meta = loadMeta(txn, dbi);
+    for (std::uint64_t i = 0; i < meta.chunks; i++)
+        deleteRaw(txn, dbi, chunkKey(i));
+    deleteRaw(txn, dbi, DictionaryKey);
+
+    SeriesMeta newMeta;
+    newMeta.generation = meta.generation + 1;
+    storeMeta(txn, dbi, newMeta);
+    append(txn, dbi, kept);
+
+    return points.size() - kept.size();
+}
+
+std::uint64_t StatisticsSeries::size(MDB_txn *txn, MDB_dbi dbi)
+{
+    return loadMeta(txn, dbi).rows;
+}
+
+} // namespace ASGenerator
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <ctime>
+#include <lmdb.h>
+
+namespace ASGenerator
+{
+
+/**
+ * One point of the statistics time series.
+ */
+struct StatisticsPoint {
+    std::time_t time{0};
+    std::string suite;
+    std::string section;
+    /// Integer values recorded for this point, by name
+    std::vector<std::pair<std::string, std::int64_t>> values;
+
+    /**
+     * Get the value named @name, or @defaultValue if the point has none.
+     */
+    std::int64_t value(std::string_view name, std::int64_t defaultValue = 0) const;
+};
+
+/**
+ * Position in the statistics series, to read only the points added after it.
+ */
+struct StatisticsCursor {
+    /// Generation of the series the position refers to
+    std::uint64_t generation{0};
+    /// Number of points that were read already
+    std::uint64_t row{0};
+};
+
+/**
+ * Append-only, column-oriented time series of statistics points in one LMDB database.
+ *
+ * Points are stored in chunks of up to ChunkRows rows. Within a chunk, timestamps are
+ * delta-encoded, suite and section names are stored as IDs into a string dictionary shared
+ * by all chunks, and every value is stored as column of variable-length integers holding
+ * the difference to the previous value of the same suite/section.
+ * Only the last chunk is ever rewritten by appending. Compacting the series rewrites it
+ * completely and starts a new generation, so cursors of older generations start over.
+ */
+class StatisticsSeries
+{
+public:
+    static constexpr std::size_t ChunkRows = 512;
+
+    /**
+     * Append @points to the series. Points must not be older than the last one stored,
+     * their time is moved forward otherwise to keep the series ordered.
+     */
+    static void append(MDB_txn *txn, MDB_dbi dbi, const std::vector<StatisticsPoint> &points);
+
+    /**
+     * Get all points recorded between @from and @to (inclusive), in order.
+     *
+     * If @interval is nonzero, the series is downsampled to at most one point per
+     * suite/section every @interval seconds, keeping the last point of each interval.
+     */
+    static std::vector<StatisticsPoint> query(
+        MDB_txn *txn,
+        MDB_dbi dbi,
+        std::time_t from,
+        std::time_t to,
+        std::time_t interval = 0);
+
+    /**
+     * Get all points after @cursor and move it to the end of the series.
+     * If the cursor belongs to an older generation, all points are returned.
+     */
+    static std::vector<StatisticsPoint> readFrom(MDB_txn *txn, MDB_dbi dbi, StatisticsCursor &cursor);
+
+    /**
+     * Drop every point that has the same values as the next point of the same suite/section,
+     * and rewrite the series. Returns the number of points that were removed.
+     */
+    static std::size_t compact(MDB_txn *txn, MDB_dbi dbi);
+
+    /**
+     * Total number of points in the series.
+     */
+    static std::uint64_t size(MDB_txn *txn, MDB_dbi dbi);
+};
+
+} // namespace ASGenerator
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stringpool.h"
+
+#include <cstring>
+
+namespace ASGenerator
+{
+
+StringPool::StringPool(std::size_t blockSize)
+    : m_blockSize(blockSize),
+      m_allocated(0),
+      m_free(nullptr),
+      m_freeSize(0)
+{
+}
+
+std::string_view StringPool::intern(std::string_view str)
+{
+    if (str.empty())
+        return {};
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_strings.find(str);
+    if (it != m_strings.end())
+        return *it;
+
+    char *data;
+    if (str.size() > m_blockSize / 4) {
+        // large strings get a block of their own, so we do not waste the rest of the current one
+        m_blocks.push_back(std::make_unique_for_overwrite<char[]>(str.size()));
+        m_allocated += str.size();
+        data = m_blocks.back().get();
+    } else {
+        if (str.size() > m_freeSize) {
+            m_blocks.push_back(std::make_unique_for_overwrite<char[]>(m_blockSize));
+            m_allocated += m_blockSize;
+            m_free = m_blocks.back().get();
+            m_freeSize = m_blockSize;
+        }
+
+        data = m_free;
+        m_free += str.size();
+        m_freeSize -= str.size();
+    }
+
+    std::memcpy(data, str.data(), str.size());
+    const std::string_view pooled(data, str.size());
+    m_strings.insert(pooled);
+
+    return pooled;
+}
+
+std::size_t StringPool::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_strings.size();
+}
+
+std::size_t StringPool::allocatedBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_allocated;
+}
+
+} // namespace ASGenerator
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+#include <unordered_set>
+
+namespace ASGenerator
+{
+
+/**
+ * Table of interned strings, which are kept in large blocks of memory.
+ *
+ * Every distinct string is stored once, and stays valid for as long as the pool
+ * exists. This is meant for values like versions, architectures or maintainers,
+ * which are repeated across many packages.
+ */
+class StringPool
+{
+public:
+    explicit StringPool(std::size_t blockSize = 64 * 1024);
+
+    /**
+     * Get the pooled copy of @str, adding it to the pool if it is not there yet.
+     * Equal strings always result in the same view.
+     */
+    std::string_view intern(std::string_view str);
+
+    /**
+     * Number of distinct strings in the pool.
+     */
+    std::size_t size() const;
+
+    /**
+     * Bytes of memory that were allocated for string data.
+     */
+    std::size_t allocatedBytes() const;
+
+    // Delete copy constructor and assignment operator
+    StringPool(const StringPool &) = delete;
+    StringPool &operator=(const StringPool &) = delete;
+
+private:
+    std::size_t m_blockSize;
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    std::size_t m_allocated;
+
+    // free space in the block we are currently filling
+    char *m_free;
+    std::size_t m_freeSize;
+
+    std::unordered_set<std::string_view> m_strings;
+    mutable std::mutex m_mutex;
+};
+
+} // namespace ASGenerator
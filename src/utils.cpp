@@ -34,8 +34,11 @@
 #include <cstring>
 #include <cerrno>
 
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
+#include <linux/fs.h>
 
 #include <unicode/unistr.h>
 #include <tbb/parallel_for_each.h>
@@ -140,6 +143,31 @@ std::optional<std::string> getCidFromGlobalID(const std::string &gcid)
     return parts[2];
 }
 
+void appendVarint(std::string &buffer, std::uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+bool readVarint(std::string_view data, std::size_t &pos, std::uint64_t &value)
+{
+    value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        if (pos >= data.size())
+            return false;
+        const auto byte = static_cast<std::uint8_t>(data[pos++]);
+        value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+
+    // more than ten bytes can not be a valid 64-bit integer
+    return false;
+}
+
 void hardlink(const fs::path &srcPath, const fs::path &destPath)
 {
     if (::link(srcPath.c_str(), destPath.c_str()) != 0)
@@ -172,6 +200,126 @@ void copyFile(const fs::path &srcFile, const fs::path &destFile, bool useHardlin
     }
 }
 
+/**
+ * Copy all data from @srcFd to @destFd, preferably inside the kernel.
+ */
+static void copyFileData(int srcFd, int destFd, std::uint64_t size)
+{
+    bool useCopyRange = true;
+    std::uint64_t done = 0;
+    while (done < size && useCopyRange) {
+        const auto res = ::copy_file_range(srcFd, nullptr, destFd, nullptr, size - done, 0);
+        if (res > 0) {
+            done += static_cast<std::uint64_t>(res);
+            continue;
+        }
+        if (res == 0)
+            return;
+        if (errno == EINTR)
+            continue;
+
+        // some filesystems and older kernels can not copy between these files,
+        // fall back to copying in userspace in that case
+        if (done == 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP))
+            useCopyRange = false;
+        else
+            throw std::runtime_error(std::format("Unable to copy file data: {}", std::strerror(errno)));
+    }
+    if (useCopyRange)
+        return;
+
+    std::vector<char> buffer(GENERIC_BUFFER_SIZE * 8);
+    while (true) {
+        const auto nRead = ::read(srcFd, buffer.data(), buffer.size());
+        if (nRead == 0)
+            break;
+        if (nRead < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::format("Unable to read file data: {}", std::strerror(errno)));
+        }
+
+        ssize_t nWritten = 0;
+        while (nWritten < nRead) {
+            const auto res = ::write(destFd, buffer.data() + nWritten, nRead - nWritten);
+            if (res < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw std::runtime_error(std::format("Unable to write file data: {}", std::strerror(errno)));
+            }
+            nWritten += res;
+        }
+    }
+}
+
+void cloneFile(const fs::path &srcPath, const fs::path &destPath, FileCloneMode mode)
+{
+    if (mode == FileCloneMode::HARDLINK) {
+        hardlink(srcPath, destPath);
+        return;
+    }
+
+    const int srcFd = ::open(srcPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (srcFd < 0)
+        throw std::runtime_error(std::format("Unable to open {}: {}", srcPath.string(), std::strerror(errno)));
+
+    struct stat st;
+    if (::fstat(srcFd, &st) != 0) {
+        const auto err = errno;
+        ::close(srcFd);
+        throw std::runtime_error(std::format("Unable to stat {}: {}", srcPath.string(), std::strerror(err)));
+    }
+
+    const int destFd = ::open(destPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777);
+    if (destFd < 0) {
+        const auto err = errno;
+        ::close(srcFd);
+        throw std::runtime_error(std::format("Unable to create {}: {}", destPath.string(), std::strerror(err)));
+    }
+
+    try {
+        // try to share the data with the original file first, if we are allowed to
+        if (mode != FileCloneMode::REFLINK || ::ioctl(destFd, FICLONE, srcFd) != 0)
+            copyFileData(srcFd, destFd, static_cast<std::uint64_t>(st.st_size));
+    } catch (...) {
+        ::close(srcFd);
+        ::close(destFd);
+        ::unlink(destPath.c_str());
+        throw;
+    }
+
+    ::close(srcFd);
+    if (::close(destFd) != 0) {
+        const auto err = errno;
+        ::unlink(destPath.c_str());
+        throw std::runtime_error(std::format("Unable to write {}: {}", destPath.string(), std::strerror(err)));
+    }
+}
+
+void cloneDir(const fs::path &srcDir, const fs::path &destDir, FileCloneMode mode)
+{
+    std::error_code ec;
+    fs::create_directories(destDir, ec);
+    if (ec)
+        throw std::runtime_error(
+            std::format("Error creating destination directory {}: {}", destDir.string(), ec.message()));
+
+    for (const auto &entry : fs::recursive_directory_iterator(srcDir)) {
+        const auto destPath = destDir / entry.path().lexically_relative(srcDir);
+        if (entry.is_directory() && !entry.is_symlink()) {
+            fs::create_directories(destPath);
+            continue;
+        }
+        if (fs::exists(fs::symlink_status(destPath, ec)))
+            continue;
+
+        if (entry.is_symlink())
+            fs::copy_symlink(entry.path(), destPath);
+        else
+            cloneFile(entry.path(), destPath, mode);
+    }
+}
+
 void copyDir(const std::string &srcDir, const std::string &destDir, bool useHardlinks, bool followSymlinks)
 {
     const fs::path srcPath(srcDir);
@@ -271,6 +419,14 @@ std::vector<std::uint8_t> stringArrayToByteArray(const std::vector<std::string>
     return result;
 }
 
+GBytes *bytesFromVector(std::vector<std::uint8_t> &&data)
+{
+    auto *owned = new std::vector<std::uint8_t>(std::move(data));
+    return g_bytes_new_with_free_func(owned->data(), owned->size(), [](gpointer ptr) {
+        delete static_cast<std::vector<std::uint8_t> *>(ptr);
+    }, owned);
+}
+
 bool isRemote(const std::string &uri)
 {
     static const std::regex uriRegex(R"(^(https?|ftps?)://)");
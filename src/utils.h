@@ -146,6 +146,18 @@ bool isTopLevelDomain(const std::string &value);
  */
 std::optional<std::string> getCidFromGlobalID(const std::string &gcid);
 
+/**
+ * Append @value to @buffer as variable-length integer (LEB128), which
+ * takes a single byte for values below 128.
+ */
+void appendVarint(std::string &buffer, std::uint64_t value);
+
+/**
+ * Read a variable-length integer written by appendVarint() from @data at @pos,
+ * and advance @pos past it. Returns false if the data ends before the integer does.
+ */
+[[nodiscard]] bool readVarint(std::string_view data, std::size_t &pos, std::uint64_t &value);
+
 /**
  * Create a hard link between two files.
  */
@@ -161,6 +173,32 @@ void hardlink(const fs::path &srcPath, const fs::path &destPath);
  */
 void copyFile(const fs::path &srcPath, const fs::path &destPath, bool useHardlinks = false, bool followSymlinks = true);
 
+/**
+ * How files are placed at a new location by cloneFile() and cloneDir().
+ */
+enum class FileCloneMode {
+    /// Create hardlinks to the original files
+    HARDLINK,
+    /// Share the file data copy-on-write where the filesystem supports it, copy it otherwise
+    REFLINK,
+    /// Copy the file data
+    COPY
+};
+
+/**
+ * Place a copy of file @srcPath at @destPath, which must not exist yet, as selected by @mode.
+ *
+ * Copies are made with copy_file_range(), which lets the kernel avoid moving the data
+ * through userspace and may share the data on filesystems like XFS or Btrfs.
+ */
+void cloneFile(const fs::path &srcPath, const fs::path &destPath, FileCloneMode mode);
+
+/**
+ * Place a copy of directory @srcDir at @destDir, using cloneFile() for every file.
+ * Files that already exist at the destination are kept, symbolic links are copied as-is.
+ */
+void cloneDir(const fs::path &srcDir, const fs::path &destDir, FileCloneMode mode);
+
 /**
  * Copy a directory.
  * This function safely overwrites existing files at the destination.
@@ -193,6 +231,12 @@ bool existsAndIsDir(const std::string &path);
  */
 std::vector<std::uint8_t> stringArrayToByteArray(const std::vector<std::string> &strArray);
 
+/**
+ * Wrap @data in a GBytes without copying it.
+ * The vector is moved into the GBytes and released together with it.
+ */
+GBytes *bytesFromVector(std::vector<std::uint8_t> &&data);
+
 /**
  * Check if string contains a remote URI.
  */
@@ -0,0 +1,511 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "valuecompressor.h"
+
+#include <format>
+#include <memory>
+#include <vector>
+#include <unordered_set>
+#include <stdexcept>
+#include <algorithm>
+#include <mutex>
+#include <zdict.h>
+
+namespace ASGenerator
+{
+
+// compression level used for all values, a good tradeoff between speed and size
+static constexpr int CompressionLevel = 3;
+
+// values smaller than this rarely get any smaller
+static constexpr std::size_t MinCompressSize = 64;
+
+// target size of trained dictionaries, as recommended by the zstd documentation
+static constexpr std::size_t DictionarySize = 112640;
+
+// maximum number of values, and amount of data, we feed into the dictionary trainer
+static constexpr std::size_t MaxTrainingSamples = 8000;
+static constexpr std::size_t MaxTrainingDataSize = 64 * 1024 * 1024;
+
+// number of values we rewrite per write transaction when recompressing
+static constexpr std::size_t RecompressBatchSize = 1000;
+
+struct ZstdCCtxDeleter {
+    void operator()(ZSTD_CCtx *ctx) const
+    {
+        ZSTD_freeCCtx(ctx);
+    }
+};
+
+struct ZstdDCtxDeleter {
+    void operator()(ZSTD_DCtx *ctx) const
+    {
+        ZSTD_freeDCtx(ctx);
+    }
+};
+
+/**
+ * Compression contexts are expensive to set up, so every thread keeps its own.
+ */
+static ZSTD_CCtx *threadCompressionContext()
+{
+    thread_local std::unique_ptr<ZSTD_CCtx, ZstdCCtxDeleter> cctx(ZSTD_createCCtx());
+    return cctx.get();
+}
+
+static ZSTD_DCtx *threadDecompressionContext()
+{
+    thread_local std::unique_ptr<ZSTD_DCtx, ZstdDCtxDeleter> dctx(ZSTD_createDCtx());
+    return dctx.get();
+}
+
+static MDB_val makeRawDbValue(std::string_view data)
+{
+    MDB_val mval;
+    mval.mv_size = data.length();
+    mval.mv_data = const_cast<char *>(data.data());
+    return mval;
+}
+
+static std::string_view rawDbValueView(const MDB_val &val)
+{
+    return {static_cast<const char *>(val.mv_data), val.mv_size};
+}
+
+static void checkMdbError(int rc, const std::string &msg)
+{
+    if (rc != 0)
+        throw std::runtime_error(std::format("{}[{}]: {}", msg, rc, mdb_strerror(rc)));
+}
+
+ValueCompressor::ValueCompressor(std::string name)
+    : m_log(getLogger("compressor")),
+      m_name(std::move(name)),
+      m_cdict(nullptr)
+{
+}
+
+ValueCompressor::~ValueCompressor()
+{
+    clearDictionaries();
+}
+
+const std::string &ValueCompressor::name() const
+{
+    return m_name;
+}
+
+void ValueCompressor::clearDictionaries()
+{
+    std::unique_lock lock(m_mutex);
+    for (auto &[id, ddict] : m_ddicts)
+        ZSTD_freeDDict(ddict);
+    m_ddicts.clear();
+
+    if (m_cdict != nullptr)
+        ZSTD_freeCDict(m_cdict);
+    m_cdict = nullptr;
+}
+
+void ValueCompressor::addDictionary(std::string_view dict, bool makeCurrent)
+{
+    const auto dictId = ZDICT_getDictID(dict.data(), dict.size());
+    if (dictId == 0)
+        throw std::runtime_error(std::format("Compression dictionary for '{}' is invalid.", m_name));
+
+    auto ddict = ZSTD_createDDict(dict.data(), dict.size());
+    if (ddict == nullptr)
+        throw std::runtime_error(std::format("Unable to load compression dictionary {} for '{}'.", dictId, m_name));
+
+    ZSTD_CDict *cdict = nullptr;
+    if (makeCurrent) {
+        cdict = ZSTD_createCDict(dict.data(), dict.size(), CompressionLevel);
+        if (cdict == nullptr) {
+            ZSTD_freeDDict(ddict);
+            throw std::runtime_error(
+                std::format("Unable to load compression dictionary {} for '{}'.", dictId, m_name));
+        }
+    }
+
+    std::unique_lock lock(m_mutex);
+    auto it = m_ddicts.find(dictId);
+    if (it != m_ddicts.end()) {
+        ZSTD_freeDDict(it->second);
+        it->second = ddict;
+    } else {
+        m_ddicts.emplace(dictId, ddict);
+    }
+
+    if (cdict != nullptr) {
+        if (m_cdict != nullptr)
+            ZSTD_freeCDict(m_cdict);
+        m_cdict = cdict;
+    }
+}
+
+void ValueCompressor::loadDictionaries(MDB_txn *txn, MDB_dbi dictDbi)
+{
+    clearDictionaries();
+
+    // the ID of the dictionary new values are compressed with is stored under our name
+    std::uint32_t currentId = 0;
+    MDB_val ckey = makeRawDbValue(m_name);
+    MDB_val cval;
+    auto rc = mdb_get(txn, dictDbi, &ckey, &cval);
+    if (rc != MDB_NOTFOUND) {
+        checkMdbError(rc, "mdb_get (dictionaries)");
+        currentId = static_cast<std::uint32_t>(std::stoul(std::string(rawDbValueView(cval))));
+    }
+
+    // all dictionaries are stored as "<name>/<id>"
+    const auto prefix = m_name + "/";
+    MDB_cursor *cur = nullptr;
+    rc = mdb_cursor_open(txn, dictDbi, &cur);
+    checkMdbError(rc, "mdb_cursor_open (dictionaries)");
+
+    try {
+        MDB_val dkey = makeRawDbValue(prefix);
+        MDB_val dval;
+        rc = mdb_cursor_get(cur, &dkey, &dval, MDB_SET_RANGE);
+        while (rc == 0) {
+            const auto keyStr = rawDbValueView(dkey);
+            if (!keyStr.starts_with(prefix))
+                break;
+
+            const auto dict = rawDbValueView(dval);
+            addDictionary(dict, currentId != 0 && ZDICT_getDictID(dict.data(), dict.size()) == currentId);
+
+            rc = mdb_cursor_get(cur, &dkey, &dval, MDB_NEXT);
+        }
+        if (rc != 0 && rc != MDB_NOTFOUND)
+            checkMdbError(rc, "mdb_cursor_get (dictionaries)");
+
+        mdb_cursor_close(cur);
+    } catch (...) {
+        mdb_cursor_close(cur);
+        throw;
+    }
+
+    std::shared_lock lock(m_mutex);
+    if (!m_ddicts.empty())
+        LOG_DEBUG(m_log, "Loaded {} compression dictionaries for {}", m_ddicts.size(), m_name);
+}
+
+bool ValueCompressor::isCompressed(std::string_view stored)
+{
+    return !stored.empty() && static_cast<std::uint8_t>(stored[0]) == FormatZstd;
+}
+
+std::string ValueCompressor::encode(std::string_view data) const
+{
+    std::string plain;
+    plain.reserve(data.size() + 1);
+    plain.append(data);
+    plain.push_back('\0');
+
+    if (data.size() < MinCompressSize)
+        return plain;
+
+    std::string result;
+    result.resize(1 + ZSTD_compressBound(data.size()));
+    result[0] = static_cast<char>(FormatZstd);
+
+    std::size_t csize;
+    {
+        std::shared_lock lock(m_mutex);
+        auto cctx = threadCompressionContext();
+        if (m_cdict != nullptr)
+            csize = ZSTD_compress_usingCDict(
+                cctx, result.data() + 1, result.size() - 1, data.data(), data.size(), m_cdict);
+        else
+            csize = ZSTD_compressCCtx(
+                cctx, result.data() + 1, result.size() - 1, data.data(), data.size(), CompressionLevel);
+    }
+    if (ZSTD_isError(csize))
+        throw std::runtime_error(
+            std::format("Unable to compress value for '{}': {}", m_name, ZSTD_getErrorName(csize)));
+
+    // only keep the compressed value if it actually saves space
+    if (csize + 1 >= plain.size())
+        return plain;
+
+    result.resize(csize + 1);
+    return result;
+}
+
+std::string ValueCompressor::decode(std::string_view stored) const
+{
+    if (!isCompressed(stored)) {
+        // legacy plain values, which carry a terminating NUL
+        if (!stored.empty() && stored.back() == '\0')
+            stored.remove_suffix(1);
+        return std::string(stored);
+    }
+
+    const auto frame = stored.substr(1);
+    const auto contentSize = ZSTD_getFrameContentSize(frame.data(), frame.size());
+    if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize == ZSTD_CONTENTSIZE_UNKNOWN)
+        throw std::runtime_error(std::format("Compressed value in '{}' is corrupt.", m_name));
+
+    std::string result;
+    result.resize(contentSize);
+
+    std::size_t dsize;
+    const auto dictId = ZSTD_getDictID_fromFrame(frame.data(), frame.size());
+    {
+        std::shared_lock lock(m_mutex);
+        auto dctx = threadDecompressionContext();
+        if (dictId == 0) {
+            dsize = ZSTD_decompressDCtx(dctx, result.data(), result.size(), frame.data(), frame.size());
+        } else {
+            const auto it = m_ddicts.find(dictId);
+            if (it == m_ddicts.end())
+                throw std::runtime_error(
+                    std::format("Compressed value in '{}' needs unknown dictionary {}.", m_name, dictId));
+            dsize = ZSTD_decompress_usingDDict(
+                dctx, result.data(), result.size(), frame.data(), frame.size(), it->second);
+        }
+    }
+    if (ZSTD_isError(dsize))
+        throw std::runtime_error(
+            std::format("Unable to decompress value in '{}': {}", m_name, ZSTD_getErrorName(dsize)));
+
+    result.resize(dsize);
+    return result;
+}
+
+void ValueCompressor::rebuild(MDB_env *env, MDB_dbi dataDbi, MDB_dbi dictDbi)
+{
+    MDB_txn *txn = nullptr;
+    MDB_cursor *cur = nullptr;
+
+    // collect an evenly spread sample of values to train the dictionary with
+    std::string samples;
+    std::vector<std::size_t> sampleSizes;
+
+    auto rc = mdb_txn_begin(env, nullptr, MDB_RDONLY, &txn);
+    checkMdbError(rc, "mdb_txn_begin");
+    try {
+        MDB_stat stat;
+        rc = mdb_stat(txn, dataDbi, &stat);
+        checkMdbError(rc, "mdb_stat");
+        const std::size_t stride = std::max<std::size_t>(1, stat.ms_entries / MaxTrainingSamples);
+
+        rc = mdb_cursor_open(txn, dataDbi, &cur);
+        checkMdbError(rc, "mdb_cursor_open");
+
+        MDB_val dkey;
+        MDB_val dval;
+        std::size_t index = 0;
+        while (mdb_cursor_get(cur, &dkey, &dval, MDB_NEXT) == 0) {
+            if (index++ % stride != 0)
+                continue;
+
+            const auto value = decode(rawDbValueView(dval));
+            if (value.size() < MinCompressSize)
+                continue;
+            if (samples.size() + value.size() > MaxTrainingDataSize)
+                break;
+            samples.append(value);
+            sampleSizes.push_back(value.size());
+        }
+
+        mdb_cursor_close(cur);
+        cur = nullptr;
+        mdb_txn_abort(txn);
+        txn = nullptr;
+    } catch (...) {
+        if (cur)
+            mdb_cursor_close(cur);
+        mdb_txn_abort(txn);
+        throw;
+    }
+
+    std::string dict;
+    dict.resize(DictionarySize);
+    const auto dictLen = ZDICT_trainFromBuffer(
+        dict.data(), dict.size(), samples.data(), sampleSizes.data(), static_cast<unsigned>(sampleSizes.size()));
+    if (ZDICT_isError(dictLen)) {
+        // this happens if there is too little data, in which case a dictionary would not help anyway
+        LOG_INFO(
+            m_log,
+            "Not training a compression dictionary for {} ({} samples): {}",
+            m_name,
+            sampleSizes.size(),
+            ZDICT_getErrorName(dictLen));
+        return;
+    }
+    dict.resize(dictLen);
+    samples.clear();
+    samples.shrink_to_fit();
+
+    const auto dictId = ZDICT_getDictID(dict.data(), dict.size());
+    LOG_INFO(
+        m_log, "Trained compression dictionary {} for {} from {} samples", dictId, m_name, sampleSizes.size());
+
+    // store the new dictionary and make it the current one
+    rc = mdb_txn_begin(env, nullptr, 0, &txn);
+    checkMdbError(rc, "mdb_txn_begin");
+    try {
+        const auto dictKeyStr = std::format("{}/{}", m_name, dictId);
+        const auto dictIdStr = std::to_string(dictId);
+        MDB_val dkey = makeRawDbValue(dictKeyStr);
+        MDB_val dval = makeRawDbValue(dict);
+        rc = mdb_put(txn, dictDbi, &dkey, &dval, 0);
+        checkMdbError(rc, "mdb_put (dictionary)");
+
+        MDB_val ckey = makeRawDbValue(m_name);
+        MDB_val cval = makeRawDbValue(dictIdStr);
+        rc = mdb_put(txn, dictDbi, &ckey, &cval, 0);
+        checkMdbError(rc, "mdb_put (dictionary)");
+
+        rc = mdb_txn_commit(txn);
+        txn = nullptr;
+        checkMdbError(rc, "mdb_txn_commit");
+    } catch (...) {
+        mdb_txn_abort(txn);
+        throw;
+    }
+    addDictionary(dict, true);
+
+    // rewrite all values with the new dictionary, in batches so we do not hold
+    // the write lock for too long
+    std::unordered_set<std::uint32_t> usedDicts;
+    std::string lastKey;
+    bool done = false;
+    std::size_t rewritten = 0;
+    while (!done) {
+        std::vector<std::pair<std::string, std::string>> batch;
+
+        rc = mdb_txn_begin(env, nullptr, 0, &txn);
+        checkMdbError(rc, "mdb_txn_begin");
+        try {
+            rc = mdb_cursor_open(txn, dataDbi, &cur);
+            checkMdbError(rc, "mdb_cursor_open");
+
+            MDB_val dkey;
+            MDB_val dval;
+            if (lastKey.empty()) {
+                rc = mdb_cursor_get(cur, &dkey, &dval, MDB_FIRST);
+            } else {
+                dkey = makeRawDbValue(lastKey);
+                rc = mdb_cursor_get(cur, &dkey, &dval, MDB_SET_RANGE);
+                if (rc == 0 && rawDbValueView(dkey) == lastKey)
+                    rc = mdb_cursor_get(cur, &dkey, &dval, MDB_NEXT);
+            }
+
+            std::size_t count = 0;
+            while (rc == 0 && count < RecompressBatchSize) {
+                const auto stored = rawDbValueView(dval);
+                const auto encoded = encode(decode(stored));
+                if (isCompressed(encoded))
+                    usedDicts.insert(ZSTD_getDictID_fromFrame(encoded.data() + 1, encoded.size() - 1));
+                lastKey = std::string(rawDbValueView(dkey));
+                if (encoded != stored)
+                    batch.emplace_back(lastKey, encoded);
+
+                count++;
+                rc = mdb_cursor_get(cur, &dkey, &dval, MDB_NEXT);
+            }
+            if (rc == MDB_NOTFOUND)
+                done = true;
+            else if (rc != 0)
+                checkMdbError(rc, "mdb_cursor_get");
+            mdb_cursor_close(cur);
+            cur = nullptr;
+
+            for (const auto &[key, value] : batch) {
+                MDB_val pkey = makeRawDbValue(key);
+                MDB_val pval = makeRawDbValue(value);
+                rc = mdb_put(txn, dataDbi, &pkey, &pval, 0);
+                checkMdbError(rc, "mdb_put");
+            }
+
+            rc = mdb_txn_commit(txn);
+            txn = nullptr;
+            checkMdbError(rc, "mdb_txn_commit");
+        } catch (...) {
+            if (cur)
+                mdb_cursor_close(cur);
+            mdb_txn_abort(txn);
+            throw;
+        }
+
+        rewritten += batch.size();
+    }
+
+    // drop dictionaries that no value needs anymore
+    const auto prefix = m_name + "/";
+    std::vector<std::uint32_t> droppedDicts;
+    rc = mdb_txn_begin(env, nullptr, 0, &txn);
+    checkMdbError(rc, "mdb_txn_begin");
+    try {
+        rc = mdb_cursor_open(txn, dictDbi, &cur);
+        checkMdbError(rc, "mdb_cursor_open (dictionaries)");
+
+        MDB_val dkey = makeRawDbValue(prefix);
+        MDB_val dval;
+        rc = mdb_cursor_get(cur, &dkey, &dval, MDB_SET_RANGE);
+        while (rc == 0 && rawDbValueView(dkey).starts_with(prefix)) {
+            const auto id = ZDICT_getDictID(dval.mv_data, dval.mv_size);
+            if (id != dictId && !usedDicts.contains(id)) {
+                rc = mdb_cursor_del(cur, 0);
+                checkMdbError(rc, "mdb_cursor_del (dictionaries)");
+                droppedDicts.push_back(id);
+                rc = mdb_cursor_get(cur, &dkey, &dval, MDB_GET_CURRENT);
+            } else {
+                rc = mdb_cursor_get(cur, &dkey, &dval, MDB_NEXT);
+            }
+        }
+        if (rc != 0 && rc != MDB_NOTFOUND)
+            checkMdbError(rc, "mdb_cursor_get (dictionaries)");
+        mdb_cursor_close(cur);
+        cur = nullptr;
+
+        rc = mdb_txn_commit(txn);
+        txn = nullptr;
+        checkMdbError(rc, "mdb_txn_commit");
+    } catch (...) {
+        if (cur)
+            mdb_cursor_close(cur);
+        mdb_txn_abort(txn);
+        throw;
+    }
+
+    {
+        std::unique_lock lock(m_mutex);
+        for (const auto id : droppedDicts) {
+            auto it = m_ddicts.find(id);
+            if (it == m_ddicts.end())
+                continue;
+            ZSTD_freeDDict(it->second);
+            m_ddicts.erase(it);
+        }
+    }
+
+    LOG_INFO(
+        m_log,
+        "Recompressed {} values of {}, dropped {} old dictionaries",
+        rewritten,
+        m_name,
+        droppedDicts.size());
+}
+
+} // namespace ASGenerator
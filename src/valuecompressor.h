@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * Licensed under the GNU Lesser General Public License Version 3
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the license, or
+ * (at your option) any later version.
+ *
+ * This software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this software.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <shared_mutex>
+#include <cstdint>
+#include <lmdb.h>
+#include <zstd.h>
+
+#include "logging.h"
+
+namespace ASGenerator
+{
+
+/**
+ * Transparent compression for the values of one LMDB database.
+ *
+ * A value is stored either as plain text with a terminating NUL, which is how all values
+ * were stored before compression was added, or as a format header byte followed by a zstd
+ * frame. Frames record the ID of the dictionary they were compressed with, so values stay
+ * readable for as long as their dictionary is kept in the database.
+ */
+class ValueCompressor
+{
+public:
+    /// Header byte of values that are stored as zstd frame
+    static constexpr std::uint8_t FormatZstd = 0x01;
+
+    /**
+     * @param name Name of the database whose values we compress, used to find its dictionaries.
+     */
+    explicit ValueCompressor(std::string name);
+    ~ValueCompressor();
+
+    const std::string &name() const;
+
+    /**
+     * Load the dictionaries of our database from @dictDbi, replacing any we had before.
+     */
+    void loadDictionaries(MDB_txn *txn, MDB_dbi dictDbi);
+
+    /**
+     * Encode @data into the representation that is stored in the database.
+     */
+    std::string encode(std::string_view data) const;
+
+    /**
+     * Check if the stored value @stored is compressed. Values that are not
+     * can be used as they are, minus their terminating NUL.
+     */
+    static bool isCompressed(std::string_view stored);
+
+    /**
+     * Decode the stored value @stored.
+     */
+    std::string decode(std::string_view stored) const;
+
+    /**
+     * Train a new dictionary from the values in @dataDbi and rewrite all of them with it.
+     * Dictionaries no value refers to anymore are dropped afterwards.
+     *
+     * Other processes that have the database open will not know about the new dictionary,
+     * so this must not run while the generator is processing data.
+     */
+    void rebuild(MDB_env *env, MDB_dbi dataDbi, MDB_dbi dictDbi);
+
+    // Delete copy constructor and assignment operator
+    ValueCompressor(const ValueCompressor &) = delete;
+    ValueCompressor &operator=(const ValueCompressor &) = delete;
+
+private:
+    quill::Logger *m_log;
+    std::string m_name;
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::uint32_t, ZSTD_DDict *> m_ddicts;
+    ZSTD_CDict *m_cdict;
+
+    void addDictionary(std::string_view dict, bool makeCurrent);
+    void clearDictionaries();
+};
+
+} // namespace ASGenerator
@@ -26,6 +26,7 @@
 #include <fstream>
 #include <filesystem>
 #include <regex>
+#include <unordered_set>
 #include <vector>
 #include <string>
 #include <optional>
@@ -36,6 +37,8 @@
 
 #include "utils.h"
 #include "logging.h"
+#include "instrumentation.h"
+#include "archiveindex.h"
 
 namespace ASGenerator
 {
@@ -158,6 +161,15 @@ void ArchiveDecompressor::open(const std::string &fname, const fs::path &tmpDir)
 {
     m_archiveFname = fname;
     m_isExtractedToTmp = false;
+    m_batchData.clear();
+    m_seekIndex.reset();
+    m_seekIndexTried = false;
+
+    // a seek index is cached next to an explicitly given temporary directory, so it survives
+    // the archive being closed and opened again
+    m_seekIndexFname.clear();
+    if (!tmpDir.empty())
+        m_seekIndexFname = tmpDir.parent_path() / std::format("{}.idx", fs::path(fname).filename().string());
 
     m_tmpDir = tmpDir;
     if (m_tmpDir.empty())
@@ -184,6 +196,8 @@ bool ArchiveDecompressor::isOpen() const
 void ArchiveDecompressor::close()
 {
     m_archiveFname.clear();
+    m_batchData.clear();
+    m_seekIndex.reset();
     cleanupTempDirectory();
 }
 
@@ -204,6 +218,47 @@ size_t ArchiveDecompressor::getArchiveSize() const
     }
 }
 
+bool ArchiveDecompressor::seekIndexIfPossible()
+{
+    if (m_seekIndex)
+        return true;
+    if (m_seekIndexTried || m_isExtractedToTmp || !m_canExtractToTmp || !m_optimizeRepeatedReads)
+        return false;
+    m_seekIndexTried = true;
+
+    const auto p = fs::path(m_archiveFname);
+    const auto displayName = (p.parent_path().filename() / p.filename()).string();
+    try {
+        if (!m_seekIndexFname.empty())
+            m_seekIndex = ArchiveIndex::load(m_seekIndexFname, m_archiveFname);
+        if (m_seekIndex)
+            return true;
+
+        m_seekIndex = ArchiveIndex::build(m_archiveFname);
+    } catch (const std::exception &e) {
+        LOG_DEBUG(logRoot, "Unable to index archive '{}' for seeking: {}", displayName, e.what());
+        m_seekIndex.reset();
+    }
+    if (!m_seekIndex)
+        return false;
+    LOG_DEBUG(
+        logRoot,
+        "Indexed archive '{}' for seeking ({} entries, {} checkpoints)",
+        displayName,
+        m_seekIndex->entryCount(),
+        m_seekIndex->checkpointCount());
+
+    if (!m_seekIndexFname.empty()) {
+        try {
+            m_seekIndex->save(m_seekIndexFname);
+        } catch (const std::exception &e) {
+            LOG_WARNING(logRoot, "Unable to save seek index for '{}': {}", displayName, e.what());
+        }
+    }
+
+    return true;
+}
+
 bool ArchiveDecompressor::tmpExtractIfPossible()
 {
     if (m_isExtractedToTmp)
@@ -248,24 +303,27 @@ bool ArchiveDecompressor::pathMatches(const std::string &path1, const std::strin
     if (path1 == path2)
         return true;
 
-    const auto abs1 = (fs::path("/") / path1).lexically_normal();
-    const auto abs2 = (fs::path("/") / path2).lexically_normal();
-
-    return abs1 == abs2;
+    return normalizedEntryPath(path1) == normalizedEntryPath(path2);
 }
 
-std::vector<uint8_t> ArchiveDecompressor::readEntry(archive *ar)
+std::vector<uint8_t> ArchiveDecompressor::readEntry(archive *ar, archive_entry *en)
 {
     const void *buff = nullptr;
     size_t size = 0;
     int64_t offset = 0;
     std::vector<uint8_t> result;
 
+    // the size is not known for every format, so it is only a hint
+    const auto entrySize = archive_entry_size_is_set(en) ? archive_entry_size(en) : 0;
+    if (entrySize > 0)
+        result.reserve(static_cast<size_t>(entrySize));
+
     while (archive_read_data_block(ar, &buff, &size, &offset) == ARCHIVE_OK) {
         const auto ptr = static_cast<const uint8_t *>(buff);
         result.insert(result.end(), ptr, ptr + size);
     }
 
+    Instrumentation::get().count(PerfCounter::BytesDecompressed, result.size());
     return result;
 }
 
@@ -301,6 +359,8 @@ void ArchiveDecompressor::extractEntryTo(archive *ar, const std::string &fname)
             size -= bytes_to_write;
         }
     }
+
+    Instrumentation::get().count(PerfCounter::BytesDecompressed, static_cast<std::uint64_t>(output_offset));
 }
 
 archive *ArchiveDecompressor::openArchive()
@@ -326,6 +386,24 @@ archive *ArchiveDecompressor::openArchive()
 
 bool ArchiveDecompressor::extractFileTo(const std::string &fname, const std::string &fdest)
 {
+    ScopedTimer timer(PerfStage::ArchiveExtract);
+
+    // Try optimization: if the archive is indexed, only decompress the part we need
+    if (seekIndexIfPossible()) {
+        const auto data = m_seekIndex->readFile(fname);
+        if (!data.has_value())
+            return false; // File not found in archive
+        Instrumentation::get().count(PerfCounter::BytesDecompressed, data->size());
+
+        fs::create_directories(fs::path(fdest).parent_path());
+        std::ofstream f(fdest, std::ios::binary | std::ios::trunc);
+        if (!f)
+            throw std::runtime_error(std::format("Failed to open file for writing: {}", fdest));
+        f.write(reinterpret_cast<const char *>(data->data()), static_cast<std::streamsize>(data->size()));
+
+        return true;
+    }
+
     // Try optimization: if fully extracted, copy from filesystem
     if (tmpExtractIfPossible()) {
         fs::path extractedPath = m_tmpDir / fs::path(fname).relative_path();
@@ -364,6 +442,8 @@ bool ArchiveDecompressor::extractFileTo(const std::string &fname, const std::str
 
 void ArchiveDecompressor::extractArchive(const std::string &dest)
 {
+    ScopedTimer timer(PerfStage::ArchiveExtract);
+
     if (!fs::is_directory(dest))
         throw std::runtime_error(std::format("Destination is not a directory: {}", dest));
 
@@ -436,6 +516,25 @@ void ArchiveDecompressor::extractArchive(const std::string &dest)
 
 std::vector<uint8_t> ArchiveDecompressor::readData(const std::string &fname)
 {
+    ScopedTimer timer(PerfStage::ArchiveExtract);
+
+    // we may have read this file as part of a batch already
+    if (!m_batchData.empty()) {
+        const auto it = m_batchData.find(normalizedEntryPath(fname));
+        if (it != m_batchData.end())
+            return it->second;
+    }
+
+    // Try optimization: if the archive is indexed, only decompress the part we need
+    if (seekIndexIfPossible()) {
+        auto data = m_seekIndex->readFile(fname);
+        if (!data.has_value())
+            throw std::runtime_error(std::format("File '{}' was not found in the archive.", fname));
+        Instrumentation::get().count(PerfCounter::BytesDecompressed, data->size());
+
+        return std::move(*data);
+    }
+
     // Try optimization: if fully extracted, read from filesystem
     if (tmpExtractIfPossible()) {
         fs::path extractedPath = m_tmpDir / fs::path(fname).relative_path();
@@ -510,7 +609,7 @@ std::vector<uint8_t> ArchiveDecompressor::readData(const std::string &fname)
                 return {};
             }
 
-            return readEntry(ar.get());
+            return readEntry(ar.get(), en);
 
         } else {
             archive_read_data_skip(ar.get());
@@ -520,8 +619,116 @@ std::vector<uint8_t> ArchiveDecompressor::readData(const std::string &fname)
     throw std::runtime_error(std::format("File '{}' was not found in the archive.", fname));
 }
 
+std::unordered_map<std::string, std::vector<uint8_t>> ArchiveDecompressor::readDataBatch(
+    const std::set<std::string> &fnames)
+{
+    ScopedTimer timer(PerfStage::ArchiveExtract);
+    std::unordered_map<std::string, std::vector<uint8_t>> result;
+
+    // paths we still need data for, with the names they were requested by and
+    // the paths of the links that lead to them
+    struct WantedPath {
+        std::vector<std::string> names;
+        std::vector<std::string> links;
+    };
+    std::unordered_map<std::string, WantedPath> wanted;
+    for (const auto &fname : fnames) {
+        const auto path = normalizedEntryPath(fname);
+        const auto it = m_batchData.find(path);
+        if (it != m_batchData.end())
+            result[fname] = it->second;
+        else
+            wanted[path].names.push_back(fname);
+    }
+    if (wanted.empty())
+        return result;
+
+    // reading from the index or the extracted archive is cheap anyway
+    if (seekIndexIfPossible() || tmpExtractIfPossible()) {
+        for (const auto &[path, entry] : wanted) {
+            try {
+                auto data = readData(path);
+                for (const auto &name : entry.names)
+                    result[name] = data;
+            } catch (const std::exception &) {
+                // the file does not exist, which callers find out by its absence from the result
+            }
+        }
+        return result;
+    }
+
+    const auto storeData = [&](const std::string &path, const WantedPath &entry, std::vector<uint8_t> data) {
+        for (const auto &name : entry.names)
+            result[name] = data;
+        for (const auto &link : entry.links)
+            m_batchData[link] = data;
+        m_batchData[path] = std::move(data);
+    };
+
+    // Links are resolved on the fly if their target follows them in the archive. Hardlinks
+    // (and some symlinks) point backwards though, so we may need another pass for those.
+    constexpr int maxPasses = 4;
+    for (int pass = 0; pass < maxPasses && !wanted.empty(); pass++) {
+        std::unordered_set<std::string> linkTargets;
+
+        archive_entry *en = nullptr;
+        ArchivePtr ar(openArchive(), archive_read_free);
+        while (!wanted.empty() && archive_read_next_header(ar.get(), &en) == ARCHIVE_OK) {
+            const auto path = normalizedEntryPath(archive_entry_pathname(en));
+            const auto it = wanted.find(path);
+            if (it == wanted.end()) {
+                archive_read_data_skip(ar.get());
+                continue;
+            }
+            auto entry = std::move(it->second);
+            wanted.erase(it);
+
+            const auto filetype = archive_entry_filetype(en);
+            std::string target;
+            if (filetype == AE_IFLNK) {
+                const char *linkTarget = archive_entry_symlink(en);
+                if (linkTarget == nullptr)
+                    continue;
+                target = fs::path(linkTarget).is_absolute()
+                             ? normalizedEntryPath(linkTarget)
+                             : normalizedEntryPath((fs::path(path).parent_path() / linkTarget).string());
+            } else if (archive_entry_size(en) == 0 && archive_entry_hardlink(en) != nullptr) {
+                target = normalizedEntryPath(archive_entry_hardlink(en));
+            } else if (filetype == AE_IFREG) {
+                storeData(path, entry, readEntry(ar.get(), en));
+                continue;
+            } else {
+                // directories and special files are never read
+                continue;
+            }
+
+            const auto dataIt = m_batchData.find(target);
+            if (dataIt != m_batchData.end()) {
+                storeData(path, entry, dataIt->second);
+                continue;
+            }
+
+            // look for the target instead, in this pass if it is still ahead of us
+            auto &targetEntry = wanted[target];
+            targetEntry.names.insert(targetEntry.names.end(), entry.names.begin(), entry.names.end());
+            targetEntry.links.insert(targetEntry.links.end(), entry.links.begin(), entry.links.end());
+            targetEntry.links.push_back(path);
+            linkTargets.insert(target);
+        }
+
+        // only link targets are worth another pass, anything else is not in the archive
+        std::erase_if(wanted, [&linkTargets](const auto &item) {
+            return !linkTargets.contains(item.first);
+        });
+    }
+
+    return result;
+}
+
 std::vector<std::string> ArchiveDecompressor::extractFilesByRegex(const std::regex &re, const std::string &destdir)
 {
+    ScopedTimer timer(PerfStage::ArchiveExtract);
+
     archive_entry *en = nullptr;
     std::vector<std::string> matches;
     ArchivePtr ar(openArchive(), archive_read_free);
@@ -542,6 +749,8 @@ std::vector<std::string> ArchiveDecompressor::extractFilesByRegex(const std::reg
 
 std::vector<std::string> ArchiveDecompressor::readContents()
 {
+    ScopedTimer timer(PerfStage::ArchiveExtract);
+
     archive_entry *en = nullptr;
     std::vector<std::string> contents;
     ArchivePtr ar(openArchive(), archive_read_free);
@@ -597,7 +806,7 @@ std::generator<ArchiveDecompressor::ArchiveEntry> ArchiveDecompressor::read()
             continue;
         }
 
-        entry.data = readEntry(ar.get());
+        entry.data = readEntry(ar.get(), en);
         co_yield entry;
     }
 }
@@ -612,6 +821,8 @@ std::generator<ArchiveDecompressor::ArchiveEntry> ArchiveDecompressor::read()
  */
 void compressAndSave(const std::vector<uint8_t> &data, const std::string &fname, ArchiveType atype)
 {
+    ScopedTimer timer(PerfStage::ExportCompress);
+
     ArchivePtr ar(archive_write_new(), archive_write_free);
 
     archive_write_set_format_raw(ar.get());
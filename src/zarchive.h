@@ -25,9 +25,15 @@
 #include <optional>
 #include <regex>
 #include <mutex>
+#include <memory>
+#include <set>
+#include <unordered_map>
 #include <generator>
 
+#include "archiveindex.h"
+
 struct archive;
+struct archive_entry;
 
 namespace ASGenerator
 {
@@ -58,10 +64,13 @@ public:
     void close();
 
     /**
-     * If this is set to true, and the archive is large, it will be extracted to a
-     * temporary location and entries read from there. This avoids repeatedly
-     * seeking through the archive to extract data if readData() and extractFileTo()
-     * are used a lot. Repeated seeking is slower than temporary extraction.
+     * If this is set to true, and the archive is large, it will be indexed so
+     * individual entries can be decompressed without reading the archive from its
+     * beginning. The index is cached next to the temporary directory, if one was given.
+     * If the archive can not be indexed, it is extracted to a temporary location and
+     * entries are read from there instead.
+     * This avoids repeatedly seeking through the archive to extract data if readData()
+     * and extractFileTo() are used a lot.
      *
      * @param enable Enable or disable optimization for repeated reads.
      */
@@ -70,6 +79,17 @@ public:
     bool extractFileTo(const std::string &fname, const std::string &fdest);
     void extractArchive(const std::string &dest);
     std::vector<uint8_t> readData(const std::string &fname);
+
+    /**
+     * Read the data of all files in @fnames in a single pass over the archive, resolving
+     * symbolic links and hardlinks on the way.
+     * The data is kept in memory, so later calls to readData() for these files are served
+     * without touching the archive again.
+     *
+     * @return The data of every file that was found, by the name it was requested with.
+     */
+    std::unordered_map<std::string, std::vector<uint8_t>> readDataBatch(const std::set<std::string> &fnames);
+
     std::vector<std::string> extractFilesByRegex(const std::regex &re, const std::string &destdir);
     std::vector<std::string> readContents();
     std::generator<ArchiveEntry> read();
@@ -82,10 +102,18 @@ private:
     bool m_optimizeRepeatedReads = false;
     bool m_isExtractedToTmp = false;
 
+    // file data read by readDataBatch(), by normalized absolute path
+    std::unordered_map<std::string, std::vector<uint8_t>> m_batchData;
+
+    std::unique_ptr<ArchiveIndex> m_seekIndex;
+    fs::path m_seekIndexFname;
+    bool m_seekIndexTried = false;
+
     bool pathMatches(const std::string &path1, const std::string &path2) const;
-    std::vector<uint8_t> readEntry(struct archive *ar);
+    std::vector<uint8_t> readEntry(struct archive *ar, struct archive_entry *en);
     void extractEntryTo(struct archive *ar, const std::string &fname);
     struct archive *openArchive();
+    bool seekIndexIfPossible();
     bool tmpExtractIfPossible();
     void cleanupTempDirectory();
     size_t getArchiveSize() const;
@@ -0,0 +1,535 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "bench-archivegen.h"
+
+#include <format>
+#include <fstream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include <glib.h>
+
+#include "utils.h"
+#include "zarchive.h"
+
+namespace ASGenerator
+{
+
+enum class SyntheticKind {
+    DesktopApp,
+    IconTheme,
+    Font,
+    LargePayload,
+    Plain
+};
+
+/**
+ * A package of the synthetic archive, with the contents of its files by their installed path.
+ */
+struct SyntheticPackage {
+    std::string name;
+    SyntheticKind kind;
+    std::string summary;
+    std::map<std::string, std::string> files;
+};
+
+static const std::vector<std::string> SyntheticLocales =
+    {"de", "fr", "es", "it", "pt_BR", "ja", "ru", "pl", "nl", "sv", "cs", "uk", "zh_CN", "fi", "da", "tr"};
+
+static const std::string_view SyntheticVersion = "1.0-1";
+
+static std::string readFileData(const fs::path &fname)
+{
+    std::ifstream f(fname, std::ios::binary);
+    if (!f)
+        throw std::runtime_error(std::format("Unable to read {}", fname.string()));
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+static void writeFileData(const fs::path &fname, std::string_view data)
+{
+    fs::create_directories(fname.parent_path());
+    std::ofstream f(fname, std::ios::binary | std::ios::trunc);
+    f.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!f)
+        throw std::runtime_error(std::format("Unable to write {}", fname.string()));
+}
+
+static void appendU32LE(std::string &buf, std::uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        buf += static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+static void appendU32BE(std::string &buf, std::uint32_t value)
+{
+    for (int i = 3; i >= 0; i--)
+        buf += static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+static std::uint32_t pngCrc32(std::string_view data)
+{
+    std::uint32_t crc = 0xFFFFFFFF;
+    for (const auto c : data) {
+        crc ^= static_cast<unsigned char>(c);
+        for (int k = 0; k < 8; k++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+
+    return ~crc;
+}
+
+/**
+ * Make a unique variant of the PNG image @png, by adding a text chunk containing @tag to it.
+ */
+static std::string uniquePng(const std::string &png, const std::string &tag)
+{
+    // the image has to end with an IEND chunk: length, type and CRC, without any data
+    constexpr std::size_t iendSize = 12;
+    if (png.size() < 8 + iendSize || png.compare(png.size() - 8, 4, "IEND") != 0)
+        return png;
+
+    std::string chunkData = "Comment";
+    chunkData += '\0';
+    chunkData += tag;
+
+    std::string chunk;
+    appendU32BE(chunk, static_cast<std::uint32_t>(chunkData.size()));
+    chunk += "tEXt";
+    chunk += chunkData;
+    appendU32BE(chunk, pngCrc32(std::string_view(chunk).substr(4)));
+
+    std::string res = png;
+    res.insert(res.size() - iendSize, chunk);
+    return res;
+}
+
+/**
+ * Create a GNU gettext message catalog containing @messages, without hash table.
+ */
+static std::string makeMoCatalog(const std::map<std::string, std::string> &messages)
+{
+    // std::map keeps the messages sorted by their ID, as the format requires
+    const auto count = static_cast<std::uint32_t>(messages.size());
+    const std::uint32_t origTabOffset = 28;
+    const std::uint32_t transTabOffset = origTabOffset + count * 8;
+    const std::uint32_t stringsOffset = transTabOffset + count * 8;
+
+    std::string origTable;
+    std::string transTable;
+    std::string strings;
+    for (const auto &[msgid, _] : messages) {
+        appendU32LE(origTable, static_cast<std::uint32_t>(msgid.size()));
+        appendU32LE(origTable, static_cast<std::uint32_t>(stringsOffset + strings.size()));
+        strings += msgid;
+        strings += '\0';
+    }
+    for (const auto &[_, msgstr] : messages) {
+        appendU32LE(transTable, static_cast<std::uint32_t>(msgstr.size()));
+        appendU32LE(transTable, static_cast<std::uint32_t>(stringsOffset + strings.size()));
+        strings += msgstr;
+        strings += '\0';
+    }
+
+    std::string res;
+    appendU32LE(res, 0x950412de);
+    appendU32LE(res, 0);
+    appendU32LE(res, count);
+    appendU32LE(res, origTabOffset);
+    appendU32LE(res, transTabOffset);
+    appendU32LE(res, 0);
+    appendU32LE(res, stringsOffset);
+    res += origTable;
+    res += transTable;
+    res += strings;
+
+    return res;
+}
+
+static std::string randomBytes(std::mt19937 &rng, std::size_t size)
+{
+    std::string res;
+    res.resize(size);
+    for (std::size_t i = 0; i < size; i += 4) {
+        const auto value = rng();
+        for (std::size_t j = 0; j < 4 && i + j < size; j++)
+            res[i + j] = static_cast<char>((value >> (8 * j)) & 0xFF);
+    }
+
+    return res;
+}
+
+static std::string appComponentId(std::size_t index)
+{
+    return std::format("org.example.BenchApp{}", index);
+}
+
+static void addDesktopApp(
+    SyntheticPackage &pkg,
+    std::size_t index,
+    const SyntheticArchiveSpec &spec,
+    const std::string &iconData,
+    bool localized,
+    bool themedIcon,
+    std::mt19937 &rng)
+{
+    const auto cid = appComponentId(index);
+    const auto appName = std::format("Bench App {}", index);
+    const auto iconName = themedIcon ? std::format("bench-themed-{}", index % spec.iconsPerTheme) : cid;
+
+    pkg.files[std::format("/usr/share/applications/{}.desktop", cid)] = std::format(
+        "[Desktop Entry]\n"
+        "Type=Application\n"
+        "Name={}\n"
+        "Comment=Synthetic application number {}\n"
+        "Exec={}\n"
+        "Icon={}\n"
+        "Categories=Utility;\n",
+        appName,
+        index,
+        pkg.name,
+        iconName);
+
+    std::string translation;
+    if (localized)
+        translation = std::format("  <translation type=\"gettext\">{}</translation>\n", pkg.name);
+    pkg.files[std::format("/usr/share/metainfo/{}.metainfo.xml", cid)] = std::format(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<component type=\"desktop-application\">\n"
+        "  <id>{0}</id>\n"
+        "  <metadata_license>CC0-1.0</metadata_license>\n"
+        "  <project_license>GPL-3.0-or-later</project_license>\n"
+        "  <name>{1}</name>\n"
+        "  <summary>Synthetic application for benchmarks</summary>\n"
+        "  <description>\n"
+        "    <p>{1} is generated for benchmarking the metadata generator.</p>\n"
+        "    <p>It does nothing useful at all.</p>\n"
+        "  </description>\n"
+        "  <launchable type=\"desktop-id\">{0}.desktop</launchable>\n"
+        "  <developer id=\"org.example\">\n"
+        "    <name>Example Developers</name>\n"
+        "  </developer>\n"
+        "  <url type=\"homepage\">https://example.org/bench-app-{2}</url>\n"
+        "{3}"
+        "  <releases>\n"
+        "    <release version=\"1.0\" date=\"2026-01-01\"/>\n"
+        "  </releases>\n"
+        "</component>\n",
+        cid,
+        appName,
+        index,
+        translation);
+
+    if (!themedIcon)
+        pkg.files[std::format("/usr/share/icons/hicolor/128x128/apps/{}.png", cid)] = uniquePng(iconData, cid);
+
+    if (localized) {
+        for (std::size_t i = 0; i < spec.localesPerApp; i++) {
+            const auto &locale = SyntheticLocales[i % SyntheticLocales.size()];
+
+            // translate a different share of the messages for every locale
+            std::map<std::string, std::string> messages;
+            messages[""] = "Content-Type: text/plain; charset=UTF-8\n";
+            messages[appName] = std::format("[{}] {}", locale, appName);
+            const std::size_t msgCount = 40;
+            const std::size_t translated = msgCount - (i * 5) % msgCount;
+            for (std::size_t j = 0; j < translated; j++)
+                messages[std::format("Message {} of {}", j, pkg.name)] = std::format("[{}] Message {}", locale, j);
+
+            pkg.files[std::format("/usr/share/locale/{}/LC_MESSAGES/{}.mo", locale, pkg.name)] = makeMoCatalog(
+                messages);
+        }
+    }
+
+    pkg.files[std::format("/usr/bin/{}", pkg.name)] = randomBytes(rng, 16 * 1024);
+}
+
+static void addIconTheme(
+    SyntheticPackage &pkg,
+    const std::string &themeName,
+    const SyntheticArchiveSpec &spec,
+    const std::string &iconData)
+{
+    static const std::vector<std::string> sizes = {"48x48", "64x64", "128x128"};
+
+    std::string index = std::format("[Icon Theme]\nName={}\nComment=Synthetic icon theme\nDirectories=", themeName);
+    for (std::size_t i = 0; i < sizes.size(); i++)
+        index += std::format("{}{}/apps", i == 0 ? "" : ",", sizes[i]);
+    index += "\n";
+    for (const auto &size : sizes)
+        index += std::format("\n[{}/apps]\nSize={}\nContext=Applications\nType=Fixed\n", size, size.substr(0, size.find('x')));
+    pkg.files[std::format("/usr/share/icons/{}/index.theme", themeName)] = index;
+
+    for (std::size_t i = 0; i < spec.iconsPerTheme; i++) {
+        for (const auto &size : sizes) {
+            const auto fname = std::format("/usr/share/icons/{}/{}/apps/bench-themed-{}.png", themeName, size, i);
+            pkg.files[fname] = uniquePng(iconData, fname);
+        }
+    }
+}
+
+static void addFont(SyntheticPackage &pkg, std::size_t index, const std::string &fontData)
+{
+    const auto fontName = std::format("Bench Sans {}", index);
+    pkg.files[std::format("/usr/share/fonts/truetype/bench-{}/BenchSans{}-Regular.ttf", index, index)] = fontData;
+    pkg.files[std::format("/usr/share/metainfo/org.example.fonts.BenchSans{}.metainfo.xml", index)] = std::format(
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<component type=\"font\">\n"
+        "  <id>org.example.fonts.BenchSans{0}</id>\n"
+        "  <metadata_license>CC0-1.0</metadata_license>\n"
+        "  <project_license>OFL-1.1</project_license>\n"
+        "  <name>{1}</name>\n"
+        "  <summary>Synthetic font for benchmarks</summary>\n"
+        "  <provides>\n"
+        "    <font>{1}</font>\n"
+        "  </provides>\n"
+        "</component>\n",
+        index,
+        fontName);
+}
+
+static std::string tarFromFiles(
+    const fs::path &stagingDir,
+    const std::string &tarName,
+    const std::map<std::string, std::string> &files)
+{
+    const auto tarFname = stagingDir / tarName;
+    {
+        ArchiveCompressor ac(ArchiveType::GZIP);
+        ac.open(tarFname.string());
+        std::size_t i = 0;
+        for (const auto &[path, data] : files) {
+            const auto tmpFname = stagingDir / std::format("{}-{}", tarName, i++);
+            writeFileData(tmpFname, data);
+            ac.addFile(tmpFname.string(), "." + path);
+            fs::remove(tmpFname);
+        }
+        ac.close();
+    }
+
+    auto data = readFileData(tarFname);
+    fs::remove(tarFname);
+    return data;
+}
+
+static void appendArMember(std::string &ar, const std::string &name, const std::string &data)
+{
+    ar += std::format("{:<16}{:<12}{:<6}{:<6}{:<8}{:<10}`\n", name, 0, 0, 0, 100644, data.size());
+    ar += data;
+    if (data.size() % 2 != 0)
+        ar += '\n';
+}
+
+static std::string controlFields(const SyntheticPackage &pkg, const SyntheticArchiveSpec &spec)
+{
+    std::uint64_t installedSize = 0;
+    for (const auto &[_, data] : pkg.files)
+        installedSize += data.size();
+
+    return std::format(
+        "Package: {}\n"
+        "Version: {}\n"
+        "Architecture: {}\n"
+        "Maintainer: Benchmark Maintainers <bench@example.org>\n"
+        "Installed-Size: {}\n"
+        "Description: {}\n"
+        " This package was generated to benchmark the metadata generator.\n",
+        pkg.name,
+        SyntheticVersion,
+        spec.arch,
+        installedSize / 1024 + 1,
+        pkg.summary);
+}
+
+/**
+ * Build a Debian package for @pkg at @debFname.
+ */
+static void writeDeb(
+    const fs::path &debFname,
+    const fs::path &stagingDir,
+    const SyntheticPackage &pkg,
+    const SyntheticArchiveSpec &spec)
+{
+    std::string md5sums;
+    for (const auto &[path, data] : pkg.files) {
+        g_autofree gchar *md5 = g_compute_checksum_for_data(
+            G_CHECKSUM_MD5, reinterpret_cast<const guchar *>(data.data()), data.size());
+        md5sums += std::format("{}  {}\n", md5, path.substr(1));
+    }
+
+    fs::create_directories(stagingDir);
+    const std::map<std::string, std::string> controlFiles = {
+        {"/control", controlFields(pkg, spec)},
+        {"/md5sums", md5sums                 },
+    };
+    const auto controlTar = tarFromFiles(stagingDir, "control.tar.gz", controlFiles);
+    const auto dataTar = tarFromFiles(stagingDir, "data.tar.gz", pkg.files);
+
+    std::string deb = "!<arch>\n";
+    appendArMember(deb, "debian-binary", "2.0\n");
+    appendArMember(deb, "control.tar.gz", controlTar);
+    appendArMember(deb, "data.tar.gz", dataTar);
+
+    // write under a temporary name, so an interrupted run never leaves a broken package behind
+    const auto tmpFname = debFname.string() + ".new";
+    writeFileData(tmpFname, deb);
+    fs::rename(tmpFname, debFname);
+}
+
+static std::vector<std::uint8_t> toBytes(const std::string &data)
+{
+    return std::vector<std::uint8_t>(data.begin(), data.end());
+}
+
+SyntheticArchiveStats generateSyntheticArchive(const fs::path &root, const SyntheticArchiveSpec &spec)
+{
+    if (spec.iconsPerTheme == 0)
+        throw std::runtime_error("A synthetic archive needs at least one icon per theme.");
+
+    const auto iconData = readFileData(
+        spec.iconSample.empty() ? Utils::getTestSamplesDir() / "appstream-logo.png" : spec.iconSample);
+    std::string fontData;
+    if (!spec.fontSample.empty())
+        fontData = readFileData(spec.fontSample);
+
+    std::mt19937 rng(spec.seed);
+    std::uniform_real_distribution<double> shareDist(0.0, 1.0);
+    if (fontData.empty())
+        fontData = randomBytes(rng, 64 * 1024);
+
+    // decide on the kind of every package first, so the contents don't depend on the archive size
+    std::vector<SyntheticKind> kinds;
+    std::vector<bool> localized;
+    kinds.reserve(spec.packages);
+    for (std::size_t i = 0; i < spec.packages; i++) {
+        const auto roll = shareDist(rng);
+        auto threshold = spec.desktopAppShare;
+        SyntheticKind kind = SyntheticKind::Plain;
+        if (roll < threshold) {
+            kind = SyntheticKind::DesktopApp;
+        } else if (roll < (threshold += spec.iconThemeShare)) {
+            kind = SyntheticKind::IconTheme;
+        } else if (roll < (threshold += spec.fontShare)) {
+            kind = SyntheticKind::Font;
+        } else if (roll < (threshold += spec.largePayloadShare)) {
+            kind = SyntheticKind::LargePayload;
+        }
+        kinds.push_back(kind);
+        localized.push_back(shareDist(rng) < spec.localizedShare);
+    }
+
+    // the first icon theme is always Adwaita, which applications can take their icons from
+    bool haveAdwaita = false;
+    for (const auto kind : kinds) {
+        if (kind == SyntheticKind::IconTheme) {
+            haveAdwaita = true;
+            break;
+        }
+    }
+
+    const auto distDir = root / "dists" / spec.suite;
+    const auto stagingDir = root / ".staging";
+    SyntheticArchiveStats stats;
+    std::string packagesIndex;
+    std::string translationIndex;
+    std::size_t iconThemeCount = 0;
+
+    for (std::size_t i = 0; i < spec.packages; i++) {
+        SyntheticPackage pkg;
+        pkg.kind = kinds[i];
+        // every package gets its own generator, so package files can be reused between runs
+        std::mt19937 pkgRng(spec.seed + static_cast<std::uint32_t>(i) + 1);
+
+        switch (pkg.kind) {
+        case SyntheticKind::DesktopApp:
+        case SyntheticKind::LargePayload:
+            pkg.name = std::format("bench-app-{}", i);
+            pkg.summary = std::format("Synthetic application {}", i);
+            addDesktopApp(pkg, i, spec, iconData, localized[i], haveAdwaita && i % 4 == 3, pkgRng);
+            if (pkg.kind == SyntheticKind::LargePayload) {
+                pkg.files[std::format("/usr/share/{}/payload.bin", pkg.name)] = randomBytes(pkgRng, spec.payloadBytes);
+                stats.largePayloads++;
+            } else {
+                stats.desktopApps++;
+            }
+            break;
+        case SyntheticKind::IconTheme: {
+            const auto themeName = iconThemeCount == 0 ? std::string("Adwaita")
+                                                       : std::format("BenchTheme{}", iconThemeCount);
+            pkg.name = iconThemeCount == 0 ? std::string("adwaita-icon-theme")
+                                           : std::format("bench-theme-{}-icon-theme", iconThemeCount);
+            pkg.summary = std::format("Synthetic icon theme {}", themeName);
+            addIconTheme(pkg, themeName, spec, iconData);
+            iconThemeCount++;
+            stats.iconThemes++;
+            break;
+        }
+        case SyntheticKind::Font:
+            pkg.name = std::format("fonts-bench-{}", i);
+            pkg.summary = std::format("Synthetic font {}", i);
+            addFont(pkg, i, fontData);
+            stats.fonts++;
+            break;
+        case SyntheticKind::Plain:
+            pkg.name = std::format("libbench-{}", i);
+            pkg.summary = std::format("Synthetic library {}", i);
+            pkg.files[std::format("/usr/lib/libbench-{}.so.1", i)] = randomBytes(pkgRng, 32 * 1024);
+            pkg.files[std::format("/usr/share/doc/{}/copyright", pkg.name)] = "Public domain.\n";
+            stats.plain++;
+            break;
+        }
+
+        const auto poolPath = fs::path("pool") / spec.section / pkg.name.substr(0, 1) / pkg.name
+                              / std::format("{}_{}_{}.deb", pkg.name, SyntheticVersion, spec.arch);
+        const auto debFname = root / poolPath;
+        if (!fs::exists(debFname)) {
+            fs::create_directories(debFname.parent_path());
+            writeDeb(debFname, stagingDir, pkg, spec);
+        }
+        const auto debSize = fs::file_size(debFname);
+        stats.bytes += debSize;
+
+        packagesIndex += controlFields(pkg, spec);
+        packagesIndex += std::format("Filename: {}\nSize: {}\n\n", poolPath.string(), debSize);
+        translationIndex += std::format(
+            "Package: {}\nDescription-en: {}\n This package was generated to benchmark the metadata generator.\n\n",
+            pkg.name,
+            pkg.summary);
+    }
+
+    const auto binaryDir = distDir / spec.section / std::format("binary-{}", spec.arch);
+    fs::create_directories(binaryDir);
+    fs::create_directories(distDir / spec.section / "i18n");
+    compressAndSave(toBytes(packagesIndex), (binaryDir / "Packages.gz").string(), ArchiveType::GZIP);
+    compressAndSave(
+        toBytes(translationIndex), (distDir / spec.section / "i18n" / "Translation-en.gz").string(), ArchiveType::GZIP);
+
+    writeFileData(
+        distDir / "InRelease",
+        std::format(
+            "Suite: {0}\n"
+            "Codename: {0}\n"
+            "Architectures: {1}\n"
+            "Components: {2}\n"
+            "SHA256:\n"
+            " {3} {4} {2}/binary-{1}/Packages\n"
+            " {3} {4} {2}/i18n/Translation-en\n",
+            spec.suite,
+            spec.arch,
+            spec.section,
+            std::string(64, '0'),
+            0));
+
+    std::error_code ec;
+    fs::remove_all(stagingDir, ec);
+
+    return stats;
+}
+
+} // namespace ASGenerator
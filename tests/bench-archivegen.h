@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <filesystem>
+
+namespace ASGenerator
+{
+
+namespace fs = std::filesystem;
+
+/**
+ * Description of a synthetic Debian-style archive.
+ *
+ * The shares are fractions of the total number of packages. Packages that
+ * do not fall into any of the categories are plain library packages without
+ * any data that is interesting to the generator.
+ */
+struct SyntheticArchiveSpec {
+    std::string suite = "bench";
+    std::string section = "main";
+    std::string arch = "amd64";
+
+    std::size_t packages = 100;
+
+    /// Applications with a desktop-entry file, metainfo file and icon
+    double desktopAppShare = 0.35;
+    /// Icon theme packages, the first one of which is always "Adwaita"
+    double iconThemeShare = 0.03;
+    /// Font packages with a metainfo file
+    double fontShare = 0.07;
+    /// Applications that also ship a large, incompressible payload
+    double largePayloadShare = 0.03;
+
+    /// Share of applications that ship gettext translations
+    double localizedShare = 0.5;
+    std::size_t localesPerApp = 6;
+    std::size_t iconsPerTheme = 40;
+    std::size_t payloadBytes = 4 * 1024 * 1024;
+
+    /// PNG image used for all icons. Every copy is made unique, so icon caches can not cheat.
+    fs::path iconSample;
+    /// Font file used for font packages. If empty, a file that is not a valid font is used.
+    fs::path fontSample;
+
+    std::uint32_t seed = 42;
+};
+
+/**
+ * Summary of what was generated.
+ */
+struct SyntheticArchiveStats {
+    std::size_t desktopApps = 0;
+    std::size_t iconThemes = 0;
+    std::size_t fonts = 0;
+    std::size_t largePayloads = 0;
+    std::size_t plain = 0;
+    /// Total size of all package files
+    std::uint64_t bytes = 0;
+};
+
+/**
+ * Generate a Debian-style archive as described by @spec in @root.
+ *
+ * The result is deterministic for the same specification, and package files that
+ * exist already are reused. Generating the same archive with fewer packages
+ * thereby only rewrites the package index, which drops the packages at its end.
+ */
+SyntheticArchiveStats generateSyntheticArchive(const fs::path &root, const SyntheticArchiveSpec &spec);
+
+} // namespace ASGenerator
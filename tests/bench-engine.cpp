@@ -0,0 +1,325 @@
+/*
+ * Copyright (C) 2026 Matthias Klumpp <matthias@tenstral.net>
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glib.h>
+#include <nlohmann/json.hpp>
+
+#include "bench-archivegen.h"
+#include "config.h"
+#include "engine.h"
+#include "instrumentation.h"
+#include "logging.h"
+#include "utils.h"
+#include "backends/debian/tagfile.h"
+
+using namespace ASGenerator;
+
+/**
+ * Run @func and return the time it took, in seconds.
+ */
+static double timed(const std::function<void()> &func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Time spent in every stage since the instrumentation was last reset, over all scopes.
+ */
+static nlohmann::json stageTimes()
+{
+    PerfScopeSummary total;
+    for (const auto &summary : Instrumentation::get().summaries())
+        total.merge(summary);
+
+    auto node = nlohmann::json::object();
+    for (std::size_t i = 0; i < PerfStageCount; i++) {
+        if (total.stages[i].calls == 0)
+            continue;
+        node[perfStageName(static_cast<PerfStage>(i))] = std::chrono::duration<double>(total.stages[i].total).count();
+    }
+
+    return node;
+}
+
+static double stageTime(const nlohmann::json &stages, PerfStage stage)
+{
+    return stages.value(perfStageName(stage), 0.0);
+}
+
+static fs::path writeConfig(const fs::path &benchDir, const SyntheticArchiveSpec &spec)
+{
+    const nlohmann::json config = {
+        {"ProjectName",  "Benchmark"                                                                        },
+        {"ArchiveRoot",  (benchDir / "archive").string()                                                    },
+        {"WorkspaceDir", (benchDir / "workspace").string()                                                  },
+        {"MediaBaseUrl", "https://example.org/media"                                                        },
+        {"HtmlBaseUrl",  "https://example.org/html"                                                         },
+        {"Backend",      "debian"                                                                           },
+        {"ImageFormat",  "png"                                                                              },
+        {"Suites",       {{spec.suite, {{"sections", {spec.section}}, {"architectures", {spec.arch}}}}}}
+    };
+
+    const auto configFname = benchDir / "asgen-config.json";
+    std::ofstream f(configFname);
+    f << config.dump(2) << "\n";
+    return configFname;
+}
+
+/**
+ * Parse the package index of the archive at @archiveDir @runs times.
+ */
+static nlohmann::json benchTagFile(const fs::path &archiveDir, const SyntheticArchiveSpec &spec, std::size_t runs)
+{
+    const auto indexFname = archiveDir / "dists" / spec.suite / spec.section / std::format("binary-{}", spec.arch)
+                            / "Packages.gz";
+
+    double best = 0;
+    double sum = 0;
+    std::size_t sections = 0;
+    for (std::size_t run = 0; run < runs; run++) {
+        sections = 0;
+        const auto duration = timed([&]() {
+            TagFile tf;
+            tf.open(indexFname.string());
+            do {
+                if (tf.readField("Package").empty())
+                    continue;
+                tf.readField("Version");
+                tf.readField("Architecture");
+                tf.readField("Filename");
+                tf.readField("Description");
+                sections++;
+            } while (tf.nextSection());
+        });
+        sum += duration;
+        if (run == 0 || duration < best)
+            best = duration;
+    }
+
+    return {
+        {"runs",     runs                                 },
+        {"sections", sections                             },
+        {"mean",     runs > 0 ? sum / runs : 0.0          },
+        {"best",     best                                 }
+    };
+}
+
+static nlohmann::json benchScale(const fs::path &workDir, SyntheticArchiveSpec spec, std::size_t tagFileRuns)
+{
+    const auto benchDir = workDir / std::format("scale-{}", spec.packages);
+    const auto archiveDir = benchDir / "archive";
+    fs::remove_all(benchDir);
+    fs::create_directories(benchDir / "workspace");
+
+    std::cout << std::format("Benchmarking an archive of {} packages", spec.packages) << std::endl;
+
+    SyntheticArchiveStats stats;
+    const auto generateTime = timed([&]() {
+        stats = generateSyntheticArchive(archiveDir, spec);
+    });
+
+    nlohmann::json result = {
+        {"packages", spec.packages},
+        {"archive",
+         {{"desktopApps", stats.desktopApps},
+          {"iconThemes", stats.iconThemes},
+          {"fonts", stats.fonts},
+          {"largePayloads", stats.largePayloads},
+          {"plain", stats.plain},
+          {"bytes", stats.bytes},
+          {"generateSeconds", generateTime}}},
+    };
+    auto &benchmarks = result["benchmarks"];
+    auto &stages = result["stages"];
+
+    benchmarks["tagFileParse"] = benchTagFile(archiveDir, spec, tagFileRuns);
+
+    Config::get().loadFromFile(writeConfig(benchDir, spec).string(), (benchDir / "workspace").string());
+    {
+        Engine engine;
+
+        // first run on an empty database, every package has to be processed
+        benchmarks["runCold"] = timed([&]() {
+            engine.run(spec.suite);
+        });
+        stages["runCold"] = stageTimes();
+        benchmarks["seedContentsData"] = stageTime(stages["runCold"], PerfStage::ContentsSeed);
+        benchmarks["processPackages"] = stageTime(stages["runCold"], PerfStage::Process);
+
+        // nothing changed, so this only checks the archive and exports the data again
+        benchmarks["runWarm"] = timed([&]() {
+            engine.run(spec.suite);
+        });
+        stages["runWarm"] = stageTimes();
+
+        benchmarks["publish"] = timed([&]() {
+            engine.publish(spec.suite);
+        });
+        stages["publish"] = stageTimes();
+        benchmarks["exportMetadata"] = stageTime(stages["publish"], PerfStage::Export);
+        benchmarks["exportIconTarballs"] = stageTime(stages["publish"], PerfStage::IconTarballs);
+    }
+
+    // drop a quarter of the packages from the archive, so cleanup has work to do
+    auto reducedSpec = spec;
+    reducedSpec.packages = spec.packages - spec.packages / 4;
+    generateSyntheticArchive(archiveDir, reducedSpec);
+    {
+        Engine engine;
+        benchmarks["runCleanup"] = timed([&]() {
+            engine.runCleanup();
+        });
+    }
+
+    return result;
+}
+
+/**
+ * Print the relative difference of all benchmarks in @newFname compared to @oldFname.
+ */
+static int compareResults(const std::string &oldFname, const std::string &newFname)
+{
+    std::ifstream oldF(oldFname);
+    std::ifstream newF(newFname);
+    if (!oldF || !newF) {
+        std::cerr << "Unable to open benchmark results for comparison." << std::endl;
+        return 1;
+    }
+    const auto oldDoc = nlohmann::json::parse(oldF);
+    const auto newDoc = nlohmann::json::parse(newF);
+
+    const auto seconds = [](const nlohmann::json &value) -> double {
+        if (value.is_object())
+            return value.value("best", 0.0);
+        return value.is_number() ? value.get<double>() : 0.0;
+    };
+
+    for (const auto &newScale : newDoc["scales"]) {
+        const auto packages = newScale["packages"].get<std::size_t>();
+        const nlohmann::json *oldScale = nullptr;
+        for (const auto &scale : oldDoc["scales"]) {
+            if (scale["packages"].get<std::size_t>() == packages) {
+                oldScale = &scale;
+                break;
+            }
+        }
+        if (oldScale == nullptr)
+            continue;
+
+        std::cout << std::format("{} packages:", packages) << std::endl;
+        for (const auto &[name, value] : newScale["benchmarks"].items()) {
+            if (!(*oldScale)["benchmarks"].contains(name))
+                continue;
+            const auto oldTime = seconds((*oldScale)["benchmarks"][name]);
+            const auto newTime = seconds(value);
+            const auto change = oldTime > 0 ? (newTime - oldTime) / oldTime * 100.0 : 0.0;
+            std::cout << std::format("  {:<20} {:>10.4f}s {:>10.4f}s {:>+8.1f}%", name, oldTime, newTime, change)
+                      << std::endl;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    g_autofree gchar *scalesStr = nullptr;
+    g_autofree gchar *outputFname = nullptr;
+    g_autofree gchar *workDirStr = nullptr;
+    g_autofree gchar *fontFname = nullptr;
+    gint tagFileRuns = 10;
+    gboolean compare = FALSE;
+
+    GOptionEntry entries[] = {
+        {"scales", 0, 0, G_OPTION_ARG_STRING, &scalesStr, "Comma-separated archive sizes to run at", "N,..."},
+        {"output", 'o', 0, G_OPTION_ARG_FILENAME, &outputFname, "Write the results to FILE, as JSON", "FILE"},
+        {"workdir", 0, 0, G_OPTION_ARG_FILENAME, &workDirStr, "Directory to place the archives in", "DIR"},
+        {"font", 0, 0, G_OPTION_ARG_FILENAME, &fontFname, "Font file to use for the font packages", "FILE"},
+        {"tagfile-runs", 0, 0, G_OPTION_ARG_INT, &tagFileRuns, "Number of times the package index is parsed", "N"},
+        {"compare", 0, 0, G_OPTION_ARG_NONE, &compare, "Compare the two result files given as arguments", nullptr},
+        {nullptr}
+    };
+
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(GOptionContext) optCtx = g_option_context_new("- benchmark the metadata generator");
+    g_option_context_add_main_entries(optCtx, entries, nullptr);
+    if (!g_option_context_parse(optCtx, &argc, &argv, &error)) {
+        std::cerr << std::format("Unable to parse options: {}", error->message) << std::endl;
+        return 1;
+    }
+
+    if (compare) {
+        if (argc != 3) {
+            std::cerr << "Need the old and the new result file to compare." << std::endl;
+            return 1;
+        }
+        return compareResults(argv[1], argv[2]);
+    }
+
+    std::vector<std::size_t> scales = {25, 100, 400};
+    if (scalesStr != nullptr) {
+        scales.clear();
+        for (const auto &part : Utils::splitString(scalesStr, ','))
+            scales.push_back(std::stoul(part));
+    }
+
+    const auto workDir = workDirStr != nullptr
+                             ? fs::path(workDirStr)
+                             : fs::temp_directory_path() / std::format("asgen-bench-{}", Utils::randomString(8));
+
+    // keep the output readable, the results are what we are interested in
+    initializeLogging(quill::LogLevel::Warning);
+
+    SyntheticArchiveSpec spec;
+    if (fontFname != nullptr)
+        spec.fontSample = fontFname;
+
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    nlohmann::json results = {
+        {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(now).count()},
+        {"cpus",      std::thread::hardware_concurrency()                          },
+        {"scales",    nlohmann::json::array()                                      },
+    };
+
+    int ret = 0;
+    try {
+        for (const auto scale : scales) {
+            spec.packages = scale;
+            results["scales"].push_back(
+                benchScale(workDir, spec, static_cast<std::size_t>(std::max(tagFileRuns, 1))));
+        }
+    } catch (const std::exception &e) {
+        std::cerr << std::format("Benchmark failed: {}", e.what()) << std::endl;
+        ret = 1;
+    }
+    shutdownLogging();
+
+    if (workDirStr == nullptr) {
+        std::error_code ec;
+        fs::remove_all(workDir, ec);
+    }
+
+    if (outputFname != nullptr) {
+        std::ofstream f(outputFname);
+        f << results.dump(2) << "\n";
+    } else {
+        std::cout << results.dump(2) << std::endl;
+    }
+
+    return ret;
+}
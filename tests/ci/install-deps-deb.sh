@@ -52,6 +52,8 @@ fi;
 # asgen-specific dependencies
 eatmydata apt-get install -yq --no-install-recommends \
     liblmdb-dev \
+    libzstd-dev \
+    zlib1g-dev \
     libarchive-dev \
     libpango1.0-dev \
     nlohmann-json3-dev \
@@ -42,6 +42,9 @@ dnf --assumeyes --quiet --setopt=install_weak_deps=False install \
     'pkgconfig(nlohmann_json)' \
     'pkgconfig(xmlb)' \
     'pkgconfig(lmdb)' \
+    'pkgconfig(libzstd)' \
+    'pkgconfig(liblzma)' \
+    'pkgconfig(zlib)' \
     'pkgconfig(pango)' \
     'pkgconfig(libfyaml)' \
     'pkgconfig(tbb)' \
@@ -13,11 +13,24 @@
 #include <string>
 #include <unordered_map>
 #include <string_view>
+#include <map>
+#include <vector>
+#include <set>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <format>
 
 #include "utils.h"
 
+#include "pkgindexcache.h"
+#include "contentsstore.h"
 #include "backends/archlinux/listfile.h"
+#include "backends/dummy/pkgindex.h"
 #include "backends/rpmmd/rpmpkgindex.h"
+#include "backends/ubuntu/mocatalog.h"
+#include "backends/ubuntu/ubupkg.h"
 
 using namespace ASGenerator;
 
@@ -83,3 +96,366 @@ TEST_CASE("RPMPackageIndex", "[backend][rpmmd]")
         REQUIRE(pkgs.size() == 4);
     }
 }
+
+TEST_CASE("PackageIndexCache", "[backend]")
+{
+    const auto samplesDir = Utils::getTestSamplesDir();
+    // a budget of zero only keeps pinned package sets once the index is released
+    PackageIndexCache cache(std::make_unique<DummyPackageIndex>(samplesDir.string()), 0);
+
+    auto pkgs = cache.packagesFor("sid", "main", "amd64");
+    REQUIRE(pkgs.size() == 1);
+
+    SECTION("Package sets are shared until they are evicted")
+    {
+        REQUIRE(cache.packagesFor("sid", "main", "amd64")[0] == pkgs[0]);
+        REQUIRE(cache.cachedSets() == 1);
+
+        cache.release();
+        REQUIRE(cache.cachedSets() == 0);
+        REQUIRE(cache.cachedBytes() == 0);
+        REQUIRE(cache.packagesFor("sid", "main", "amd64")[0] != pkgs[0]);
+    }
+
+    SECTION("Pinned package sets survive releasing the index")
+    {
+        {
+            PackageIndexCache::Pin pin(cache, "sid", "main");
+            pkgs = cache.packagesFor("sid", "main", "amd64");
+            cache.packagesFor("sid", "contrib", "amd64");
+
+            cache.release();
+            REQUIRE(cache.cachedSets() == 1);
+            REQUIRE(cache.packagesFor("sid", "main", "amd64")[0] == pkgs[0]);
+        }
+
+        cache.release();
+        REQUIRE(cache.cachedSets() == 0);
+    }
+}
+
+/**
+ * A package index that takes its time to load, counting how often it does.
+ */
+class SlowPackageIndex : public DummyPackageIndex
+{
+public:
+    explicit SlowPackageIndex(const std::string &dir)
+        : DummyPackageIndex(dir),
+          loads(0)
+    {
+    }
+
+    std::vector<std::shared_ptr<Package>> packagesFor(
+        const std::string &suite,
+        const std::string &section,
+        const std::string &arch,
+        bool withLongDescs = true) override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        loads++;
+        return DummyPackageIndex::packagesFor(suite, section, arch, withLongDescs);
+    }
+
+    std::atomic<int> loads;
+};
+
+TEST_CASE("PackageIndexCache concurrent loads", "[backend]")
+{
+    auto index = std::make_unique<SlowPackageIndex>(Utils::getTestSamplesDir().string());
+    auto *slowIndex = index.get();
+    PackageIndexCache cache(std::move(index), 0);
+
+    std::vector<std::shared_ptr<Package>> results(8);
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < results.size(); i++)
+        threads.emplace_back([&, i]() {
+            results[i] = cache.packagesFor("sid", "main", "amd64")[0];
+        });
+
+    for (auto &thread : threads)
+        thread.join();
+
+    // everybody waited for the same set to be loaded
+    REQUIRE(slowIndex->loads == 1);
+    for (const auto &pkg : results)
+        REQUIRE(pkg == results[0]);
+    REQUIRE(cache.cachedSets() == 1);
+}
+
+/**
+ * Write a minimal GNU message catalog, the way msgfmt lays it out.
+ */
+static void writeMoFile(const fs::path &fname, const std::map<std::string, std::string> &messages, bool withHashTable)
+{
+    const std::uint32_t count = messages.size();
+    const std::uint32_t hashSize = withHashTable ? 7 : 0;
+    const std::uint32_t origTabOffset = 28;
+    const std::uint32_t transTabOffset = origTabOffset + count * 8;
+    const std::uint32_t hashTabOffset = transTabOffset + count * 8;
+
+    std::vector<std::uint32_t> header = {0x950412de, 0, count, origTabOffset, transTabOffset, hashSize, hashTabOffset};
+    std::vector<std::uint32_t> origTab, transTab, hashTab(hashSize, 0);
+    std::string strings;
+    std::uint32_t strOffset = hashTabOffset + hashSize * 4;
+
+    std::uint32_t index = 0;
+    for (const auto &[msgid, msgstr] : messages) {
+        origTab.push_back(msgid.size());
+        origTab.push_back(strOffset + strings.size());
+        strings.append(msgid);
+        strings.push_back('\0');
+
+        if (withHashTable) {
+            // the GNU gettext string hash, only taking the singular form into account
+            std::uint32_t hval = 0;
+            for (const auto c : std::string_view(msgid.c_str())) {
+                hval = (hval << 4) + static_cast<unsigned char>(c);
+                const std::uint32_t g = hval & 0xf0000000;
+                if (g != 0)
+                    hval ^= (g >> 24) ^ g;
+            }
+            std::uint32_t idx = hval % hashSize;
+            const std::uint32_t incr = 1 + (hval % (hashSize - 2));
+            while (hashTab[idx] != 0)
+                idx = (idx + incr) % hashSize;
+            hashTab[idx] = index + 1;
+        }
+        index++;
+    }
+    for (const auto &[msgid, msgstr] : messages) {
+        transTab.push_back(msgstr.size());
+        transTab.push_back(strOffset + strings.size());
+        strings.append(msgstr);
+        strings.push_back('\0');
+    }
+
+    std::ofstream f(fname, std::ios::binary);
+    for (const auto *table : {&header, &origTab, &transTab, &hashTab})
+        f.write(reinterpret_cast<const char *>(table->data()), table->size() * sizeof(std::uint32_t));
+    f.write(strings.data(), strings.size());
+}
+
+TEST_CASE("MoCatalog", "[backend][ubuntu]")
+{
+    const auto tmpDir = fs::temp_directory_path() / std::format("asgen-mo-{}", Utils::randomString(8));
+    fs::create_directories(tmpDir);
+
+    const std::map<std::string, std::string> messages = {
+        {"", "Content-Type: text/plain; charset=UTF-8\n"},
+        {"Calculator", "Taschenrechner"},
+        {"Perform calculations", "Berechnungen durchf\xc3\xbchren"},
+        {"Untranslated", ""},
+        {std::string("file\0files", 10), std::string("Datei\0Dateien", 13)},
+    };
+
+    for (const auto withHashTable : {true, false}) {
+        const auto moPath = tmpDir / (withHashTable ? "hashed.mo" : "sorted.mo");
+        writeMoFile(moPath, messages, withHashTable);
+
+        MoCatalog catalog(moPath);
+        REQUIRE(catalog.size() == messages.size());
+        REQUIRE(catalog.lookup("Calculator") == "Taschenrechner");
+        REQUIRE(catalog.lookup("Perform calculations") == "Berechnungen durchf\xc3\xbchren");
+        REQUIRE(catalog.lookup("file") == "Datei");
+        REQUIRE_FALSE(catalog.lookup("Untranslated").has_value());
+        REQUIRE_FALSE(catalog.lookup("Calc").has_value());
+        REQUIRE_FALSE(catalog.lookup("Unknown").has_value());
+        REQUIRE_FALSE(catalog.lookup("").has_value());
+
+        // catalogs read from an archive are used from memory
+        std::ifstream f(moPath, std::ios::binary);
+        std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+        MoCatalog memCatalog(std::move(data), moPath.string());
+        REQUIRE(memCatalog.lookup("Calculator") == "Taschenrechner");
+        REQUIRE_FALSE(memCatalog.lookup("Unknown").has_value());
+    }
+
+    std::ofstream(tmpDir / "invalid.mo") << "This is not a message catalog.";
+    REQUIRE_THROWS(MoCatalog(tmpDir / "invalid.mo"));
+
+    fs::remove_all(tmpDir);
+}
+
+/**
+ * A language pack that serves its message catalogs from a directory,
+ * counting how often it is read from.
+ */
+class FakeLanguagePack : public UbuntuPackage
+{
+public:
+    FakeLanguagePack(const std::string &pname, const fs::path &root)
+        : UbuntuPackage(pname, "1.0", "all"),
+          m_root(root),
+          prefetches(0),
+          reads(0),
+          cleanups(0)
+    {
+        for (const auto &entry : fs::recursive_directory_iterator(root)) {
+            if (entry.is_regular_file())
+                m_contents.push_back("/" + fs::relative(entry.path(), root).string());
+        }
+    }
+
+    const std::vector<std::string> &contents() override
+    {
+        return m_contents;
+    }
+
+    void prefetchFiles(const std::set<std::string> &) override
+    {
+        // give other threads a chance to ask for the same catalogs
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        prefetches++;
+    }
+
+    std::vector<std::uint8_t> getFileData(const std::string &fname) override
+    {
+        reads++;
+        std::ifstream f(m_root / fname.substr(1), std::ios::binary);
+        return {std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+    }
+
+    void cleanupTemp() override
+    {
+        cleanups++;
+    }
+
+    std::atomic<int> prefetches;
+    std::atomic<int> reads;
+    std::atomic<int> cleanups;
+
+private:
+    fs::path m_root;
+    std::vector<std::string> m_contents;
+};
+
+static void writeLangpackCatalog(
+    const fs::path &root,
+    const std::string &locale,
+    const std::string &domain,
+    const std::string &translation)
+{
+    const auto dir = root / "usr/share/locale-langpack" / locale / "LC_MESSAGES";
+    fs::create_directories(dir);
+    writeMoFile(
+        dir / (domain + ".mo"),
+        {{"", "Content-Type: text/plain; charset=UTF-8\n"}, {"Calculator", translation}},
+        true);
+}
+
+TEST_CASE("LanguagePackProvider", "[backend][ubuntu]")
+{
+    const auto tmpDir = fs::temp_directory_path() / std::format("asgen-langpack-{}", Utils::randomString(8));
+    fs::create_directories(tmpDir);
+
+    SECTION("Look up translations")
+    {
+        writeLangpackCatalog(tmpDir / "de", "de", "gnome-calculator", "Taschenrechner");
+        writeLangpackCatalog(tmpDir / "de", "de_AT", "gnome-calculator", "Taschenrechner");
+        writeLangpackCatalog(tmpDir / "fr", "fr", "gnome-calculator", "Calculatrice");
+        writeLangpackCatalog(tmpDir / "fr", "fr", "gnome-mines", "Calculator");
+        auto langpackDe = std::make_shared<FakeLanguagePack>("language-pack-gnome-de-base", tmpDir / "de");
+        auto langpackFr = std::make_shared<FakeLanguagePack>("language-pack-gnome-fr-base", tmpDir / "fr");
+
+        LanguagePackProvider provider;
+        provider.addLanguagePacks({langpackDe, langpackFr});
+
+        const auto translations = provider.getTranslations("gnome-calculator", "Calculator");
+        REQUIRE(translations.size() == 3);
+        REQUIRE(translations.at("de") == "Taschenrechner");
+        REQUIRE(translations.at("de_AT") == "Taschenrechner");
+        REQUIRE(translations.at("fr") == "Calculatrice");
+
+        // untranslated strings and unknown domains have no translations
+        REQUIRE(provider.getTranslations("gnome-calculator", "Unknown").empty());
+        REQUIRE(provider.getTranslations("gnome-mines", "Calculator").empty());
+        REQUIRE(provider.getTranslations("nonexistent", "Calculator").empty());
+
+        // catalogs are read once, in one pass per language pack, and temporary data is removed afterwards
+        provider.getTranslations("gnome-calculator", "Calculator");
+        REQUIRE(langpackDe->prefetches == 1);
+        REQUIRE(langpackDe->reads == 2);
+        REQUIRE(langpackDe->cleanups == 1);
+        REQUIRE(langpackFr->prefetches == 2);
+        REQUIRE(langpackFr->reads == 2);
+        REQUIRE(langpackFr->cleanups == 2);
+    }
+
+    SECTION("Later language packs take precedence")
+    {
+        writeLangpackCatalog(tmpDir / "base", "de", "gnome-calculator", "Rechner");
+        writeLangpackCatalog(tmpDir / "base", "fr", "gnome-calculator", "Calculatrice");
+        writeLangpackCatalog(tmpDir / "update", "de", "gnome-calculator", "Taschenrechner");
+        auto langpackBase = std::make_shared<FakeLanguagePack>("language-pack-gnome-base", tmpDir / "base");
+        auto langpackUpdate = std::make_shared<FakeLanguagePack>("language-pack-gnome-update", tmpDir / "update");
+
+        // only the contents of the later language pack are known to the contents store, so
+        // the earlier one is indexed after it and must not replace its catalogs
+        ContentsStore cstore;
+        cstore.open((tmpDir / "contents").string());
+        cstore.addContents(langpackUpdate->id(), langpackUpdate->contents());
+
+        LanguagePackProvider provider;
+        provider.addLanguagePacks({langpackBase, langpackUpdate});
+        provider.indexCatalogs(cstore);
+
+        const auto translations = provider.getTranslations("gnome-calculator", "Calculator");
+        REQUIRE(translations.size() == 2);
+        REQUIRE(translations.at("de") == "Taschenrechner");
+        REQUIRE(translations.at("fr") == "Calculatrice");
+        REQUIRE(langpackBase->reads == 1);
+        REQUIRE(langpackUpdate->reads == 1);
+    }
+
+    SECTION("Evict the least recently used domains")
+    {
+        const auto domainCount = LanguagePackProvider::MaxCachedDomains + 1;
+        for (std::size_t i = 0; i < domainCount; i++)
+            writeLangpackCatalog(tmpDir / "de", "de", std::format("domain{}", i), "Taschenrechner");
+        auto langpack = std::make_shared<FakeLanguagePack>("language-pack-de", tmpDir / "de");
+
+        LanguagePackProvider provider;
+        provider.addLanguagePacks({langpack});
+
+        for (std::size_t i = 0; i < LanguagePackProvider::MaxCachedDomains; i++)
+            REQUIRE(provider.getTranslations(std::format("domain{}", i), "Calculator").size() == 1);
+        REQUIRE(langpack->reads == LanguagePackProvider::MaxCachedDomains);
+
+        // using a domain keeps it in memory, the least recently used one is dropped instead
+        provider.getTranslations("domain0", "Calculator");
+        provider.getTranslations(std::format("domain{}", domainCount - 1), "Calculator");
+        REQUIRE(langpack->reads == domainCount);
+
+        provider.getTranslations("domain0", "Calculator");
+        REQUIRE(langpack->reads == domainCount);
+        REQUIRE(provider.getTranslations("domain1", "Calculator").size() == 1);
+        REQUIRE(langpack->reads == domainCount + 1);
+    }
+
+    SECTION("Load a domain only once")
+    {
+        for (const auto &locale : {"de", "fr", "pt_BR"})
+            writeLangpackCatalog(tmpDir / "all", locale, "gnome-calculator", "Taschenrechner");
+        auto langpack = std::make_shared<FakeLanguagePack>("language-pack-gnome", tmpDir / "all");
+
+        LanguagePackProvider provider;
+        provider.addLanguagePacks({langpack});
+
+        std::vector<std::size_t> resultSizes(8, 0);
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < resultSizes.size(); i++)
+            threads.emplace_back([&, i]() {
+                resultSizes[i] = provider.getTranslations("gnome-calculator", "Calculator").size();
+            });
+        for (auto &thread : threads)
+            thread.join();
+
+        for (const auto size : resultSizes)
+            REQUIRE(size == 3);
+        REQUIRE(langpack->prefetches == 1);
+        REQUIRE(langpack->reads == 3);
+    }
+
+    fs::remove_all(tmpDir);
+}
@@ -324,6 +324,25 @@ Name:
         REQUIRE(retrievedXml == xmlData);
         REQUIRE(retrievedYaml == yamlData);
 
+        // summary records of components
+        REQUIRE_FALSE(store.componentSummaryExists(gcid));
+        REQUIRE_FALSE(store.readSnapshot().componentSummary(gcid).has_value());
+
+        ComponentSummary summary;
+        summary.kind = AS_COMPONENT_KIND_DESKTOP_APP;
+        summary.cid = "org.example.test";
+        summary.iconName = "org.example.test.png";
+        REQUIRE_NOTHROW(store.setComponentSummary(gcid, summary));
+        REQUIRE(store.componentSummaryExists(gcid));
+
+        const auto retrievedSummary = store.readSnapshot().componentSummary(gcid);
+        REQUIRE(retrievedSummary.has_value());
+        REQUIRE(retrievedSummary->kind == AS_COMPONENT_KIND_DESKTOP_APP);
+        REQUIRE(retrievedSummary->cid == summary.cid);
+        REQUIRE(retrievedSummary->iconName == summary.iconName);
+
+        REQUIRE_THROWS(ComponentSummary::deserialize("garbage"));
+
         store.close();
     }
 
@@ -351,6 +370,23 @@ Name:
         REQUIRE_NOTHROW(store.removePackage(pkgId));
         REQUIRE_FALSE(store.packageExists(pkgId));
 
+        // Classify several packages at once, the state has to survive reopening the database
+        store.setPackageIgnore("ignored/1.0/amd64");
+        loadHintsRegistry();
+        GeneratorResult gres(std::make_shared<DummyPackage>("seen", "1.0", "amd64"));
+        gres.addHint("general", "description-from-package");
+        store.addGeneratorResult(DataType::XML, gres);
+        store.close();
+        store.open(tempDir.string(), mediaDir.string());
+
+        const auto states = store.getPackageStates({"ignored/1.0/amd64", "seen/1.0/amd64", pkgId});
+        REQUIRE(
+            states
+            == std::vector<PackageState>{PackageState::Ignored, PackageState::Processed, PackageState::Unknown});
+
+        store.removePackages({"ignored/1.0/amd64"});
+        REQUIRE(store.getPackageStates({"ignored/1.0/amd64"})[0] == PackageState::Unknown);
+
         store.close();
     }
 
@@ -640,6 +676,66 @@ Name:
         store.close();
     }
 
+    SECTION("Package records")
+    {
+        DataStore store;
+        store.open(tempDir.string(), mediaDir.string());
+
+        REQUIRE_FALSE(store.getPackageRecords("stable", "main", "amd64").has_value());
+
+        std::vector<PackageRecord> records(2);
+        records[0].name = "foobar";
+        records[0].ver = "1.0-1";
+        records[0].arch = "amd64";
+        records[0].maintainer = "Jane Doe <jane@example.org>";
+        records[1].kind = PackageKind::Fake;
+        records[1].name = "+extra-metainfo";
+        records[1].ver = "0~0";
+        records[1].arch = "amd64";
+        store.setPackageRecords("stable", "main", "amd64", records);
+        store.setPackageRecords("stable", "contrib", "amd64", {});
+
+        const auto stored = store.getPackageRecords("stable", "main", "amd64");
+        REQUIRE(stored.has_value());
+        REQUIRE(stored->size() == 2);
+        REQUIRE(stored->at(0).name == "foobar");
+        REQUIRE(stored->at(0).ver == "1.0-1");
+        REQUIRE(stored->at(0).arch == "amd64");
+        REQUIRE(stored->at(0).maintainer == "Jane Doe <jane@example.org>");
+        REQUIRE(stored->at(0).kind == PackageKind::Physical);
+        REQUIRE(stored->at(1).kind == PackageKind::Fake);
+        REQUIRE(stored->at(1).maintainer.empty());
+
+        const auto empty = store.getPackageRecords("stable", "contrib", "amd64");
+        REQUIRE(empty.has_value());
+        REQUIRE(empty->empty());
+
+        store.close();
+    }
+
+    SECTION("Suite media links")
+    {
+        DataStore store;
+        store.open(tempDir.string(), mediaDir.string());
+
+        REQUIRE(store.getSuiteMediaLinks("stable").empty());
+
+        store.addSuiteMediaLinks("stable", {"org/example/foo.desktop/A1", "org/example/bar.desktop/B2"});
+        store.addSuiteMediaLinks("stable-updates", {"org/example/baz.desktop/C3"});
+
+        auto links = store.getSuiteMediaLinks("stable");
+        REQUIRE(links.size() == 2);
+        REQUIRE(links.contains("org/example/foo.desktop/A1"));
+        REQUIRE(links.contains("org/example/bar.desktop/B2"));
+        REQUIRE(store.getSuiteMediaLinks("stable-updates").size() == 1);
+
+        store.clearSuiteMediaLinks("stable");
+        REQUIRE(store.getSuiteMediaLinks("stable").empty());
+        REQUIRE(store.getSuiteMediaLinks("stable-updates").size() == 1);
+
+        store.close();
+    }
+
     // Cleanup
     fs::remove_all(tempDir);
     fs::remove_all(mediaDir);
@@ -908,3 +1004,347 @@ TEST_CASE("DataStore component ownership", "[datastore]")
         fs::remove_all(mediaDir);
     }
 }
+
+TEST_CASE("DataStore result reuse", "[datastore]")
+{
+    loadHintsRegistry();
+
+    auto tempDir = fs::temp_directory_path() / std::format("asgen-test-{}", Utils::randomString(8));
+    auto mediaDir = fs::temp_directory_path() / std::format("asgen-media-{}", Utils::randomString(8));
+    fs::create_directories(tempDir);
+    fs::create_directories(mediaDir);
+
+    DataStore store;
+    store.open(tempDir.string(), mediaDir.string());
+
+    REQUIRE(DataStore::packageInputsKey("foobar/1.0-1/amd64") == "foobar/amd64");
+
+    // inputs records survive a roundtrip through the database
+    PackageInputs inputs;
+    inputs.pkid = "foobar/1.0-1/amd64";
+    inputs.environment = "abc:def";
+    inputs.files["/usr/share/metainfo/org.example.foobar.metainfo.xml"] = "d41d8cd98f00b204e9800998ecf8427e";
+    store.setPackageInputs(DataStore::packageInputsKey(inputs.pkid), inputs);
+
+    const auto storedInputs = store.getPackageInputs("foobar/amd64");
+    REQUIRE(storedInputs.has_value());
+    REQUIRE(storedInputs->pkid == inputs.pkid);
+    REQUIRE(storedInputs->environment == inputs.environment);
+    REQUIRE(storedInputs->files == inputs.files);
+    REQUIRE_FALSE(store.getPackageInputs("foobar/i386").has_value());
+
+    // create a result to reuse
+    auto pkg = std::make_shared<DummyPackage>("foobar", "1.0-1", "amd64");
+    pkg->setMaintainer("Test Maintainer <test@example.org>");
+    GeneratorResult gres(pkg);
+
+    g_autoptr(AsComponent) cpt = as_component_new();
+    as_component_set_kind(cpt, AS_COMPONENT_KIND_DESKTOP_APP);
+    as_component_set_id(cpt, "org.example.foobar");
+    as_component_set_name(cpt, "Foobar", "C");
+    as_component_set_summary(cpt, "Does foo with bar", "C");
+    gres.addComponent(cpt);
+    gres.addHint(cpt, "description-from-package");
+    const auto gcid = gres.getComponentGcids()[0];
+    store.addGeneratorResult(DataType::XML, gres);
+
+    // a hint naming the file of the old version
+    {
+        auto hints = PackageHints::decode(store.readSnapshot().hints("foobar/1.0-1/amd64"));
+        hints.addHint(
+            "org.example.foobar",
+            "pkg-empty-file",
+            {
+                {"fname",     "foobar.png"            },
+                {"pkg_fname", "foobar_1.0-1_amd64.deb"}
+        });
+        store.setHints("foobar/1.0-1/amd64", hints);
+    }
+
+    // the new version provides the very same component, and its hints refer to it
+    REQUIRE(store.cloneResult(DataType::XML, "foobar/1.0-1/amd64", "foobar/1.0-2/amd64"));
+    REQUIRE(store.getGCIDsForPackage("foobar/1.0-2/amd64") == std::vector<std::string>{gcid});
+    REQUIRE(store.getGcidOwner(gcid) == "foobar/1.0-2/amd64");
+    REQUIRE(store.getHints("foobar/1.0-2/amd64").find("\"package\":\"foobar/1.0-2/amd64\"") != std::string::npos);
+    REQUIRE(store.getHints("foobar/1.0-2/amd64").find("foobar_1.0-2_amd64.deb") != std::string::npos);
+    REQUIRE(store.getHints("foobar/1.0-2/amd64").find("foobar_1.0-1_amd64.deb") == std::string::npos);
+
+    // a snapshot sees the same data as the copying accessors
+    {
+        const auto snapshot = store.readSnapshot();
+        REQUIRE(snapshot.gcidsForPackage("foobar/1.0-2/amd64") == std::vector<std::string_view>{gcid});
+        REQUIRE(snapshot.metadata(DataType::XML, gcid) == store.getMetadata(DataType::XML, gcid));
+        REQUIRE(
+            PackageHints::decode(snapshot.hints("foobar/1.0-2/amd64")).toJson("foobar/1.0-2/amd64")
+            == store.getHints("foobar/1.0-2/amd64"));
+        REQUIRE(snapshot.hints("unknown/1.0/amd64").empty());
+        REQUIRE(snapshot.gcidsForPackage("unknown/1.0/amd64").empty());
+    }
+
+    // nothing to reuse for packages we have never seen
+    REQUIRE_FALSE(store.cloneResult(DataType::XML, "unknown/1.0/amd64", "unknown/1.1/amd64"));
+
+    // hints naming files of other packages can not be carried over, and nothing is written then
+    PackageHints foreignHints;
+    foreignHints.addHint("org.example.foobar", "pkg-empty-file", {{"pkg_fname", "icons_2.0_all.deb"}});
+    store.setHints("foobar/1.0-2/amd64", foreignHints);
+    REQUIRE_FALSE(store.cloneResult(DataType::XML, "foobar/1.0-2/amd64", "foobar/1.0-3/amd64"));
+    REQUIRE_FALSE(store.packageExists("foobar/1.0-3/amd64"));
+    REQUIRE(store.getGcidOwner(gcid) == "foobar/1.0-2/amd64");
+
+    // a component that belongs to a different package by now can not be taken along
+    std::string previousOwner;
+    REQUIRE(store.claimComponentOwnership(gcid, "foo/2.0/amd64", previousOwner, true));
+    REQUIRE_FALSE(store.cloneResult(DataType::XML, "foobar/1.0-2/amd64", "foobar/1.0-3/amd64"));
+    REQUIRE_FALSE(store.packageExists("foobar/1.0-3/amd64"));
+
+    // inputs records are dropped together with the package version they belong to
+    PackageInputs orphanedInputs;
+    orphanedInputs.pkid = "gone/1.0/amd64";
+    store.setPackageInputs(DataStore::packageInputsKey(orphanedInputs.pkid), orphanedInputs);
+    inputs.pkid = "foobar/1.0-2/amd64";
+    store.setPackageInputs(DataStore::packageInputsKey(inputs.pkid), inputs);
+    store.cleanupCruft();
+    REQUIRE_FALSE(store.getPackageInputs("gone/amd64").has_value());
+    REQUIRE(store.getPackageInputs("foobar/amd64").has_value());
+
+    store.removePackage("foobar/1.0-1/amd64");
+    REQUIRE(store.getPackageInputs("foobar/amd64").has_value());
+    store.removePackages({"foobar/1.0-2/amd64"});
+    REQUIRE_FALSE(store.getPackageInputs("foobar/amd64").has_value());
+
+    store.close();
+    fs::remove_all(tempDir);
+    fs::remove_all(mediaDir);
+}
+
+static std::string makeTestMetadata(std::size_t index)
+{
+    return std::format(
+        R"(<component type="desktop-application">
+  <id>org.example.app{0}</id>
+  <name>Example Application {0}</name>
+  <summary>Does example things, number {0}</summary>
+  <description>
+    <p>This is the example application number {0}. It is used to test the database.</p>
+  </description>
+  <launchable type="desktop-id">org.example.app{0}.desktop</launchable>
+  <pkgname>example-app{0}</pkgname>
+</component>)",
+        index);
+}
+
+TEST_CASE("Statistics time series", "[datastore]")
+{
+    auto tempDir = fs::temp_directory_path() / std::format("asgen-test-{}", Utils::randomString(8));
+    auto mediaDir = fs::temp_directory_path() / std::format("asgen-media-{}", Utils::randomString(8));
+    fs::create_directories(tempDir);
+    fs::create_directories(mediaDir);
+
+    DataStore store;
+    store.open(tempDir.string(), mediaDir.string());
+
+    // more points than fit into one chunk, for two sections that are recorded alternately
+    // start at a full hour, so we know where the downsampling intervals are
+    const std::time_t baseTime = 1699999200;
+    const std::size_t pointCount = StatisticsSeries::ChunkRows + 100;
+    for (std::size_t i = 0; i < pointCount; i++) {
+        StatisticsEntry entry;
+        entry.time = baseTime + static_cast<std::time_t>(i) * 60;
+        entry.data = {
+            {"suite",         std::string("sid")                                    },
+            {"section",       std::string(i % 2 == 0 ? "main" : "contrib")          },
+            {"totalErrors",   static_cast<std::int64_t>(i / 10)                     },
+            {"totalMetadata", static_cast<std::int64_t>(i % 2 == 0 ? 5000 : -3)     }
+        };
+        store.addStatistics(entry);
+    }
+
+    auto allStats = store.getStatistics();
+    REQUIRE(allStats.size() == pointCount);
+    REQUIRE(allStats.back().time == baseTime + static_cast<std::time_t>(pointCount - 1) * 60);
+    REQUIRE(std::get<std::string>(allStats[1].data.at("section")) == "contrib");
+    REQUIRE(std::get<std::int64_t>(allStats[1].data.at("totalMetadata")) == -3);
+    REQUIRE(std::get<std::int64_t>(allStats[600].data.at("totalErrors")) == 60);
+
+    // range queries
+    auto points = store.queryStatistics(baseTime + 60, baseTime + 180);
+    REQUIRE(points.size() == 3);
+    REQUIRE(points[0].section == "contrib");
+    REQUIRE(points[2].value("totalMetadata") == -3);
+    REQUIRE(points[2].value("doesNotExist", 42) == 42);
+
+    // one point per section and hour
+    points = store.queryStatistics(baseTime, baseTime + 3600 * 2 - 1, 3600);
+    REQUIRE(points.size() == 4);
+    for (const auto &point : points)
+        REQUIRE(point.time % 3600 >= 3600 - 120);
+
+    // reading only what was added
+    StatisticsCursor cursor;
+    REQUIRE(store.readStatistics(cursor).size() == pointCount);
+    REQUIRE(store.readStatistics(cursor).empty());
+
+    StatisticsEntry entry;
+    entry.time = baseTime;
+    entry.data = {
+        {"suite",         std::string("sid") },
+        {"section",       std::string("main")},
+        {"totalErrors",   std::int64_t(1000) },
+        {"totalMetadata", std::int64_t(5000) }
+    };
+    store.addStatistics(entry);
+    points = store.readStatistics(cursor);
+    REQUIRE(points.size() == 1);
+    // points are never older than the ones before them
+    REQUIRE(points[0].time == baseTime + static_cast<std::time_t>(pointCount - 1) * 60);
+
+    // compacting drops points that are followed by identical ones and restarts all readers
+    const auto oldGeneration = cursor.generation;
+    REQUIRE(store.compactStatistics() > 0);
+    points = store.readStatistics(cursor);
+    REQUIRE(cursor.generation != oldGeneration);
+    REQUIRE(points.size() == store.getStatistics().size());
+    REQUIRE(points.size() < pointCount + 1);
+    REQUIRE(points.back().value("totalErrors") == 1000);
+
+    store.close();
+    fs::remove_all(tempDir);
+    fs::remove_all(mediaDir);
+}
+
+TEST_CASE("Database value compression", "[datastore][contentsstore]")
+{
+    auto tempDir = fs::temp_directory_path() / std::format("asgen-test-{}", Utils::randomString(8));
+    auto mediaDir = fs::temp_directory_path() / std::format("asgen-media-{}", Utils::randomString(8));
+    fs::create_directories(tempDir / "main");
+    fs::create_directories(tempDir / "contents");
+    fs::create_directories(mediaDir);
+
+    SECTION("Value encoding")
+    {
+        ValueCompressor codec("test");
+
+        // short values are stored as they are
+        const auto shortValue = codec.encode("seen");
+        REQUIRE_FALSE(ValueCompressor::isCompressed(shortValue));
+        REQUIRE(shortValue == std::string("seen\0", 5));
+        REQUIRE(codec.decode(shortValue) == "seen");
+
+        const auto data = makeTestMetadata(1);
+        const auto encoded = codec.encode(data);
+        REQUIRE(ValueCompressor::isCompressed(encoded));
+        REQUIRE(encoded.size() < data.size());
+        REQUIRE(codec.decode(encoded) == data);
+
+        // values written before compression existed remain readable
+        REQUIRE(codec.decode(data + '\0') == data);
+        REQUIRE(codec.decode(std::string_view("\0", 1)).empty());
+    }
+
+    SECTION("Dictionary rebuild")
+    {
+        const std::size_t count = 2000;
+        {
+            DataStore dstore;
+            dstore.open((tempDir / "main").string(), mediaDir);
+            for (std::size_t i = 0; i < count; i++)
+                dstore.setMetadata(DataType::XML, std::format("org.example.app{}/abc", i), makeTestMetadata(i));
+            dstore.setHints("foobar/1.0/amd64", R"({"hints": {}})");
+
+            REQUIRE_NOTHROW(dstore.rebuildCompressionDictionaries());
+            REQUIRE(dstore.getMetadata(DataType::XML, "org.example.app42/abc") == makeTestMetadata(42));
+            dstore.setMetadata(DataType::XML, "org.example.new/abc", makeTestMetadata(count));
+            dstore.close();
+
+            ContentsStore cstore;
+            cstore.open((tempDir / "contents").string());
+            for (std::size_t i = 0; i < count; i++)
+                cstore.addContents(
+                    std::format("app{}/1.0/amd64", i),
+                    {std::format("/usr/bin/app{}", i),
+                     std::format("/usr/share/applications/org.example.app{}.desktop", i),
+                     std::format("/usr/share/icons/hicolor/64x64/apps/org.example.app{}.png", i),
+                     std::format("/usr/share/doc/app{}/copyright", i)});
+            REQUIRE_NOTHROW(cstore.rebuildCompressionDictionaries());
+            cstore.close();
+        }
+
+        // the dictionaries are loaded again when the databases are reopened
+        DataStore dstore;
+        dstore.open((tempDir / "main").string(), mediaDir);
+        REQUIRE(dstore.getMetadata(DataType::XML, "org.example.app0/abc") == makeTestMetadata(0));
+        REQUIRE(dstore.getMetadata(DataType::XML, "org.example.new/abc") == makeTestMetadata(count));
+        REQUIRE(dstore.getHints("foobar/1.0/amd64") == R"({"hints": {}})");
+        {
+            const auto snapshot = dstore.readSnapshot();
+            const auto first = snapshot.metadata(DataType::XML, "org.example.app1/abc");
+            const auto second = snapshot.metadata(DataType::XML, "org.example.app2/abc");
+            REQUIRE(first == makeTestMetadata(1));
+            REQUIRE(second == makeTestMetadata(2));
+        }
+        dstore.close();
+
+        ContentsStore cstore;
+        cstore.open((tempDir / "contents").string());
+        REQUIRE(cstore.getContents("app7/1.0/amd64").size() == 4);
+        REQUIRE(
+            cstore.getIcons("app7/1.0/amd64")
+            == std::vector<std::string>{"/usr/share/icons/hicolor/64x64/apps/org.example.app7.png"});
+        const auto iconMap = cstore.getIconFilesMap({"app1/1.0/amd64", "app2/1.0/amd64"});
+        REQUIRE(iconMap.size() == 2);
+        cstore.close();
+    }
+
+    fs::remove_all(tempDir);
+    fs::remove_all(mediaDir);
+}
+
+TEST_CASE("Database lookup benchmark", "[.][benchmark][datastore]")
+{
+    auto mediaDir = fs::temp_directory_path() / std::format("asgen-media-{}", Utils::randomString(8));
+    fs::create_directories(mediaDir);
+
+    for (const std::size_t count : {1000, 10000, 100000}) {
+        auto dbDir = fs::temp_directory_path() / std::format("asgen-bench-{}", Utils::randomString(8));
+        fs::create_directories(dbDir);
+
+        DataStore store;
+        store.open(dbDir.string(), mediaDir);
+        for (std::size_t i = 0; i < count; i++)
+            store.setMetadata(DataType::XML, std::format("org.example.app{}/abc", i), makeTestMetadata(i));
+
+        std::size_t lookup = 0;
+        BENCHMARK(std::format("lookup, {} values, no dictionary", count))
+        {
+            return store.getMetadata(DataType::XML, std::format("org.example.app{}/abc", lookup++ % count));
+        };
+
+        store.rebuildCompressionDictionaries();
+        BENCHMARK(std::format("lookup, {} values, trained dictionary", count))
+        {
+            return store.getMetadata(DataType::XML, std::format("org.example.app{}/abc", lookup++ % count));
+        };
+        store.close();
+
+        // LMDB does not shrink its data file, so copy it compacted to see the actual size
+        auto compactDir = dbDir / "compact";
+        fs::create_directories(compactDir);
+        MDB_env *env;
+        mdb_env_create(&env);
+        mdb_env_set_maxdbs(env, 16);
+        mdb_env_open(env, dbDir.c_str(), MDB_RDONLY, 0755);
+        mdb_env_copy2(env, compactDir.c_str(), MDB_CP_COMPACT);
+        mdb_env_close(env);
+        WARN(
+            std::format(
+                "{} values: {} bytes of metadata, compacted database with dictionary is {} bytes",
+                count,
+                count * makeTestMetadata(count).size(),
+                fs::file_size(compactDir / "data.mdb")));
+
+        fs::remove_all(dbDir);
+    }
+
+    fs::remove_all(mediaDir);
+}
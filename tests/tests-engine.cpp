@@ -7,11 +7,17 @@
 #include <catch2/catch_all.hpp>
 
 #include <filesystem>
+#include <fstream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
 
 #include "utils.h"
 #include "config.h"
 #include "engine.h"
+#include "zarchive.h"
+#include "bench-archivegen.h"
 
 using namespace ASGenerator;
 
@@ -68,3 +74,143 @@ TEST_CASE("Engine package info functionality", "[engine]")
 
     fs::remove_all(tempDir);
 }
+
+/**
+ * Names of the files in the icon tarball @fname.
+ */
+static std::vector<std::string> iconTarballContents(const fs::path &fname)
+{
+    ArchiveDecompressor ad;
+    ad.open(fname.string());
+    return ad.readContents();
+}
+
+TEST_CASE("Engine icon tarball export", "[engine][integration]")
+{
+    const auto tempDir = fs::temp_directory_path() / std::format("asgen-test-{}", Utils::randomString(8));
+    fs::create_directories(tempDir / "workspace");
+
+    SyntheticArchiveSpec spec;
+    spec.suite = "sid";
+    spec.packages = 12;
+    spec.desktopAppShare = 0.5;
+    spec.iconThemeShare = 0;
+    spec.fontShare = 0;
+    spec.largePayloadShare = 0;
+    spec.localizedShare = 0;
+    const auto stats = generateSyntheticArchive(tempDir / "archive", spec);
+    REQUIRE(stats.desktopApps > 0);
+
+    {
+        std::ofstream f(tempDir / "asgen-config.json");
+        f << std::format(
+            R"({{"ProjectName": "Test", "ArchiveRoot": "{}", "MediaBaseUrl": "https://example.org/media", )"
+            R"("HtmlBaseUrl": "https://example.org/html", "Backend": "debian", "Suites": {{"sid": {{"sections": ["main"], "architectures": ["amd64"]}}}}}})",
+            (tempDir / "archive").string());
+    }
+    auto &config = Config::get();
+    config.loadFromFile((tempDir / "asgen-config.json").string(), (tempDir / "workspace").string());
+    config.feature.zstdIconTarballs = true;
+
+    const auto exportDir = config.dataExportDir / "sid" / "main";
+    const auto tarballFname = exportDir / "icons-64x64.tar.gz";
+    const auto zstdTarballFname = exportDir / "icons-64x64.tar.zst";
+    const auto noPendingTarballs = [&]() {
+        for (const auto &entry : fs::directory_iterator(exportDir)) {
+            if (entry.path().extension() == ".new")
+                return false;
+        }
+        return true;
+    };
+
+    Engine engine;
+    engine.run("sid");
+    REQUIRE(fs::exists(tarballFname));
+    REQUIRE(fs::exists(zstdTarballFname));
+    REQUIRE(fs::exists(config.cacheRootDir() / "icon-tarballs" / "sid" / "main" / "icons-64x64.manifest"));
+    REQUIRE(noPendingTarballs());
+
+    const auto tarballContents = iconTarballContents(tarballFname);
+    REQUIRE(tarballContents.size() == stats.desktopApps);
+    REQUIRE(iconTarballContents(zstdTarballFname) == tarballContents);
+
+    // the cached 64x64 icons of the suite
+    std::vector<fs::path> icons;
+    for (const auto &entry : fs::recursive_directory_iterator(config.mediaExportDir / "sid")) {
+        if (entry.is_regular_file() && entry.path().parent_path().filename() == "64x64")
+            icons.push_back(entry.path());
+    }
+    std::sort(icons.begin(), icons.end());
+    REQUIRE(icons.size() == tarballContents.size());
+
+    SECTION("Tarballs are kept if no icon changed")
+    {
+        const auto mtime = fs::last_write_time(tarballFname);
+        const auto zstdMtime = fs::last_write_time(zstdTarballFname);
+
+        engine.publish("sid");
+        REQUIRE(fs::last_write_time(tarballFname) == mtime);
+        REQUIRE(fs::last_write_time(zstdTarballFname) == zstdMtime);
+        REQUIRE(iconTarballContents(tarballFname) == tarballContents);
+    }
+
+    SECTION("Tarballs are rebuilt if the size of an icon changed")
+    {
+        const auto mtime = fs::last_write_time(tarballFname);
+        {
+            std::ofstream f(icons[0], std::ios::app | std::ios::binary);
+            f << "modified";
+        }
+
+        engine.publish("sid");
+        REQUIRE(fs::last_write_time(tarballFname) != mtime);
+        REQUIRE(iconTarballContents(tarballFname) == tarballContents);
+        REQUIRE(noPendingTarballs());
+    }
+
+    SECTION("Tarballs are rebuilt if the modification time of an icon changed")
+    {
+        const auto mtime = fs::last_write_time(tarballFname);
+        fs::last_write_time(icons[0], fs::last_write_time(icons[0]) + std::chrono::seconds(10));
+
+        engine.publish("sid");
+        REQUIRE(fs::last_write_time(tarballFname) != mtime);
+        REQUIRE(noPendingTarballs());
+    }
+
+    SECTION("Missing tarballs are rebuilt")
+    {
+        const auto zstdMtime = fs::last_write_time(zstdTarballFname);
+        fs::remove(tarballFname);
+
+        engine.publish("sid");
+        REQUIRE(iconTarballContents(tarballFname) == tarballContents);
+        REQUIRE(fs::last_write_time(zstdTarballFname) != zstdMtime);
+        REQUIRE(noPendingTarballs());
+    }
+
+    SECTION("Icons that are not named like in the summary are found")
+    {
+        // the component summary knows the icon by its old name, so we have to list the directory
+        const auto renamedIcon = icons[0].parent_path() / ("renamed-" + icons[0].filename().string());
+        fs::rename(icons[0], renamedIcon);
+
+        engine.publish("sid");
+        const auto contents = iconTarballContents(tarballFname);
+        REQUIRE(contents.size() == tarballContents.size());
+        REQUIRE(std::ranges::find(contents, "/" + renamedIcon.filename().string()) != contents.end());
+        REQUIRE(std::ranges::find(contents, "/" + icons[0].filename().string()) == contents.end());
+    }
+
+    SECTION("Zstandard tarballs are removed once they are disabled")
+    {
+        const auto mtime = fs::last_write_time(tarballFname);
+        config.feature.zstdIconTarballs = false;
+
+        engine.publish("sid");
+        REQUIRE_FALSE(fs::exists(zstdTarballFname));
+        REQUIRE(fs::last_write_time(tarballFname) == mtime);
+    }
+
+    fs::remove_all(tempDir);
+}
@@ -18,6 +18,7 @@
 
 #include "utils.h"
 #include "iconhandler.h"
+#include "iconrendercache.h"
 
 using namespace ASGenerator;
 
@@ -107,3 +108,53 @@ TEST_CASE("Theme parsing", "[Theme]")
     REQUIRE(found16x16Match);
     REQUIRE(found48x48Match);
 }
+
+TEST_CASE("Icon render cache", "[IconHandler][cache]")
+{
+    auto tempDir = fs::temp_directory_path() / std::format("asgen-test-{}", Utils::randomString(8));
+    fs::create_directories(tempDir / "out");
+
+    IconRenderCache cache(tempDir / "cache");
+    const std::vector<std::uint8_t> iconData = {'a', 's', 'g', 'e', 'n'};
+    const auto key = IconRenderCache::makeKey(iconData, ImageSize(64), ASC_IMAGE_FORMAT_PNG, false);
+
+    // different sizes and formats must never share an entry
+    REQUIRE(key != IconRenderCache::makeKey(iconData, ImageSize(128), ASC_IMAGE_FORMAT_PNG, false));
+    REQUIRE(key != IconRenderCache::makeKey(iconData, ImageSize(64), ASC_IMAGE_FORMAT_JXL, false));
+
+    // nothing is cached yet
+    REQUIRE_FALSE(cache.fetch(key, tempDir / "out" / "first.png").has_value());
+    REQUIRE(cache.misses() == 1);
+
+    // add a rendered icon
+    const auto renderedFile = tempDir / "rendered.png";
+    {
+        std::ofstream f(renderedFile);
+        f << "rendered-icon";
+    }
+    cache.store(key, renderedFile, {.srcWidth = 48, .srcHeight = 48, .skipped = false});
+
+    const auto destFile = tempDir / "out" / "second.png";
+    auto entry = cache.fetch(key, destFile);
+    REQUIRE(entry.has_value());
+    REQUIRE(entry->srcWidth == 48);
+    REQUIRE(entry->srcHeight == 48);
+    REQUIRE_FALSE(entry->skipped);
+    REQUIRE(fs::exists(destFile));
+    REQUIRE(fs::file_size(destFile) == fs::file_size(renderedFile));
+    REQUIRE(cache.hits() == 1);
+
+    // skipped renders are cached too, without any image data
+    const auto smallKey = IconRenderCache::makeKey(iconData, ImageSize(128), ASC_IMAGE_FORMAT_PNG, false);
+    cache.store(smallKey, {}, {.srcWidth = 16, .srcHeight = 16, .skipped = true});
+    entry = cache.fetch(smallKey, tempDir / "out" / "third.png");
+    REQUIRE(entry.has_value());
+    REQUIRE(entry->skipped);
+    REQUIRE_FALSE(fs::exists(tempDir / "out" / "third.png"));
+
+    // recently used entries survive pruning
+    cache.prune(std::chrono::hours(1));
+    REQUIRE(cache.fetch(key, tempDir / "out" / "fourth.png").has_value());
+
+    fs::remove_all(tempDir);
+}
@@ -7,19 +7,28 @@
 #include <catch2/catch_all.hpp>
 
 #include <fstream>
+#include <format>
+#include <set>
 #include <filesystem>
 #include <optional>
+#include <atomic>
 #include <thread>
+#include <unistd.h>
 #include <appstream-compose.h>
 #include <archive.h>
 #include <archive_entry.h>
+#include <nlohmann/json.hpp>
 
 #include "utils.h"
 #include "zarchive.h"
 #include "hintregistry.h"
 #include "result.h"
+#include "instrumentation.h"
+#include "metrics.h"
 #include "backends/dummy/dummypkg.h"
 #include "cptmodifiers.h"
+#include "stringpool.h"
+#include "resourcegovernor.h"
 
 using namespace ASGenerator;
 using namespace ASGenerator::Utils;
@@ -233,9 +242,103 @@ TEST_CASE("Reading data from tarball using readData", "[zarchive]")
         REQUIRE_THROWS_AS(ar.readData("non/existent/file"), std::runtime_error);
     }
 
+    SECTION("Read multiple files in one batch")
+    {
+        const auto batch = ar.readDataBatch({"b/a", "/c/d", "e/f", "non/existent/file"});
+        REQUIRE(batch.size() == 3);
+        REQUIRE(batch.at("b/a") == ar.readData("b/a"));
+        REQUIRE(batch.at("/c/d") == ar.readData("c/d"));
+
+        // the hardlink resolves to the data of its target
+        REQUIRE(!batch.at("e/f").empty());
+        REQUIRE(batch.at("e/f") == ar.readData("e/f"));
+    }
+
     ar.close();
 }
 
+TEST_CASE("Seekable archive index", "[zarchive]")
+{
+    const auto sampleTar = getTestSamplesDir() / "test.tar.xz";
+    const auto tmpDir = fs::temp_directory_path() / std::format("asgen-index-{}", getpid());
+    fs::create_directories(tmpDir);
+
+    // the sample is an uncompressed tarball, so we also index compressed copies of it
+    const auto tarData = Utils::getFileContents(sampleTar);
+    const auto gzipTar = tmpDir / "test.tar.gz";
+    const auto xzTar = tmpDir / "test.tar.xz";
+    const auto zstdTar = tmpDir / "test.tar.zst";
+    compressAndSave(tarData, gzipTar, ArchiveType::GZIP);
+    compressAndSave(tarData, xzTar, ArchiveType::XZ);
+    compressAndSave(tarData, zstdTar, ArchiveType::ZSTD);
+
+    for (const auto &archive : {sampleTar, gzipTar, xzTar, zstdTar}) {
+        auto index = ArchiveIndex::build(archive);
+        REQUIRE(index != nullptr);
+        REQUIRE(index->entryCount() == 4);
+
+        auto data = index->readFile("b/a");
+        REQUIRE(data.has_value());
+        REQUIRE(std::string(data->begin(), data->end()) == "hello\n");
+        data = index->readFile("/c/d");
+        REQUIRE(data.has_value());
+        REQUIRE(std::string(data->begin(), data->end()) == "world\n");
+        REQUIRE(!index->readFile("non/existent/file").has_value());
+
+        // hardlinks resolve to the data of their target
+        data = index->readFile("e/f");
+        REQUIRE(data.has_value());
+        REQUIRE(data == index->readFile("test.txt"));
+
+        const auto indexFname = tmpDir / "test.idx";
+        index->save(indexFname);
+        auto loaded = ArchiveIndex::load(indexFname, archive);
+        REQUIRE(loaded != nullptr);
+        REQUIRE(loaded->entryCount() == index->entryCount());
+        REQUIRE(loaded->checkpointCount() == index->checkpointCount());
+        REQUIRE(loaded->readFile("./b/a") == index->readFile("b/a"));
+
+        // an index is never used for a different archive
+        REQUIRE(ArchiveIndex::load(indexFname, archive == sampleTar ? gzipTar : sampleTar) == nullptr);
+    }
+
+    fs::remove_all(tmpDir);
+}
+
+TEST_CASE("Package contents index", "[backends]")
+{
+    const std::vector<std::string> contents = {
+        "/usr/share/icons/hicolor/64x64/apps/foo.png",
+        "/usr/bin/foo",
+        "/usr/share/applications/org.example.Foo.desktop",
+        "/usr/share/icons/hicolor/48x48/apps/foo.png",
+        "/usr/share/applications-extra/readme",
+    };
+    ContentsIndex index(contents);
+
+    REQUIRE(index.contains("/usr/bin/foo"));
+    REQUIRE(index.contains("/usr/share/icons/hicolor/48x48/apps/foo.png"));
+    REQUIRE(!index.contains("/usr/bin"));
+    REQUIRE(!index.contains("/usr/bin/foobar"));
+
+    REQUIRE(index.containsPrefix("/usr/share/applications/"));
+    REQUIRE(index.containsPrefix("/usr/share/icons/hicolor/"));
+    REQUIRE(!index.containsPrefix("/usr/lib/"));
+    REQUIRE(!index.containsPrefix("/usr/share/icons/Adwaita/"));
+
+    const auto icons = index.filesWithPrefix("/usr/share/icons/");
+    REQUIRE(icons.size() == 2);
+    REQUIRE(icons[0] == "/usr/share/icons/hicolor/48x48/apps/foo.png");
+    REQUIRE(icons[1] == "/usr/share/icons/hicolor/64x64/apps/foo.png");
+    REQUIRE(index.filesWithPrefix("/usr/share/applications/").size() == 1);
+
+    // the index keeps its own copy of the list
+    auto listCopy = std::make_unique<std::vector<std::string>>(contents);
+    ContentsIndex ownIndex(*listCopy);
+    listCopy.reset();
+    REQUIRE(ownIndex.contains("/usr/bin/foo"));
+}
+
 TEST_CASE("Utils: getCidFromGlobalID", "[utils]")
 {
     REQUIRE(getCidFromGlobalID("f/fo/foobar.desktop/DEADBEEF").value() == "foobar.desktop");
@@ -268,6 +371,45 @@ TEST_CASE("Utils: getTextFileContents and getFileContents read file data", "[uti
     fs::remove(tmpfile);
 }
 
+TEST_CASE("Utils: bytesFromVector takes over the data", "[utils]")
+{
+    std::vector<std::uint8_t> data = {'a', 's', 'g', 'e', 'n'};
+    const auto *dataPtr = data.data();
+
+    g_autoptr(GBytes) bytes = bytesFromVector(std::move(data));
+    gsize size = 0;
+    REQUIRE(g_bytes_get_data(bytes, &size) == dataPtr);
+    REQUIRE(size == 5);
+}
+
+TEST_CASE("Utils: cloneDir places files as requested", "[utils]")
+{
+    const auto tmpDir = fs::temp_directory_path() / std::format("asgen-clonetest-{}", randomString(8));
+    const auto srcDir = tmpDir / "src";
+    fs::create_directories(srcDir / "icons" / "64x64");
+    {
+        std::ofstream f(srcDir / "icons" / "64x64" / "foo.png");
+        f << "not really an image";
+    }
+    fs::create_symlink("foo.png", srcDir / "icons" / "64x64" / "bar.png");
+
+    for (const auto mode : {FileCloneMode::HARDLINK, FileCloneMode::REFLINK, FileCloneMode::COPY}) {
+        const auto destDir = tmpDir / "dest";
+        fs::remove_all(destDir);
+
+        cloneDir(srcDir, destDir, mode);
+        // a second run keeps what is there already
+        REQUIRE_NOTHROW(cloneDir(srcDir, destDir, mode));
+
+        const auto destFile = destDir / "icons" / "64x64" / "foo.png";
+        REQUIRE(getFileContents(destFile.string()).size() == 19);
+        REQUIRE(fs::is_symlink(destDir / "icons" / "64x64" / "bar.png"));
+        REQUIRE(fs::hard_link_count(destFile) == (mode == FileCloneMode::HARDLINK ? 2 : 1));
+    }
+
+    fs::remove_all(tmpDir);
+}
+
 TEST_CASE("Utils: normalizePath", "[utils]")
 {
     REQUIRE(normalizePath("/usr") == "/usr");
@@ -276,6 +418,64 @@ TEST_CASE("Utils: normalizePath", "[utils]")
     REQUIRE(normalizePath("/usr/test/..//") == "/usr");
 }
 
+TEST_CASE("StringPool interns strings", "[utils]")
+{
+    StringPool pool(64);
+
+    const std::string version = "1.2.3-1";
+    const auto first = pool.intern(version);
+    REQUIRE(first == version);
+    REQUIRE(first.data() != version.data());
+    REQUIRE(pool.intern(std::string("1.2.3-1")).data() == first.data());
+    REQUIRE(pool.intern("").empty());
+
+    // strings that do not fit into a block are stored as well
+    const std::string longText(200, 'x');
+    REQUIRE(pool.intern(longText) == longText);
+    REQUIRE(pool.intern("amd64") == "amd64");
+
+    REQUIRE(pool.size() == 3);
+    REQUIRE(pool.intern(version).data() == first.data());
+}
+
+TEST_CASE("ResourceGovernor admits packages within its limits", "[utils]")
+{
+    ResourceGovernor governor(100, 0);
+
+    // a package is admitted on its own, even if it needs more than allowed
+    {
+        auto big = governor.reserve({500, 0});
+        REQUIRE(governor.stats().reserved.memory == 500);
+    }
+    REQUIRE(governor.stats().reserved.memory == 0);
+
+    auto first = std::make_optional(governor.reserve({60, 10}));
+    std::atomic_bool admitted = false;
+    std::thread worker([&]() {
+        auto second = governor.reserve({60, 10});
+        admitted = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    REQUIRE_FALSE(admitted);
+
+    first.reset();
+    worker.join();
+    REQUIRE(admitted);
+
+    const auto stats = governor.stats();
+    REQUIRE(stats.waits == 1);
+    REQUIRE(stats.peak.memory == 500);
+    REQUIRE(stats.reserved.memory == 0);
+    REQUIRE(stats.reserved.disk == 0);
+
+    // we learn from the disk space a package actually used
+    DummyPackage pkg("foobar", "1.0", "amd64");
+    const auto estimate = governor.processEstimate(pkg);
+    governor.recordDiskUsage("foobar", estimate.disk * 2);
+    REQUIRE(governor.processEstimate(pkg).disk == estimate.disk * 2);
+}
+
 TEST_CASE("Selectively reading tarball", "[zarchive]")
 {
     std::string archive = fs::path(getTestSamplesDir()) / "test.tar.xz";
@@ -576,6 +776,52 @@ TEST_CASE("GeneratorResult functionality", "[result]")
         REQUIRE(jsonStr.find("desktop-entry-hidden-set") != std::string::npos);
     }
 
+    SECTION("Binary hints records")
+    {
+        GeneratorResult result(pkg);
+        result.addHint("org.freedesktop.foobar.desktop", "metainfo-validation-error", "Quote \" and\nnewline\x01");
+        result.addHint(
+            "org.freedesktop.foobar.desktop",
+            "desktop-entry-hidden-set",
+            {
+                {"storage", "towel"}
+        });
+        result.addHint("org.freedesktop.awesome-bar.desktop", "metainfo-validation-error", "Add chocolate.");
+
+        // the record is read back losslessly, and generates the same JSON document as before
+        const auto hints = result.hints();
+        const auto data = hints.encode();
+        REQUIRE(PackageHints::isEncoded(data));
+        const auto decoded = PackageHints::decode(data);
+        REQUIRE(decoded.components.size() == 2);
+        REQUIRE(decoded.toJson(result.pkid()) == result.hintsToJson());
+        const auto jsonDoc = nlohmann::ordered_json::parse(result.hintsToJson());
+        REQUIRE(jsonDoc["package"] == "foobar/1.0.0/amd64");
+        REQUIRE(jsonDoc.dump() == result.hintsToJson());
+
+        // every tag is stored only once
+        REQUIRE(data.size() < result.hintsToJson().size());
+        std::size_t tagCount = 0;
+        for (auto pos = data.find("metainfo-validation-error"); pos != std::string::npos;
+             pos = data.find("metainfo-validation-error", pos + 1))
+            tagCount++;
+        REQUIRE(tagCount == 1);
+
+        // JSON documents of older versions remain readable
+        const auto legacy = PackageHints::decode(result.hintsToJson());
+        REQUIRE_FALSE(PackageHints::isEncoded(result.hintsToJson()));
+        REQUIRE(legacy.encode() == data);
+
+        // duplicate tags are not added twice
+        auto updated = decoded;
+        REQUIRE_FALSE(updated.addHint("org.freedesktop.foobar.desktop", "desktop-entry-hidden-set"));
+        REQUIRE(updated.addHint("org.freedesktop.new.desktop", "metainfo-duplicate-id", {{"cid", "new"}}));
+        REQUIRE(updated.components.size() == 3);
+
+        REQUIRE_THROWS(PackageHints::decode(data.substr(0, data.size() - 3)));
+        REQUIRE_THROWS(PackageHints::decode(R"({"package": "foobar/1.0.0/amd64"})"));
+    }
+
     SECTION("Move semantics")
     {
         GeneratorResult result1(pkg);
@@ -671,3 +917,121 @@ TEST_CASE("Utils: UTF-8 sanitization", "[utils]")
         REQUIRE(sanitized == input); // Should preserve emoji characters
     }
 }
+
+TEST_CASE("Run instrumentation", "[instrumentation]")
+{
+    auto &instr = Instrumentation::get();
+    instr.reset();
+
+    instr.setScope("sid", "main", "amd64");
+    {
+        ScopedTimer outer(PerfStage::ArchiveExtract);
+        // nested timers of the same stage are not counted twice
+        ScopedTimer inner(PerfStage::ArchiveExtract);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    instr.count(PerfCounter::PackagesProcessed, 3);
+
+    instr.setScope("sid", "main", "arm64");
+    {
+        ScopedTimer timer(PerfStage::ArchiveExtract);
+    }
+    instr.count(PerfCounter::PackagesProcessed);
+
+    // work on the whole section, and elsewhere
+    instr.setScope("sid", "main");
+    {
+        ScopedTimer timer(PerfStage::IconTarballs);
+    }
+    instr.setScope("sid", "contrib", "amd64");
+    instr.count(PerfCounter::PackagesProcessed, 10);
+
+    const auto summaries = instr.summaries();
+    REQUIRE(summaries.size() == 4);
+    REQUIRE(summaries[0].arch == "amd64");
+    REQUIRE(summaries[0].stages[static_cast<std::size_t>(PerfStage::ArchiveExtract)].calls == 1);
+    REQUIRE(summaries[0].stages[static_cast<std::size_t>(PerfStage::ArchiveExtract)].total >= std::chrono::milliseconds(2));
+
+    const auto section = instr.sectionSummary("sid", "main");
+    REQUIRE(section.stages[static_cast<std::size_t>(PerfStage::ArchiveExtract)].calls == 2);
+    REQUIRE(section.stages[static_cast<std::size_t>(PerfStage::IconTarballs)].calls == 1);
+    REQUIRE(section.counters[static_cast<std::size_t>(PerfCounter::PackagesProcessed)] == 4);
+
+    REQUIRE_FALSE(instr.summaryTable().empty());
+    const auto jsonDoc = instr.toJson();
+    REQUIRE(jsonDoc["scopes"].size() == 4);
+    REQUIRE(jsonDoc["scopes"][3]["counters"]["packagesProcessed"] == 10);
+
+    instr.reset();
+    REQUIRE(instr.summaries().empty());
+}
+
+TEST_CASE("Trace recording", "[instrumentation]")
+{
+    const auto traceFname = fs::temp_directory_path() / std::format("asgen-trace-{}.json", getpid());
+    auto &trace = TraceRecorder::get();
+    trace.start();
+
+    {
+        TraceSpan span("package", "foobar/1.0/amd64");
+        ScopedTimer timer(PerfStage::Compose);
+    }
+    std::thread worker([]() {
+        TraceSpan span("package", "\"quoted\"/1.0/amd64");
+        ScopedTimer timer(PerfStage::DbCommit);
+    });
+    worker.join();
+
+    trace.write(traceFname);
+    std::ifstream f(traceFname);
+    const auto doc = nlohmann::json::parse(f);
+    fs::remove(traceFname);
+
+    std::set<std::string> names;
+    std::set<int> threads;
+    for (const auto &event : doc["traceEvents"]) {
+        if (event["ph"] != "X")
+            continue;
+        names.insert(event["name"].get<std::string>());
+        threads.insert(event["tid"].get<int>());
+        REQUIRE(event["dur"].get<std::int64_t>() >= 0);
+    }
+    REQUIRE(names.contains("foobar/1.0/amd64"));
+    REQUIRE(names.contains("\"quoted\"/1.0/amd64"));
+    REQUIRE(names.contains("compose"));
+    REQUIRE(names.contains("dbCommit"));
+    REQUIRE(threads.size() >= 2);
+}
+
+TEST_CASE("OpenMetrics rendering", "[instrumentation]")
+{
+    MetricFamily hints{"asgen_hints", "gauge", "Number of issue hints.", {}, {}};
+    hints.add(4, {{"suite", "sid"}, {"severity", "error"}});
+    hints.add(0.5, {{"suite", "with \"quotes\"\\"}, {"severity", "info"}});
+    MetricFamily info{"asgen_build", "info", {}, {}, {}};
+    info.add(1, {{"version", "1.0"}});
+    MetricFamily duration{"asgen_last_run_duration_seconds", "gauge", "Run time.", "seconds", {}};
+    duration.add(12);
+
+    const auto text = renderOpenMetrics({hints, info, duration});
+    REQUIRE(
+        text
+        == "# TYPE asgen_hints gauge\n"
+           "# HELP asgen_hints Number of issue hints.\n"
+           "asgen_hints{suite=\"sid\",severity=\"error\"} 4\n"
+           "asgen_hints{suite=\"with \\\"quotes\\\"\\\\\",severity=\"info\"} 0.5\n"
+           "# TYPE asgen_build info\n"
+           "asgen_build_info{version=\"1.0\"} 1\n"
+           "# TYPE asgen_last_run_duration_seconds gauge\n"
+           "# UNIT asgen_last_run_duration_seconds seconds\n"
+           "# HELP asgen_last_run_duration_seconds Run time.\n"
+           "asgen_last_run_duration_seconds 12\n"
+           "# EOF\n");
+
+    const auto fname = fs::temp_directory_path() / std::format("asgen-metrics-{}.prom", getpid());
+    writeOpenMetricsFile(fname, {duration});
+    std::ifstream f(fname);
+    const std::string written((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    REQUIRE(written == renderOpenMetrics({duration}));
+    fs::remove(fname);
+}
@@ -434,6 +434,53 @@ TEST_CASE_METHOD(ReportGeneratorTestFixture, "ReportGenerator render pages with
         REQUIRE(content.find("warnings") != std::string::npos); // From the template
     }
 
+    SECTION("Only changed pages are rendered again")
+    {
+        ReportGenerator::DataSummary dsum;
+
+        ReportGenerator::HintEntry hentry;
+        hentry.identifier = "test.component.1";
+        hentry.archs = {"amd64"};
+        hentry.errors = {
+            {"error-tag", "Error message"}
+        };
+        dsum.hintEntries["testpkg1"]["test.component.1"] = hentry;
+
+        hentry.identifier = "test.component.2";
+        dsum.hintEntries["testpkg2"]["test.component.2"] = hentry;
+
+        REQUIRE_NOTHROW(m_reportGen->renderPagesFor("testsuite", "main", dsum));
+
+        auto issuesDir = m_htmlDir / "testsuite" / "main" / "issues";
+        auto page1 = issuesDir / "testpkg1.html";
+        auto page2 = issuesDir / "testpkg2.html";
+        REQUIRE(fs::exists(page1));
+        REQUIRE(fs::exists(page2));
+
+        // mark the pages, so we can tell whether they were written again
+        const auto oldTime = fs::file_time_type::clock::now() - std::chrono::hours(1);
+        fs::last_write_time(page1, oldTime);
+        fs::last_write_time(page2, oldTime);
+
+        // change one package, and drop the other one
+        dsum.hintEntries.erase("testpkg2");
+        dsum.hintEntries["testpkg1"]["test.component.1"].warnings = {
+            {"warning-tag", "Warning message"}
+        };
+        hentry.identifier = "test.component.3";
+        dsum.hintEntries["testpkg3"]["test.component.3"] = hentry;
+
+        REQUIRE_NOTHROW(m_reportGen->renderPagesFor("testsuite", "main", dsum));
+        REQUIRE(fs::last_write_time(page1) != oldTime);
+        REQUIRE(!fs::exists(page2));
+        REQUIRE(fs::exists(issuesDir / "testpkg3.html"));
+
+        // nothing changed, nothing is written
+        fs::last_write_time(page1, oldTime);
+        REQUIRE_NOTHROW(m_reportGen->renderPagesFor("testsuite", "main", dsum));
+        REQUIRE(fs::last_write_time(page1) == oldTime);
+    }
+
     SECTION("Update index pages")
     {
         REQUIRE_NOTHROW(m_reportGen->updateIndexPages());